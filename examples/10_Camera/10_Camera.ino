@@ -115,6 +115,7 @@ R4A_WEB_SERVER webServer =
     webServerConfigUpdate,          // _configUpdate
     webServerRegisterErrorHandlers, // _registerErrorHandlers
     webServerRegisterUriHandlers,   // _registerUriHandlers
+    r4aWebServerUploadReloadParameters, // _uploadComplete
     80,         // _port
     nullptr,    // _webServer
 };
@@ -67,6 +67,8 @@ const R4A_MENU_ENTRY debugMenuTable[] =
     {"l",   r4aEsp32MenuLedCDisplaySummary, 0,              nullptr,    0,      "Display the LED controller registers"},
     {"p",    r4aEsp32MenuDisplayPartitions, 0,              nullptr,    0,      "Display the partitions"},
     {"s",       nullptr,                    MTI_SERVO,      nullptr,    0,      "Servo menu"},
+    {"ss",      r4aOv2640MenuStreamStats,   0,              nullptr,    0,      "Display the camera stream statistics"},
+    {"st",      r4aOv2640MenuTiming,        0,              nullptr,    0,      "Display the camera image timing"},
     {"x",       nullptr,                    R4A_MENU_MAIN,  nullptr,    0,      "Return to the main menu"},
 };
 #define DEBUG_MENU_ENTRIES      sizeof(debugMenuTable) / sizeof(debugMenuTable[0])
@@ -20,6 +20,18 @@ const httpd_uri_t ov2640JpegPage =
     .supported_subprotocol = nullptr,
 };
 
+// URI handler structure for GET /stream
+const httpd_uri_t ov2640StreamPage =
+{
+    .uri      = "/stream",
+    .method   = HTTP_GET,
+    .handler  = r4aOv2640StreamHandler,
+    .user_ctx = (void *)ov2640ProcessWebServerFrameBuffer,
+    .is_websocket = true,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = nullptr,
+};
+
 //*********************************************************************
 // Process the web server's frame buffer
 // Inputs:
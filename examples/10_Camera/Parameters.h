@@ -59,7 +59,9 @@ const R4A_ESP32_NVM_PARAMETER nvmParameters[] =
 // Required    Type                  Minimum     Maximum        Address                     Name            Default Value
     {true,  R4A_ESP32_NVM_PT_BOOL,   0,          1,             &webServerDebug,            "WebDebug",     false},
     {true,  R4A_ESP32_NVM_PT_BOOL,   0,          1,             &r4aWebServerEnable,        "WebServer",    false},
+    {true,  R4A_ESP32_NVM_PT_UINT32, 1024,       65536,         &r4aWebServerBufferBytes,   "WebBufBytes",  8192},
     {true,  R4A_ESP32_NVM_PT_P_CHAR, 0,          0,             &r4aWebServerNvmArea,       "WebNvmArea",   R4A_ESP32_NVM_STRING(DOWNLOAD_AREA)},
+    {false, R4A_ESP32_NVM_PT_P_CHAR, 0,          0,             &r4aWebServerUploadPassword, "WebUpPass",   0},
 
     // WiFi: Public Access Points (APs)
 // Required    Type                  Minimum     Maximum        Address                     Name            Default Value
@@ -57,6 +57,29 @@ const httpd_uri_t webServerFileDownloadUri =
     .supported_subprotocol = nullptr,
 };
 
+// URI handlers for uploading files, the request body replaces the file
+const httpd_uri_t webServerFilePostUri =
+{
+    .uri       = DOWNLOAD_AREA "*",  // Match all URIs of type /path/to/file
+    .method    = HTTP_POST,
+    .handler   = r4aWebServerFileUpload,
+    .user_ctx  = (void *)&webServer,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = nullptr,
+};
+
+const httpd_uri_t webServerFilePutUri =
+{
+    .uri       = DOWNLOAD_AREA "*",  // Match all URIs of type /path/to/file
+    .method    = HTTP_PUT,
+    .handler   = r4aWebServerFileUpload,
+    .user_ctx  = (void *)&webServer,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = nullptr,
+};
+
 // URI handler for getting OV2640 details
 const httpd_uri_t webServerOv2640DetailsUri =
 {
@@ -92,6 +115,19 @@ bool webServerRegisterUriHandlers(R4A_WEB_SERVER * object)
             break;
         }
 
+        // Add the NVM upload pages
+        error = httpd_register_uri_handler(object->_webServer,
+                                           &webServerFilePostUri);
+        if (error == ESP_OK)
+            error = httpd_register_uri_handler(object->_webServer,
+                                               &webServerFilePutUri);
+        if (error != ESP_OK)
+        {
+            if (r4aWebServerDebug)
+                r4aWebServerDebug->printf("ERROR: Failed to register NVM upload handlers, error: %d!\r\n", error);
+            break;
+        }
+
         // Add the jpeg camera image page
         error = httpd_register_uri_handler(object->_webServer, &ov2640JpegPage);
         if (error != ESP_OK)
@@ -101,6 +137,15 @@ bool webServerRegisterUriHandlers(R4A_WEB_SERVER * object)
             break;
         }
 
+        // Add the jpeg camera stream page
+        error = httpd_register_uri_handler(object->_webServer, &ov2640StreamPage);
+        if (error != ESP_OK)
+        {
+            if (r4aWebServerDebug)
+                r4aWebServerDebug->printf("ERROR: Failed to register stream handler, error: %d!\r\n", error);
+            break;
+        }
+
         // Add the OV2640 details page
         error = httpd_register_uri_handler(object->_webServer, &webServerOv2640DetailsUri);
         if (error != ESP_OK)
@@ -0,0 +1,399 @@
+/**********************************************************************
+  Command_Queue_Benchmark.cpp
+
+  Program to stress test the command queue (src/Atomic.cpp) and compare
+  its post cost against a ring buffer protected by a pthread mutex.
+  Several producer threads post numbered commands while a consumer
+  thread, playing the role of the control loop, drains the queue and
+  verifies that every command executes once and in the order each
+  producer posted it.  The program exits with a non-zero status when a
+  command is lost, repeated or executed out of order.
+**********************************************************************/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../src/R4A_ESP32_Lock.h"
+#include "../../src/R4A_ESP32_Queue.h"
+
+#define COMMANDS_PER_DRAIN      2
+#define COMMANDS_PER_PRODUCER   200000
+#define MAX_PRODUCERS           15
+#define QUEUE_ENTRIES           16
+#define WAIT_COMMANDS           20000
+
+// Queue types
+enum QUEUE_TYPE
+{
+    QUEUE_LOCK_FREE = 0,
+    QUEUE_MUTEX,
+    QUEUE_TYPE_MAX
+};
+
+const char * const queueName[QUEUE_TYPE_MAX] =
+{
+    "lock free",
+    "mutex",
+};
+
+// Thread context
+typedef struct _THREAD_CONTEXT
+{
+    pthread_t _thread;
+    int _queueType;             // Queue to use
+    int _producer;              // Producer number
+    uint64_t _postNsec;         // Time spent posting
+    uint64_t _retries;          // Posts repeated because the queue was full
+} THREAD_CONTEXT;
+
+// Ring buffer protected by a mutex, used for comparison
+typedef struct _MUTEX_QUEUE
+{
+    pthread_mutex_t _mutex;
+    uint32_t _head;
+    uint32_t _tail;
+    intptr_t _parameter[QUEUE_ENTRIES];
+} MUTEX_QUEUE;
+
+//****************************************
+// Locals
+//****************************************
+
+R4A_ESP32_COMMAND commands[QUEUE_ENTRIES];
+R4A_ESP32_COMMAND_QUEUE commandQueue = R4A_ESP32_COMMAND_QUEUE_INITIALIZER("Benchmark", commands);
+MUTEX_QUEUE mutexQueue = {PTHREAD_MUTEX_INITIALIZER};
+volatile int producersRunning;
+
+// Verification data, only updated by the consumer
+uint32_t nextCommand[MAX_PRODUCERS];
+uint64_t commandErrors;
+uint64_t commandsExecuted;
+
+//*********************************************************************
+// Verify and account for a command, executed by the consumer
+void executeCommand(intptr_t parameter, Print * display)
+{
+    uint32_t command;
+    int producer;
+
+    producer = parameter >> 24;
+    command = parameter & 0xffffff;
+    if ((producer >= MAX_PRODUCERS) || (command != nextCommand[producer]))
+        commandErrors += 1;
+    else
+        nextCommand[producer] = command + 1;
+    commandsExecuted += 1;
+}
+
+//*********************************************************************
+// Post a command, return true if successful
+bool post(int queueType, intptr_t parameter)
+{
+    bool posted;
+
+    switch (queueType)
+    {
+    case QUEUE_LOCK_FREE:
+        return r4aEsp32CommandQueuePost(&commandQueue, executeCommand, parameter, nullptr) != 0;
+
+    case QUEUE_MUTEX:
+        pthread_mutex_lock(&mutexQueue._mutex);
+        posted = ((mutexQueue._tail - mutexQueue._head) < QUEUE_ENTRIES);
+        if (posted)
+        {
+            mutexQueue._parameter[mutexQueue._tail % QUEUE_ENTRIES] = parameter;
+            mutexQueue._tail += 1;
+        }
+        pthread_mutex_unlock(&mutexQueue._mutex);
+        return posted;
+    }
+    return false;
+}
+
+//*********************************************************************
+// Execute the posted commands, return the number of commands executed
+uint32_t drain(int queueType)
+{
+    uint32_t count;
+    intptr_t parameter;
+
+    switch (queueType)
+    {
+    case QUEUE_LOCK_FREE:
+        return r4aEsp32CommandQueueDrain(&commandQueue, COMMANDS_PER_DRAIN);
+
+    case QUEUE_MUTEX:
+        for (count = 0; count < COMMANDS_PER_DRAIN; count++)
+        {
+            pthread_mutex_lock(&mutexQueue._mutex);
+            if (mutexQueue._head == mutexQueue._tail)
+            {
+                pthread_mutex_unlock(&mutexQueue._mutex);
+                break;
+            }
+            parameter = mutexQueue._parameter[mutexQueue._head % QUEUE_ENTRIES];
+            mutexQueue._head += 1;
+            pthread_mutex_unlock(&mutexQueue._mutex);
+            executeCommand(parameter, nullptr);
+        }
+        return count;
+    }
+    return 0;
+}
+
+//*********************************************************************
+// Post the commands for a producer
+void * producerThread(void * parameter)
+{
+    uint32_t command;
+    THREAD_CONTEXT * context;
+    intptr_t value;
+    uint64_t startNsec;
+
+    context = (THREAD_CONTEXT *)parameter;
+    for (command = 0; command < COMMANDS_PER_PRODUCER; command++)
+    {
+        value = ((intptr_t)context->_producer << 24) | command;
+        startNsec = r4aEsp32LockHostNsec();
+        while (!post(context->_queueType, value))
+        {
+            context->_retries += 1;
+            R4A_ESP32_LOCK_YIELD();
+        }
+        context->_postNsec += r4aEsp32LockHostNsec() - startNsec;
+    }
+    __atomic_fetch_sub(&producersRunning, 1, __ATOMIC_RELEASE);
+    return nullptr;
+}
+
+//*********************************************************************
+// Drain the queue until the producers are done and the queue is empty
+void * consumerThread(void * parameter)
+{
+    THREAD_CONTEXT * context;
+    int running;
+
+    context = (THREAD_CONTEXT *)parameter;
+    while (1)
+    {
+        // Check the producers before the queue, the queue is empty for
+        // good when no producers were running before it was drained
+        running = __atomic_load_n(&producersRunning, __ATOMIC_ACQUIRE);
+        if (drain(context->_queueType))
+            continue;
+        if (!running)
+            break;
+        R4A_ESP32_LOCK_YIELD();
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Verify that the queue delivers every command once and in order
+bool stressTest(int queueType, int producers)
+{
+    THREAD_CONTEXT consumer;
+    THREAD_CONTEXT context[MAX_PRODUCERS];
+    uint64_t expected;
+    int index;
+    uint64_t postNsec;
+    uint64_t retries;
+    uint64_t startNsec;
+    int status;
+    bool success;
+    uint64_t totalNsec;
+
+    // Reset the queues and the verification data
+    memset(commands, 0, sizeof(commands));
+    commandQueue._tail = 0;
+    commandQueue._head = 0;
+    commandQueue._completed = 0;
+    r4aEsp32CommandQueueClearStats(&commandQueue);
+    mutexQueue._head = 0;
+    mutexQueue._tail = 0;
+    memset(nextCommand, 0, sizeof(nextCommand));
+    commandErrors = 0;
+    commandsExecuted = 0;
+    producersRunning = producers;
+
+    // Start the consumer and the producers
+    startNsec = r4aEsp32LockHostNsec();
+    memset(&consumer, 0, sizeof(consumer));
+    consumer._queueType = queueType;
+    memset(context, 0, sizeof(context));
+    status = pthread_create(&consumer._thread, nullptr, consumerThread, &consumer);
+    for (index = 0; (status == 0) && (index < producers); index++)
+    {
+        context[index]._queueType = queueType;
+        context[index]._producer = index;
+        status = pthread_create(&context[index]._thread, nullptr, producerThread, &context[index]);
+    }
+    if (status)
+    {
+        fprintf(stderr, "ERROR: Failed to create thread, %s!\n", strerror(status));
+        exit(status);
+    }
+
+    // Wait for the threads to finish
+    for (index = 0; index < producers; index++)
+        pthread_join(context[index]._thread, nullptr);
+    pthread_join(consumer._thread, nullptr);
+    totalNsec = r4aEsp32LockHostNsec() - startNsec;
+
+    // Sum the producer results
+    postNsec = 0;
+    retries = 0;
+    for (index = 0; index < producers; index++)
+    {
+        postNsec += context[index]._postNsec;
+        retries += context[index]._retries;
+    }
+
+    // Verify the results
+    expected = (uint64_t)producers * COMMANDS_PER_PRODUCER;
+    success = (commandsExecuted == expected) && (commandErrors == 0);
+    for (index = 0; index < producers; index++)
+        if (nextCommand[index] != COMMANDS_PER_PRODUCER)
+            success = false;
+    if ((queueType == QUEUE_LOCK_FREE)
+        && ((commandQueue._executed != expected) || (commandQueue._completed != expected)))
+        success = false;
+
+    // Display the results
+    printf("%s: %-9s %9d %10.2f %9.1f %8.1f",
+           success ? "PASS" : "FAIL",
+           queueName[queueType],
+           producers,
+           (double)expected * 1000. / totalNsec,
+           (double)postNsec / expected,
+           (double)retries * 100. / expected);
+    if (queueType == QUEUE_LOCK_FREE)
+        printf(" %9lu %11.1f %11u",
+               (unsigned long)commandQueue._maxDepth,
+               (double)commandQueue._totalLatencyUsec / commandQueue._executed,
+               commandQueue._maxLatencyUsec);
+    printf("\n");
+    if (!success)
+        printf("FAIL: %llu of %llu commands executed, %llu out of order\n",
+               (unsigned long long)commandsExecuted,
+               (unsigned long long)expected,
+               (unsigned long long)commandErrors);
+    return success;
+}
+
+//*********************************************************************
+// Drain the queue until told to stop
+volatile bool waitStop;
+
+void * waitConsumerThread(void * parameter)
+{
+    while (!waitStop)
+        if (!r4aEsp32CommandQueueDrain(&commandQueue, COMMANDS_PER_DRAIN))
+            R4A_ESP32_LOCK_YIELD();
+    return nullptr;
+}
+
+//*********************************************************************
+// Measure the time to post a command and wait for it to complete
+bool waitTest()
+{
+    uint32_t command;
+    pthread_t consumer;
+    uint64_t maxNsec;
+    uint64_t nsec;
+    uint64_t startNsec;
+    bool success;
+    uint32_t ticket;
+    uint64_t totalNsec;
+
+    // Reset the queue and the verification data
+    memset(commands, 0, sizeof(commands));
+    commandQueue._tail = 0;
+    commandQueue._head = 0;
+    commandQueue._completed = 0;
+    r4aEsp32CommandQueueClearStats(&commandQueue);
+    memset(nextCommand, 0, sizeof(nextCommand));
+    commandErrors = 0;
+    commandsExecuted = 0;
+    waitStop = false;
+
+    // Post each command and wait for it to complete
+    pthread_create(&consumer, nullptr, waitConsumerThread, nullptr);
+    maxNsec = 0;
+    success = true;
+    totalNsec = 0;
+    for (command = 0; command < WAIT_COMMANDS; command++)
+    {
+        startNsec = r4aEsp32LockHostNsec();
+        ticket = r4aEsp32CommandQueuePost(&commandQueue, executeCommand, command, nullptr);
+        if ((ticket == 0) || !r4aEsp32CommandQueueWait(&commandQueue, ticket, 1000 * 1000))
+        {
+            success = false;
+            break;
+        }
+
+        // The command must be complete when the wait returns
+        if (commandsExecuted != (command + 1))
+            success = false;
+        nsec = r4aEsp32LockHostNsec() - startNsec;
+        totalNsec += nsec;
+        if (maxNsec < nsec)
+            maxNsec = nsec;
+    }
+    waitStop = true;
+    pthread_join(consumer, nullptr);
+
+    // A wait on a command that was never posted must time out
+    ticket = commandQueue._tail + 2;
+    if (r4aEsp32CommandQueueWait(&commandQueue, ticket, 1000) || (commandQueue._timeouts != 1))
+        success = false;
+    success &= (commandErrors == 0);
+
+    printf("%s: post and wait, %u commands, %.1f uSec average, %.1f uSec maximum\n",
+           success ? "PASS" : "FAIL",
+           command,
+           command ? (double)totalNsec / command / 1000. : 0.,
+           (double)maxNsec / 1000.);
+    return success;
+}
+
+//*********************************************************************
+// Test the command queue and compare it against a mutex
+int main(int argc, char **argv)
+{
+    int maxProducers;
+    int producers;
+    int queueType;
+    bool success;
+
+    // Get the maximum number of producers
+    maxProducers = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (maxProducers < 1)
+        maxProducers = 1;
+    if (argc == 2)
+        maxProducers = atoi(argv[1]);
+    if ((argc > 2) || (maxProducers < 1) || (maxProducers > MAX_PRODUCERS))
+    {
+        fprintf(stderr, "%s   [max_producers]\n", argv[0]);
+        fprintf(stderr, "\n");
+        fprintf(stderr, "max_producers: 1 - %d, defaults to the number of processors - 1\n",
+                MAX_PRODUCERS);
+        return -1;
+    }
+
+    // Display the results as they are available
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // Stress test the queues
+    success = waitTest();
+    printf("\n");
+    printf("      Queue     Producers  MCmds/Sec   Post nS  Full %%  Max Depth  Avg Lat uS  Max Lat uS\n");
+    for (producers = 1; producers <= maxProducers; producers <<= 1)
+        for (queueType = 0; queueType < QUEUE_TYPE_MAX; queueType++)
+            success &= stressTest(queueType, producers);
+    return success ? 0 : -1;
+}
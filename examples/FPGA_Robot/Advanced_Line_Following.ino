@@ -44,10 +44,14 @@ void alfChallenge(R4A_ROBOT_CHALLENGE * object)
 {
     uint32_t currentUsec;
 
-    // Read the line sensors
+    // Read the line sensors, stop when the value is not current
     currentUsec = micros();
-    pcf8574.read(&lineSensors);
-    lineSensors &= 7;
+    if (!robotReadLineSensors())
+    {
+        Serial.printf("ERROR: Line sensors not responding, stopping the robot!\r\n");
+        alfStop();
+        return;
+    }
 
     // Determine if the line sensor value has changed
     if (previousLineSensors != lineSensors)
@@ -58,7 +62,7 @@ void alfChallenge(R4A_ROBOT_CHALLENGE * object)
         alfStateRoutine[alfState]();
 
         // Log the sensors
-        if (logBuffer)
+        if (logBuffer._buffer)
             logData(currentUsec, alfState);
     }
 }
@@ -159,7 +163,7 @@ void alfStart(R4A_ROBOT_CHALLENGE * object)
     challengeStart();
 
     // Log the sensors
-    if (logBuffer)
+    if (logBuffer._buffer)
         logData(currentUsec, alfState);
     previousLineSensors = lineSensors;
 }
@@ -184,7 +188,7 @@ void alfStop(R4A_ROBOT_CHALLENGE * object)
     alfState = ALF_STATE_STOP;
     robotMotorSetSpeeds(0, 0);
 
-    if (logBuffer)
+    if (logBuffer._buffer)
     {
         // Read the line sensors
         pcf8574.read(&lineSensors);
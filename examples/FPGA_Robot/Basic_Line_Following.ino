@@ -44,10 +44,16 @@ void blfChallenge(R4A_ROBOT_CHALLENGE * object)
     static int16_t previousLeftSpeed;
     static int16_t previousRightSpeed;
 
-    // Read the line sensors
+    // Read the line sensors, stop when the value is not current
     currentUsec = micros();
-    pcf8574.read(&lineSensors);
-    lineSensors &= 7;
+    if (!robotReadLineSensors())
+    {
+        Serial.printf("ERROR: Line sensors not responding, stopping the robot!\r\n");
+        robotMotorSetSpeeds(0, 0);
+        r4aRobotStop(&robot, millis());
+        blfState = BLF_STATE_STOP;
+        return;
+    }
     if (BLF_DEBUG_STATES)
         Serial.printf("%d %d %d\r\n",
                       lineSensors & 1,
@@ -90,7 +96,7 @@ void blfChallenge(R4A_ROBOT_CHALLENGE * object)
     }
 
     // Log the sensors
-    if (logBuffer && ((lineSensors != previousLineSensors)
+    if (logBuffer._buffer && ((lineSensors != previousLineSensors)
                         || (robotLeftSpeed != previousLeftSpeed)
                         || (robotRightSpeed != previousRightSpeed)))
         logData(currentUsec, blfState);
@@ -179,7 +185,7 @@ void blfStart(R4A_ROBOT_CHALLENGE * object)
     challengeStart();
 
     // Log the sensors
-    if (logBuffer)
+    if (logBuffer._buffer)
         logData(currentUsec, blfState);
     previousLineSensors = lineSensors;
 }
@@ -205,7 +211,7 @@ void blfStop(R4A_ROBOT_CHALLENGE * object)
     blfState = BLF_STATE_STOP;
     robotMotorSetSpeeds(0, 0);
 
-    if (logBuffer)
+    if (logBuffer._buffer)
     {
         // Read the line sensors
         pcf8574.read(&lineSensors);
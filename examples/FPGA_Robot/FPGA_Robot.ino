@@ -163,6 +163,23 @@ R4A_I2C_BUS * r4aI2cBus; // I2C bus for menu system
         R4A_PCA9685_MOTOR motorFrontLeft(&pca9685, 14, 15);
     R4A_PCF8574 pcf8574(&esp32I2cBus._i2cBus, PCF8574_I2C_ADDRESS);
 
+// I2C devices serviced by the I2C scheduler task
+#define LINE_SENSOR_MAX_AGE_USEC    (20 * 1000) // Stop the challenge when older
+
+enum I2C_JOB_INDEX
+{
+    I2C_JOB_PCF8574 = 0,    // Line sensors
+    // Add new jobs above this line
+    I2C_JOB_COUNT
+};
+
+R4A_ESP32_I2C_JOB i2cJobTable[I2C_JOB_COUNT] =
+{
+    // Name                 Address              Command  Bytes  Read  Period mSec
+    {"PCF8574 line sensors", PCF8574_I2C_ADDRESS, nullptr, 0,     1,    1},
+};
+R4A_ESP32_I2C_SCHEDULER i2cScheduler;
+
 bool generalCallPresent;
 bool pca9685Present;
 bool pcf8574Present;
@@ -189,7 +206,7 @@ typedef struct _LOG_ENTRY
     uint16_t _reserved;
 } LOG_ENTRY;
 
-uint8_t * logBuffer;    // Buffer for logging
+R4A_RING_BUFFER logBuffer; // Buffer for logging
 uint32_t logStartUsec;  // Start time in microseconds
 
 uint8_t lineSensors;    // Last value of the line sensors
@@ -412,6 +429,7 @@ R4A_WEB_SERVER webServer =
     webServerConfigUpdate,          // _configUpdate
     webServerRegisterErrorHandlers, // _registerErrorHandlers
     webServerRegisterUriHandlers,   // _registerUriHandlers
+    r4aWebServerUploadReloadParameters, // _uploadComplete
     80,         // _port
     nullptr,    // _webServer
 };
@@ -634,6 +652,14 @@ void loop()
         r4aWebServerUpdate(&webServer, r4aWifiStationOnline && webServerEnable);
     }
 
+    // Merge the parameter changes into the parameter file
+    if (!r4aRobotIsActive(&robot))
+    {
+        if (DEBUG_LOOP_CORE_1)
+            callingRoutine("r4aEsp32NvmJournalUpdate");
+        r4aEsp32NvmJournalUpdate(parameterFilePath, nvmParameters, nvmParameterCount);
+    }
+
     // Display the robot's runtime
     if (robotRunTime && r4aRobotIsRunning(&robot))
     {
@@ -736,6 +762,17 @@ void setupCore0(void *parameter)
     // Initialize the PCF8574
     log_v("Calling pcf8574.write");
     pcf8574.write(0xff);
+
+    // Read the line sensors from the I2C scheduler task
+    if (pcf8574Present)
+    {
+        log_v("Calling r4aEsp32I2cSchedulerBegin");
+        r4aEsp32I2cSchedulerBegin(&i2cScheduler,
+                                  i2cBus,
+                                  i2cJobTable,
+                                  I2C_JOB_COUNT,
+                                  1);
+    }
 #endif  // USE_I2C
 
     // Initialize the robot
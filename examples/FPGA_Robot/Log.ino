@@ -8,14 +8,17 @@
 // Constants
 //****************************************
 
-const size_t logBufferSize = 256 * sizeof(LOG_ENTRY);
+const size_t logBufferSize = 8192;  // Power of 2, more than 256 entries
+
+enum LOG_TYPE
+{
+    LOG_TYPE_STATE = 0,
+};
 
 //****************************************
 // Locals
 //****************************************
 
-volatile uint8_t * logBufHead;  // Log entry insertion location
-volatile uint8_t * logBufTail;  // Log entry removal location
 const char ** logStateTable;
 uint8_t logStopState;
 
@@ -24,25 +27,17 @@ uint8_t logStopState;
 void logData(uint32_t currentUsec, uint8_t state)
 {
     LOG_ENTRY * logEntry;
-    LOG_ENTRY * logNext;
-
-    logEntry = (LOG_ENTRY *)logBufHead;
-    logNext = logEntry + 1;
-    if (logNext >= (LOG_ENTRY *)&logBuffer[logBufferSize])
-        logNext = (LOG_ENTRY *)logBuffer;
 
     // Verify that logging is running
-    if ((logPrint == nullptr)       // Not logging
-        || (logBuffer == nullptr)   // No buffer
-        || (logBufHead == nullptr)) // No head
+    if (logPrint == nullptr)    // Not logging
         return;
 
-    // Verify that there is space in the buffer
-    if (logNext == (LOG_ENTRY *)logBufTail)  // Buffer full
-    {
-        Serial.printf("ERROR: Log buffer full, %d uSec!\r\n", currentUsec);
+    // Reserve space in the log buffer, the buffer counts the dropped entries
+    logEntry = (LOG_ENTRY *)r4aRingBufferReserve(&logBuffer,
+                                                 LOG_TYPE_STATE,
+                                                 sizeof(*logEntry));
+    if (logEntry == nullptr)
         return;
-    }
 
     // Add an entry to the log buffer
     logEntry->_microSec = currentUsec;
@@ -52,8 +47,8 @@ void logData(uint32_t currentUsec, uint8_t state)
     logEntry->_lineSensors = lineSensors;
     logEntry->_reserved = 0;
 
-    // Insert this entry into the log buffer
-    logBufHead = (uint8_t *)logNext;
+    // Make this entry available for printing
+    r4aRingBufferCommit(&logBuffer, logEntry);
 }
 
 //*********************************************************************
@@ -61,14 +56,9 @@ void logData(uint32_t currentUsec, uint8_t state)
 void logInit(const char ** stateTable, uint8_t stopState)
 {
     // Attempt to allocate the log buffer
-    if (stateTable && (logBuffer == nullptr))
+    if (stateTable)
     {
-        logBuffer = (uint8_t *)r4aMalloc(logBufferSize, "Log Buffer");
-        if (logBuffer)
-        {
-            logBufHead = logBuffer;
-            logBufTail = logBuffer;
-        }
+        r4aRingBufferBegin(&logBuffer, logBufferSize);
 
         // Save the state table and stop state
         logStateTable = stateTable;
@@ -83,7 +73,6 @@ bool logDataPrint()
 {
     static char line[128];
     LOG_ENTRY * logEntry;
-    LOG_ENTRY * logNext;
     const char * sensorTable[8] =
     {
         ".       .", // 0
@@ -98,22 +87,13 @@ bool logDataPrint()
     uint32_t seconds;
     uint32_t microseconds;
 
-    logEntry = (LOG_ENTRY *)logBufTail;
-    logNext = logEntry + 1;
-    if (logNext >= (LOG_ENTRY *)&logBuffer[logBufferSize])
-        logNext = (LOG_ENTRY *)logBuffer;
-
     // Verify that logging is enabled
-    if ((logPrint == nullptr)           // No output device
-        || (logBuffer == nullptr)       // No buffer
-        || (logBufHead == nullptr)      // No head
-        || (logBufTail == nullptr))     // No tail
-    {
+    if (logPrint == nullptr)    // No output device
         return false;
-    }
 
     // Determine if the buffer is empty
-    if (logBufHead == logBufTail)   // Empty list
+    logEntry = (LOG_ENTRY *)r4aRingBufferPeek(&logBuffer);
+    if (logEntry == nullptr)    // Empty list
         return false;
 
     // Format the log entry
@@ -131,14 +111,17 @@ bool logDataPrint()
     // Display the log entry
     logPrint->printf("%s", line);
 
-    // Remove this entry from the log buffer
-    logBufTail = (uint8_t *)logNext;
-
     // Done printing the data
     if (logEntry->_state == logStopState)
     {
+        if (logBuffer._recordsDropped)
+            logPrint->printf("WARNING: %ld log entries dropped, log buffer full!\r\n",
+                             logBuffer._recordsDropped);
         logPrint->printf("\r\n");
         logPrint = nullptr;
     }
+
+    // Remove this entry from the log buffer
+    r4aRingBufferRelease(&logBuffer);
     return true;
 }
@@ -119,6 +119,11 @@ const R4A_MENU_ENTRY debugMenuTable[] =
     {"h",       r4aEsp32MenuDisplayHeap,    0,              nullptr,    0,      "Display the heap"},
 #ifdef  USE_I2C
     {"i",       nullptr,                    MTI_I2C,        nullptr,    0,      "I2C menu"},
+    {"ic",  r4aEsp32I2cMenuStatsClear,  (intptr_t)&esp32I2cBus, nullptr, 0, "Clear the I2C transaction statistics"},
+    {"id",  r4aEsp32I2cMenuStatsDump,   (intptr_t)&esp32I2cBus, nullptr, 0, "Dump the I2C transaction statistics as JSON"},
+    {"ir",  r4aEsp32I2cMenuRefresh,     (intptr_t)&esp32I2cBus, nullptr, 0, "Probe the I2C bus and update the presence map"},
+    {"is",  r4aEsp32I2cSchedulerMenuStats, (intptr_t)&i2cScheduler, nullptr, 0, "Display the I2C scheduler statistics"},
+    {"it",  r4aEsp32I2cMenuStats,       (intptr_t)&esp32I2cBus, nullptr, 0, "Display the I2C transaction statistics"},
     {"m",       nullptr,                    MTI_MOTOR,      nullptr,    0,      "Motor menu"},
 #endif  // USE_I2C
     {"p",    r4aEsp32MenuDisplayPartitions, 0,              nullptr,    0,      "Display the partitions"},
@@ -149,6 +154,7 @@ const R4A_MENU_ENTRY flashMenuTable[] =
     {"id9f",    r4aSpiFlashMenuReadId9f,    0,                      nullptr,            0,      "Read 3 byte ID"},
     {"rd",      r4aSpiFlashMenuReadData,    (intptr_t)"addr len",   r4aMenuHelpSuffix,  8,      "Read len bytes from addr"},
     {"rs", r4aSpiFlashMenuReadStatusRegister, 0,                    nullptr,            0,      "Read status register"},
+    {"ss",   r4aEsp32SpiMenuStats,          0,                      nullptr,            0,      "Display SPI statistics"},
     {"we",   r4aSpiFlashMenuWriteEnable,    1,                      nullptr,            0,      "Enable writes to SPI flash"},
     {"wp",   r4aSpiFlashMenuWriteEnable,    0,                      nullptr,            0,      "Write protect SPI flash"},
     {"x",       nullptr,                    R4A_MENU_MAIN,          nullptr,            0,      "Return to the main menu"},
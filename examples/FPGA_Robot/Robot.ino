@@ -86,6 +86,32 @@ bool robotMotorSetSpeeds(int16_t left, int16_t right, Print * display)
            && pca9685.writeBufferedRegisters(display);
 }
 
+//*********************************************************************
+// Get the latest PCF8574 line sensor values
+// Outputs:
+//   Returns true when lineSensors was updated and false when the value
+//   published by the I2C scheduler is stale or the last read failed
+bool robotReadLineSensors()
+{
+    R4A_ESP32_I2C_SNAPSHOT snapshot;
+
+    // Read the PCF8574 when the I2C scheduler is not running
+    if (!i2cScheduler._task)
+    {
+        pcf8574.read(&lineSensors);
+        lineSensors &= 7;
+        return true;
+    }
+
+    // Use the value published by the I2C scheduler task
+    if ((!r4aEsp32I2cJobSnapshot(&i2cJobTable[I2C_JOB_PCF8574], &snapshot))
+        || snapshot._failed
+        || ((esp_timer_get_time() - snapshot._usec) > LINE_SENSOR_MAX_AGE_USEC))
+        return false;
+    lineSensors = snapshot._data[0] & 7;
+    return true;
+}
+
 //*********************************************************************
 // Restore the time display state
 void robotNtpTimeRestore()
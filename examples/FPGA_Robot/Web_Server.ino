@@ -57,6 +57,29 @@ const httpd_uri_t webServerFileDownloadUri =
     .supported_subprotocol = nullptr,
 };
 
+// URI handlers for uploading files, the request body replaces the file
+const httpd_uri_t webServerFilePostUri =
+{
+    .uri       = DOWNLOAD_AREA "*",  // Match all URIs of type /path/to/file
+    .method    = HTTP_POST,
+    .handler   = r4aWebServerFileUpload,
+    .user_ctx  = (void *)&webServer,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = nullptr,
+};
+
+const httpd_uri_t webServerFilePutUri =
+{
+    .uri       = DOWNLOAD_AREA "*",  // Match all URIs of type /path/to/file
+    .method    = HTTP_PUT,
+    .handler   = r4aWebServerFileUpload,
+    .user_ctx  = (void *)&webServer,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = nullptr,
+};
+
 //*********************************************************************
 // Register the URI handlers
 // Inputs:
@@ -80,6 +103,19 @@ bool webServerRegisterUriHandlers(R4A_WEB_SERVER * object)
             break;
         }
 
+        // Add the NVM upload pages
+        error = httpd_register_uri_handler(object->_webServer,
+                                           &webServerFilePostUri);
+        if (error == ESP_OK)
+            error = httpd_register_uri_handler(object->_webServer,
+                                               &webServerFilePutUri);
+        if (error != ESP_OK)
+        {
+            if (r4aWebServerDebug)
+                r4aWebServerDebug->printf("ERROR: Failed to register NVM upload handlers, error: %d!\r\n", error);
+            break;
+        }
+
         // Successfully registered the handlers
         return true;
     } while (0);
@@ -44,10 +44,14 @@ void alfChallenge(R4A_ROBOT_CHALLENGE * object)
 {
     uint32_t currentUsec;
 
-    // Read the line sensors
+    // Read the line sensors, stop when the value is not current
     currentUsec = micros();
-    pcf8574.read(&lineSensors);
-    lineSensors &= 7;
+    if (!robotReadLineSensors())
+    {
+        Serial.printf("ERROR: Line sensors not responding, stopping the robot!\r\n");
+        alfStop();
+        return;
+    }
 
     // Determine if the line sensor value has changed
     if (previousLineSensors != lineSensors)
@@ -58,8 +62,8 @@ void alfChallenge(R4A_ROBOT_CHALLENGE * object)
         alfStateRoutine[alfState]();
 
         // Log the sensors
-        if (logBuffer)
-            logLineSensorData(currentUsec, alfState, LOG_LINE_SENSOR_DATA_POW2LENGTH);
+        if (logBuffer._buffer)
+            logLineSensorData(currentUsec, alfState);
     }
 }
 
@@ -128,6 +132,7 @@ void alfStart(Print * display)
 
     // Attempt to allocate the log buffer
     if (logInit(alfStateTable,
+                sizeof(alfStateTable) / sizeof(alfStateTable[0]),
                 ALF_STATE_STOP,
                 sensorTable,
                 sensorMask) == false)
@@ -145,10 +150,7 @@ void alfStart(Print * display)
     }
     else
         // Start the robot challenge if the robot is not active
-        r4aRobotStart(&robot,
-                      &advancedLineFollowing,
-                      robotStartDelaySec,
-                      display);
+        robotStart(&advancedLineFollowing, display);
 }
 
 //*********************************************************************
@@ -172,8 +174,8 @@ void alfStart(R4A_ROBOT_CHALLENGE * object)
     challengeStart();
 
     // Log the sensors
-    if (logBuffer)
-        logLineSensorData(currentUsec, alfState, LOG_LINE_SENSOR_DATA_POW2LENGTH);
+    if (logBuffer._buffer)
+        logLineSensorData(currentUsec, alfState);
     previousLineSensors = lineSensors;
 }
 
@@ -197,14 +199,14 @@ void alfStop(R4A_ROBOT_CHALLENGE * object)
     alfState = ALF_STATE_STOP;
     robotMotorSetSpeeds(0, 0);
 
-    if (logBuffer)
+    if (logBuffer._buffer)
     {
         // Read the line sensors
         pcf8574.read(&lineSensors);
         lineSensors &= 7;
 
         // Log the sensors
-        logLineSensorData(currentUsec, alfState, LOG_LINE_SENSOR_DATA_POW2LENGTH);
+        logLineSensorData(currentUsec, alfState);
     }
 
     // Turn on the brake lights
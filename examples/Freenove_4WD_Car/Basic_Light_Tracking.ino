@@ -81,10 +81,7 @@ void bltStart(Print * display)
     }
     else
         // Start the robot challenge if the robot is not active
-        r4aRobotStart(&robot,
-                      &basicLightTracking,
-                      robotStartDelaySec,
-                      display);
+        robotStart(&basicLightTracking, display);
 }
 
 //*********************************************************************
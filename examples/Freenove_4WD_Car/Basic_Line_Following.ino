@@ -44,10 +44,16 @@ void blfChallenge(R4A_ROBOT_CHALLENGE * object)
     static int16_t previousLeftSpeed;
     static int16_t previousRightSpeed;
 
-    // Read the line sensors
+    // Read the line sensors, stop when the value is not current
     currentUsec = micros();
-    pcf8574.read(&lineSensors);
-    lineSensors &= 7;
+    if (!robotReadLineSensors())
+    {
+        Serial.printf("ERROR: Line sensors not responding, stopping the robot!\r\n");
+        robotMotorSetSpeeds(0, 0);
+        r4aRobotStop(&robot, millis());
+        blfState = BLF_STATE_STOP;
+        return;
+    }
     if (BLF_DEBUG_STATES)
         Serial.printf("%d %d %d\r\n",
                       lineSensors & 1,
@@ -90,10 +96,10 @@ void blfChallenge(R4A_ROBOT_CHALLENGE * object)
     }
 
     // Log the sensors
-    if (logBuffer && ((lineSensors != previousLineSensors)
+    if (logBuffer._buffer && ((lineSensors != previousLineSensors)
                         || (robotLeftSpeed != previousLeftSpeed)
                         || (robotRightSpeed != previousRightSpeed)))
-        logLineSensorData(currentUsec, blfState, LOG_LINE_SENSOR_DATA_POW2LENGTH);
+        logLineSensorData(currentUsec, blfState);
     previousLeftSpeed = robotLeftSpeed;
     previousRightSpeed = robotRightSpeed;
 }
@@ -184,6 +190,7 @@ void blfStart(Print * display)
 
     // Attempt to allocate the log buffer
     if (logInit(blfStateTable,
+                sizeof(blfStateTable) / sizeof(blfStateTable[0]),
                 BLF_STATE_STOP,
                 sensorTable,
                 sensorMask) == false)
@@ -201,10 +208,7 @@ void blfStart(Print * display)
     }
     else
         // Start the robot challenge if the robot is not active
-        r4aRobotStart(&robot,
-                      challengeStructure,
-                      robotStartDelaySec,
-                      display);
+        robotStart(challengeStructure, display);
 }
 
 //*********************************************************************
@@ -228,8 +232,8 @@ void blfStart(R4A_ROBOT_CHALLENGE * object)
     challengeStart();
 
     // Log the sensors
-    if (logBuffer)
-        logLineSensorData(currentUsec, blfState, LOG_LINE_SENSOR_DATA_POW2LENGTH);
+    if (logBuffer._buffer)
+        logLineSensorData(currentUsec, blfState);
     previousLineSensors = lineSensors;
 }
 
@@ -254,13 +258,13 @@ void blfStop(R4A_ROBOT_CHALLENGE * object)
     blfState = BLF_STATE_STOP;
     robotMotorSetSpeeds(0, 0);
 
-    if (logBuffer)
+    if (logBuffer._buffer)
     {
         // Read the line sensors
         blfReadLineSensors();
 
         // Log the sensors
-        logLineSensorData(currentUsec, blfState, LOG_LINE_SENSOR_DATA_POW2LENGTH);
+        logLineSensorData(currentUsec, blfState);
     }
 
     challengeStop();
@@ -65,10 +65,7 @@ void clfStart(Print * display)
     }
     else
         // Start the robot challenge if the robot is not active
-        r4aRobotStart(&robot,
-                      &cameraLineFollowing,
-                      robotStartDelaySec,
-                      display);
+        robotStart(&cameraLineFollowing, display);
 }
 
 //*********************************************************************
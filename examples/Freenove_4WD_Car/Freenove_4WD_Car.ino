@@ -13,8 +13,10 @@
 #include <R4A_Freenove_4WD_Car.h>   // Freenove 4WD Car configuration
 #include <R4A_SparkFun.h>           // SparkFun Electronics boards
 #include "Sensor_Table.h"
+#include "Log_Binary.h"             // Binary log stream format
 
 #define USE_I2C
+//#define USE_MEMORY_POOL
 //#define USE_NTRIP
 //#define USE_OV2640
 //#define USE_SPARKFUN_SEN_13582
@@ -158,6 +160,23 @@ R4A_I2C_BUS * r4aI2cBus; // I2C bus for menu system
         R4A_PCA9685_MOTOR motorFrontRight(&pca9685, 13, 12);
         R4A_PCA9685_MOTOR motorFrontLeft(&pca9685, 14, 15);
     R4A_PCF8574 pcf8574(&esp32I2cBus._i2cBus, PCF8574_I2C_ADDRESS);
+
+// I2C devices serviced by the I2C scheduler task
+#define LINE_SENSOR_MAX_AGE_USEC    (20 * 1000) // Stop the challenge when older
+
+enum I2C_JOB_INDEX
+{
+    I2C_JOB_PCF8574 = 0,    // Line sensors
+    // Add new jobs above this line
+    I2C_JOB_COUNT
+};
+
+R4A_ESP32_I2C_JOB i2cJobTable[I2C_JOB_COUNT] =
+{
+    // Name                 Address              Command  Bytes  Read  Period mSec
+    {"PCF8574 line sensors", PCF8574_I2C_ADDRESS, nullptr, 0,     1,    1},
+};
+R4A_ESP32_I2C_SCHEDULER i2cScheduler;
 #ifdef  USE_OV2640
     const R4A_OV2640_SETUP ov2640 =
     {
@@ -212,7 +231,7 @@ int16_t lsAdcValue;
 // Logging
 //****************************************
 
-uint8_t * logBuffer;    // Buffer for logging
+R4A_RING_BUFFER logBuffer; // Buffer for logging
 uint32_t logStartUsec;  // Start time in microseconds
 
 uint8_t lineSensors;    // Last value of the line sensors
@@ -220,10 +239,9 @@ uint8_t previousLineSensors;
 int16_t robotLeftSpeed;
 int16_t robotRightSpeed;
 
+bool logBinary;          // Send the log entries as binary records
 Print * logPrint;       // Network connection for logging
 
-#define LOG_LINE_SENSOR_DATA_POW2LENGTH     4
-
 //****************************************
 // Loop globals
 //****************************************
@@ -272,6 +290,13 @@ void robotDisplayTime(uint32_t milliseconds);
 
 R4A_ROBOT robot;
 
+// Commands from the menus executed by loop on core 1
+#define ROBOT_COMMANDS_PER_LOOP     2           // Limit the loop time impact
+#define ROBOT_COMMAND_TIMEOUT_USEC  (1000 * 1000) // Warn when a command takes longer
+
+R4A_ESP32_COMMAND robotCommands[16];
+R4A_ESP32_COMMAND_QUEUE robotCommandQueue = R4A_ESP32_COMMAND_QUEUE_INITIALIZER("Robot", robotCommands);
+
 START_CHALLENGE challengeList[] =
 {
     nullptr,
@@ -323,6 +348,7 @@ R4A_WEB_SERVER webServer =
     webServerConfigUpdate,          // _configUpdate
     webServerRegisterErrorHandlers, // _registerErrorHandlers
     webServerRegisterUriHandlers,   // _registerUriHandlers
+    r4aWebServerUploadReloadParameters, // _uploadComplete
     80,         // _port
     nullptr,    // _webServer
 };
@@ -358,6 +384,12 @@ void setup()
     Serial.println();
     Serial.printf("Freenove 4WD Car\r\n");
 
+#ifdef  USE_MEMORY_POOL
+    // Allocate the memory pool before the heap gets fragmented
+    log_v("Calling r4aEsp32PoolBegin");
+    r4aEsp32PoolBegin();
+#endif  // USE_MEMORY_POOL
+
     // Display the core number
     log_v("setup() running on core %d\r\n", xPortGetCoreID());
 
@@ -373,6 +405,9 @@ void setup()
     log_v("Calling r4aMenuBegin");
     r4aMenuBegin(&serialMenu, menuTable, menuTableEntries);
 
+    // Execute the LED menu commands on core 1 between the robot updates
+    r4a4wdCarCommandQueue = &robotCommandQueue;
+
     // Set the ADC reference voltage
     log_v("Calling r4aEsp32VoltageSetReference");
     r4aEsp32VoltageSetReference(ADC_REFERENCE_VOLTAGE);
@@ -455,6 +490,17 @@ void setup()
     // Initialize the PCF8574
     log_v("Calling pcf8574.write");
     pcf8574.write(0xff);
+
+    // Read the line sensors from the I2C scheduler task
+    if (pcf8574Present)
+    {
+        log_v("Calling r4aEsp32I2cSchedulerBegin");
+        r4aEsp32I2cSchedulerBegin(&i2cScheduler,
+                                  i2cBus,
+                                  i2cJobTable,
+                                  I2C_JOB_COUNT,
+                                  1);
+    }
 #endif  // USE_I2C
 
     // Initialize the SX1509
@@ -580,6 +626,12 @@ void loop()
     }
 #endif  // USE_NTRIP
 
+    // Execute the robot commands from the menus before updating the
+    // robot state
+    if (DEBUG_LOOP_CORE_1)
+        callingRoutine("r4aEsp32CommandQueueDrain");
+    r4aEsp32CommandQueueDrain(&robotCommandQueue, ROBOT_COMMANDS_PER_LOOP);
+
     // Perform the robot challenge
     if (DEBUG_LOOP_CORE_1)
         callingRoutine("r4aRobotUpdate");
@@ -779,6 +831,14 @@ void loopCore0()
         r4aWebServerUpdate(&webServer, r4aWifiStationOnline && webServerEnable);
     }
 
+    // Merge the parameter changes into the parameter file
+    if (!r4aRobotIsActive(&robot))
+    {
+        if (DEBUG_LOOP_CORE_0)
+            callingRoutine("r4aEsp32NvmJournalUpdate");
+        r4aEsp32NvmJournalUpdate(parameterFilePath, nvmParameters, nvmParameterCount);
+    }
+
 #ifdef  USE_OV2640
     // Discard frame buffers
     if (r4aCameraUsers == 0)
@@ -8,41 +8,26 @@
 // Constants
 //****************************************
 
-const size_t logBufferSize = 8192;
+const size_t logBufferSize = 8192;  // Power of 2
 
 #define LOG_STATE_WIDTH         17
 
 #define LOG_DASHES_LENGTH       80
 #define LOG_SPACES_LENGTH       80
 
-enum LOG_TYPE
-{
-    LOG_TYPE_LINE_SENSOR = 0,
-};
+#define LOG_BINARY_BUFFER_BYTES 512     // Binary records sent in a single write
 
 //****************************************
 // New Types
 //****************************************
 
-typedef struct _LOG_ENTRY
-{
-    uint8_t _logType;
-    uint8_t _pow2Length;
-    uint8_t _state;
-    uint8_t _data8;
-    uint32_t _microSec;
-    uint32_t _loopCount;
-    int16_t _leftSpeed;
-    int16_t _rightSpeed;
-} LOG_ENTRY;
-
-typedef bool (*LOG_PRINT_DATA_ROUTINE)(LOG_ENTRY * logEntry, LOG_ENTRY * logNext);
+typedef bool (*LOG_PRINT_DATA_ROUTINE)(LOG_ENTRY * logEntry);
 
 //****************************************
 // Forward routines declarations
 //****************************************
 
-bool logLineSensorPrint(LOG_ENTRY * logEntry, LOG_ENTRY * logNext);
+bool logLineSensorPrint(LOG_ENTRY * logEntry);
 
 //****************************************
 // Log data routines
@@ -62,17 +47,17 @@ const LOG_PRINT_DATA_ROUTINE logPrintDataRoutine[] =
 const char * const logDashes = "--------------------------------------------------------------------------------";
 const char * const logSpaces = "                                                                                ";
 
-volatile uint8_t * logBufHead;  // Log entry insertion location
-volatile uint8_t * logBufTail;  // Log entry removal location
 bool logPrintHeader;
 uint8_t logSensorMask;
 const char * const * logSensorTable;
+uint8_t logStateCount;
 const char ** logStateTable;
 uint8_t logStopState;
 
 //*********************************************************************
 // Initialize the log buffer
 bool logInit(const char ** stateTable,
+             uint8_t stateCount,
              uint8_t stopState,
              const char * const * sensorTable,
              uint8_t sensorMask)
@@ -80,64 +65,155 @@ bool logInit(const char ** stateTable,
     // Attempt to allocate the log buffer
     if (stateTable && sensorTable)
     {
-        if (logBuffer == nullptr)
-            logBuffer = (uint8_t *)r4aMalloc(logBufferSize, "Log Buffer");
-
         // Save the state table and stop state
+        logStateCount = stateCount;
         logStateTable = stateTable;
         logSensorTable = sensorTable;
         logSensorMask = sensorMask;
         logStopState = stopState;
         logStartUsec = 0;
         logPrintHeader = true;
-        logBufTail = logBuffer;
-        logBufHead = logBuffer;
-        return (logBuffer != nullptr);
+        return r4aRingBufferBegin(&logBuffer, logBufferSize);
     }
     return false;
 }
 
+//*********************************************************************
+// Send the binary log header and the strings used to display the log
+void logBinaryHeader()
+{
+    LOG_BINARY_HEADER header;
+    int index;
+    const char * name;
+    size_t stringBytes;
+
+    // Determine the size of the strings
+    name = robot._challenge->_name;
+    stringBytes = strlen(name) + 1;
+    for (index = 0; index < logStateCount; index++)
+        stringBytes += strlen(logStateTable[index]) + 1;
+    for (index = 0; index <= logSensorMask; index++)
+        stringBytes += strlen(logSensorTable[index]) + 1;
+
+    // Describe the log entries
+    memset(&header, 0, sizeof(header));
+    header._magic = LOG_BINARY_MAGIC;
+    header._version = LOG_BINARY_VERSION;
+    header._headerBytes = sizeof(header);
+    header._entryBytes = sizeof(LOG_ENTRY);
+    header._stringBytes = stringBytes;
+    header._stateCount = logStateCount;
+    header._sensorCount = logSensorMask + 1;
+    header._startUsec = logStartUsec;
+    header._sensorMask = logSensorMask;
+    header._stopState = logStopState;
+    logPrint->write((const uint8_t *)&header, sizeof(header));
+
+    // Send the strings
+    logPrint->write((const uint8_t *)name, strlen(name) + 1);
+    for (index = 0; index < logStateCount; index++)
+        logPrint->write((const uint8_t *)logStateTable[index],
+                        strlen(logStateTable[index]) + 1);
+    for (index = 0; index <= logSensorMask; index++)
+        logPrint->write((const uint8_t *)logSensorTable[index],
+                        strlen(logSensorTable[index]) + 1);
+}
+
+//*********************************************************************
+// Send the log entries as binary records, the Log_Decoder application
+// formats the log on the host
+// Outputs:
+//   Returns true if log entries were sent
+bool logBinaryPrint()
+{
+    uint8_t buffer[LOG_BINARY_BUFFER_BYTES];
+    LOG_BINARY_END * end;
+    LOG_ENTRY * logEntry;
+    uint16_t length;
+    size_t offset;
+    LOG_BINARY_RECORD * record;
+    bool stop;
+    uint8_t type;
+
+    // Send the header before the first entry
+    if (logPrintHeader)
+    {
+        if (r4aRingBufferPeek(&logBuffer) == nullptr)
+            return false;
+        logPrintHeader = false;
+        logBinaryHeader();
+    }
+
+    // Copy the log entries into the buffer
+    offset = 0;
+    stop = false;
+    while ((offset + sizeof(*record) + sizeof(*logEntry) + sizeof(*record) + sizeof(*end))
+           <= sizeof(buffer))
+    {
+        logEntry = (LOG_ENTRY *)r4aRingBufferPeek(&logBuffer, &type, &length);
+        if (logEntry == nullptr)
+            break;
+        record = (LOG_BINARY_RECORD *)&buffer[offset];
+        record->_type = type;
+        record->_length = length;
+        offset += sizeof(*record);
+        memcpy(&buffer[offset], logEntry, length);
+        offset += length;
+        stop = (logEntry->_state == logStopState);
+        r4aRingBufferRelease(&logBuffer);
+
+        // Mark the end of the log
+        if (stop)
+        {
+            record = (LOG_BINARY_RECORD *)&buffer[offset];
+            record->_type = LOG_TYPE_END;
+            record->_length = sizeof(*end);
+            offset += sizeof(*record);
+            end = (LOG_BINARY_END *)&buffer[offset];
+            end->_entriesDropped = logBuffer._recordsDropped;
+            offset += sizeof(*end);
+            break;
+        }
+    }
+
+    // Send the records
+    if (offset)
+        logPrint->write(buffer, offset);
+
+    // Disable further logging
+    if (stop)
+        logPrint = nullptr;
+    return (offset != 0) && (stop == false);
+}
+
 //*********************************************************************
 // Log the line sensor data and robot state
-void logLineSensorData(uint32_t currentUsec, uint8_t state, uint8_t pow2Length)
+void logLineSensorData(uint32_t currentUsec, uint8_t state)
 {
     LOG_ENTRY * logEntry;
-    LOG_ENTRY * logNext;
 
     // Verify that logging is running
-    if ((logPrint == nullptr)       // Not logging
-        || (logBuffer == nullptr)   // No buffer
-        || (logBufHead == nullptr)) // No head
+    if (logPrint == nullptr)    // Not logging
         return;
 
-    // Determine the next buffer location
-    logEntry = (LOG_ENTRY *)logBufHead;
-    if (pow2Length)
-        logNext = (LOG_ENTRY *)((uint8_t *)logEntry + (1 << pow2Length));
-    else
-        logNext = logEntry;
-    if (logNext >= (LOG_ENTRY *)&logBuffer[logBufferSize])
-        logNext = (LOG_ENTRY *)logBuffer;
-
-    // Verify that there is space in the buffer
-    if (logNext == (LOG_ENTRY *)logBufTail)  // Buffer full
-    {
-        Serial.printf("ERROR: Log buffer full, %d uSec!\r\n", currentUsec);
+    // Reserve space in the log buffer, the buffer counts the dropped entries
+    logEntry = (LOG_ENTRY *)r4aRingBufferReserve(&logBuffer,
+                                                 LOG_TYPE_LINE_SENSOR,
+                                                 sizeof(*logEntry));
+    if (logEntry == nullptr)
         return;
-    }
 
     // Add an entry to the log buffer
-    logEntry->_logType = LOG_TYPE_LINE_SENSOR;
-    logEntry->_pow2Length = pow2Length;
     logEntry->_state = state;
     logEntry->_data8 = lineSensors;
+    logEntry->_reserved = 0;
     logEntry->_microSec = currentUsec;
     logEntry->_loopCount = loopCount;
     logEntry->_leftSpeed = robotLeftSpeed;
     logEntry->_rightSpeed = robotRightSpeed;
 
-    // Insert this entry into the log buffer
-    logBufHead = (uint8_t *)logNext;
+    // Make this entry available for printing
+    r4aRingBufferCommit(&logBuffer, logEntry);
 }
 
 //*********************************************************************
@@ -186,7 +262,7 @@ void logLineSensorDisplayHeaderDashes(int sensorHeaderWidth, Print * display)
 
 //*********************************************************************
 // Display the line sensor log entries
-bool logLineSensorPrint(LOG_ENTRY * logEntry, LOG_ENTRY * logNext)
+bool logLineSensorPrint(LOG_ENTRY * logEntry)
 {
     uint32_t deltaSec;
     uint32_t deltaUsec;
@@ -289,6 +365,14 @@ bool logLineSensorPrint(LOG_ENTRY * logEntry, LOG_ENTRY * logNext)
         loopTimesMenu(nullptr, nullptr, logPrint);
         logPrint->printf("\r\n");
 
+        // Display the dropped log entries
+        if (logBuffer._recordsDropped)
+        {
+            logPrint->printf("WARNING: %ld log entries dropped, log buffer full!\r\n",
+                             logBuffer._recordsDropped);
+            logPrint->printf("\r\n");
+        }
+
         // Display the parameters
         logPrint->printf("Parameters\r\n");
         logPrint->printf("----------\r\n");
@@ -306,13 +390,10 @@ bool logLineSensorPrint(LOG_ENTRY * logEntry, LOG_ENTRY * logNext)
 
         // Disable further logging
         logPrint = nullptr;
-        logBufHead = nullptr;
-        logBufTail = nullptr;
-        logNext = nullptr;
     }
 
     // Remove this entry from the log buffer
-    logBufTail = (uint8_t *)logNext;
+    r4aRingBufferRelease(&logBuffer);
 
     // Successfully output the data
     return true;
@@ -323,30 +404,21 @@ bool logLineSensorPrint(LOG_ENTRY * logEntry, LOG_ENTRY * logNext)
 bool logPrintData()
 {
     LOG_ENTRY * logEntry;
-    LOG_ENTRY * logNext;
+    uint8_t logType;
 
     // Verify that logging is enabled
-    if ((logPrint == nullptr)           // No output device
-        || (logBuffer == nullptr)       // No buffer
-        || (logBufHead == nullptr)      // No head
-        || (logBufTail == nullptr))     // No tail
-    {
+    if (logPrint == nullptr)    // No output device
         return false;
-    }
+
+    // Send the raw log entries
+    if (logBinary)
+        return logBinaryPrint();
 
     // Determine if the buffer is empty
-    if (logBufHead == logBufTail)   // Empty list
+    logEntry = (LOG_ENTRY *)r4aRingBufferPeek(&logBuffer, &logType);
+    if (logEntry == nullptr)    // Empty list
         return false;
 
-    // Compute the location of the next log entry
-    logEntry = (LOG_ENTRY *)logBufTail;
-    if (logEntry->_pow2Length)
-        logNext = (LOG_ENTRY *)((uint8_t *)logEntry + (1 << logEntry->_pow2Length));
-    else
-        logNext = logEntry;
-    if (logNext >= (LOG_ENTRY *)&logBuffer[logBufferSize])
-        logNext = (LOG_ENTRY *)logBuffer;
-
     // Print the log entry
-    return logPrintDataRoutine[logEntry->_logType](logEntry, logNext);
+    return logPrintDataRoutine[logType](logEntry);
 }
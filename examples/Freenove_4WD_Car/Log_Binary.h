@@ -0,0 +1,66 @@
+/**********************************************************************
+  Log_Binary.h
+
+  Binary log stream format, shared with the Log_Decoder application
+**********************************************************************/
+
+#include <stdint.h>
+
+#ifndef __LOG_BINARY_H__
+#define __LOG_BINARY_H__
+
+//  +--------+---------+--------+--------+--------+-----+--------+
+//  | Header | Strings | Record | Record | Record | ... | End    |
+//  +--------+---------+--------+--------+--------+-----+--------+
+//
+// The strings are zero terminated and contain the challenge name, the
+// state names and the line sensor names.  Each record starts with a
+// LOG_BINARY_RECORD followed by _length bytes of data.
+
+#define LOG_BINARY_MAGIC        0x4c413452  // "R4AL"
+#define LOG_BINARY_VERSION      1
+
+enum LOG_TYPE
+{
+    LOG_TYPE_LINE_SENSOR = 0,   // LOG_ENTRY
+    LOG_TYPE_END = 0xff,        // LOG_BINARY_END
+};
+
+typedef struct _LOG_BINARY_HEADER
+{
+    uint32_t _magic;            // LOG_BINARY_MAGIC
+    uint16_t _version;          // LOG_BINARY_VERSION
+    uint16_t _headerBytes;      // sizeof(LOG_BINARY_HEADER)
+    uint16_t _entryBytes;       // sizeof(LOG_ENTRY)
+    uint16_t _stringBytes;      // Number of bytes of strings following the header
+    uint16_t _stateCount;       // Number of state names
+    uint16_t _sensorCount;      // Number of line sensor names
+    uint32_t _startUsec;        // Challenge start time in microseconds
+    uint8_t _sensorMask;        // Mask applied to the line sensor data
+    uint8_t _stopState;         // State value when the robot is stopped
+    uint8_t _reserved[2];
+} LOG_BINARY_HEADER;
+
+typedef struct _LOG_BINARY_RECORD
+{
+    uint8_t _type;              // LOG_TYPE_*
+    uint8_t _length;            // Number of data bytes following this header
+} LOG_BINARY_RECORD;
+
+typedef struct _LOG_ENTRY
+{
+    uint8_t _state;
+    uint8_t _data8;
+    uint16_t _reserved;
+    uint32_t _microSec;
+    uint32_t _loopCount;
+    int16_t _leftSpeed;
+    int16_t _rightSpeed;
+} LOG_ENTRY;
+
+typedef struct _LOG_BINARY_END
+{
+    uint32_t _entriesDropped;   // Number of log entries dropped by the robot
+} LOG_BINARY_END;
+
+#endif  // __LOG_BINARY_H__
@@ -139,6 +139,7 @@ void menuSetLogPrint(const struct _R4A_MENU_ENTRY * menuEntry,
                      const char * command,
                      Print * display)
 {
+    logBinary = (menuEntry->menuParameter != 0);
     logPrint = display;
 }
 
@@ -152,7 +153,7 @@ void robotMenuStop(const R4A_MENU_ENTRY * menuEntry,
                    const char * command,
                    Print * display)
 {
-    r4aRobotStop(&robot, millis(), display);
+    robotCommandExecute(robotCommandStop, 0, display);
 }
 
 //*********************************************************************
@@ -254,16 +255,33 @@ const R4A_MENU_ENTRY debugMenuTable[] =
     // Command  menuRoutine                 menuParam       HelpRoutine align   HelpText
     {"g",       nullptr,                    MTI_GPIO,       nullptr,    0,      "Enter the GPIO menu"},
     {"h",       r4aEsp32MenuDisplayHeap,    0,              nullptr,    0,      "Display the heap"},
+    {"hp",  r4aEsp32HeapProfileMenuDisplay, 20,             nullptr,    0,      "Display the top 20 heap consumers by tag"},
+    {"hpj", r4aEsp32HeapProfileMenuDump,    0,              nullptr,    0,      "Dump the heap profile as JSON"},
+    {"hpr", r4aEsp32HeapProfileMenuReset,   0,              nullptr,    0,      "Reset the heap profile peaks and counters"},
+    {"hpt", r4aEsp32HeapProfileMenuToggle,  0,              nullptr,    0,      "Toggle heap profiling"},
 #ifdef  USE_I2C
     {"i",       nullptr,                    MTI_I2C,        nullptr,    0,      "I2C menu"},
+    {"ic",  r4aEsp32I2cMenuStatsClear,  (intptr_t)&esp32I2cBus, nullptr, 0, "Clear the I2C transaction statistics"},
+    {"id",  r4aEsp32I2cMenuStatsDump,   (intptr_t)&esp32I2cBus, nullptr, 0, "Dump the I2C transaction statistics as JSON"},
+    {"ir",  r4aEsp32I2cMenuRefresh,     (intptr_t)&esp32I2cBus, nullptr, 0, "Probe the I2C bus and update the presence map"},
+    {"is",  r4aEsp32I2cSchedulerMenuStats, (intptr_t)&i2cScheduler, nullptr, 0, "Display the I2C scheduler statistics"},
+    {"it",  r4aEsp32I2cMenuStats,       (intptr_t)&esp32I2cBus, nullptr, 0, "Display the I2C transaction statistics"},
     {"l",       nullptr,                    MTI_LED_MATRIX, nullptr,    0,      "LED matrix menu"},
     {"m",       nullptr,                    MTI_MOTOR,      nullptr,    0,      "Motor menu"},
 #endif  // USE_I2C
     {"p",    r4aEsp32MenuDisplayPartitions, 0,              nullptr,    0,      "Display the partitions"},
+    {"pool",    r4aEsp32PoolMenuStats,      0,              nullptr,    0,      "Display the memory pool statistics"},
+    {"q",  r4aEsp32CommandQueueMenuStats, (intptr_t)&robotCommandQueue, nullptr, 0, "Display the robot command queue statistics"},
 #ifdef  USE_I2C
     {"s",       nullptr,                    MTI_SERVO,      nullptr,    0,      "Servo menu"},
 #endif  // USE_I2C
+    {"spi",     r4aEsp32SpiMenuStats,       0,              nullptr,    0,      "Display the SPI and WS2812 frame statistics"},
+#ifdef  USE_OV2640
+    {"ss",      r4aOv2640MenuStreamStats,   0,              nullptr,    0,      "Display the camera stream statistics"},
+    {"st",      r4aOv2640MenuTiming,        0,              nullptr,    0,      "Display the camera image timing"},
+#endif  // USE_OV2640
     {"w",       nullptr,                    MTI_WS2812_LED, nullptr,    0,      "WS2812 RGB LED menu"},
+    {"wsb", r4aWebServerMenuBufferSpeed, (intptr_t)"ffff", r4aMenuHelpSuffix, 4, "Display the MB/s reading file ffff for each web server buffer size"},
     {"x",       nullptr,                    R4A_MENU_MAIN,  nullptr,    0,      "Return to the main menu"},
 };
 #define DEBUG_MENU_ENTRIES      sizeof(debugMenuTable) / sizeof(debugMenuTable[0])
@@ -366,6 +384,7 @@ const R4A_MENU_ENTRY wayPointMenuTable[] =
 {
     // Command  menuRoutine                 menuParam               HelpRoutine         align   HelpText
     {"a",       r4aEsp32WpMenuAddPoint,     (intptr_t)"comment",    r4aMenuHelpSuffix,  7,      "Add a point to the file"},
+    {"bin",     r4aEsp32WpMenuConvertToBinary, 0,                   nullptr,            0,      "Convert the waypoint file to binary"},
     {"cat",     r4aEsp32NvmMenuFileCat,     (intptr_t)"ffff",       r4aMenuHelpSuffix,  4,      "Display the contents of file ffff"},
     {"cp",      r4aEsp32NvmMenuFileCopy,    (intptr_t)"src dest",   r4aMenuHelpSuffix,  8,      "Copy src file to dest file"},
     {"dp",      r4aEsp32WpMenuDisplayPoint, 0,                      nullptr,            0,      "Display the next waypoint"},
@@ -375,7 +394,9 @@ const R4A_MENU_ENTRY wayPointMenuTable[] =
     {"mv",      r4aEsp32NvmMenuFileMove,    (intptr_t)"src dest",   r4aMenuHelpSuffix,  8,      "Rename a file"},
     {"p",       r4aEsp32WpMenuPrintFile,    0,                      nullptr,            0,      "Print the waypoint file contents"},
     {"rm",      r4aEsp32NvmMenuFileRemove,  (intptr_t)"ffff",       r4aMenuHelpSuffix,  4,      "Remove file ffff"},
+    {"txt",     r4aEsp32WpMenuConvertToText, 0,                     nullptr,            0,      "Convert the binary waypoint file to text"},
     {"wget",    r4aEsp32NvmMenuHttpFileGet, (intptr_t)"url",        r4aMenuHelpSuffix,  3,      "Get a file from a web server"},
+    {"ws",      r4aEsp32WpMenuWriterStats,  0,                      nullptr,            0,      "Display the waypoint writer statistics"},
     {"x",       nullptr,                    R4A_MENU_MAIN,          nullptr,            0,      "Exit the menu system"},
 };
 #define WAYPOINT_MENU_ENTRIES  sizeof(wayPointMenuTable) / sizeof(wayPointMenuTable[0])
@@ -435,6 +456,7 @@ const R4A_MENU_ENTRY mainMenuTable[] =
 #endif  // USE_OV2640
     {"i",  r4aMenuBoolToggle, (intptr_t)&ignoreBatteryCheck, r4aMenuBoolHelp, 0, "Ignore the battery check"},
     {"log",     menuSetLogPrint,    0,              nullptr,    0,      "Set log print path"},
+    {"logb",    menuSetLogPrint,    1,              nullptr,    0,      "Set binary log path, use Log_Decoder"},
     {"nvm",     nullptr,            MTI_NVM,        nullptr,    0,      "Enter the NVM menu"},
     {"r",  r4aEsp32MenuSystemReset, 0,              nullptr,    0,      "System reset"},
 #ifdef  USE_I2C
@@ -12,6 +12,7 @@
 
 #define OV2640_DETAILS_PAGE     "ov2640-details"
 #define OV2640_JPEG_PAGE        "ov2640-jpeg"
+#define OV2640_STREAM_PAGE      "ov2640-stream"
 
 // URI handler structure for GET OV2640_JPEG_PAGE
 const httpd_uri_t ov2640JpegPageUri =
@@ -19,7 +20,19 @@ const httpd_uri_t ov2640JpegPageUri =
     .uri      = OV2640_JPEG_PAGE,
     .method   = HTTP_GET,
     .handler  = r4aOv2640JpegHandler,
-    .user_ctx = (void *)ov2640JpegHandlerProcessFrameBuffer,
+    .user_ctx = (void *)ov2640ProcessWebServerFrameBuffer,
+    .is_websocket = true,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = nullptr,
+};
+
+// URI handler structure for GET OV2640_STREAM_PAGE
+const httpd_uri_t ov2640StreamPageUri =
+{
+    .uri      = OV2640_STREAM_PAGE,
+    .method   = HTTP_GET,
+    .handler  = r4aOv2640StreamHandler,
+    .user_ctx = (void *)ov2640ProcessWebServerFrameBuffer,
     .is_websocket = true,
     .handle_ws_control_frames = false,
     .supported_subprotocol = nullptr,
@@ -63,6 +76,15 @@ bool ov2640RegisterUriHandlers(R4A_WEB_SERVER * object)
                 break;
             }
 
+            // Add the OV2640 JPEG stream page
+            error = httpd_register_uri_handler(object->_webServer, &ov2640StreamPageUri);
+            if (error != ESP_OK)
+            {
+                if (r4aWebServerDebug)
+                    r4aWebServerDebug->printf("ERROR: Failed to register stream handler, error: %d!\r\n", error);
+                break;
+            }
+
             // Add the OV2640 details page
             error = httpd_register_uri_handler(object->_webServer, &ov2640DetailsUri);
             if (error != ESP_OK)
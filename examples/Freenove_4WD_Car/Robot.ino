@@ -7,6 +7,51 @@
 bool robotPreviousNtpTime;
 bool robotNtpTimeRestoreNecessary;
 
+extern TaskHandle_t loopTaskHandle;
+
+//*********************************************************************
+// Execute a robot command on core 1 between the robot updates and wait
+// for the command to complete.  Setup and loop run on the loop task, so
+// the command executes directly when called from that task.
+// Inputs:
+//   routine: Routine for loop to execute
+//   parameter: Parameter for the routine
+//   display: Device used for output
+void robotCommandExecute(R4A_ESP32_COMMAND_ROUTINE routine,
+                         intptr_t parameter,
+                         Print * display)
+{
+    r4aEsp32CommandQueueExecute((xTaskGetCurrentTaskHandle() == loopTaskHandle)
+                                    ? nullptr : &robotCommandQueue,
+                                routine,
+                                parameter,
+                                display,
+                                ROBOT_COMMAND_TIMEOUT_USEC);
+}
+
+//*********************************************************************
+// Start a challenge, executed by loop on core 1
+// Inputs:
+//   parameter: Address of the R4A_ROBOT_CHALLENGE
+//   display: Device used for output
+void robotCommandStart(intptr_t parameter, Print * display)
+{
+    r4aRobotStart(&robot,
+                  (R4A_ROBOT_CHALLENGE *)parameter,
+                  robotStartDelaySec,
+                  display);
+}
+
+//*********************************************************************
+// Stop the robot, executed by loop on core 1
+// Inputs:
+//   parameter: Not used
+//   display: Device used for output
+void robotCommandStop(intptr_t parameter, Print * display)
+{
+    r4aRobotStop(&robot, millis(), display);
+}
+
 //*********************************************************************
 // Called when the robot starts
 bool robotCheckBatteryLevel()
@@ -131,6 +176,32 @@ bool robotMotorSetSpeeds(int16_t left, int16_t right, Print * display)
            && pca9685.writeBufferedRegisters(display);
 }
 
+//*********************************************************************
+// Get the latest PCF8574 line sensor values
+// Outputs:
+//   Returns true when lineSensors was updated and false when the value
+//   published by the I2C scheduler is stale or the last read failed
+bool robotReadLineSensors()
+{
+    R4A_ESP32_I2C_SNAPSHOT snapshot;
+
+    // Read the PCF8574 when the I2C scheduler is not running
+    if (!i2cScheduler._task)
+    {
+        pcf8574.read(&lineSensors);
+        lineSensors &= 7;
+        return true;
+    }
+
+    // Use the value published by the I2C scheduler task
+    if ((!r4aEsp32I2cJobSnapshot(&i2cJobTable[I2C_JOB_PCF8574], &snapshot))
+        || snapshot._failed
+        || ((esp_timer_get_time() - snapshot._usec) > LINE_SENSOR_MAX_AGE_USEC))
+        return false;
+    lineSensors = snapshot._data[0] & 7;
+    return true;
+}
+
 //*********************************************************************
 // Restore the time display state
 void robotNtpTimeRestore()
@@ -150,3 +221,15 @@ void robotNtpTimeSave()
     robotNtpTimeRestoreNecessary = robotNtpTime;
     robotNtpTime = false;
 }
+
+//*********************************************************************
+// Start the robot challenge if the robot is not active.  The challenge
+// start routines verify the devices and read their files on the menu
+// task, only the robot start executes on core 1.
+// Inputs:
+//   challenge: Address of the R4A_ROBOT_CHALLENGE to start
+//   display: Device used for output
+void robotStart(R4A_ROBOT_CHALLENGE * challenge, Print * display)
+{
+    robotCommandExecute(robotCommandStart, (intptr_t)challenge, display);
+}
@@ -6,6 +6,15 @@
 
 #ifdef  USE_WAYPOINT_FOLLOWING
 
+//****************************************
+// Constants
+//****************************************
+
+#define WPF_LOG_BUFFER_BYTES    8192    // Log ring buffer size in bytes
+#define WPF_LOG_FLUSH_BYTES     2048    // Write the log when this many bytes are buffered
+#define WPF_LOG_FLUSH_MSEC      1000    // Write the log at least once a second
+#define WPF_READ_BUFFER_BYTES   1024    // Waypoint file read buffer size in bytes
+
 //****************************************
 // Types
 //****************************************
@@ -22,9 +31,9 @@ typedef struct _WAYPOINT_FOLLOWING
     uint32_t _previousLogMsec;
     double _previousLong; // Previous longitude in degrees (-180 to 180)
     uint8_t _satellitesInView; // Number of satellites in view
+    R4A_ESP32_WP_FILE _wpBinaryFile; // Binary waypoint file
     int _wpCount; // Number of waypoints
-    File _wpFile; // Waypoint file
-    File _wpLogFile; // Waypoint log file
+    R4A_ESP32_FILE_WRITER _wpLogFile; // Waypoint log file
 } WAYPOINT_FOLLOWING;
 
 //****************************************
@@ -133,15 +142,7 @@ void wpfChallenge(R4A_ROBOT_CHALLENGE * object)
 bool wpfGetWaypoint()
 {
     bool wayPointAvailable;
-    wayPointAvailable = r4aEsp32WpReadPoint(&wpfData._wpFile,
-                                            &wpfData._latitude,
-                                            &wpfData._longitude,
-                                            &wpfData._altitude,
-                                            &wpfData._horizontalAccuracy,
-                                            &wpfData._horizontalAccuracyStdDev,
-                                            &wpfData._satellitesInView,
-                                            &wpfData._comment,
-                                            (Print *)&wpfData._wpLogFile);
+    wayPointAvailable = wpfReadWaypoint();
     if (wayPointAvailable)
         wpfLogWayPoint();
     else
@@ -161,15 +162,11 @@ void wpfInit(R4A_ROBOT_CHALLENGE * object)
 
     // Get the initial waypoint
     wpfData._wpCount = 0;
-    if (r4aEsp32WpReadPoint(&wpfData._wpFile,
-                            &wpfData._latitude,
-                            &wpfData._longitude,
-                            &wpfData._altitude,
-                            &wpfData._horizontalAccuracy,
-                            &wpfData._horizontalAccuracyStdDev,
-                            &wpfData._satellitesInView,
-                            &wpfData._comment,
-                            (Print *)&wpfData._wpLogFile) == false)
+    String binaryPath = r4aEsp32WpBinaryFilePath();
+    if ((r4aEsp32WpBinaryOpen(&wpfData._wpBinaryFile,
+                              binaryPath.c_str(),
+                              (Print *)&wpfData._wpLogFile) == false)
+        || (wpfReadWaypoint() == false))
     {
         // Failed to read the initial waypoint, stop the robot
         r4aRobotStop(&robot, millis(), (Print *)&wpfData._wpLogFile);
@@ -232,6 +229,32 @@ void wpfLogWayPoint()
                               wpfData._comment.c_str());
 }
 
+//*********************************************************************
+// Read the current waypoint from the binary waypoint file
+// Outputs:
+//   Returns true if the waypoint was successfully read
+bool wpfReadWaypoint()
+{
+    R4A_ESP32_WP_POINT point;
+
+    // Read the waypoint
+    if (!r4aEsp32WpBinaryReadPoint(&wpfData._wpBinaryFile,
+                                   wpfData._wpCount,
+                                   &point,
+                                   (Print *)&wpfData._wpLogFile))
+        return false;
+
+    // Save the waypoint
+    wpfData._altitude = point._altitude;
+    wpfData._comment = String(point._comment);
+    wpfData._horizontalAccuracy = point._horizontalAccuracy;
+    wpfData._horizontalAccuracyStdDev = point._horizontalAccuracyStdDev;
+    wpfData._latitude = point._latitude;
+    wpfData._longitude = point._longitude;
+    wpfData._satellitesInView = point._satellitesInView;
+    return true;
+}
+
 //*********************************************************************
 // Start the waypoint following
 // Inputs:
@@ -284,8 +307,13 @@ void wpfStart(Print * display)
         path = filePath.c_str();
         logFilePath = String("/") + String(wpLogFileName);
         logPath = logFilePath.c_str();
-        wpfData._wpLogFile = LittleFS.open(logPath, FILE_WRITE);
-        if (!wpfData._wpLogFile)
+        if (!wpfData._wpLogFile.begin(logPath,
+                                      FILE_WRITE,
+                                      nullptr,
+                                      WPF_LOG_BUFFER_BYTES,
+                                      WPF_LOG_FLUSH_BYTES,
+                                      WPF_LOG_FLUSH_MSEC,
+                                      display))
             display->printf("ERROR: Failed to open the log file %s!\r\n", wpLogFileName);
         else if (LittleFS.exists(path) == false)
             display->printf("ERROR: Waypoint file %s does not exist!\r\n", r4aEsp32WpFileName);
@@ -294,10 +322,12 @@ void wpfStart(Print * display)
             double altitude;
             String comment;
             File file;
+            uint8_t * fileBuffer;
             double horizontalAccuracy;
             double horizontalAccuracyStdDev;
             double latitude;
             double longitude;
+            R4A_ESP32_NVM_LINE_READER reader;
             uint8_t satellitesInView;
             const char * format  = "%3d   %14.9f   %14.9f   %10.3f   %9.3f   %9.3f   %3d   %s\r\n";
             //                      123   -123.123456789   -123.123456789   123456.123   12345.123   12345.123   123   1234567
@@ -326,10 +356,21 @@ void wpfStart(Print * display)
             display->printf("%s", header2);
             wpfData._wpLogFile.printf("%s", header2);
 
+            // Allocate the read buffer from the heap instead of the stack
+            fileBuffer = (uint8_t *)r4aMalloc(WPF_READ_BUFFER_BYTES, "WPF read buffer (fileBuffer)");
+            if (!fileBuffer)
+                display->printf("ERROR: Failed to allocate the waypoint file read buffer!\r\n");
+
             // Display the waypoints
-            for (int count = 1; ; count++)
+            r4aEsp32WpWriter.flush();
+            if (fileBuffer)
+            {
+                file = LittleFS.open(path, FILE_READ);
+                r4aEsp32NvmLineReaderBegin(&reader, &file, fileBuffer, WPF_READ_BUFFER_BYTES);
+            }
+            for (int count = 1; file; count++)
             {
-                if (r4aEsp32WpReadPoint(&file,
+                if (r4aEsp32WpReadPoint(&reader,
                                         &latitude,
                                         &longitude,
                                         &altitude,
@@ -358,14 +399,21 @@ void wpfStart(Print * display)
                                           satellitesInView,
                                           comment.c_str());
             }
+            if (file)
+                file.close();
+            if (fileBuffer)
+                r4aFree(fileBuffer, "WPF read buffer (fileBuffer)");
             display->println();
             wpfData._wpLogFile.println();
+            wpfData._wpLogFile.flush();
 
-            // Start the robot challenge if the robot is not active
-            r4aRobotStart(&robot,
-                          &wayPointFollowing,
-                          robotStartDelaySec,
-                          display);
+            // Build the binary waypoint file used while the robot is running
+            String binaryPath = r4aEsp32WpBinaryFilePath();
+            if (r4aEsp32WpConvertToBinary(path, binaryPath.c_str(), display))
+            {
+                // Start the robot challenge if the robot is not active
+                robotStart(&wayPointFollowing, display);
+            }
         }
     }
 }
@@ -397,6 +445,16 @@ void wpfStartMenu(const struct _R4A_MENU_ENTRY * menuEntry,
 void wpfStop(R4A_ROBOT_CHALLENGE * object)
 {
     challengeStop();
+
+    // Done with the waypoint file
+    r4aEsp32WpBinaryClose(&wpfData._wpBinaryFile);
+
+    // Write the buffered log data to the file from the flush task, don't
+    // delay the motor stop waiting for the flash write
+    wpfData._wpLogFile.flushAsync();
+    if (wpfData._wpLogFile.recordsDropped())
+        Serial.printf("WARNING: %ld log records dropped, see %s\r\n",
+                      wpfData._wpLogFile.recordsDropped(), wpLogFileName);
 }
 
 #endif  // USE_WAYPOINT_FOLLOWING
@@ -0,0 +1,200 @@
+/**********************************************************************
+  I2C_Stats_Test.cpp
+
+  Program to test the I2C transaction statistics (src/I2C_Stats.cpp).
+  The tests verify the latency histogram bucket boundaries, the NAK,
+  timeout and error counters, the device table limit and the latency
+  percentiles computed from the histogram.  The benchmark measures the
+  time to record a transaction.  The program exits with a non-zero
+  status when a test fails.
+**********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/R4A_ESP32_I2C_Stats.h"
+
+#define BENCHMARK_RECORDS       (10 * 1000 * 1000)
+
+//****************************************
+// Locals
+//****************************************
+
+static R4A_ESP32_I2C_STATS stats;
+
+//*********************************************************************
+// Get the host time in microseconds
+static uint64_t usec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000000ull) + (now.tv_nsec / 1000);
+}
+
+//*********************************************************************
+// Verify a value
+static bool check(const char * test, const char * name, uint64_t value, uint64_t expected)
+{
+    if (value == expected)
+        return true;
+    fprintf(stderr, "ERROR: %s, %s is %llu, expecting %llu!\n",
+            test, name, (unsigned long long)value, (unsigned long long)expected);
+    return false;
+}
+
+//*********************************************************************
+// Verify the latency histogram bucket boundaries
+static bool histogramTest()
+{
+    int bucket;
+    R4A_ESP32_I2C_DEVICE_STATS * deviceStats;
+    char name[32];
+    bool success;
+    uint32_t usecs[] =
+    {
+        0, 31,                  // Bucket 0
+        32, 63,                 // Bucket 1
+        64, 127,                // Bucket 2
+        32 << 9, (32 << 10) - 1,// Bucket 10
+        32 << 10, 0xffffffff,   // Bucket 11, no upper limit
+    };
+    int expected[R4A_ESP32_I2C_HISTOGRAM_BUCKETS] = {2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 2, 2};
+
+    memset(&stats, 0, sizeof(stats));
+    for (int index = 0; index < (int)(sizeof(usecs) / sizeof(usecs[0])); index++)
+        r4aEsp32I2cStatsRecord(&stats, 0x20, 1, ESP_OK, usecs[index]);
+
+    deviceStats = &stats._device[0];
+    success = check("histogram", "devices", stats._devices, 1)
+           && check("histogram", "transactions", deviceStats->_transactions, 10)
+           && check("histogram", "maxUsec", deviceStats->_maxUsec, 0xffffffff);
+    for (bucket = 0; success && (bucket < R4A_ESP32_I2C_HISTOGRAM_BUCKETS); bucket++)
+    {
+        snprintf(name, sizeof(name), "bucket %d", bucket);
+        success = check("histogram", name, deviceStats->_histogram[bucket], expected[bucket]);
+    }
+    printf("%s: histogram bucket boundaries\n", success ? "PASS" : "FAIL");
+    return success;
+}
+
+//*********************************************************************
+// Verify the status counters and the device table
+static bool countersTest()
+{
+    uint8_t address;
+    R4A_ESP32_I2C_DEVICE_STATS * deviceStats;
+    bool success;
+
+    memset(&stats, 0, sizeof(stats));
+    r4aEsp32I2cStatsRecord(&stats, 0x40, 3, ESP_OK, 100);
+    r4aEsp32I2cStatsRecord(&stats, 0x40, 2, ESP_FAIL, 100);
+    r4aEsp32I2cStatsRecord(&stats, 0x40, 2, ESP_ERR_INVALID_STATE, 100);
+    r4aEsp32I2cStatsRecord(&stats, 0x40, 1, ESP_ERR_TIMEOUT, 500);
+    r4aEsp32I2cStatsRecord(&stats, 0xc0, 1, 0x102, 100);  // Address is masked to 0x40
+
+    deviceStats = &stats._device[0];
+    success = check("counters", "devices", stats._devices, 1)
+           && check("counters", "address", deviceStats->_i2cAddress, 0x40)
+           && check("counters", "transactions", deviceStats->_transactions, 5)
+           && check("counters", "bytes", deviceStats->_bytes, 9)
+           && check("counters", "naks", deviceStats->_naks, 2)
+           && check("counters", "timeouts", deviceStats->_timeouts, 1)
+           && check("counters", "errors", deviceStats->_errors, 1)
+           && check("counters", "totalUsec", deviceStats->_totalUsec, 900)
+           && check("counters", "maxUsec", deviceStats->_maxUsec, 500);
+
+    // Fill the device table, the following devices are dropped
+    for (address = 0; success && (address < (R4A_ESP32_I2C_STATS_DEVICES + 4)); address++)
+        r4aEsp32I2cStatsRecord(&stats, 0x08 + address, 1, ESP_OK, 10);
+    success = success
+           && check("counters", "devices", stats._devices, R4A_ESP32_I2C_STATS_DEVICES)
+           && check("counters", "dropped", stats._dropped, 5)
+           && check("counters", "last address",
+                    stats._device[R4A_ESP32_I2C_STATS_DEVICES - 1]._i2cAddress,
+                    0x08 + R4A_ESP32_I2C_STATS_DEVICES - 2);
+    printf("%s: status counters and device table\n", success ? "PASS" : "FAIL");
+    return success;
+}
+
+//*********************************************************************
+// Verify the percentiles computed from the histogram
+static bool percentileTest()
+{
+    R4A_ESP32_I2C_DEVICE_STATS * deviceStats;
+    int index;
+    bool success;
+
+    // 90 transactions at 50 uSec, 9 at 200 uSec and 1 at 5000 uSec
+    memset(&stats, 0, sizeof(stats));
+    for (index = 0; index < 90; index++)
+        r4aEsp32I2cStatsRecord(&stats, 0x20, 1, ESP_OK, 50);
+    for (index = 0; index < 9; index++)
+        r4aEsp32I2cStatsRecord(&stats, 0x20, 1, ESP_OK, 200);
+    r4aEsp32I2cStatsRecord(&stats, 0x20, 1, ESP_OK, 5000);
+
+    deviceStats = &stats._device[0];
+    success = check("percentile", "p1", r4aEsp32I2cStatsPercentile(deviceStats, 1), 63)
+           && check("percentile", "p50", r4aEsp32I2cStatsPercentile(deviceStats, 50), 63)
+           && check("percentile", "p90", r4aEsp32I2cStatsPercentile(deviceStats, 90), 63)
+           && check("percentile", "p91", r4aEsp32I2cStatsPercentile(deviceStats, 91), 255)
+           && check("percentile", "p99", r4aEsp32I2cStatsPercentile(deviceStats, 99), 255)
+           && check("percentile", "p100", r4aEsp32I2cStatsPercentile(deviceStats, 100), 5000);
+
+    // The maximum limits the end of the bucket
+    memset(&stats, 0, sizeof(stats));
+    r4aEsp32I2cStatsRecord(&stats, 0x20, 1, ESP_OK, 70);
+    success = success
+           && check("percentile", "single", r4aEsp32I2cStatsPercentile(&stats._device[0], 50), 70);
+
+    // The last bucket reports the maximum
+    memset(&stats, 0, sizeof(stats));
+    r4aEsp32I2cStatsRecord(&stats, 0x20, 1, ESP_OK, 1000000);
+    success = success
+           && check("percentile", "last bucket", r4aEsp32I2cStatsPercentile(&stats._device[0], 50), 1000000);
+
+    // No transactions
+    memset(&stats, 0, sizeof(stats));
+    success = success
+           && check("percentile", "empty", r4aEsp32I2cStatsPercentile(&stats._device[0], 50), 0);
+    printf("%s: latency percentiles\n", success ? "PASS" : "FAIL");
+    return success;
+}
+
+//*********************************************************************
+// Measure the time to record a transaction
+static void recordBenchmark()
+{
+    uint64_t elapsedUsec;
+    uint32_t index;
+    uint64_t startUsec;
+
+    memset(&stats, 0, sizeof(stats));
+    startUsec = usec();
+    for (index = 0; index < BENCHMARK_RECORDS; index++)
+        r4aEsp32I2cStatsRecord(&stats,
+                               0x20 + (index & 7),
+                               4,
+                               (index & 0xff) ? ESP_OK : ESP_FAIL,
+                               (index * 2654435761u) >> 20);
+    elapsedUsec = usec() - startUsec;
+    printf("%d records in %llu uSec, %.1f nSec per record\n",
+           BENCHMARK_RECORDS,
+           (unsigned long long)elapsedUsec,
+           (elapsedUsec * 1000.0) / BENCHMARK_RECORDS);
+}
+
+//*********************************************************************
+// Test the I2C transaction statistics
+int main(int argc, char **argv)
+{
+    bool success;
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    success = histogramTest();
+    success &= countersTest();
+    success &= percentileTest();
+    recordBenchmark();
+    return success ? 0 : -1;
+}
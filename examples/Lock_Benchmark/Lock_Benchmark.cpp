@@ -0,0 +1,382 @@
+/**********************************************************************
+  Lock_Benchmark.cpp
+
+  Program to stress test the ticket lock (src/Atomic.cpp) and compare
+  its throughput under contention against r4aLockAcquire and a pthread
+  mutex.  The program exits with a non-zero status when a stress test
+  fails.
+**********************************************************************/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../src/R4A_ESP32_Lock.h"
+
+#define MAX_THREADS             16
+#define STRESS_ITERATIONS       200000
+#define BENCHMARK_MSEC          500
+
+// Lock types
+enum LOCK_TYPE
+{
+    LOCK_TICKET = 0,
+    LOCK_SPIN,
+    LOCK_MUTEX,
+    LOCK_TYPE_MAX
+};
+
+const char * const lockName[LOCK_TYPE_MAX] =
+{
+    "ticket",
+    "spin",
+    "mutex",
+};
+
+// Thread context
+typedef struct _THREAD_CONTEXT
+{
+    pthread_t _thread;
+    int _lockType;              // Lock to use
+    uint64_t _operations;       // Number of times the lock was acquired
+    uint64_t _maxWaitNsec;      // Longest wait for the lock
+} THREAD_CONTEXT;
+
+// Routines in src/Atomic.cpp declared by R4A_Robot.h on the ESP32
+void r4aLockAcquire(volatile int32_t * lock, int moBefore, int moAfter);
+void r4aLockRelease(volatile int32_t * lock, int moBefore);
+
+//****************************************
+// Locals
+//****************************************
+
+volatile bool benchmarkStop;
+R4A_ESP32_LOCK ticketLock = R4A_ESP32_LOCK_INITIALIZER("Benchmark");
+pthread_mutex_t mutexLock = PTHREAD_MUTEX_INITIALIZER;
+volatile int32_t spinLock;
+
+// Data protected by the lock
+volatile uint64_t counterA;
+volatile uint64_t counterB;
+volatile uint64_t tornUpdates;
+
+//*********************************************************************
+// Acquire the lock
+void lockAcquire(int lockType)
+{
+    switch (lockType)
+    {
+    case LOCK_TICKET:
+        r4aEsp32LockAcquire(&ticketLock);
+        break;
+
+    case LOCK_SPIN:
+        r4aLockAcquire(&spinLock, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+        break;
+
+    case LOCK_MUTEX:
+        pthread_mutex_lock(&mutexLock);
+        break;
+    }
+}
+
+//*********************************************************************
+// Release the lock
+void lockRelease(int lockType)
+{
+    switch (lockType)
+    {
+    case LOCK_TICKET:
+        r4aEsp32LockRelease(&ticketLock);
+        break;
+
+    case LOCK_SPIN:
+        r4aLockRelease(&spinLock, __ATOMIC_RELEASE);
+        break;
+
+    case LOCK_MUTEX:
+        pthread_mutex_unlock(&mutexLock);
+        break;
+    }
+}
+
+//*********************************************************************
+// Update the protected data, detect updates by other threads
+void criticalSection()
+{
+    uint64_t value;
+
+    value = counterA;
+    counterA = value + 1;
+    if (counterB != value)
+        tornUpdates += 1;
+    counterB = value + 1;
+}
+
+//*********************************************************************
+// Acquire the lock a fixed number of times
+void * stressThread(void * parameter)
+{
+    THREAD_CONTEXT * context;
+    int iteration;
+
+    context = (THREAD_CONTEXT *)parameter;
+    for (iteration = 0; iteration < STRESS_ITERATIONS; iteration++)
+    {
+        lockAcquire(context->_lockType);
+        criticalSection();
+        lockRelease(context->_lockType);
+        context->_operations += 1;
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Acquire the lock until told to stop
+void * benchmarkThread(void * parameter)
+{
+    THREAD_CONTEXT * context;
+    uint64_t startNsec;
+    uint64_t waitNsec;
+
+    context = (THREAD_CONTEXT *)parameter;
+    while (!benchmarkStop)
+    {
+        startNsec = r4aEsp32LockHostNsec();
+        lockAcquire(context->_lockType);
+        waitNsec = r4aEsp32LockHostNsec() - startNsec;
+        criticalSection();
+        lockRelease(context->_lockType);
+        if (context->_maxWaitNsec < waitNsec)
+            context->_maxWaitNsec = waitNsec;
+        context->_operations += 1;
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Run the threads
+// Inputs:
+//   routine: Thread routine
+//   lockType: Lock to use
+//   threads: Number of threads
+//   context: Array of THREAD_CONTEXT structures
+//   msec: Milliseconds to run, zero to wait for the threads to exit
+void runThreads(void * (* routine)(void *),
+                int lockType,
+                int threads,
+                THREAD_CONTEXT * context,
+                int msec)
+{
+    int index;
+    int status;
+
+    // Reset the protected data
+    counterA = 0;
+    counterB = 0;
+    tornUpdates = 0;
+    benchmarkStop = false;
+    r4aEsp32LockClearStats(&ticketLock);
+
+    // Start the threads
+    memset(context, 0, sizeof(*context) * threads);
+    for (index = 0; index < threads; index++)
+    {
+        context[index]._lockType = lockType;
+        status = pthread_create(&context[index]._thread, nullptr, routine, &context[index]);
+        if (status)
+        {
+            fprintf(stderr, "ERROR: Failed to create thread, %s!\n", strerror(status));
+            exit(status);
+        }
+    }
+
+    // Stop the threads
+    if (msec)
+    {
+        usleep(msec * 1000);
+        benchmarkStop = true;
+    }
+    for (index = 0; index < threads; index++)
+        pthread_join(context[index]._thread, nullptr);
+}
+
+//*********************************************************************
+// Verify that the lock provides mutual exclusion
+bool stressTest(int lockType, int threads)
+{
+    THREAD_CONTEXT context[MAX_THREADS];
+    uint64_t expected;
+    bool success;
+
+    runThreads(stressThread, lockType, threads, context, 0);
+    expected = (uint64_t)threads * STRESS_ITERATIONS;
+    success = (counterA == expected) && (tornUpdates == 0);
+    printf("%s: %-6s %2d threads, %llu updates, %llu torn, %s\n",
+           success ? "PASS" : "FAIL",
+           lockName[lockType],
+           threads,
+           (unsigned long long)counterA,
+           (unsigned long long)tornUpdates,
+           success ? "exclusive" : "NOT exclusive");
+    if ((lockType == LOCK_TICKET) && (ticketLock._acquisitions != expected))
+    {
+        printf("FAIL: ticket lock counted %u acquisitions, expected %llu\n",
+               ticketLock._acquisitions, (unsigned long long)expected);
+        success = false;
+    }
+    return success;
+}
+
+//*********************************************************************
+// Hold the ticket lock for a while
+void * holdThread(void * parameter)
+{
+    r4aEsp32LockAcquire(&ticketLock);
+    usleep(20 * 1000);
+    r4aEsp32LockRelease(&ticketLock);
+    return nullptr;
+}
+
+//*********************************************************************
+// Verify the try acquire timeout and the owner checks
+bool ownerTest()
+{
+    pthread_t holder;
+    bool success;
+
+    success = true;
+    r4aEsp32LockClearStats(&ticketLock);
+
+    // Recursive acquire is refused
+    r4aEsp32LockAcquire(&ticketLock);
+    if (r4aEsp32LockAcquire(&ticketLock) || r4aEsp32LockTryAcquire(&ticketLock, 0)
+        || (ticketLock._recursions != 2))
+    {
+        printf("FAIL: Recursive acquire not detected\n");
+        success = false;
+    }
+    r4aEsp32LockRelease(&ticketLock);
+
+    // Release without holding the lock is refused
+    if (r4aEsp32LockRelease(&ticketLock) || (ticketLock._badReleases != 1))
+    {
+        printf("FAIL: Release by another thread not detected\n");
+        success = false;
+    }
+
+    // Try acquire times out while another thread holds the lock
+    pthread_create(&holder, nullptr, holdThread, nullptr);
+    while (!ticketLock._owner)
+        usleep(100);
+    if (r4aEsp32LockTryAcquire(&ticketLock, 1000) || (ticketLock._timeouts != 1))
+    {
+        printf("FAIL: Try acquire did not time out\n");
+        success = false;
+    }
+
+    // Try acquire succeeds once the lock is released
+    if (!r4aEsp32LockTryAcquire(&ticketLock, 1000 * 1000))
+    {
+        printf("FAIL: Try acquire did not get the lock\n");
+        success = false;
+    }
+    else
+        r4aEsp32LockRelease(&ticketLock);
+    pthread_join(holder, nullptr);
+    if (ticketLock._ticket >> 16 != (ticketLock._ticket & 0xffff))
+    {
+        printf("FAIL: Ticket lock left held, 0x%08x\n", ticketLock._ticket);
+        success = false;
+    }
+    printf("%s: ticket owner, recursion and timeout checks\n", success ? "PASS" : "FAIL");
+    return success;
+}
+
+//*********************************************************************
+// Measure the lock throughput
+void benchmark(int lockType, int threads)
+{
+    THREAD_CONTEXT context[MAX_THREADS];
+    uint64_t fewest;
+    int index;
+    uint64_t maxWaitNsec;
+    uint64_t most;
+    uint64_t operations;
+
+    runThreads(benchmarkThread, lockType, threads, context, BENCHMARK_MSEC);
+
+    // Sum the results
+    fewest = UINT64_MAX;
+    maxWaitNsec = 0;
+    most = 0;
+    operations = 0;
+    for (index = 0; index < threads; index++)
+    {
+        operations += context[index]._operations;
+        if (fewest > context[index]._operations)
+            fewest = context[index]._operations;
+        if (most < context[index]._operations)
+            most = context[index]._operations;
+        if (maxWaitNsec < context[index]._maxWaitNsec)
+            maxWaitNsec = context[index]._maxWaitNsec;
+    }
+
+    // Display the results, fairness is the ratio of the fewest to the
+    // most acquisitions by a thread
+    printf("%-6s %7d %12.2f %8.1f %11.1f",
+           lockName[lockType],
+           threads,
+           (double)operations * 1000. / BENCHMARK_MSEC / 1000000.,
+           most ? (double)fewest * 100. / most : 0.,
+           (double)maxWaitNsec / 1000.);
+    if ((lockType == LOCK_TICKET) && ticketLock._contended)
+        printf(" %11llu %8.1f",
+               (unsigned long long)(ticketLock._spinCycles / ticketLock._contended),
+               (double)ticketLock._contended * 100. / ticketLock._acquisitions);
+    printf("\n");
+}
+
+//*********************************************************************
+// Test the ticket lock and compare it against the other locks
+int main(int argc, char **argv)
+{
+    int lockType;
+    int maxThreads;
+    bool success;
+    int threads;
+
+    // Get the maximum number of threads
+    maxThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (argc == 2)
+        maxThreads = atoi(argv[1]);
+    if ((argc > 2) || (maxThreads < 1) || (maxThreads > MAX_THREADS))
+    {
+        fprintf(stderr, "%s   [max_threads]\n", argv[0]);
+        fprintf(stderr, "\n");
+        fprintf(stderr, "max_threads: 1 - %d, defaults to the number of processors\n", MAX_THREADS);
+        return -1;
+    }
+    if (maxThreads > MAX_THREADS)
+        maxThreads = MAX_THREADS;
+
+    // Display the results as they are available
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // Stress test the locks
+    success = ownerTest();
+    for (lockType = 0; lockType < LOCK_TYPE_MAX; lockType++)
+        for (threads = 2; threads <= maxThreads; threads <<= 1)
+            success &= stressTest(lockType, threads);
+
+    // Measure the throughput
+    printf("\n");
+    printf("Lock   Threads  MOps/Sec   Fair %%  Max Wait uS  Avg Cycles  Contend %%\n");
+    for (threads = 1; threads <= maxThreads; threads <<= 1)
+        for (lockType = 0; lockType < LOCK_TYPE_MAX; lockType++)
+            benchmark(lockType, threads);
+    return success ? 0 : -1;
+}
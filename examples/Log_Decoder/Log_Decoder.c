@@ -0,0 +1,456 @@
+/**********************************************************************
+  Log_Decoder.c
+
+  Program to display the binary log sent by the Freenove_4WD_Car
+  example.  The binary log is enabled with the logb menu command.
+**********************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Log_Binary.h"
+
+#define LOG_DASHES_LENGTH       80
+#define LOG_SPACES_LENGTH       80
+#define LOG_STATE_WIDTH         17
+
+#define TELNET_PORT             23
+
+//****************************************
+// Locals
+//****************************************
+
+//                                       1         2         3         4         5         6         7         8
+//                              12345678901234567890123456789012345678901234567890123456789012345678901234567890
+const char * const logDashes = "--------------------------------------------------------------------------------";
+const char * const logSpaces = "                                                                                ";
+
+LOG_BINARY_HEADER header;
+const char ** sensorTable;
+const char ** stateTable;
+char * strings;
+
+//*********************************************************************
+// Read data from the file or socket
+// Inputs:
+//   fd: File or socket descriptor
+//   buffer: Address of the buffer to receive the data
+//   length: Number of bytes to read
+// Outputs:
+//   Returns true if all of the data was read and false upon end of
+//   file or error
+int readData(int fd, void * buffer, size_t length)
+{
+    ssize_t bytesRead;
+    size_t offset;
+
+    offset = 0;
+    while (offset < length)
+    {
+        bytesRead = read(fd, &((uint8_t *)buffer)[offset], length - offset);
+        if (bytesRead < 0)
+        {
+            perror("ERROR: Failed to read the log data!\r\n");
+            return 0;
+        }
+        if (bytesRead == 0)
+            return 0;
+        offset += bytesRead;
+    }
+    return 1;
+}
+
+//*********************************************************************
+// Locate the start of the binary log, skipping any menu output
+// Inputs:
+//   fd: File or socket descriptor
+// Outputs:
+//   Returns true if the log header was found
+int findHeader(int fd)
+{
+    uint8_t data;
+    uint32_t magic;
+
+    // Search for the magic value, the header is sent in little endian
+    magic = 0;
+    do
+    {
+        if (!readData(fd, &data, sizeof(data)))
+        {
+            fprintf(stderr, "ERROR: Binary log header not found!\r\n");
+            return 0;
+        }
+        magic = (magic >> 8) | (((uint32_t)data) << 24);
+    } while (magic != LOG_BINARY_MAGIC);
+
+    // Read the remainder of the header
+    header._magic = magic;
+    if (!readData(fd,
+                  &((uint8_t *)&header)[sizeof(magic)],
+                  sizeof(header) - sizeof(magic)))
+    {
+        fprintf(stderr, "ERROR: Failed to read the log header!\r\n");
+        return 0;
+    }
+
+    // Validate the header
+    if ((header._version != LOG_BINARY_VERSION)
+        || (header._headerBytes != sizeof(header))
+        || (header._entryBytes != sizeof(LOG_ENTRY))
+        || (header._sensorCount != (header._sensorMask + 1)))
+    {
+        fprintf(stderr, "ERROR: Unsupported log version %d!\r\n", header._version);
+        return 0;
+    }
+    return 1;
+}
+
+//*********************************************************************
+// Read the challenge name, state names and sensor names
+// Inputs:
+//   fd: File or socket descriptor
+// Outputs:
+//   Returns the challenge name or NULL upon failure
+const char * readStrings(int fd)
+{
+    const char * end;
+    int index;
+    const char * name;
+    char * string;
+
+    // Allocate the string buffer and the tables
+    strings = malloc(header._stringBytes + 1);
+    stateTable = malloc(header._stateCount * sizeof(*stateTable));
+    sensorTable = malloc(header._sensorCount * sizeof(*sensorTable));
+    if ((!strings) || (!stateTable) || (!sensorTable))
+    {
+        fprintf(stderr, "ERROR: Failed to allocate the string tables!\r\n");
+        return NULL;
+    }
+
+    // Read the strings
+    if (!readData(fd, strings, header._stringBytes))
+    {
+        fprintf(stderr, "ERROR: Failed to read the log strings!\r\n");
+        return NULL;
+    }
+    strings[header._stringBytes] = 0;
+    end = &strings[header._stringBytes];
+
+    // Locate the strings
+    string = strings;
+    name = string;
+    string += strlen(string) + 1;
+    for (index = 0; index < header._stateCount; index++)
+    {
+        stateTable[index] = (string < end) ? string : "";
+        string += strlen(string) + 1;
+    }
+    for (index = 0; index < header._sensorCount; index++)
+    {
+        sensorTable[index] = (string < end) ? string : "";
+        string += strlen(string) + 1;
+    }
+    if (string > (end + 1))
+    {
+        fprintf(stderr, "ERROR: Log strings are truncated!\r\n");
+        return NULL;
+    }
+    return name;
+}
+
+//*********************************************************************
+// Display the header for the log
+void logLineSensorDisplayHeader(int sensorHeaderWidth)
+{
+    const char * const headerLeft = " Elapsed Time     Delta Time   Left  ";
+    const char * const headerSensors = "Sensors";
+    const char * const headerRight = "  Right   Loops  State";
+    int sensorLength;
+    int spacesLeft;
+    int spacesRight;
+
+    // Determine left and right spaces
+    sensorLength = strlen(headerSensors);
+    spacesLeft = LOG_SPACES_LENGTH - ((sensorHeaderWidth - sensorLength) >> 1);
+    spacesRight = LOG_SPACES_LENGTH - ((sensorHeaderWidth - sensorLength + 1) >> 1);
+
+    // Display the header
+    printf("%s%s%s%s%s\r\n",
+           headerLeft,
+           &logSpaces[spacesLeft],
+           headerSensors,
+           &logSpaces[spacesRight],
+           headerRight);
+}
+
+//*********************************************************************
+// Display the dashes for the log header
+void logLineSensorDisplayHeaderDashes(int sensorHeaderWidth)
+{
+    const char * const dashesLeft = "-------------  -------------  -----  ";
+    const char * const dashesRight = "  -----  ------  ";
+    int dashesSensors;
+    int dashesState;
+
+    // Determine sensors and state dashes
+    dashesSensors = LOG_DASHES_LENGTH - sensorHeaderWidth;
+    dashesState = LOG_DASHES_LENGTH - LOG_STATE_WIDTH;
+    printf("%s%s%s%s\r\n",
+           dashesLeft,
+           &logDashes[dashesSensors],
+           dashesRight,
+           &logDashes[dashesState]);
+}
+
+//*********************************************************************
+// Display a line of the log, the robot was in the previous state
+// until the time of the current entry
+void logLineSensorDisplayEntry(const LOG_ENTRY * logEntry,
+                               const LOG_ENTRY * previousEntry)
+{
+    uint32_t deltaSec;
+    uint32_t deltaUsec;
+    uint32_t microseconds;
+    uint32_t seconds;
+    uint8_t sensors;
+    uint8_t state;
+
+    // Compute the challenge time and delta time
+    microseconds = logEntry->_microSec - header._startUsec;
+    seconds = microseconds / (1000 * 1000);
+    microseconds -= seconds * 1000 * 1000;
+
+    deltaUsec = logEntry->_microSec - previousEntry->_microSec;
+    deltaSec = deltaUsec / (1000 * 1000);
+    deltaUsec -= deltaSec * 1000 * 1000;
+
+    // Display the log entry
+    sensors = previousEntry->_data8 & header._sensorMask;
+    state = previousEntry->_state;
+    printf("%6d.%06d, %6d.%06d: %5d  %s  %5d %7d  %s\r\n",
+           seconds,
+           microseconds,
+           deltaSec,
+           deltaUsec,
+           previousEntry->_leftSpeed,
+           sensorTable[sensors],
+           previousEntry->_rightSpeed,
+           logEntry->_loopCount - previousEntry->_loopCount,
+           (state < header._stateCount) ? stateTable[state] : "Unknown");
+}
+
+//*********************************************************************
+// Display the log entries
+// Inputs:
+//   fd: File or socket descriptor
+// Outputs:
+//   Returns the exit status value
+int logDisplay(int fd)
+{
+    uint8_t data[256];
+    LOG_BINARY_END * end;
+    int firstEntry;
+    LOG_ENTRY * logEntry;
+    const char * name;
+    LOG_ENTRY previousEntry;
+    LOG_BINARY_RECORD record;
+    int sensorLength;
+
+    // Get the log description
+    if (!findHeader(fd))
+        return -1;
+    name = readStrings(fd);
+    if (!name)
+        return -1;
+
+    // Display the log header
+    printf("\r\n");
+    printf("%s\r\n", &logDashes[0]);
+    printf("%s\r\n", name);
+    printf("%s\r\n", &logDashes[0]);
+    printf("\r\n");
+    sensorLength = strlen(sensorTable[0]);
+    logLineSensorDisplayHeader(sensorLength);
+    logLineSensorDisplayHeaderDashes(sensorLength);
+
+    // Display the log entries
+    firstEntry = 1;
+    logEntry = (LOG_ENTRY *)data;
+    while (1)
+    {
+        // Get the next record
+        if ((!readData(fd, &record, sizeof(record)))
+            || (!readData(fd, data, record._length)))
+        {
+            fprintf(stderr, "ERROR: Log ended before the robot stopped!\r\n");
+            return -1;
+        }
+
+        // Done when the robot stops
+        if (record._type == LOG_TYPE_END)
+            break;
+
+        // Skip unknown records
+        if ((record._type != LOG_TYPE_LINE_SENSOR)
+            || (record._length < sizeof(*logEntry)))
+            continue;
+
+        // The first entry marks the start of the challenge
+        if (firstEntry)
+        {
+            firstEntry = 0;
+            memcpy(&previousEntry, logEntry, sizeof(previousEntry));
+        }
+        logLineSensorDisplayEntry(logEntry, &previousEntry);
+
+        // Display the change that caused the stop
+        if ((logEntry->_state == header._stopState)
+            && (previousEntry._state != header._stopState))
+            logLineSensorDisplayEntry(logEntry, logEntry);
+        memcpy(&previousEntry, logEntry, sizeof(previousEntry));
+    }
+
+    // Add a header below the log
+    logLineSensorDisplayHeaderDashes(sensorLength);
+    logLineSensorDisplayHeader(sensorLength);
+    printf("\r\n");
+
+    // Display the dropped log entries
+    end = (LOG_BINARY_END *)data;
+    if ((record._length >= sizeof(*end)) && end->_entriesDropped)
+    {
+        printf("WARNING: %d log entries dropped, log buffer full!\r\n",
+               end->_entriesDropped);
+        printf("\r\n");
+    }
+    return 0;
+}
+
+//*********************************************************************
+// Connect to the robot's telnet server and request the binary log
+// Inputs:
+//   serverName: Name or IP address of the robot
+// Outputs:
+//   Returns the socket descriptor or -1 upon failure
+int telnetConnect(const char * serverName)
+{
+    const char * const command = "logb\r\n";
+    struct hostent * server;
+    struct sockaddr_in serverIpAddress;
+    int sockfd;
+
+    do
+    {
+        // Translate from a name to an IP address
+        server = gethostbyname(serverName);
+        if (!server)
+        {
+            errno = h_errno;
+            perror("ERROR: Server not found!\r\n");
+            break;
+        }
+
+        // Create the socket
+        sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (sockfd < 0)
+        {
+            perror("ERROR: Failed to create the socket!\r\n");
+            break;
+        }
+
+        // Initialize the server address
+        memset(&serverIpAddress, 0, sizeof(serverIpAddress));
+        serverIpAddress.sin_family = AF_INET;
+        memcpy(&serverIpAddress.sin_addr.s_addr, server->h_addr, server->h_length);
+        serverIpAddress.sin_port = htons(TELNET_PORT);
+
+        // Attempt to connect to the server
+        if (connect(sockfd, (struct sockaddr *)&serverIpAddress, sizeof(serverIpAddress)))
+        {
+            perror("ERROR: Failed to connect to the telnet server!\r\n");
+            close(sockfd);
+            break;
+        }
+
+        // Send the log data to this connection
+        if (send(sockfd, command, strlen(command), 0) < 0)
+        {
+            perror("ERROR: Failed to send the logb command!\r\n");
+            close(sockfd);
+            break;
+        }
+        return sockfd;
+    } while (0);
+    return -1;
+}
+
+//*********************************************************************
+// Inputs:
+//   argc: Argument count
+//   argv: Array of argument values
+// Outputs:
+//   Returns the value to the command line
+int main(int argc, char **argv)
+{
+    int displayHelp;
+    int exitStatus;
+    int fd;
+
+    displayHelp = 1;
+    exitStatus = -1;
+    fd = -1;
+    do
+    {
+        // Open the log file
+        if (argc == 2)
+        {
+            fd = open(argv[1], O_RDONLY);
+            if (fd < 0)
+            {
+                exitStatus = errno;
+                perror("ERROR: Failed to open the file!\r\n");
+                break;
+            }
+        }
+
+        // Connect to the robot
+        else if ((argc == 3) && (strcmp(argv[1], "--telnet") == 0))
+        {
+            fd = telnetConnect(argv[2]);
+            if (fd < 0)
+            {
+                exitStatus = errno;
+                break;
+            }
+        }
+        else
+            break;
+
+        // Display the log
+        displayHelp = 0;
+        exitStatus = logDisplay(fd);
+    } while (0);
+
+    // Done with the log
+    if (fd >= 0)
+        close(fd);
+
+    // Display the help text
+    if (displayHelp)
+    {
+        printf("%s   log_file\r\n", argv[0]);
+        printf("%s   --telnet   robot\r\n", argv[0]);
+        printf("\r\n");
+        printf("log_file: File containing the output from the logb command\r\n");
+        printf("robot: Name or IP address of the Freenove_4WD_Car robot\r\n");
+    }
+    return exitStatus;
+}
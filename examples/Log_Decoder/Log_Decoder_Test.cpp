@@ -0,0 +1,400 @@
+/**********************************************************************
+  Log_Decoder_Test.cpp
+
+  Program to test the Log_Decoder application.  The test builds a
+  binary log capture the way the Freenove_4WD_Car example sends it:
+  menu output, the header and strings, and then the line sensor entries
+  passed through the ring buffer (src/Ring_Buffer.cpp) and copied into
+  512 byte writes, with some entries dropped when the buffer is full.
+  The Log_Decoder output must match the table formatted by the text
+  log in Log.ino.  Truncated captures and captures without a header
+  must fail.  The program exits with a non-zero status when a test
+  fails.
+**********************************************************************/
+
+#include <string.h>
+#include <sys/wait.h>
+
+#include "Ring_Buffer_Host.h"
+#include "../../src/R4A_ESP32_Ring_Buffer.h"
+#include "Log_Binary.h"
+#include "Sensor_Table.h"
+
+#define CAPTURE_FILE            "Log_Decoder_Test.bin"
+#define ENTRY_COUNT             2000
+#define LOG_BINARY_BUFFER_BYTES 512     // Matches Log.ino
+#define LOG_BUFFER_BYTES        1024
+#define LOG_DASHES_LENGTH       80
+#define LOG_SPACES_LENGTH       80
+#define LOG_STATE_WIDTH         17
+#define OUTPUT_BYTES            (1024 * 1024)
+#define SENSOR_MASK             7
+#define STOP_STATE              0
+
+//****************************************
+// Constants
+//****************************************
+
+static const char * challengeName = "Basic Line Following";
+
+//                                       1         2         3         4         5         6         7         8
+//                              12345678901234567890123456789012345678901234567890123456789012345678901234567890
+static const char * const logDashes = "--------------------------------------------------------------------------------";
+static const char * const logSpaces = "                                                                                ";
+
+static const char * const stateTable[] =
+{
+    "Stop",
+    "Forward",
+    "Turn Left",
+    "Turn Right",
+};
+
+static const int stateCount = sizeof(stateTable) / sizeof(stateTable[0]);
+
+//****************************************
+// Globals
+//****************************************
+
+Print Serial;
+
+//****************************************
+// Locals
+//****************************************
+
+static size_t captureBytes;
+static uint8_t * captureData;
+static size_t expectedBytes;
+static char * expectedText;
+static R4A_RING_BUFFER logBuffer;
+static uint32_t logStartUsec;
+
+//*********************************************************************
+// Add data to the capture
+static void captureWrite(const void * data, size_t length)
+{
+    captureData = (uint8_t *)realloc(captureData, captureBytes + length);
+    memcpy(&captureData[captureBytes], data, length);
+    captureBytes += length;
+}
+
+//*********************************************************************
+// Add text to the expected decoder output
+static void expectedPrintf(const char * format, ...)
+{
+    va_list args;
+    char line[256];
+    int length;
+
+    va_start(args, format);
+    length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    expectedText = (char *)realloc(expectedText, expectedBytes + length + 1);
+    memcpy(&expectedText[expectedBytes], line, length + 1);
+    expectedBytes += length;
+}
+
+//*********************************************************************
+// Send the binary log header and the strings, see logBinaryHeader in
+// Log.ino
+static void logBinaryHeader()
+{
+    LOG_BINARY_HEADER header;
+    int index;
+    size_t stringBytes;
+
+    // Determine the size of the strings
+    stringBytes = strlen(challengeName) + 1;
+    for (index = 0; index < stateCount; index++)
+        stringBytes += strlen(stateTable[index]) + 1;
+    for (index = 0; index <= SENSOR_MASK; index++)
+        stringBytes += strlen(pcf8574SensorTable[index]) + 1;
+
+    // Describe the log entries
+    memset(&header, 0, sizeof(header));
+    header._magic = LOG_BINARY_MAGIC;
+    header._version = LOG_BINARY_VERSION;
+    header._headerBytes = sizeof(header);
+    header._entryBytes = sizeof(LOG_ENTRY);
+    header._stringBytes = stringBytes;
+    header._stateCount = stateCount;
+    header._sensorCount = SENSOR_MASK + 1;
+    header._startUsec = logStartUsec;
+    header._sensorMask = SENSOR_MASK;
+    header._stopState = STOP_STATE;
+    captureWrite(&header, sizeof(header));
+
+    // Send the strings
+    captureWrite(challengeName, strlen(challengeName) + 1);
+    for (index = 0; index < stateCount; index++)
+        captureWrite(stateTable[index], strlen(stateTable[index]) + 1);
+    for (index = 0; index <= SENSOR_MASK; index++)
+        captureWrite(pcf8574SensorTable[index], strlen(pcf8574SensorTable[index]) + 1);
+}
+
+//*********************************************************************
+// Display a line of the text log, see logLineSensorPrint in Log.ino
+static void logTextEntry(const LOG_ENTRY * logEntry,
+                         const LOG_ENTRY * previousEntry)
+{
+    uint32_t deltaSec;
+    uint32_t deltaUsec;
+    uint32_t microseconds;
+    uint32_t seconds;
+
+    // Compute the challenge time and delta time
+    microseconds = logEntry->_microSec - logStartUsec;
+    seconds = microseconds / (1000 * 1000);
+    microseconds -= seconds * 1000 * 1000;
+
+    deltaUsec = logEntry->_microSec - previousEntry->_microSec;
+    deltaSec = deltaUsec / (1000 * 1000);
+    deltaUsec -= deltaSec * 1000 * 1000;
+
+    // Display the log entry
+    expectedPrintf("%6ld.%06ld, %6ld.%06ld: %5d  %s  %5d %7d  %s\r\n",
+                   (long)seconds,
+                   (long)microseconds,
+                   (long)deltaSec,
+                   (long)deltaUsec,
+                   previousEntry->_leftSpeed,
+                   pcf8574SensorTable[previousEntry->_data8 & SENSOR_MASK],
+                   previousEntry->_rightSpeed,
+                   logEntry->_loopCount - previousEntry->_loopCount,
+                   stateTable[previousEntry->_state]);
+}
+
+//*********************************************************************
+// Display the column headings of the text log
+static void logTextHeader(bool dashesFirst)
+{
+    const char * const dashesLeft = "-------------  -------------  -----  ";
+    const char * const dashesRight = "  -----  ------  ";
+    const char * const headerLeft = " Elapsed Time     Delta Time   Left  ";
+    const char * const headerSensors = "Sensors";
+    const char * const headerRight = "  Right   Loops  State";
+    int sensorHeaderWidth;
+    int sensorLength;
+    char dashes[256];
+    char heading[256];
+
+    sensorHeaderWidth = strlen(pcf8574SensorTable[0]);
+    sensorLength = strlen(headerSensors);
+    snprintf(heading, sizeof(heading), "%s%s%s%s%s\r\n",
+             headerLeft,
+             &logSpaces[LOG_SPACES_LENGTH - ((sensorHeaderWidth - sensorLength) >> 1)],
+             headerSensors,
+             &logSpaces[LOG_SPACES_LENGTH - ((sensorHeaderWidth - sensorLength + 1) >> 1)],
+             headerRight);
+    snprintf(dashes, sizeof(dashes), "%s%s%s%s\r\n",
+             dashesLeft,
+             &logDashes[LOG_DASHES_LENGTH - sensorHeaderWidth],
+             dashesRight,
+             &logDashes[LOG_DASHES_LENGTH - LOG_STATE_WIDTH]);
+    expectedPrintf("%s%s", dashesFirst ? dashes : heading, dashesFirst ? heading : dashes);
+}
+
+//*********************************************************************
+// Send the log entries as binary records, see logBinaryPrint in Log.ino
+// Outputs:
+//   Returns true when the stop entry was sent
+static bool logBinaryPrint(LOG_ENTRY * previousEntry)
+{
+    uint8_t buffer[LOG_BINARY_BUFFER_BYTES];
+    LOG_BINARY_END * end;
+    LOG_ENTRY * logEntry;
+    uint16_t length;
+    size_t offset;
+    LOG_BINARY_RECORD * record;
+    bool stop;
+    uint8_t type;
+
+    // Copy the log entries into the buffer
+    offset = 0;
+    stop = false;
+    while ((offset + sizeof(*record) + sizeof(*logEntry) + sizeof(*record) + sizeof(*end))
+           <= sizeof(buffer))
+    {
+        logEntry = (LOG_ENTRY *)r4aRingBufferPeek(&logBuffer, &type, &length);
+        if (logEntry == nullptr)
+            break;
+        record = (LOG_BINARY_RECORD *)&buffer[offset];
+        record->_type = type;
+        record->_length = length;
+        offset += sizeof(*record);
+        memcpy(&buffer[offset], logEntry, length);
+        offset += length;
+
+        // Format the text log for this entry
+        if (previousEntry->_microSec == 0)
+            *previousEntry = *logEntry;
+        logTextEntry(logEntry, previousEntry);
+        stop = (logEntry->_state == STOP_STATE);
+        if (stop && (previousEntry->_state != STOP_STATE))
+            logTextEntry(logEntry, logEntry);
+        *previousEntry = *logEntry;
+        r4aRingBufferRelease(&logBuffer);
+
+        // Mark the end of the log
+        if (stop)
+        {
+            record = (LOG_BINARY_RECORD *)&buffer[offset];
+            record->_type = LOG_TYPE_END;
+            record->_length = sizeof(*end);
+            offset += sizeof(*record);
+            end = (LOG_BINARY_END *)&buffer[offset];
+            end->_entriesDropped = logBuffer._recordsDropped;
+            offset += sizeof(*end);
+            break;
+        }
+    }
+
+    // Send the records
+    if (offset)
+        captureWrite(buffer, offset);
+    return stop;
+}
+
+//*********************************************************************
+// Build the capture file and the expected decoder output
+static bool buildCapture()
+{
+    int entry;
+    const char * menuText = "Freenove_4WD_Car menu\r\n> logb\r\n";
+    LOG_ENTRY * logEntry;
+    LOG_ENTRY previousEntry;
+    bool stop;
+
+    captureBytes = 0;
+    expectedBytes = 0;
+    memset(&previousEntry, 0, sizeof(previousEntry));
+    memset(&logBuffer, 0, sizeof(logBuffer));
+    if (!r4aRingBufferBegin(&logBuffer, LOG_BUFFER_BYTES, false, nullptr))
+        return false;
+
+    // Send the menu output, header and strings
+    captureWrite(menuText, strlen(menuText));
+    logStartUsec = 12345678;
+    logBinaryHeader();
+    expectedPrintf("\r\n%s\r\n%s\r\n%s\r\n\r\n", logDashes, challengeName, logDashes);
+    logTextHeader(false);
+
+    // Log the entries, draining the ring buffer every 16 entries except
+    // for a period where the buffer fills and drops entries
+    stop = false;
+    for (entry = 0; entry < ENTRY_COUNT; entry++)
+    {
+        logEntry = (LOG_ENTRY *)r4aRingBufferReserve(&logBuffer,
+                                                     LOG_TYPE_LINE_SENSOR,
+                                                     sizeof(*logEntry));
+        if (logEntry)
+        {
+            logEntry->_state = (entry == (ENTRY_COUNT - 1)) ? STOP_STATE
+                             : 1 + ((entry / 7) % (stateCount - 1));
+            logEntry->_data8 = (uint8_t)(entry * 5);
+            logEntry->_reserved = 0;
+            logEntry->_microSec = logStartUsec + (entry * 1234567) / 10;
+            logEntry->_loopCount = entry * 3;
+            logEntry->_leftSpeed = (int16_t)(((entry * 37) % 8192) - 4096);
+            logEntry->_rightSpeed = (int16_t)(((entry * 53) % 8192) - 4096);
+            r4aRingBufferCommit(&logBuffer, logEntry);
+        }
+        if ((((entry & 0xf) == 0xf) && ((entry < 500) || (entry > 700)))
+            || (entry == (ENTRY_COUNT - 1)))
+            while (r4aRingBufferPeek(&logBuffer) && (stop == false))
+                stop = logBinaryPrint(&previousEntry);
+    }
+
+    // Finish the text log
+    logTextHeader(true);
+    expectedPrintf("\r\n");
+    if (logBuffer._recordsDropped)
+        expectedPrintf("WARNING: %d log entries dropped, log buffer full!\r\n\r\n",
+                       (int)logBuffer._recordsDropped);
+    r4aRingBufferEnd(&logBuffer);
+    return stop && logBuffer._recordsDropped;
+}
+
+//*********************************************************************
+// Run the decoder on the first bytes of the capture
+// Outputs:
+//   Returns the decoder exit status
+static int runDecoder(size_t length, char * output, size_t outputBytes)
+{
+    size_t bytesRead;
+    FILE * file;
+    FILE * pipe;
+    int status;
+
+    // Write the capture file
+    file = fopen(CAPTURE_FILE, "wb");
+    if (!file)
+        return -1;
+    fwrite(captureData, 1, length, file);
+    fclose(file);
+
+    // Run the decoder, the error messages go to stderr
+    pipe = popen("./Log_Decoder " CAPTURE_FILE " 2> /dev/null", "r");
+    if (!pipe)
+        return -1;
+    bytesRead = fread(output, 1, outputBytes - 1, pipe);
+    output[bytesRead] = 0;
+    status = pclose(pipe);
+    remove(CAPTURE_FILE);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+//*********************************************************************
+// Display the test result
+static bool testResult(const char * test, bool success)
+{
+    printf("%s: %s\n", success ? "PASS" : "FAIL", test);
+    return success;
+}
+
+//*********************************************************************
+// Test the log decoder
+int main(int argc, char **argv)
+{
+    size_t offset;
+    char * output;
+    int status;
+    bool success;
+    char test[128];
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    output = (char *)malloc(OUTPUT_BYTES);
+    success = buildCapture();
+    if (!success)
+        fprintf(stderr, "ERROR: Failed to build the capture!\n");
+
+    // Decode the complete capture
+    if (success)
+    {
+        status = runDecoder(captureBytes, output, OUTPUT_BYTES);
+        success = (status == 0) && (strcmp(output, expectedText) == 0);
+        if ((status == 0) && !success)
+        {
+            for (offset = 0; output[offset] && (output[offset] == expectedText[offset]); offset++)
+                ;
+            fprintf(stderr, "ERROR: Output differs at offset %ld: %.40s\n",
+                    (long)offset, &output[offset]);
+        }
+        snprintf(test, sizeof(test), "%ld byte capture decodes to the %ld byte text log",
+                 (long)captureBytes, (long)expectedBytes);
+        success = testResult(test, success);
+
+        // Truncate the capture before the end record
+        status = runDecoder(captureBytes - sizeof(LOG_BINARY_END), output, OUTPUT_BYTES);
+        success &= testResult("truncated capture fails", status != 0);
+
+        // Remove the header
+        memmove(captureData, &captureData[captureBytes / 2], captureBytes / 2);
+        status = runDecoder(captureBytes / 2, output, OUTPUT_BYTES);
+        success &= testResult("capture without a header fails", status != 0);
+    }
+    free(output);
+    free(captureData);
+    free(expectedText);
+    return success ? 0 : -1;
+}
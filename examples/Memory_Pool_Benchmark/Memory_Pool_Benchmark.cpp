@@ -0,0 +1,483 @@
+/**********************************************************************
+  Memory_Pool_Benchmark.cpp
+
+  Program to compare the size class memory pool (src/Pool.cpp) against
+  the system allocator.  The allocation trace is either captured from
+  the robot's serial output with r4aMallocDebug set to true, or
+  generated by this program.  Each thread replays the trace, thread
+  numbers are used as the core numbers for the pool.
+**********************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/R4A_ESP32_Pool.h"
+
+#define ADDRESS_TABLE_ENTRIES   (1 << 16)
+#define LINE_LENGTH             1024
+#define MAX_THREADS             16
+
+#define SYNTHETIC_OPERATIONS    200000
+#define SYNTHETIC_SLOTS         256
+
+//****************************************
+// Types
+//****************************************
+
+// Allocation trace entry
+typedef struct _TRACE_ENTRY
+{
+    uint32_t _bytes;            // Bytes to allocate, zero for free
+    uint32_t _slot;             // Index into the pointer table
+} TRACE_ENTRY;
+
+// Thread context
+typedef struct _THREAD_CONTEXT
+{
+    pthread_t _thread;
+    int _core;                  // Core number passed to the pool
+    bool _usePool;              // Use the pool before malloc
+    uint64_t _fallbacks;        // Allocations satisfied by malloc
+    uint64_t _nsec;             // Time spent replaying the trace
+    void ** _pointers;          // Pointers indexed by slot
+} THREAD_CONTEXT;
+
+//****************************************
+// Locals
+//****************************************
+
+// Same block counts as r4aEsp32PoolDefaultBlocks in src/Memory.cpp
+const uint16_t defaultBlocks[R4A_ESP32_POOL_CLASSES] =
+{
+    256, 256, 128, 64, 32, 16
+};
+
+int iterations = 10;
+R4A_ESP32_POOL pool;
+uint32_t slots;
+TRACE_ENTRY * trace;
+size_t traceEntries;
+size_t traceMaxEntries;
+
+//*********************************************************************
+// Add an entry to the trace
+// Inputs:
+//   bytes: Number of bytes to allocate, zero for free
+//   slot: Index into the pointer table
+// Outputs:
+//   Returns true if successful and false upon failure
+bool traceAdd(uint32_t bytes, uint32_t slot)
+{
+    TRACE_ENTRY * newTrace;
+
+    // Grow the trace as necessary
+    if (traceEntries >= traceMaxEntries)
+    {
+        traceMaxEntries = traceMaxEntries ? traceMaxEntries * 2 : 4096;
+        newTrace = (TRACE_ENTRY *)realloc(trace, traceMaxEntries * sizeof(*trace));
+        if (!newTrace)
+        {
+            fprintf(stderr, "ERROR: Failed to allocate the trace!\n");
+            return false;
+        }
+        trace = newTrace;
+    }
+
+    // Add the entry
+    trace[traceEntries]._bytes = bytes;
+    trace[traceEntries]._slot = slot;
+    traceEntries += 1;
+    if (slots <= slot)
+        slots = slot + 1;
+    return true;
+}
+
+//*********************************************************************
+// Generate a synthetic allocation trace, mostly small strings and
+// objects with some larger buffers
+// Outputs:
+//   Returns true if successful and false upon failure
+bool traceGenerate()
+{
+    uint32_t bytes;
+    uint32_t live[SYNTHETIC_SLOTS];
+    int operation;
+    uint32_t percent;
+    uint32_t slot;
+
+    srand(1);
+    memset(live, 0, sizeof(live));
+    for (operation = 0; operation < SYNTHETIC_OPERATIONS; operation++)
+    {
+        slot = rand() % SYNTHETIC_SLOTS;
+
+        // Free the buffer in this slot
+        if (live[slot])
+        {
+            live[slot] = 0;
+            if (!traceAdd(0, slot))
+                return false;
+            continue;
+        }
+
+        // Allocate a buffer
+        percent = rand() % 100;
+        if (percent < 60)
+            bytes = 8 + (rand() % 25);          // String temporaries
+        else if (percent < 85)
+            bytes = 33 + (rand() % 96);         // Objects and web page lines
+        else if (percent < 97)
+            bytes = 129 + (rand() % 384);       // Waypoint and JSON buffers
+        else
+            bytes = 1024 + (rand() % 3072);     // Large buffers, never in the pool
+        live[slot] = bytes;
+        if (!traceAdd(bytes, slot))
+            return false;
+    }
+    return true;
+}
+
+//*********************************************************************
+// Read an allocation trace produced by r4aMalloc and r4aFree with
+// r4aMallocDebug set to true
+// Inputs:
+//   fileName: Name of the file containing the serial output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool traceRead(const char * fileName)
+{
+    uintptr_t address;
+    uintptr_t * addressTable;
+    unsigned long bytes;
+    FILE * file;
+    uint32_t freeSlot;
+    uint32_t * freeSlots;
+    uint32_t freeSlotCount;
+    uint32_t index;
+    char line[LINE_LENGTH];
+    uint32_t next;
+    const char * text;
+    bool success;
+    uint32_t * slotTable;
+
+    success = false;
+    addressTable = (uintptr_t *)calloc(ADDRESS_TABLE_ENTRIES, sizeof(*addressTable));
+    slotTable = (uint32_t *)calloc(ADDRESS_TABLE_ENTRIES, sizeof(*slotTable));
+    freeSlots = (uint32_t *)calloc(ADDRESS_TABLE_ENTRIES, sizeof(*freeSlots));
+    file = nullptr;
+    freeSlotCount = 0;
+    do
+    {
+        if ((!addressTable) || (!slotTable) || (!freeSlots))
+        {
+            fprintf(stderr, "ERROR: Failed to allocate the address table!\n");
+            break;
+        }
+
+        // Open the trace file
+        file = fopen(fileName, "r");
+        if (!file)
+        {
+            perror("ERROR: Failed to open the trace file!\n");
+            break;
+        }
+
+        // Walk the trace, ignore the DMA buffers
+        success = true;
+        while (success && fgets(line, sizeof(line), file))
+        {
+            if ((sscanf(line, "%lx:", (unsigned long *)&address) != 1)
+                || (address == 0)
+                || strstr(line, " for DMA"))
+                continue;
+
+            // Locate the address in the table
+            index = (address >> 2) & (ADDRESS_TABLE_ENTRIES - 1);
+            while (addressTable[index] && (addressTable[index] != address))
+                index = (index + 1) & (ADDRESS_TABLE_ENTRIES - 1);
+
+            // "%p: %s, %s, Allocated %d (0x%x) bytes"
+            text = strstr(line, ", Allocated ");
+            if (text && (sscanf(text, ", Allocated %lu", &bytes) == 1))
+            {
+                // Assign a slot to the buffer
+                if (addressTable[index] == 0)
+                {
+                    freeSlot = freeSlotCount ? freeSlots[--freeSlotCount] : slots;
+                    addressTable[index] = address;
+                    slotTable[index] = freeSlot;
+                }
+                success = traceAdd(bytes, slotTable[index]);
+                continue;
+            }
+
+            // "%p: %s, Freeing %s", ignore buffers allocated before the
+            // trace started
+            if (strstr(line, ", Freeing ") && (addressTable[index] == address))
+            {
+                success = traceAdd(0, slotTable[index]);
+                freeSlots[freeSlotCount++] = slotTable[index];
+
+                // Remove the address, rehash the following entries
+                addressTable[index] = 0;
+                next = (index + 1) & (ADDRESS_TABLE_ENTRIES - 1);
+                while (addressTable[next])
+                {
+                    address = addressTable[next];
+                    freeSlot = slotTable[next];
+                    addressTable[next] = 0;
+                    index = (address >> 2) & (ADDRESS_TABLE_ENTRIES - 1);
+                    while (addressTable[index])
+                        index = (index + 1) & (ADDRESS_TABLE_ENTRIES - 1);
+                    addressTable[index] = address;
+                    slotTable[index] = freeSlot;
+                    next = (next + 1) & (ADDRESS_TABLE_ENTRIES - 1);
+                }
+            }
+        }
+        if (success && (traceEntries == 0))
+        {
+            fprintf(stderr, "ERROR: No allocations found in %s!\n", fileName);
+            success = false;
+        }
+    } while (0);
+
+    // Done with the file and tables
+    if (file)
+        fclose(file);
+    free(freeSlots);
+    free(slotTable);
+    free(addressTable);
+    return success;
+}
+
+//*********************************************************************
+// Replay the trace
+// Inputs:
+//   parameter: Address of the THREAD_CONTEXT
+// Outputs:
+//   Returns nullptr
+void * replay(void * parameter)
+{
+    void * buffer;
+    THREAD_CONTEXT * context;
+    TRACE_ENTRY * entry;
+    struct timespec end;
+    int iteration;
+    struct timespec start;
+    uint32_t slot;
+
+    context = (THREAD_CONTEXT *)parameter;
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (entry = trace; entry < &trace[traceEntries]; entry++)
+        {
+            slot = entry->_slot;
+
+            // Free the buffer
+            if (entry->_bytes == 0)
+            {
+                buffer = context->_pointers[slot];
+                context->_pointers[slot] = nullptr;
+                if ((!context->_usePool)
+                    || (!r4aEsp32PoolFree(&pool, buffer, context->_core)))
+                    free(buffer);
+                continue;
+            }
+
+            // Allocate the buffer, the trace may reuse a slot when the
+            // free was not logged
+            if (context->_pointers[slot])
+                continue;
+            buffer = nullptr;
+            if (context->_usePool)
+                buffer = r4aEsp32PoolAlloc(&pool, entry->_bytes, context->_core);
+            if (!buffer)
+            {
+                if (context->_usePool)
+                    context->_fallbacks += 1;
+                buffer = malloc(entry->_bytes);
+            }
+            *(volatile uint8_t *)buffer = (uint8_t)slot;
+            context->_pointers[slot] = buffer;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        context->_nsec += ((uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ull)
+                        + end.tv_nsec - start.tv_nsec;
+
+        // Release the buffers still allocated at the end of the trace
+        for (slot = 0; slot < slots; slot++)
+        {
+            buffer = context->_pointers[slot];
+            context->_pointers[slot] = nullptr;
+            if (buffer && ((!context->_usePool)
+                           || (!r4aEsp32PoolFree(&pool, buffer, context->_core))))
+                free(buffer);
+        }
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Run the benchmark
+// Inputs:
+//   name: Name of the allocator
+//   threads: Number of threads replaying the trace
+//   usePool: Use the pool before malloc
+// Outputs:
+//   Returns true if successful and false upon failure
+bool runBenchmark(const char * name, int threads, bool usePool)
+{
+    THREAD_CONTEXT context[MAX_THREADS];
+    uint64_t fallbacks;
+    int index;
+    uint64_t nsec;
+    uint64_t operations;
+    int status;
+
+    // Start the threads
+    memset(context, 0, sizeof(context));
+    for (index = 0; index < threads; index++)
+    {
+        context[index]._core = index;
+        context[index]._usePool = usePool;
+        context[index]._pointers = (void **)calloc(slots, sizeof(void *));
+        if (!context[index]._pointers)
+        {
+            fprintf(stderr, "ERROR: Failed to allocate the pointer table!\n");
+            return false;
+        }
+    }
+    for (index = 0; index < threads; index++)
+    {
+        status = pthread_create(&context[index]._thread, nullptr, replay, &context[index]);
+        if (status)
+        {
+            fprintf(stderr, "ERROR: Failed to create thread, %s!\n", strerror(status));
+            exit(status);
+        }
+    }
+
+    // Wait for the threads to finish
+    fallbacks = 0;
+    nsec = 0;
+    for (index = 0; index < threads; index++)
+    {
+        pthread_join(context[index]._thread, nullptr);
+        fallbacks += context[index]._fallbacks;
+        nsec += context[index]._nsec;
+        free(context[index]._pointers);
+    }
+
+    // Display the results
+    operations = (uint64_t)traceEntries * iterations * threads;
+    printf("%-8s %7d %12llu %10.1f %12llu\n",
+           name,
+           threads,
+           (unsigned long long)operations,
+           (double)nsec / operations,
+           (unsigned long long)fallbacks);
+    return true;
+}
+
+//*********************************************************************
+// Display the help text
+// Inputs:
+//   program: Name of the program
+void displayHelp(const char * program)
+{
+    fprintf(stderr, "%s   [-i iterations]   [-t threads]   [trace_file]\n", program);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "trace_file: Serial output captured with r4aMallocDebug set to true,\n");
+    fprintf(stderr, "            a synthetic trace is generated when not specified\n");
+}
+
+//*********************************************************************
+// Compare the memory pool against the system allocator
+int main(int argc, char **argv)
+{
+    uint32_t allocations;
+    int argIndex;
+    int index;
+    void * memory;
+    R4A_ESP32_POOL_CLASS * poolClass;
+    int threads;
+
+    // Get the options
+    threads = 2;
+    for (argIndex = 1; argIndex < argc; argIndex++)
+    {
+        if ((strcmp(argv[argIndex], "-i") == 0) && ((argIndex + 1) < argc))
+            iterations = atoi(argv[++argIndex]);
+        else if ((strcmp(argv[argIndex], "-t") == 0) && ((argIndex + 1) < argc))
+            threads = atoi(argv[++argIndex]);
+        else
+            break;
+    }
+    if ((argIndex < (argc - 1))
+        || ((argIndex < argc) && (argv[argIndex][0] == '-'))
+        || (iterations <= 0)
+        || (threads <= 0)
+        || (threads > MAX_THREADS))
+    {
+        displayHelp(argv[0]);
+        return -1;
+    }
+
+    // Get the allocation trace
+    if (!((argIndex < argc) ? traceRead(argv[argIndex]) : traceGenerate()))
+        return -1;
+    allocations = 0;
+    for (index = 0; index < (int)traceEntries; index++)
+        if (trace[index]._bytes)
+            allocations += 1;
+    printf("Trace: %lu operations, %lu allocations, %lu slots\n",
+           (unsigned long)traceEntries, (unsigned long)allocations, (unsigned long)slots);
+
+    // Allocate the pool
+    memory = malloc(r4aEsp32PoolBytes(defaultBlocks));
+    if (!memory)
+    {
+        fprintf(stderr, "ERROR: Failed to allocate the pool!\n");
+        return -1;
+    }
+    r4aEsp32PoolInit(&pool, memory, defaultBlocks);
+
+    // Run the benchmarks, single threaded and then multi-threaded
+    printf("\n");
+    printf("Allocator Threads   Operations  nSec/Op    Fallbacks\n");
+    if ((!runBenchmark("malloc", 1, false))
+        || (!runBenchmark("pool", 1, true)))
+        return -1;
+    if ((threads > 1)
+        && ((!runBenchmark("malloc", threads, false))
+            || (!runBenchmark("pool", threads, true))))
+        return -1;
+
+    // Display the pool statistics
+    printf("\n");
+    printf("Bytes  Blocks  High Water  Allocations  Exhausted  Steals  Avg Request\n");
+    for (index = 0; index < R4A_ESP32_POOL_CLASSES; index++)
+    {
+        poolClass = &pool._class[index];
+        printf("%5u  %6u  %10u  %11u  %9u  %6u  %11u\n",
+               poolClass->_blockBytes,
+               poolClass->_blocks,
+               poolClass->_highWater,
+               poolClass->_allocations,
+               poolClass->_exhausted,
+               poolClass->_steals,
+               poolClass->_allocations
+                   ? (uint32_t)(poolClass->_requestedBytes / poolClass->_allocations)
+                   : 0);
+    }
+    free(memory);
+    free(trace);
+    return 0;
+}
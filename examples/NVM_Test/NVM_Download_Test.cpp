@@ -0,0 +1,331 @@
+/**********************************************************************
+  NVM_Download_Test.cpp
+
+  Program to test the streaming download (r4aEsp32NvmStreamToFile in
+  src/NVM.cpp) against a local HTTP/1.0 stand-in server.  The server
+  sends a file with and without a Content-Length header, closes the
+  connection early, and stalls in the middle of the body.  A successful
+  download must replace the file with the body, a failed download must
+  leave the original file and no temporary file.  A client that reports
+  available data which read does not return must time out.  The program
+  exits with a non-zero status when a test fails.
+**********************************************************************/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "NVM_Test_Table.h"
+
+#define BODY_BYTES              (300 * 1024)
+#define DOWNLOAD_FILE           "/Download.bin"
+#define ORIGINAL_TEXT           "original file\r\n"
+#define STALL_MSEC              7000
+#define TRUNCATED_BYTES         (100 * 1024)
+
+// Responses sent by the server
+enum SERVER_RESPONSE
+{
+    RESPONSE_LENGTH = 0,        // Content-Length and the complete body
+    RESPONSE_CLOSE,             // No Content-Length, close after the body
+    RESPONSE_TRUNCATED,         // Content-Length, close part way through the body
+    RESPONSE_STALL,             // Content-Length, stop sending part way through
+};
+
+//****************************************
+// Socket Client
+//****************************************
+
+class SocketClient : public Client
+{
+  private:
+
+    int _socket;
+
+  public:
+
+    SocketClient(int socket) : _socket(socket) {}
+
+    // Get the number of bytes that may be read without waiting
+    int available()
+    {
+        int bytes;
+
+        if (ioctl(_socket, FIONREAD, &bytes) < 0)
+            return 0;
+        return bytes;
+    }
+
+    // Determine if the connection is still open
+    uint8_t connected()
+    {
+        uint8_t data;
+
+        return recv(_socket, &data, sizeof(data), MSG_PEEK | MSG_DONTWAIT) != 0;
+    }
+
+    // Read data from the connection, returns -1 when no data is available
+    int read(uint8_t * buffer, size_t length)
+    {
+        return recv(_socket, buffer, length, MSG_DONTWAIT);
+    }
+};
+
+//****************************************
+// Failing Client
+//****************************************
+
+// Reports data that read never returns
+class FailingClient : public Client
+{
+  public:
+
+    int available() { return 100; }
+    uint8_t connected() { return 1; }
+    int read(uint8_t * buffer, size_t length) { return -1; }
+};
+
+//****************************************
+// Locals
+//****************************************
+
+uint8_t body[BODY_BYTES];
+int listenSocket;
+uint16_t serverPort;
+volatile SERVER_RESPONSE serverResponse;
+
+//*********************************************************************
+// Send data on the socket
+bool sendData(int socket, const void * data, size_t length)
+{
+    ssize_t bytesSent;
+    size_t offset;
+
+    for (offset = 0; offset < length; offset += bytesSent)
+    {
+        bytesSent = send(socket, &((const uint8_t *)data)[offset], length - offset, MSG_NOSIGNAL);
+        if (bytesSent <= 0)
+            return false;
+    }
+    return true;
+}
+
+//*********************************************************************
+// Answer each request with the selected response
+void * serverThread(void * parameter)
+{
+    size_t bodyBytes;
+    char header[128];
+    char request[1024];
+    int socket;
+
+    while (1)
+    {
+        socket = accept(listenSocket, nullptr, nullptr);
+        if (socket < 0)
+            break;
+
+        // Read the request, a single recv is enough for the test client
+        recv(socket, request, sizeof(request), 0);
+
+        // Send the response header
+        if (serverResponse == RESPONSE_CLOSE)
+            snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n\r\n");
+        else
+            snprintf(header, sizeof(header),
+                     "HTTP/1.0 200 OK\r\nContent-Length: %d\r\n\r\n", BODY_BYTES);
+        sendData(socket, header, strlen(header));
+
+        // Send the body
+        bodyBytes = BODY_BYTES;
+        if ((serverResponse == RESPONSE_TRUNCATED) || (serverResponse == RESPONSE_STALL))
+            bodyBytes = TRUNCATED_BYTES;
+        sendData(socket, body, bodyBytes);
+        if (serverResponse == RESPONSE_STALL)
+            delay(STALL_MSEC);
+        close(socket);
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Start the stand-in server on a local port
+bool serverStart()
+{
+    struct sockaddr_in address;
+    socklen_t addressLength;
+    pthread_t thread;
+
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket < 0)
+        return false;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addressLength = sizeof(address);
+    if (bind(listenSocket, (struct sockaddr *)&address, sizeof(address))
+        || listen(listenSocket, 1)
+        || getsockname(listenSocket, (struct sockaddr *)&address, &addressLength))
+        return false;
+    serverPort = ntohs(address.sin_port);
+    pthread_create(&thread, nullptr, serverThread, nullptr);
+    pthread_detach(thread);
+    return true;
+}
+
+//*********************************************************************
+// Request the file and read the response header
+// Outputs:
+//   Returns the socket or -1 upon failure
+int httpGet(int32_t * length)
+{
+    struct sockaddr_in address;
+    char data;
+    char line[256];
+    size_t offset;
+    const char * request = "GET /Download.bin HTTP/1.0\r\n\r\n";
+    int socket;
+
+    // Connect to the server
+    socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(serverPort);
+    if ((socket < 0)
+        || connect(socket, (struct sockaddr *)&address, sizeof(address))
+        || (!sendData(socket, request, strlen(request))))
+        return -1;
+
+    // Read the header lines until the empty line, like HTTPClient
+    *length = -1;
+    offset = 0;
+    while (recv(socket, &data, 1, 0) == 1)
+    {
+        if (data == '\r')
+            continue;
+        if (data != '\n')
+        {
+            if (offset < (sizeof(line) - 1))
+                line[offset++] = data;
+            continue;
+        }
+        line[offset] = 0;
+        if (offset == 0)
+            return socket;
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+            *length = atoi(&line[15]);
+        offset = 0;
+    }
+    close(socket);
+    return -1;
+}
+
+//*********************************************************************
+// Determine if the download file contains the data
+bool fileMatches(const void * data, size_t length)
+{
+    uint8_t * buffer;
+    File file;
+    bool match;
+
+    file = LittleFS.open(DOWNLOAD_FILE, FILE_READ);
+    if (!file)
+        return false;
+    buffer = (uint8_t *)malloc(length + 1);
+    match = (file.read(buffer, length + 1) == length)
+         && (memcmp(buffer, data, length) == 0);
+    free(buffer);
+    file.close();
+    return match;
+}
+
+//*********************************************************************
+// Download the file and verify the result
+bool downloadTest(const char * name,
+                  SERVER_RESPONSE response,
+                  Client * failingClient,
+                  bool expectSuccess)
+{
+    bool downloaded;
+    File file;
+    int32_t length;
+    uint32_t msec;
+    int socket;
+    bool success;
+    uint64_t startUsec;
+
+    // Create the original file
+    file = LittleFS.open(DOWNLOAD_FILE, FILE_WRITE);
+    file.write((const uint8_t *)ORIGINAL_TEXT, strlen(ORIGINAL_TEXT));
+    file.close();
+
+    // Download the file
+    socket = -1;
+    startUsec = nvmTestUsec();
+    if (failingClient)
+        downloaded = r4aEsp32NvmStreamToFile(failingClient, BODY_BYTES, DOWNLOAD_FILE, nullptr);
+    else
+    {
+        serverResponse = response;
+        socket = httpGet(&length);
+        if (socket < 0)
+        {
+            fprintf(stderr, "ERROR: %s, failed to request the file!\n", name);
+            return false;
+        }
+        SocketClient client(socket);
+        downloaded = r4aEsp32NvmStreamToFile(&client, length, DOWNLOAD_FILE, nullptr);
+        close(socket);
+    }
+    msec = (uint32_t)((nvmTestUsec() - startUsec) / 1000);
+
+    // Verify the file
+    if (expectSuccess)
+        success = downloaded && fileMatches(body, BODY_BYTES);
+    else
+        success = (!downloaded) && fileMatches(ORIGINAL_TEXT, strlen(ORIGINAL_TEXT));
+    success = success && (!LittleFS.exists(DOWNLOAD_FILE ".tmp"));
+    printf("%s: %s, download %s in %lu mSec\n",
+           success ? "PASS" : "FAIL",
+           name,
+           downloaded ? "succeeded" : "failed",
+           (unsigned long)msec);
+    return success;
+}
+
+//*********************************************************************
+// Test the streaming download
+int main(int argc, char **argv)
+{
+    const char * directory;
+    FailingClient failingClient;
+    int index;
+    bool success;
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // Abort instead of spinning forever
+    alarm(60);
+
+    directory = nvmTestDirectoryCreate("NVM_Download_Test");
+    for (index = 0; index < BODY_BYTES; index++)
+        body[index] = (uint8_t)((index * 7) + (index >> 9));
+    success = serverStart();
+    if (!success)
+        fprintf(stderr, "ERROR: Failed to start the server!\n");
+    else
+    {
+        success = downloadTest("Content-Length", RESPONSE_LENGTH, nullptr, true);
+        success &= downloadTest("close delimited", RESPONSE_CLOSE, nullptr, true);
+        success &= downloadTest("closed before Content-Length", RESPONSE_TRUNCATED, nullptr, false);
+        success &= downloadTest("stalled before Content-Length", RESPONSE_STALL, nullptr, false);
+        success &= downloadTest("available without data", RESPONSE_LENGTH, &failingClient, false);
+    }
+    close(listenSocket);
+    nvmTestDirectoryRemove(directory);
+    return success ? 0 : -1;
+}
@@ -0,0 +1,578 @@
+/**********************************************************************
+  NVM_Host.cpp
+
+  Robots-For-All (R4A)
+  Host stand-ins for the Arduino classes and the ESP32 routines used by
+  src/NVM.cpp
+**********************************************************************/
+
+#include <pthread.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <set>
+
+#include "NVM_Host.h"
+
+//****************************************
+// Globals
+//****************************************
+
+HostFS LittleFS;
+HostSerial Serial;
+
+//****************************************
+// Types
+//****************************************
+
+typedef struct _HOST_SEMAPHORE
+{
+    pthread_mutex_t _mutex;
+    pthread_t _owner;
+    int _depth;                 // Number of takes by the owner
+} HOST_SEMAPHORE;
+
+//****************************************
+// Locals
+//****************************************
+
+static std::set<void *> allocations;
+static pthread_mutex_t allocationMutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool crashed;
+static int crashPoint;
+static int fsChanges;
+static uint64_t fileReadBytes;
+static uint64_t fileReads;
+static pthread_mutex_t fsMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::string fsRoot;
+static std::set<HOST_SEMAPHORE *> semaphores;
+static pthread_mutex_t semaphoreMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//*********************************************************************
+// Output a buffer of bytes
+size_t Print::write(const uint8_t * buffer, size_t length)
+{
+    size_t bytesWritten;
+
+    bytesWritten = 0;
+    while (length--)
+        bytesWritten += write(*buffer++);
+    return bytesWritten;
+}
+
+//*********************************************************************
+// Output a formatted string
+size_t Print::printf(const char * format, ...)
+{
+    va_list args;
+    char buffer[1024];
+    int length;
+
+    va_start(args, format);
+    length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0)
+        return 0;
+    if ((size_t)length >= sizeof(buffer))
+        length = sizeof(buffer) - 1;
+    return write((const uint8_t *)buffer, length);
+}
+
+//*********************************************************************
+// Output a string
+size_t Print::print(const char * string)
+{
+    return write((const uint8_t *)string, strlen(string));
+}
+
+//*********************************************************************
+// Output a string followed by CR and LF
+size_t Print::println(const char * string)
+{
+    return print(string) + print("\r\n");
+}
+
+//*********************************************************************
+// Output a byte
+size_t HostSerial::write(uint8_t data)
+{
+    return write(&data, 1);
+}
+
+//*********************************************************************
+// Output a buffer of bytes
+size_t HostSerial::write(const uint8_t * buffer, size_t length)
+{
+    if (!_quiet)
+        fwrite(buffer, 1, length, stdout);
+    return length;
+}
+
+//*********************************************************************
+// Request a crash before the specified file system change
+void hostCrashAfter(int changes)
+{
+    pthread_mutex_lock(&fsMutex);
+    crashed = false;
+    crashPoint = changes;
+    fsChanges = 0;
+    pthread_mutex_unlock(&fsMutex);
+}
+
+//*********************************************************************
+// Release the mutexes held by this thread after a crash
+void hostCrashRecover()
+{
+    std::set<HOST_SEMAPHORE *>::iterator iterator;
+
+    pthread_mutex_lock(&semaphoreMutex);
+    for (iterator = semaphores.begin(); iterator != semaphores.end(); iterator++)
+        while ((*iterator)->_depth && pthread_equal((*iterator)->_owner, pthread_self()))
+            xSemaphoreGiveRecursive(*iterator);
+    pthread_mutex_unlock(&semaphoreMutex);
+}
+
+//*********************************************************************
+// Get the number of File::read calls and bytes read since the last call
+uint64_t hostFileReads(uint64_t * bytesRead)
+{
+    *bytesRead = __atomic_exchange_n(&fileReadBytes, 0, __ATOMIC_RELAXED);
+    return __atomic_exchange_n(&fileReads, 0, __ATOMIC_RELAXED);
+}
+
+//*********************************************************************
+// Get the number of file system changes
+int hostFsChanges()
+{
+    return fsChanges;
+}
+
+//*********************************************************************
+// Account for a file system change, called with fsMutex held
+void hostFsChange()
+{
+    fsChanges += 1;
+    if (crashPoint && (fsChanges >= crashPoint))
+    {
+        crashed = true;
+        pthread_mutex_unlock(&fsMutex);
+        throw HOST_CRASH();
+    }
+}
+
+//*********************************************************************
+// Read the host file into a string
+static bool hostReadFile(const std::string &hostPath, std::string * data)
+{
+    char buffer[4096];
+    size_t bytesRead;
+    FILE * file;
+
+    file = fopen(hostPath.c_str(), "rb");
+    if (!file)
+        return false;
+    data->clear();
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data->append(buffer, bytesRead);
+    fclose(file);
+    return true;
+}
+
+//*********************************************************************
+// Write a string to the host file
+static bool hostWriteFile(const std::string &hostPath, const std::string &data)
+{
+    FILE * file;
+    bool success;
+
+    file = fopen(hostPath.c_str(), "wb");
+    if (!file)
+        return false;
+    success = (fwrite(data.data(), 1, data.length(), file) == data.length());
+    success &= (fclose(file) == 0);
+    return success;
+}
+
+//*********************************************************************
+// Discard the uncommitted data after a crash, otherwise commit the data
+_HOST_FILE::~_HOST_FILE()
+{
+    if (_dirty && (!crashed))
+    {
+        pthread_mutex_lock(&fsMutex);
+        hostWriteFile(_hostPath, _data);
+        pthread_mutex_unlock(&fsMutex);
+    }
+}
+
+//*********************************************************************
+// Get the number of bytes remaining in the file
+int File::available()
+{
+    if (!_file)
+        return 0;
+    return _file->_data.length() - _file->_position;
+}
+
+//*********************************************************************
+// Close the file, committing the data
+void File::close()
+{
+    if (_file && _file->_dirty && (!crashed))
+    {
+        pthread_mutex_lock(&fsMutex);
+        hostFsChange();
+        hostWriteFile(_file->_hostPath, _file->_data);
+        pthread_mutex_unlock(&fsMutex);
+        _file->_dirty = false;
+    }
+    _file.reset();
+}
+
+//*********************************************************************
+// Get the last write time of the committed file
+time_t File::getLastWrite()
+{
+    struct stat status;
+
+    if ((!_file) || stat(_file->_hostPath.c_str(), &status))
+        return 0;
+    return status.st_mtime;
+}
+
+//*********************************************************************
+// Get the file name
+const char * File::name() const
+{
+    return _file ? _file->_path.c_str() : "";
+}
+
+//*********************************************************************
+// Get the file position
+size_t File::position() const
+{
+    return _file ? _file->_position : 0;
+}
+
+//*********************************************************************
+// Read a byte from the file
+int File::read()
+{
+    uint8_t data;
+
+    if (read(&data, 1) != 1)
+        return -1;
+    return data;
+}
+
+//*********************************************************************
+// Read data from the file
+size_t File::read(uint8_t * buffer, size_t length)
+{
+    size_t bytesRead;
+
+    __atomic_fetch_add(&fileReads, 1, __ATOMIC_RELAXED);
+    if (!_file)
+        return 0;
+    bytesRead = _file->_data.length() - _file->_position;
+    if (bytesRead > length)
+        bytesRead = length;
+    memcpy(buffer, &_file->_data[_file->_position], bytesRead);
+    _file->_position += bytesRead;
+    __atomic_fetch_add(&fileReadBytes, bytesRead, __ATOMIC_RELAXED);
+    return bytesRead;
+}
+
+//*********************************************************************
+// Set the file position
+bool File::seek(uint32_t position)
+{
+    if ((!_file) || (position > _file->_data.length()))
+        return false;
+    _file->_position = position;
+    return true;
+}
+
+//*********************************************************************
+// Get the file size
+size_t File::size() const
+{
+    return _file ? _file->_data.length() : 0;
+}
+
+//*********************************************************************
+// Write a byte to the file
+size_t File::write(uint8_t data)
+{
+    return write(&data, 1);
+}
+
+//*********************************************************************
+// Write data to the file
+size_t File::write(const uint8_t * buffer, size_t length)
+{
+    if ((!_file) || (!_file->_write))
+        return 0;
+    _file->_data.replace(_file->_position, length, (const char *)buffer, length);
+    _file->_position += length;
+    _file->_dirty = true;
+    return length;
+}
+
+//*********************************************************************
+// Set the host directory holding the files
+void HostFS::begin(const char * directory)
+{
+    fsRoot = directory;
+}
+
+//*********************************************************************
+// Determine if the file exists
+bool HostFS::exists(const char * path)
+{
+    return (access(hostPath(path).c_str(), F_OK) == 0);
+}
+
+//*********************************************************************
+// Get the host path for a file
+std::string HostFS::hostPath(const char * path)
+{
+    return fsRoot + std::string(path);
+}
+
+//*********************************************************************
+// Open the file
+File HostFS::open(const char * path, const char * mode)
+{
+    File file;
+    HOST_FILE * hostFile;
+    bool success;
+
+    hostFile = new HOST_FILE;
+    hostFile->_dirty = false;
+    hostFile->_hostPath = hostPath(path);
+    hostFile->_path = path;
+    hostFile->_position = 0;
+    hostFile->_write = (mode[0] != 'r');
+
+    // Read the existing file
+    pthread_mutex_lock(&fsMutex);
+    success = hostReadFile(hostFile->_hostPath, &hostFile->_data);
+    if (mode[0] == 'w')
+    {
+        // Truncate the file when it is committed
+        hostFile->_data.clear();
+        hostFile->_dirty = true;
+    }
+    if (mode[0] == 'a')
+        hostFile->_position = hostFile->_data.length();
+
+    // Create the file
+    if ((!success) && hostFile->_write)
+    {
+        hostFsChange();
+        success = hostWriteFile(hostFile->_hostPath, hostFile->_data);
+    }
+    pthread_mutex_unlock(&fsMutex);
+
+    // Return the file
+    if (success)
+        file._file.reset(hostFile);
+    else
+        delete hostFile;
+    return file;
+}
+
+//*********************************************************************
+// Remove the file
+bool HostFS::remove(const char * path)
+{
+    bool success;
+
+    pthread_mutex_lock(&fsMutex);
+    hostFsChange();
+    success = (unlink(hostPath(path).c_str()) == 0);
+    pthread_mutex_unlock(&fsMutex);
+    return success;
+}
+
+//*********************************************************************
+// Rename the file, replacing an existing file
+bool HostFS::rename(const char * oldPath, const char * newPath)
+{
+    bool success;
+
+    pthread_mutex_lock(&fsMutex);
+    hostFsChange();
+    success = (::rename(hostPath(oldPath).c_str(), hostPath(newPath).c_str()) == 0);
+    pthread_mutex_unlock(&fsMutex);
+    return success;
+}
+
+//*********************************************************************
+// Delay for the specified number of milliseconds
+void delay(uint32_t msec)
+{
+    usleep(msec * 1000);
+}
+
+//*********************************************************************
+// Compute the CRC-32 using a table, like the ESP32 ROM
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t * buffer, uint32_t length)
+{
+    int bit;
+    static uint32_t crcTable[256];
+    uint32_t value;
+
+    // Build the table
+    if (!crcTable[1])
+        for (int index = 0; index < 256; index++)
+        {
+            value = index;
+            for (bit = 0; bit < 8; bit++)
+                value = (value >> 1) ^ (0xedb88320 & -(value & 1));
+            crcTable[index] = value;
+        }
+
+    // Compute the CRC
+    crc = ~crc;
+    while (length--)
+        crc = (crc >> 8) ^ crcTable[(crc ^ *buffer++) & 0xff];
+    return ~crc;
+}
+
+//*********************************************************************
+// Get the number of milliseconds since the program started
+uint32_t millis()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((now.tv_sec * 1000ull) + (now.tv_nsec / 1000000));
+}
+
+//*********************************************************************
+// Display a buffer in hexadecimal and ASCII
+void r4aDumpBuffer(intptr_t offset,
+                   const uint8_t * buffer,
+                   uint32_t length,
+                   Print * display)
+{
+    uint32_t index;
+
+    for (index = 0; index < length; index++)
+    {
+        if ((index & 15) == 0)
+            display->printf("%s%08lx:", index ? "\r\n" : "", (unsigned long)(offset + index));
+        display->printf(" %02x", buffer[index]);
+    }
+    display->println();
+}
+
+//*********************************************************************
+// Determine if the buffer was allocated by r4aMalloc
+bool r4aEsp32IsAddressInRAM(void * addr)
+{
+    bool allocated;
+
+    pthread_mutex_lock(&allocationMutex);
+    allocated = (allocations.find(addr) != allocations.end());
+    pthread_mutex_unlock(&allocationMutex);
+    return allocated;
+}
+
+//*********************************************************************
+// Free a buffer allocated by r4aMalloc
+void r4aFree(void * buffer, const char * text)
+{
+    pthread_mutex_lock(&allocationMutex);
+    if (!allocations.erase(buffer))
+    {
+        fprintf(stderr, "ERROR: Freeing %p which was not allocated, %s!\n", buffer, text);
+        exit(-1);
+    }
+    pthread_mutex_unlock(&allocationMutex);
+    free(buffer);
+}
+
+//*********************************************************************
+// Allocate a buffer
+void * r4aMalloc(size_t length, const char * text)
+{
+    void * buffer;
+
+    buffer = malloc(length);
+    if (buffer)
+    {
+        pthread_mutex_lock(&allocationMutex);
+        allocations.insert(buffer);
+        pthread_mutex_unlock(&allocationMutex);
+    }
+    return buffer;
+}
+
+//*********************************************************************
+// Report a fatal error
+void r4aReportFatalError(const char * errorMessage)
+{
+    fprintf(stderr, "ERROR: %s\n", errorMessage);
+    exit(-1);
+}
+
+//*********************************************************************
+// Compare two strings ignoring the case
+int r4aStricmp(const char * str1, const char * str2)
+{
+    return strcasecmp(str1, str2);
+}
+
+//*********************************************************************
+// Delete a semaphore
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    pthread_mutex_lock(&semaphoreMutex);
+    semaphores.erase(semaphore);
+    pthread_mutex_unlock(&semaphoreMutex);
+    pthread_mutex_destroy(&semaphore->_mutex);
+    delete semaphore;
+}
+
+//*********************************************************************
+// Create a mutex that may be taken again by the owner
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+    pthread_mutexattr_t attributes;
+    HOST_SEMAPHORE * semaphore;
+
+    semaphore = new HOST_SEMAPHORE;
+    semaphore->_depth = 0;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&semaphore->_mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    pthread_mutex_lock(&semaphoreMutex);
+    semaphores.insert(semaphore);
+    pthread_mutex_unlock(&semaphoreMutex);
+    return semaphore;
+}
+
+//*********************************************************************
+// Release the mutex
+int xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore)
+{
+    semaphore->_depth -= 1;
+    pthread_mutex_unlock(&semaphore->_mutex);
+    return pdTRUE;
+}
+
+//*********************************************************************
+// Take the mutex, waiting for the owner to release it
+int xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, uint32_t ticks)
+{
+    pthread_mutex_lock(&semaphore->_mutex);
+    semaphore->_owner = pthread_self();
+    semaphore->_depth += 1;
+    return pdTRUE;
+}
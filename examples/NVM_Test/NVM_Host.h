@@ -0,0 +1,253 @@
+/**********************************************************************
+  NVM_Host.h
+
+  Robots-For-All (R4A)
+  Host stand-ins for the Arduino classes and the ESP32 routines used by
+  src/NVM.cpp
+
+  The LittleFS stand-in stores the files in a host directory.  Like
+  LittleFS, a file is created when it is opened for write and the data
+  written to the file is committed when the file is closed.  A test may
+  request a simulated crash before any of the file system changes, the
+  crash throws HOST_CRASH and discards the uncommitted data, leaving the
+  files as they would be found after a power failure.
+**********************************************************************/
+
+#ifndef __NVM_HOST_H__
+#define __NVM_HOST_H__
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <memory>
+#include <string>
+
+//****************************************
+// Constants
+//****************************************
+
+#define FILE_APPEND     "a"
+#define FILE_READ       "r"
+#define FILE_WRITE      "w"
+
+#define log_d(...)
+#define log_e(...)
+#define log_v(...)
+
+#define pdTRUE          1
+#define portMAX_DELAY   0xffffffff
+
+//****************************************
+// Print
+//****************************************
+
+class Print
+{
+  public:
+
+    virtual ~Print() {}
+
+    // Output a byte
+    virtual size_t write(uint8_t data) = 0;
+
+    // Output a buffer of bytes
+    virtual size_t write(const uint8_t * buffer, size_t length);
+
+    // Output a formatted string
+    size_t printf(const char * format, ...);
+
+    // Output a string
+    size_t print(const char * string);
+
+    // Output a string followed by CR and LF
+    size_t println(const char * string = "");
+};
+
+// Print to stdout, may be silenced by the benchmarks
+class HostSerial : public Print
+{
+  public:
+
+    bool _quiet;                // Set to discard the output
+
+    size_t write(uint8_t data);
+    size_t write(const uint8_t * buffer, size_t length);
+};
+
+extern HostSerial Serial;
+
+//****************************************
+// String
+//****************************************
+
+class String
+{
+  public:
+
+    std::string _string;
+
+    String() {}
+    String(const char * string) : _string(string ? string : "") {}
+    const char * c_str() const { return _string.c_str(); }
+    size_t length() const { return _string.length(); }
+    String operator+(const String &string) const
+    {
+        String result;
+
+        result._string = _string + string._string;
+        return result;
+    }
+};
+
+//****************************************
+// Client
+//****************************************
+
+class Client
+{
+  public:
+
+    virtual ~Client() {}
+
+    // Get the number of bytes that may be read without waiting
+    virtual int available() = 0;
+
+    // Determine if the connection is still open
+    virtual uint8_t connected() = 0;
+
+    // Read data from the connection, returns -1 when no data is available
+    virtual int read(uint8_t * buffer, size_t length) = 0;
+};
+
+//****************************************
+// File and LittleFS
+//****************************************
+
+// Thrown by the file system when the simulated crash occurs
+class HOST_CRASH
+{
+};
+
+// Open file state, shared by the copies of a File object
+typedef struct _HOST_FILE
+{
+    std::string _data;          // File contents
+    bool _dirty;                // Data needs to be committed upon close
+    std::string _hostPath;      // Path to the host file
+    std::string _path;          // Path within the file system
+    size_t _position;           // Offset of the next read or write
+    bool _write;                // File opened for write or append
+
+    ~_HOST_FILE();
+} HOST_FILE;
+
+class File
+{
+  public:
+
+    std::shared_ptr<HOST_FILE> _file;
+
+    operator bool() const { return (bool)_file; }
+    int available();
+    void close();
+    time_t getLastWrite();
+    const char * name() const;
+    size_t position() const;
+    int read();
+    size_t read(uint8_t * buffer, size_t length);
+    bool seek(uint32_t position);
+    size_t size() const;
+    size_t write(uint8_t data);
+    size_t write(const uint8_t * buffer, size_t length);
+};
+
+class HostFS
+{
+  public:
+
+    // Set the host directory holding the files
+    void begin(const char * directory);
+
+    bool exists(const char * path);
+    File open(const char * path, const char * mode = FILE_READ);
+    bool remove(const char * path);
+    bool rename(const char * oldPath, const char * newPath);
+
+    // Get the host path for a file
+    std::string hostPath(const char * path);
+};
+
+extern HostFS LittleFS;
+
+//****************************************
+// R4A_ESP32_FILE_WRITER
+//****************************************
+
+class R4A_ESP32_FILE_WRITER
+{
+  public:
+
+    // Close the writers using the file, the host has no writers
+    static void closeFile(const char * path) {}
+};
+
+//****************************************
+// FreeRTOS semaphores
+//****************************************
+
+typedef struct _HOST_SEMAPHORE * SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+int xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore);
+int xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, uint32_t ticks);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+
+//****************************************
+// Crash simulation
+//****************************************
+
+// Request a crash before the specified file system change, the first
+// change is 1, zero disables the crash
+void hostCrashAfter(int changes);
+
+// Get the number of file system changes
+int hostFsChanges();
+
+// Account for a file system change, throws HOST_CRASH at the crash point
+void hostFsChange();
+
+// Release the mutexes held by this thread when the crash unwound the
+// stack, simulating the reboot
+void hostCrashRecover();
+
+//****************************************
+// File statistics
+//****************************************
+
+// Get the number of File::read calls and the number of bytes read since
+// the previous call
+uint64_t hostFileReads(uint64_t * bytesRead);
+
+//****************************************
+// Arduino and R4A support routines
+//****************************************
+
+void delay(uint32_t msec);
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t * buffer, uint32_t length);
+uint32_t millis();
+void r4aDumpBuffer(intptr_t offset,
+                   const uint8_t * buffer,
+                   uint32_t length,
+                   Print * display = &Serial);
+bool r4aEsp32IsAddressInRAM(void * addr);
+void r4aFree(void * buffer, const char * text);
+void * r4aMalloc(size_t length, const char * text);
+void r4aReportFatalError(const char * errorMessage);
+int r4aStricmp(const char * str1, const char * str2);
+
+#endif  // __NVM_HOST_H__
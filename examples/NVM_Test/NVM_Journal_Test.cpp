@@ -0,0 +1,315 @@
+/**********************************************************************
+  NVM_Journal_Test.cpp
+
+  Program to test the parameter journal (src/NVM.cpp).  The first test
+  sets parameter values in one thread while another thread compacts the
+  journal, verifying that the reloaded parameter file holds the last
+  values set.  The remaining tests crash the file system before each of
+  the file system changes made by the journal compaction and the journal
+  append, verifying that the reloaded parameter values are the values
+  set before the crash.  The last test replaces the parameter file with
+  an uploaded file, verifying that the journal and binary parameter file
+  of the previous file are not applied to the uploaded values.  The
+  program exits with a non-zero status when a test fails.
+**********************************************************************/
+
+#include <pthread.h>
+
+#include "NVM_Test_Table.h"
+
+#define BINARY_FILE             NVM_TEST_PARAMETER_FILE ".bin"
+#define JOURNAL_FILE            NVM_TEST_PARAMETER_FILE ".jnl"
+#define PARAMETER_COUNT         74
+#define RACE_SETS               20000
+#define CRASH_SETS              10
+#define UPLOAD_FILE             "/Parameters.txt.upload"
+
+//****************************************
+// Locals
+//****************************************
+
+R4A_ESP32_NVM_VALUE expected[PARAMETER_COUNT];
+R4A_ESP32_NVM_PARAMETER parameterTable[PARAMETER_COUNT];
+volatile bool setsDone;
+R4A_ESP32_NVM_VALUE values[PARAMETER_COUNT];
+
+//*********************************************************************
+// Set a parameter value, strings are set to "set-<value>"
+bool parameterSet(int index, int value)
+{
+    const R4A_ESP32_NVM_PARAMETER * parameter;
+    char valueString[32];
+
+    parameter = &parameterTable[index];
+    if (parameter->type == R4A_ESP32_NVM_PT_P_CHAR)
+        sprintf(valueString, "set-%d", value);
+    else
+        sprintf(valueString, "%d", value % (int)(parameter->maximum + 1));
+    return r4aEsp32NvmParameterSet(NVM_TEST_PARAMETER_FILE,
+                                   parameterTable,
+                                   PARAMETER_COUNT,
+                                   parameter,
+                                   valueString,
+                                   nullptr);
+}
+
+//*********************************************************************
+// Save the current parameter values, copying the strings
+void expectedSave()
+{
+    int index;
+
+    for (index = 0; index < PARAMETER_COUNT; index++)
+    {
+        if ((parameterTable[index].type == R4A_ESP32_NVM_PT_P_CHAR) && expected[index].pcc)
+            free((void *)expected[index].pcc);
+        expected[index] = values[index];
+        if ((parameterTable[index].type == R4A_ESP32_NVM_PT_P_CHAR) && values[index].pcc)
+            expected[index].pcc = strdup(values[index].pcc);
+    }
+}
+
+//*********************************************************************
+// Reload the parameters and compare them with the expected values,
+// returns the index of the first mismatch or -1 when the values match
+int parametersLoad()
+{
+    r4aEsp32NvmGetDefaultParameters(parameterTable, PARAMETER_COUNT);
+    if (!r4aEsp32NvmReadParameters(NVM_TEST_PARAMETER_FILE,
+                                   parameterTable,
+                                   PARAMETER_COUNT,
+                                   nullptr))
+        return PARAMETER_COUNT;
+    return nvmTestTableCompare(parameterTable, PARAMETER_COUNT, expected);
+}
+
+//*********************************************************************
+// Reload the parameters and verify the values
+bool parametersVerify(const char * test)
+{
+    int index;
+
+    index = parametersLoad();
+    if (index >= PARAMETER_COUNT)
+    {
+        fprintf(stderr, "ERROR: %s, failed to read the parameter file!\n", test);
+        return false;
+    }
+    if (index >= 0)
+    {
+        fprintf(stderr, "ERROR: %s, %s has the wrong value!\n",
+                test, parameterTable[index].name);
+        return false;
+    }
+    return true;
+}
+
+//*********************************************************************
+// Write the parameter file and add some entries to the journal
+bool parametersReset()
+{
+    int index;
+
+    r4aEsp32NvmGetDefaultParameters(parameterTable, PARAMETER_COUNT);
+    if (!r4aEsp32NvmWriteParameters(NVM_TEST_PARAMETER_FILE,
+                                    parameterTable,
+                                    PARAMETER_COUNT,
+                                    nullptr))
+        return false;
+    for (index = 0; index < CRASH_SETS; index++)
+        if (!parameterSet((index * 7) % PARAMETER_COUNT, index + 1))
+            return false;
+    expectedSave();
+    return true;
+}
+
+//*********************************************************************
+// Compact the journal until the sets are done
+void * compactThread(void * parameter)
+{
+    uint64_t * compactions;
+
+    compactions = (uint64_t *)parameter;
+    while (!setsDone)
+    {
+        r4aEsp32NvmJournalCompact(NVM_TEST_PARAMETER_FILE,
+                                  parameterTable,
+                                  PARAMETER_COUNT,
+                                  nullptr);
+        *compactions += 1;
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Set the parameters while another thread compacts the journal
+bool raceTest()
+{
+    uint64_t compactions;
+    int set;
+    bool success;
+    pthread_t thread;
+
+    // Write the parameter file
+    r4aEsp32NvmGetDefaultParameters(parameterTable, PARAMETER_COUNT);
+    success = r4aEsp32NvmWriteParameters(NVM_TEST_PARAMETER_FILE,
+                                         parameterTable,
+                                         PARAMETER_COUNT,
+                                         nullptr);
+
+    // Set the parameters while compacting the journal
+    compactions = 0;
+    setsDone = false;
+    pthread_create(&thread, nullptr, compactThread, &compactions);
+    for (set = 0; success && (set < RACE_SETS); set++)
+        success = parameterSet((set * 13) % PARAMETER_COUNT, set);
+    setsDone = true;
+    pthread_join(thread, nullptr);
+
+    // Verify that no values were lost
+    if (success)
+    {
+        expectedSave();
+        success = parametersVerify("race");
+    }
+    printf("%s: %d sets during %llu compactions %s\n",
+           success ? "PASS" : "FAIL",
+           RACE_SETS,
+           (unsigned long long)compactions,
+           success ? "were saved" : "lost values");
+    return success;
+}
+
+//*********************************************************************
+// Crash before each file system change made by an operation
+bool crashTest(const char * name, bool compact)
+{
+    bool crashed;
+    int crashPoint;
+    char test[64];
+    R4A_ESP32_NVM_VALUE newValue;
+    R4A_ESP32_NVM_VALUE oldValue;
+    bool success;
+
+    crashed = true;
+    success = true;
+    for (crashPoint = 1; success && crashed; crashPoint++)
+    {
+        snprintf(test, sizeof(test), "%s crash %d", name, crashPoint);
+
+        // Create the parameter file and journal
+        success = parametersReset();
+        if (!success)
+        {
+            fprintf(stderr, "ERROR: %s, failed to write the parameter files!\n", test);
+            break;
+        }
+
+        // Perform the operation, crashing before the specified change
+        crashed = false;
+        hostCrashAfter(crashPoint);
+        try
+        {
+            if (compact)
+                r4aEsp32NvmJournalCompact(NVM_TEST_PARAMETER_FILE,
+                                          parameterTable,
+                                          PARAMETER_COUNT,
+                                          nullptr);
+            else
+                parameterSet(3, 77);
+        }
+        catch (HOST_CRASH &crash)
+        {
+            crashed = true;
+        }
+        hostCrashAfter(0);
+        hostCrashRecover();
+
+        // The journal compaction must not change the values
+        if (compact)
+            success = parametersVerify(test);
+
+        // The journal append must produce either the old or new value
+        else
+        {
+            oldValue = expected[3];
+            newValue.u64 = 0;
+            newValue.u32 = 77;
+            expected[3] = newValue;
+            if (crashed && (parametersLoad() >= 0))
+                expected[3] = oldValue;
+            success = parametersVerify(test);
+        }
+
+        // Verify that the journal still accepts changes after the crash
+        if (success)
+        {
+            success = parameterSet(5, crashPoint);
+            expectedSave();
+            success = success && parametersVerify(test);
+        }
+    }
+    printf("%s: %s, %d crash points %s\n",
+           success ? "PASS" : "FAIL",
+           name,
+           crashPoint - 2,
+           success ? "restored the values" : "lost values");
+    return success;
+}
+
+//*********************************************************************
+// Replace the parameter file with an uploaded file
+bool uploadTest()
+{
+    bool success;
+
+    // Create the parameter file, journal and binary parameter file
+    success = parametersReset() && parametersVerify("upload");
+    success = success
+           && LittleFS.exists(BINARY_FILE)
+           && LittleFS.exists(JOURNAL_FILE);
+
+    // Upload a parameter file containing the default values
+    r4aEsp32NvmGetDefaultParameters(parameterTable, PARAMETER_COUNT);
+    expectedSave();
+    success = success && r4aEsp32NvmWriteParameters(UPLOAD_FILE,
+                                                    parameterTable,
+                                                    PARAMETER_COUNT,
+                                                    nullptr);
+    success = success && r4aEsp32NvmReplaceParameterFile(UPLOAD_FILE,
+                                                         NVM_TEST_PARAMETER_FILE,
+                                                         nullptr);
+
+    // The previous journal and binary parameter file must be gone
+    success = success
+           && (!LittleFS.exists(UPLOAD_FILE))
+           && (!LittleFS.exists(BINARY_FILE))
+           && (!LittleFS.exists(JOURNAL_FILE));
+
+    // The reloaded values must be the uploaded values
+    success = success && parametersVerify("upload");
+    printf("%s: upload %s\n",
+           success ? "PASS" : "FAIL",
+           success ? "replaced the values" : "kept stale values");
+    return success;
+}
+
+//*********************************************************************
+// Test the parameter journal
+int main(int argc, char **argv)
+{
+    const char * directory;
+    bool success;
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    directory = nvmTestDirectoryCreate("NVM_Journal_Test");
+    nvmTestTableBuild(parameterTable, values, PARAMETER_COUNT);
+
+    success = raceTest();
+    success &= crashTest("compaction", true);
+    success &= crashTest("append", false);
+    success &= uploadTest();
+
+    nvmTestDirectoryRemove(directory);
+    return success ? 0 : -1;
+}
@@ -0,0 +1,300 @@
+/**********************************************************************
+  NVM_Load_Benchmark.cpp
+
+  Program to compare the time to load the parameters from the text
+  parameter file and from the binary parameter file (src/NVM.cpp) for
+  parameter tables of 50, 200 and 1000 entries.
+
+  The binary file is only used while the text file is unchanged.  When
+  the size and last write time of the text file match the values in
+  the binary file header and the binary file was written in a later
+  second, the load skips the CRC of the text file.  Otherwise the text
+  file is read to compute its CRC.  The benchmark times both binary
+  loads, the "binary" column uses the size and time and the "bin+CRC"
+  column includes the CRC of the text file.  The "CRC" column is the
+  time to compute the CRC alone.  The host LittleFS stand-in reads the
+  whole file when it is opened, so the host times for the binary load
+  include reading the text file once.  The bytes read columns show the
+  data read with File::read by each load.
+
+  The program also verifies that an edit of the text file that does not
+  change the file size causes the binary file to be ignored and
+  rebuilt, both when the text file is older than the binary file and
+  when the edit happens in the same second that the binary file was
+  written.  The program exits with a non-zero status when the edited
+  value is not loaded.
+**********************************************************************/
+
+#include <sys/stat.h>
+#include <utime.h>
+
+#include "NVM_Test_Table.h"
+
+#define AGE_SECONDS             10
+#define EDIT_VALUE              0x5a
+#define LOAD_PARAMETERS         (100 * 1000)    // Loads = LOAD_PARAMETERS / parameters
+
+// Compute the size and CRC of the text parameter file, src/NVM.cpp
+size_t r4aEsp32NvmTextFileCrc(const char * filePath, uint32_t * crc);
+
+//****************************************
+// Constants
+//****************************************
+
+const int parameterCounts[] = {50, 200, 1000};
+const int parameterCountEntries = sizeof(parameterCounts) / sizeof(parameterCounts[0]);
+
+//****************************************
+// Locals
+//****************************************
+
+int loads;
+int parameterCount;
+R4A_ESP32_NVM_PARAMETER * parameterTable;
+R4A_ESP32_NVM_VALUE * values;
+
+//*********************************************************************
+// Get the size of a file
+size_t fileBytes(const char * path)
+{
+    File file;
+    size_t length;
+
+    file = LittleFS.open(path, FILE_READ);
+    length = file.size();
+    file.close();
+    return length;
+}
+
+//*********************************************************************
+// Set the last write time of the text file in the past and rewrite the
+// binary file, the binary load then skips the CRC of the text file
+bool ageTextFile()
+{
+    struct stat status;
+    struct utimbuf times;
+    std::string path;
+
+    path = LittleFS.hostPath(NVM_TEST_PARAMETER_FILE);
+    if (stat(path.c_str(), &status))
+        return false;
+    times.actime = status.st_atime - AGE_SECONDS;
+    times.modtime = status.st_mtime - AGE_SECONDS;
+    return (utime(path.c_str(), &times) == 0)
+        && r4aEsp32NvmWriteBinaryParameters(NVM_TEST_PARAMETER_FILE,
+                                            parameterTable,
+                                            parameterCount,
+                                            nullptr);
+}
+
+//*********************************************************************
+// Read the binary file after setting the last write time of the text
+// file to the value in the header, forcing the CRC of the text file
+bool readBinaryWithCrc(const char * filePath,
+                       const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                       int parametersCount,
+                       Print * display)
+{
+    std::string path;
+    struct utimbuf times;
+
+    // Give the text file the same time as the binary file
+    path = LittleFS.hostPath(NVM_TEST_PARAMETER_FILE ".bin");
+    times.actime = time(nullptr);
+    times.modtime = times.actime;
+    utime(path.c_str(), &times);
+    path = LittleFS.hostPath(NVM_TEST_PARAMETER_FILE);
+    utime(path.c_str(), &times);
+    return r4aEsp32NvmReadBinaryParameters(filePath, parameterTable, parametersCount, display);
+}
+
+//*********************************************************************
+// Compute the CRC of the text file
+bool readTextCrc(const char * filePath,
+                 const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                 int parametersCount,
+                 Print * display)
+{
+    uint32_t crc;
+
+    return (r4aEsp32NvmTextFileCrc(filePath, &crc) != 0);
+}
+
+//*********************************************************************
+// Time the loads using one of the read routines
+bool timeLoads(const char * name,
+               bool (* readParameters)(const char * filePath,
+                                       const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                       int parametersCount,
+                                       Print * display))
+{
+    uint64_t bytesRead;
+    int load;
+    uint64_t startUsec;
+    uint64_t usec;
+
+    hostFileReads(&bytesRead);
+    startUsec = nvmTestUsec();
+    for (load = 0; load < loads; load++)
+        if (!readParameters(NVM_TEST_PARAMETER_FILE, parameterTable, parameterCount, nullptr))
+        {
+            fprintf(stderr, "ERROR: %s failed!\n", name);
+            return false;
+        }
+    usec = nvmTestUsec() - startUsec;
+    hostFileReads(&bytesRead);
+    printf("    %-8s %10.2f  %10llu\n",
+           name,
+           (double)usec / loads,
+           (unsigned long long)(bytesRead / loads));
+    return true;
+}
+
+//*********************************************************************
+// Change a value in the text file without changing the file size
+bool editTextFile(int * parameterIndex)
+{
+    std::string data;
+    File file;
+    int index;
+    size_t offset;
+    char value[32];
+
+    // Locate a uint32_t parameter
+    for (index = 0; index < parameterCount; index++)
+        if (parameterTable[index].type == R4A_ESP32_NVM_PT_UINT32)
+            break;
+    *parameterIndex = index;
+
+    // Read the text file
+    file = LittleFS.open(NVM_TEST_PARAMETER_FILE, FILE_READ);
+    data.resize(file.size());
+    file.read((uint8_t *)&data[0], data.length());
+    file.close();
+
+    // Locate the value string: name, type, value
+    offset = data.find(std::string(parameterTable[index].name) + '\0');
+    if (offset == std::string::npos)
+        return false;
+    offset += strlen(parameterTable[index].name) + 1;
+    offset += strlen(&data[offset]) + 1;
+
+    // Replace the value with one of the same length
+    sprintf(value, "0x%016llx", (unsigned long long)EDIT_VALUE);
+    if (strlen(&data[offset]) != strlen(value))
+        return false;
+    memcpy(&data[offset], value, strlen(value));
+
+    // Write the text file
+    file = LittleFS.open(NVM_TEST_PARAMETER_FILE, FILE_WRITE);
+    file.write((const uint8_t *)data.data(), data.length());
+    file.close();
+    return true;
+}
+
+//*********************************************************************
+// Write the parameter files
+bool writeParameterFiles()
+{
+    r4aEsp32NvmGetDefaultParameters(parameterTable, parameterCount);
+    return r4aEsp32NvmWriteParameters(NVM_TEST_PARAMETER_FILE,
+                                      parameterTable,
+                                      parameterCount,
+                                      nullptr);
+}
+
+//*********************************************************************
+// Verify that an edit of the text file is not hidden by the binary file
+bool verifyEdit(const char * name)
+{
+    int index;
+    bool success;
+
+    success = editTextFile(&index);
+    if (!success)
+        fprintf(stderr, "ERROR: Failed to edit the text file!\n");
+    else
+    {
+        r4aEsp32NvmGetDefaultParameters(parameterTable, parameterCount);
+        success = r4aEsp32NvmReadParameters(NVM_TEST_PARAMETER_FILE,
+                                            parameterTable,
+                                            parameterCount,
+                                            nullptr)
+               && (values[index].u32 == EDIT_VALUE);
+        if (success)
+        {
+            // The binary file was rebuilt and now holds the edited value
+            r4aEsp32NvmGetDefaultParameters(parameterTable, parameterCount);
+            success = r4aEsp32NvmReadBinaryParameters(NVM_TEST_PARAMETER_FILE,
+                                                      parameterTable,
+                                                      parameterCount,
+                                                      nullptr)
+                   && (values[index].u32 == EDIT_VALUE);
+        }
+        printf("%s: %d parameters, %s text file edit %s\n",
+               success ? "PASS" : "FAIL",
+               parameterCount,
+               name,
+               success ? "was loaded" : "was hidden by the binary file");
+    }
+    return success;
+}
+
+//*********************************************************************
+// Compare the parameter load times
+int main(int argc, char **argv)
+{
+    const char * directory;
+    int entry;
+    bool success;
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    directory = nvmTestDirectoryCreate("NVM_Load_Benchmark");
+
+    success = true;
+    for (entry = 0; success && (entry < parameterCountEntries); entry++)
+    {
+        // Build the parameter table
+        parameterCount = parameterCounts[entry];
+        loads = LOAD_PARAMETERS / parameterCount;
+        parameterTable = new R4A_ESP32_NVM_PARAMETER[parameterCount];
+        values = new R4A_ESP32_NVM_VALUE[parameterCount];
+        nvmTestTableBuild(parameterTable, values, parameterCount);
+
+        // Write the parameter files, the text file is older than the
+        // binary file
+        success = writeParameterFiles() && ageTextFile();
+        if (!success)
+            fprintf(stderr, "ERROR: Failed to write the parameter files!\n");
+
+        // Time the loads
+        if (success)
+        {
+            printf("%d parameters, text file: %ld bytes, binary file: %ld bytes, %d loads\n",
+                   parameterCount,
+                   (long)fileBytes(NVM_TEST_PARAMETER_FILE),
+                   (long)fileBytes(NVM_TEST_PARAMETER_FILE ".bin"),
+                   loads);
+            printf("    File      uSec/Load  Bytes read\n");
+            success = timeLoads("text", r4aEsp32NvmReadTextParameters)
+                   && timeLoads("binary", r4aEsp32NvmReadBinaryParameters)
+                   && timeLoads("read", r4aEsp32NvmReadParameters)
+                   && timeLoads("bin+CRC", readBinaryWithCrc)
+                   && timeLoads("CRC", readTextCrc);
+        }
+
+        // Edit the text file after it was aged
+        if (success)
+            success = writeParameterFiles() && ageTextFile() && verifyEdit("older");
+
+        // Edit the text file in the same second the binary file is written
+        if (success)
+            success = writeParameterFiles() && verifyEdit("same second");
+
+        delete[] parameterTable;
+        delete[] values;
+    }
+
+    nvmTestDirectoryRemove(directory);
+    return success ? 0 : -1;
+}
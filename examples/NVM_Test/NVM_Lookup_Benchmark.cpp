@@ -0,0 +1,188 @@
+/**********************************************************************
+  NVM_Lookup_Benchmark.cpp
+
+  Program to compare the parameter lookup time using the parameter
+  table index against searching the table (src/NVM.cpp).  Several
+  threads look up the parameters of two tables in alternation while
+  other threads build the index for a third table, verifying that each
+  lookup returns the correct entry.  The program exits with a non-zero
+  status when a lookup returns the wrong entry.
+**********************************************************************/
+
+#include <pthread.h>
+
+#include "NVM_Test_Table.h"
+
+#define BUILD_THREADS           4
+#define LARGE_TABLE_COUNT       500
+#define LOOKUPS                 200000
+#define LOOKUP_THREADS          4
+#define SMALL_TABLE_COUNT       74
+
+// Table being used for the lookups
+typedef struct _TABLE
+{
+    R4A_ESP32_NVM_PARAMETER * _parameterTable;
+    int _parameterCount;
+} TABLE;
+
+// Thread context
+typedef struct _THREAD_CONTEXT
+{
+    pthread_t _thread;
+    const TABLE * _tables;      // Pair of tables to use
+    uint64_t _lookups;          // Number of lookups
+    uint64_t _usec;             // Time spent in the lookups
+    uint64_t _errors;           // Lookups returning the wrong entry
+} THREAD_CONTEXT;
+
+//****************************************
+// Locals
+//****************************************
+
+R4A_ESP32_NVM_PARAMETER buildTable[SMALL_TABLE_COUNT];
+R4A_ESP32_NVM_VALUE buildValues[SMALL_TABLE_COUNT];
+TABLE indexedTables[2];
+R4A_ESP32_NVM_PARAMETER largeTable[LARGE_TABLE_COUNT];
+R4A_ESP32_NVM_PARAMETER largeTableCopy[LARGE_TABLE_COUNT];
+R4A_ESP32_NVM_VALUE largeValues[LARGE_TABLE_COUNT];
+TABLE searchedTables[2];
+R4A_ESP32_NVM_PARAMETER smallTable[SMALL_TABLE_COUNT];
+R4A_ESP32_NVM_PARAMETER smallTableCopy[SMALL_TABLE_COUNT];
+R4A_ESP32_NVM_VALUE smallValues[SMALL_TABLE_COUNT];
+volatile bool startBuild;
+
+//*********************************************************************
+// Look up the parameters of two tables in alternation
+void * lookupThread(void * parameter)
+{
+    THREAD_CONTEXT * context;
+    int entry;
+    const R4A_ESP32_NVM_PARAMETER * found;
+    uint64_t lookup;
+    uint64_t startUsec;
+    const TABLE * table;
+
+    context = (THREAD_CONTEXT *)parameter;
+    startUsec = nvmTestUsec();
+    for (lookup = 0; lookup < LOOKUPS; lookup++)
+    {
+        // Alternate between the tables
+        table = &context->_tables[lookup & 1];
+        entry = (lookup * 7919) % table->_parameterCount;
+
+        // Look up the parameter by name, then by address
+        found = r4aEsp32NvmParameterLookup(table->_parameterTable,
+                                           table->_parameterCount,
+                                           table->_parameterTable[entry].name,
+                                           nullptr);
+        if (found != &table->_parameterTable[entry])
+            context->_errors += 1;
+        found = r4aEsp32NvmParameterLookup(table->_parameterTable,
+                                           table->_parameterCount,
+                                           table->_parameterTable[entry].addr,
+                                           nullptr);
+        if (found != &table->_parameterTable[entry])
+            context->_errors += 1;
+    }
+    context->_usec = nvmTestUsec() - startUsec;
+    context->_lookups = lookup * 2;
+    return nullptr;
+}
+
+//*********************************************************************
+// Build the index for the third table
+void * buildThread(void * parameter)
+{
+    while (!startBuild)
+        ;
+    r4aEsp32NvmGetDefaultParameters(buildTable, SMALL_TABLE_COUNT);
+    return nullptr;
+}
+
+//*********************************************************************
+// Run the lookup threads
+bool runTest(const char * name, const TABLE * tables, bool build)
+{
+    THREAD_CONTEXT buildContext[BUILD_THREADS];
+    THREAD_CONTEXT context[LOOKUP_THREADS];
+    uint64_t errors;
+    int index;
+    uint64_t lookups;
+    uint64_t usec;
+
+    // Start the threads
+    startBuild = false;
+    memset(context, 0, sizeof(context));
+    for (index = 0; index < LOOKUP_THREADS; index++)
+    {
+        context[index]._tables = tables;
+        pthread_create(&context[index]._thread, nullptr, lookupThread, &context[index]);
+    }
+    if (build)
+        for (index = 0; index < BUILD_THREADS; index++)
+            pthread_create(&buildContext[index]._thread, nullptr, buildThread, nullptr);
+    startBuild = true;
+
+    // Wait for the threads to finish
+    errors = 0;
+    lookups = 0;
+    usec = 0;
+    for (index = 0; index < LOOKUP_THREADS; index++)
+    {
+        pthread_join(context[index]._thread, nullptr);
+        errors += context[index]._errors;
+        lookups += context[index]._lookups;
+        usec += context[index]._usec;
+    }
+    if (build)
+        for (index = 0; index < BUILD_THREADS; index++)
+            pthread_join(buildContext[index]._thread, nullptr);
+
+    // Display the results
+    printf("%-8s %7d %11.1f %8llu\n",
+           name,
+           LOOKUP_THREADS,
+           (double)usec * 1000. / lookups,
+           (unsigned long long)errors);
+    return (errors == 0);
+}
+
+//*********************************************************************
+// Compare the lookup times
+int main(int argc, char **argv)
+{
+    bool success;
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // Build the tables, the copies of the tables are not indexed
+    nvmTestTableBuild(smallTable, smallValues, SMALL_TABLE_COUNT);
+    nvmTestTableBuild(largeTable, largeValues, LARGE_TABLE_COUNT);
+    nvmTestTableBuild(buildTable, buildValues, SMALL_TABLE_COUNT);
+    memcpy(smallTableCopy, smallTable, sizeof(smallTable));
+    memcpy(largeTableCopy, largeTable, sizeof(largeTable));
+
+    // Build the indexes
+    r4aEsp32NvmGetDefaultParameters(smallTable, SMALL_TABLE_COUNT);
+    r4aEsp32NvmGetDefaultParameters(largeTable, LARGE_TABLE_COUNT);
+
+    // Run the lookups
+    indexedTables[0]._parameterTable = smallTable;
+    indexedTables[0]._parameterCount = SMALL_TABLE_COUNT;
+    indexedTables[1]._parameterTable = largeTable;
+    indexedTables[1]._parameterCount = LARGE_TABLE_COUNT;
+    searchedTables[0]._parameterTable = smallTableCopy;
+    searchedTables[0]._parameterCount = SMALL_TABLE_COUNT;
+    searchedTables[1]._parameterTable = largeTableCopy;
+    searchedTables[1]._parameterCount = LARGE_TABLE_COUNT;
+    printf("%d and %d parameter tables used in alternation\n",
+           SMALL_TABLE_COUNT, LARGE_TABLE_COUNT);
+    printf("Lookup   Threads  nSec/Lookup   Errors\n");
+    success = runTest("index", indexedTables, true);
+    success &= runTest("search", searchedTables, false);
+    printf("%s: lookups %s\n",
+           success ? "PASS" : "FAIL",
+           success ? "returned the correct entries" : "returned the wrong entries");
+    return success ? 0 : -1;
+}
@@ -0,0 +1,235 @@
+/**********************************************************************
+  NVM_ReadLine_Benchmark.cpp
+
+  Program to compare the methods of reading the lines of a 10,000 line
+  waypoint file (src/NVM.cpp).  The byte method is the original
+  r4aEsp32NvmReadLine which called available and read for each byte.
+  The readline method is the current r4aEsp32NvmReadLine which reads a
+  block and seeks back to the start of the next line.  The reader
+  methods use the line reader with different buffer sizes.  The number
+  of File::read calls and bytes read approximates the LittleFS cost.
+  The program exits with a non-zero status when a method returns
+  different lines.
+**********************************************************************/
+
+#include "NVM_Test_Table.h"
+
+#define LINE_BYTES              256
+#define POINT_COUNT             10000
+#define WAYPOINT_FILE           "/Waypoints.txt"
+
+//****************************************
+// Constants
+//****************************************
+
+static const char * wpFormat  = "%14.9f   %14.9f   %10.3f   %9.3f   %9.3f   %3d   %s\r\n";
+static const char * wpHeader1 = "   Latitude        Longitude       Altitude    Horiz Acc   Std. Dev.   SIV   Comment\r\n";
+static const char * wpHeader2 = "--------------   --------------   ----------   ---------   ---------   ---   -------\r\n";
+
+//****************************************
+// Locals
+//****************************************
+
+size_t fileBytes;
+uint32_t fileCrc;
+
+//*********************************************************************
+// Original byte at a time line read
+bool byteReadLine(File * file,
+                  uint8_t * line,
+                  size_t lineLength,
+                  Print * display)
+{
+    size_t bytesAvailable;
+    uint8_t data;
+    uint8_t * lineEnd;
+
+    // Walk the data in the file until the buffer is full
+    lineEnd = &line[lineLength - 1];
+    while (line < lineEnd)
+    {
+        // Determine if there is more data in the file
+        bytesAvailable = file->available();
+        if (bytesAvailable == 0)
+            break;
+
+        // Read the next character from the file
+        data = file->read();
+
+        // Check for the end of the line
+        if (data)
+        {
+            *line++ = data;
+            if (data == '\n')
+            {
+                // Zero terminate the string of characters
+                *line = 0;
+                return true;
+            }
+        }
+    }
+
+    // Failed to find the end of the line
+    return false;
+}
+
+//*********************************************************************
+// Write the waypoint file
+bool writeWaypointFile()
+{
+    char comment[32];
+    File file;
+    char line[LINE_BYTES];
+    int length;
+    int point;
+
+    file = LittleFS.open(WAYPOINT_FILE, FILE_WRITE);
+    if (!file)
+        return false;
+    file.write((const uint8_t *)wpHeader1, strlen(wpHeader1));
+    file.write((const uint8_t *)wpHeader2, strlen(wpHeader2));
+    fileCrc = esp_rom_crc32_le(0, (const uint8_t *)wpHeader1, strlen(wpHeader1));
+    fileCrc = esp_rom_crc32_le(fileCrc, (const uint8_t *)wpHeader2, strlen(wpHeader2));
+    for (point = 0; point < POINT_COUNT; point++)
+    {
+        sprintf(comment, "Point %d", point);
+        length = sprintf(line,
+                         wpFormat,
+                         40.0 + point * 0.000001,
+                         -105.0 - point * 0.000002,
+                         1600.0 + (point % 100) * 0.01,
+                         0.014 + (point % 7) * 0.001,
+                         0.002,
+                         20 + (point % 10),
+                         comment);
+        file.write((const uint8_t *)line, length);
+        fileCrc = esp_rom_crc32_le(fileCrc, (const uint8_t *)line, length);
+    }
+    fileBytes = file.size();
+    file.close();
+    return true;
+}
+
+//*********************************************************************
+// Display the results and verify the lines
+bool displayResults(const char * name,
+                    int lines,
+                    uint64_t usec,
+                    uint32_t crc)
+{
+    uint64_t bytesRead;
+    uint64_t reads;
+    bool success;
+
+    reads = hostFileReads(&bytesRead);
+    success = (lines == (POINT_COUNT + 2)) && (crc == fileCrc);
+    printf("%-12s %7d %10.3f %9.1f %10llu %10.2f %s\n",
+           name,
+           lines,
+           (double)usec / 1000.,
+           (double)fileBytes / usec,
+           (unsigned long long)reads,
+           (double)bytesRead / fileBytes,
+           success ? "" : "wrong lines");
+    return success;
+}
+
+//*********************************************************************
+// Read the file using a read line routine
+bool timeReadLine(const char * name,
+                  bool (* readLine)(File * file,
+                                    uint8_t * line,
+                                    size_t lineLength,
+                                    Print * display))
+{
+    uint64_t bytesRead;
+    uint32_t crc;
+    File file;
+    uint8_t line[LINE_BYTES];
+    int lines;
+    uint64_t startUsec;
+    uint64_t usec;
+
+    hostFileReads(&bytesRead);
+    crc = 0;
+    lines = 0;
+    startUsec = nvmTestUsec();
+    file = LittleFS.open(WAYPOINT_FILE, FILE_READ);
+    while (readLine(&file, line, sizeof(line), nullptr))
+    {
+        crc = esp_rom_crc32_le(crc, line, strlen((char *)line));
+        lines += 1;
+    }
+    file.close();
+    usec = nvmTestUsec() - startUsec;
+    return displayResults(name, lines, usec, crc);
+}
+
+//*********************************************************************
+// Read the file using the line reader
+bool timeLineReader(const char * name, size_t bufferBytes)
+{
+    uint8_t * buffer;
+    uint64_t bytesRead;
+    uint32_t crc;
+    File file;
+    char * line;
+    size_t lineLength;
+    int lines;
+    R4A_ESP32_NVM_LINE_READER reader;
+    uint64_t startUsec;
+    uint64_t usec;
+
+    buffer = (uint8_t *)malloc(bufferBytes);
+    hostFileReads(&bytesRead);
+    crc = 0;
+    lines = 0;
+    startUsec = nvmTestUsec();
+    file = LittleFS.open(WAYPOINT_FILE, FILE_READ);
+    r4aEsp32NvmLineReaderBegin(&reader, &file, buffer, bufferBytes);
+    while ((line = r4aEsp32NvmLineReaderGetLine(&reader, &lineLength, nullptr)))
+    {
+        // Restore the CR and LF removed by the line reader
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)line, lineLength);
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)"\r\n", 2);
+        lines += 1;
+    }
+    file.close();
+    usec = nvmTestUsec() - startUsec;
+    free(buffer);
+    return displayResults(name, lines, usec, crc);
+}
+
+//*********************************************************************
+// Compare the line read times
+int main(int argc, char **argv)
+{
+    const char * directory;
+    bool success;
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    directory = nvmTestDirectoryCreate("NVM_ReadLine_Benchmark");
+
+    // Write the waypoint file
+    success = writeWaypointFile();
+    if (!success)
+        fprintf(stderr, "ERROR: Failed to write the waypoint file!\n");
+
+    // Read the waypoint file
+    if (success)
+    {
+        printf("%d line waypoint file, %ld bytes\n", POINT_COUNT + 2, (long)fileBytes);
+        printf("Method         Lines       mSec      MB/s      Reads  Read/Size\n");
+        success = timeReadLine("byte", byteReadLine);
+        success &= timeReadLine("readline", r4aEsp32NvmReadLine);
+        success &= timeLineReader("reader-512", 512);
+        success &= timeLineReader("reader-1024", 1024);
+        success &= timeLineReader("reader-4096", 4096);
+        printf("%s: read methods %s\n",
+               success ? "PASS" : "FAIL",
+               success ? "returned the same lines" : "returned different lines");
+    }
+
+    nvmTestDirectoryRemove(directory);
+    return success ? 0 : -1;
+}
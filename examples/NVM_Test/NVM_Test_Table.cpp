@@ -0,0 +1,160 @@
+/**********************************************************************
+  NVM_Test_Table.cpp
+
+  Robots-For-All (R4A)
+  Parameter table shared by the NVM host tests
+**********************************************************************/
+
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "NVM_Test_Table.h"
+
+//****************************************
+// Constants
+//****************************************
+
+// Parameter types used by the Freenove_4WD_Car example
+static const uint8_t parameterTypes[] =
+{
+    R4A_ESP32_NVM_PT_BOOL,   R4A_ESP32_NVM_PT_P_CHAR, R4A_ESP32_NVM_PT_BOOL,
+    R4A_ESP32_NVM_PT_UINT32, R4A_ESP32_NVM_PT_BOOL,   R4A_ESP32_NVM_PT_P_CHAR,
+    R4A_ESP32_NVM_PT_UINT8,  R4A_ESP32_NVM_PT_BOOL,   R4A_ESP32_NVM_PT_INT16,
+    R4A_ESP32_NVM_PT_P_CHAR, R4A_ESP32_NVM_PT_BOOL,   R4A_ESP32_NVM_PT_INT8,
+    R4A_ESP32_NVM_PT_P_CHAR, R4A_ESP32_NVM_PT_BOOL,   R4A_ESP32_NVM_PT_UINT16,
+    R4A_ESP32_NVM_PT_P_CHAR, R4A_ESP32_NVM_PT_BOOL,   R4A_ESP32_NVM_PT_UINT32,
+    R4A_ESP32_NVM_PT_BOOL,   R4A_ESP32_NVM_PT_P_CHAR, R4A_ESP32_NVM_PT_INT32,
+};
+#define PARAMETER_TYPES     (sizeof(parameterTypes) / sizeof(parameterTypes[0]))
+
+//*********************************************************************
+// Build a parameter table
+void nvmTestTableBuild(R4A_ESP32_NVM_PARAMETER * parameterTable,
+                       R4A_ESP32_NVM_VALUE * values,
+                       int parameterCount)
+{
+    int index;
+    char name[32];
+    R4A_ESP32_NVM_PARAMETER * parameter;
+    char value[32];
+
+    memset(values, 0, parameterCount * sizeof(*values));
+    for (index = 0; index < parameterCount; index++)
+    {
+        // Scatter the names so that the table is not sorted
+        parameter = &parameterTable[index];
+        sprintf(name, "parameter%04d", (index * 37) % 10007);
+        parameter->required = (index & 1);
+        parameter->type = parameterTypes[index % PARAMETER_TYPES];
+        parameter->minimum = 0;
+        parameter->maximum = (parameter->type == R4A_ESP32_NVM_PT_BOOL) ? 1 : 100;
+        parameter->addr = &values[index];
+        parameter->name = strdup(name);
+        parameter->value = index % (parameter->maximum + 1);
+        if (parameter->type == R4A_ESP32_NVM_PT_P_CHAR)
+        {
+            sprintf(value, "value-%d", index);
+            parameter->value = R4A_ESP32_NVM_STRING(strdup(value));
+        }
+    }
+}
+
+//*********************************************************************
+// Compare the parameter values with the expected values
+int nvmTestTableCompare(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                        int parameterCount,
+                        const R4A_ESP32_NVM_VALUE * expected)
+{
+    const R4A_ESP32_NVM_VALUE * actual;
+    int index;
+    bool match;
+
+    for (index = 0; index < parameterCount; index++)
+    {
+        actual = (const R4A_ESP32_NVM_VALUE *)parameterTable[index].addr;
+        switch (parameterTable[index].type)
+        {
+        default:
+            match = (actual->u64 == expected[index].u64);
+            break;
+
+        case R4A_ESP32_NVM_PT_BOOL:
+            match = (actual->b == expected[index].b);
+            break;
+
+        case R4A_ESP32_NVM_PT_INT8:
+        case R4A_ESP32_NVM_PT_UINT8:
+            match = (actual->u8 == expected[index].u8);
+            break;
+
+        case R4A_ESP32_NVM_PT_INT16:
+        case R4A_ESP32_NVM_PT_UINT16:
+            match = (actual->u16 == expected[index].u16);
+            break;
+
+        case R4A_ESP32_NVM_PT_INT32:
+        case R4A_ESP32_NVM_PT_UINT32:
+            match = (actual->u32 == expected[index].u32);
+            break;
+
+        case R4A_ESP32_NVM_PT_P_CHAR:
+            match = (actual->pcc && expected[index].pcc)
+                  ? (strcmp(actual->pcc, expected[index].pcc) == 0)
+                  : (actual->pcc == expected[index].pcc);
+            break;
+        }
+        if (!match)
+            return index;
+    }
+    return -1;
+}
+
+//*********************************************************************
+// Create a temporary directory for the files
+const char * nvmTestDirectoryCreate(const char * name)
+{
+    static char directory[64];
+
+    snprintf(directory, sizeof(directory), "/tmp/%s.XXXXXX", name);
+    if (!mkdtemp(directory))
+    {
+        fprintf(stderr, "ERROR: Failed to create directory %s!\n", directory);
+        exit(-1);
+    }
+    LittleFS.begin(directory);
+    return directory;
+}
+
+//*********************************************************************
+// Remove the temporary directory and its files
+void nvmTestDirectoryRemove(const char * directory)
+{
+    DIR * dir;
+    struct dirent * entry;
+    std::string path;
+
+    dir = opendir(directory);
+    if (dir)
+    {
+        while ((entry = readdir(dir)))
+        {
+            if (entry->d_name[0] == '.')
+                continue;
+            path = std::string(directory) + "/" + entry->d_name;
+            unlink(path.c_str());
+        }
+        closedir(dir);
+    }
+    rmdir(directory);
+}
+
+//*********************************************************************
+// Get the host time in microseconds
+uint64_t nvmTestUsec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000000ull) + (now.tv_nsec / 1000);
+}
@@ -0,0 +1,54 @@
+/**********************************************************************
+  NVM_Test_Table.h
+
+  Robots-For-All (R4A)
+  Parameter table shared by the NVM host tests
+**********************************************************************/
+
+#ifndef __NVM_TEST_TABLE_H__
+#define __NVM_TEST_TABLE_H__
+
+#include "NVM_Host.h"
+#include "../../src/R4A_ESP32_NVM.h"
+
+#define NVM_TEST_PARAMETER_FILE     "/Parameters.txt"
+
+// Build a parameter table using the same mix of types as the
+// Freenove_4WD_Car example
+// Inputs:
+//   parameterTable: Address of the table to fill in
+//   values: Address of the array of values, one per parameter
+//   parameterCount: Number of entries in the table
+void nvmTestTableBuild(R4A_ESP32_NVM_PARAMETER * parameterTable,
+                       R4A_ESP32_NVM_VALUE * values,
+                       int parameterCount);
+
+// Compare the parameter values with the expected values
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parameterCount: Number of entries in the table
+//   expected: Address of the array of expected values
+// Outputs:
+//   Returns the index of the first mismatch or -1 when all of the
+//   values match
+int nvmTestTableCompare(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                        int parameterCount,
+                        const R4A_ESP32_NVM_VALUE * expected);
+
+// Create a temporary directory for the files and start the LittleFS
+// stand-in
+// Inputs:
+//   name: Name of the test program
+// Outputs:
+//   Returns the path to the directory
+const char * nvmTestDirectoryCreate(const char * name);
+
+// Remove the temporary directory and its files
+// Inputs:
+//   directory: Path to the directory
+void nvmTestDirectoryRemove(const char * directory);
+
+// Get the host time in microseconds
+uint64_t nvmTestUsec();
+
+#endif  // __NVM_TEST_TABLE_H__
@@ -68,7 +68,7 @@ const R4A_SPI_BUS spiBus =
     -1,     // SCLK GPIO
     GPIO_SPI_MOSI,  // MOSI GPIO
     -1,     // MISO GPIO
-    r4aEsp32SpiTransfer // SPI transfer routine
+    r4aEsp32SpiFrameTransfer // SPI transfer routine, skips unchanged frames
 };
 
 // Handle for device data for SPI driver
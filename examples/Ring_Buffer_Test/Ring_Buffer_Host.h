@@ -0,0 +1,58 @@
+/**********************************************************************
+  Ring_Buffer_Host.h
+
+  Robots-For-All (R4A)
+  Host stand-ins for the Arduino Print class and the R4A routines used
+  by src/Ring_Buffer.cpp
+**********************************************************************/
+
+#ifndef __RING_BUFFER_HOST_H__
+#define __RING_BUFFER_HOST_H__
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//****************************************
+// Print
+//****************************************
+
+class Print
+{
+  public:
+
+    virtual ~Print() {}
+
+    // Output a formatted string
+    size_t printf(const char * format, ...)
+    {
+        va_list args;
+        int length;
+
+        va_start(args, format);
+        length = vprintf(format, args);
+        va_end(args);
+        return (length < 0) ? 0 : length;
+    }
+};
+
+extern Print Serial;
+
+//****************************************
+// R4A support routines
+//****************************************
+
+// Free a buffer allocated by r4aMalloc
+static inline void r4aFree(void * buffer, const char * text)
+{
+    free(buffer);
+}
+
+// Allocate a buffer
+static inline void * r4aMalloc(size_t length, const char * text)
+{
+    return malloc(length);
+}
+
+#endif  // __RING_BUFFER_HOST_H__
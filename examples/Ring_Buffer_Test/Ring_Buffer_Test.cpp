@@ -0,0 +1,421 @@
+/**********************************************************************
+  Ring_Buffer_Test.cpp
+
+  Program to test the multiple producer ring buffer (src/Ring_Buffer.cpp).
+  The first tests exercise the ring buffer from a single thread: record
+  wrap and pad records, dropping when full, uncommitted records and
+  overwriting the oldest records.  The stress tests run several
+  producer threads against a consumer thread in both modes, verifying
+  the record contents, the record order of each producer and that every
+  record is either received, dropped or overwritten.  The program exits
+  with a non-zero status when a test fails.
+**********************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include "Ring_Buffer_Host.h"
+#include "../../src/R4A_ESP32_Ring_Buffer.h"
+
+#define MAX_PRODUCERS           4
+#define MAX_RECORD_BYTES        200
+#define STRESS_RECORDS          1000000
+
+// Record written by the producers
+typedef struct _RECORD
+{
+    uint32_t _producer;         // Producer number
+    uint32_t _sequence;         // Record number for this producer
+    uint32_t _check;            // Check value of the producer and sequence
+    uint8_t _fill[MAX_RECORD_BYTES - 12]; // Data pattern
+} RECORD;
+
+// Producer thread context
+typedef struct _PRODUCER
+{
+    pthread_t _thread;
+    int _producer;              // Producer number
+    bool _zeroCopy;             // Use reserve and commit instead of write
+} PRODUCER;
+
+//****************************************
+// Globals
+//****************************************
+
+Print Serial;
+
+//****************************************
+// Locals
+//****************************************
+
+static uint64_t consumerErrors;
+static uint64_t consumerRecords[MAX_PRODUCERS];
+static volatile int producersDone;
+static R4A_RING_BUFFER ring;
+static uint64_t sentRecords[MAX_PRODUCERS];
+
+//*********************************************************************
+// Get the host time in microseconds
+static uint64_t usec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000000ull) + (now.tv_nsec / 1000);
+}
+
+//*********************************************************************
+// Get the record length for a sequence number
+static uint16_t recordLength(uint32_t sequence)
+{
+    return 12 + ((sequence * 37) % (MAX_RECORD_BYTES - 12 + 1));
+}
+
+//*********************************************************************
+// Fill in a record
+static void recordFill(RECORD * record, int producer, uint32_t sequence)
+{
+    uint16_t index;
+    uint16_t length;
+
+    record->_producer = producer;
+    record->_sequence = sequence;
+    record->_check = (producer ^ sequence) * 2654435761u;
+    length = recordLength(sequence) - 12;
+    for (index = 0; index < length; index++)
+        record->_fill[index] = (uint8_t)(sequence + index);
+}
+
+//*********************************************************************
+// Verify a record
+static bool recordVerify(const RECORD * record, uint16_t length)
+{
+    uint16_t index;
+
+    if ((length < 12) || (record->_producer >= MAX_PRODUCERS))
+        return false;
+    if ((length != recordLength(record->_sequence))
+        || (record->_check != ((record->_producer ^ record->_sequence) * 2654435761u)))
+        return false;
+    for (index = 0; index < (length - 12); index++)
+        if (record->_fill[index] != (uint8_t)(record->_sequence + index))
+            return false;
+    return true;
+}
+
+//*********************************************************************
+// Display the test result
+static bool testResult(const char * test, bool success)
+{
+    printf("%s: %s\n", success ? "PASS" : "FAIL", test);
+    return success;
+}
+
+//*********************************************************************
+// Verify the buffer size validation, the records and the pad records
+static bool testWrap()
+{
+    int count;
+    uint16_t length;
+    uint8_t * peek;
+    RECORD read;
+    RECORD record;
+    uint32_t sequence;
+    bool success;
+    uint8_t type;
+
+    memset(&ring, 0, sizeof(ring));
+    success = (r4aRingBufferBegin(&ring, 1000, false, nullptr) == false)
+           && r4aRingBufferBegin(&ring, 256, false, nullptr)
+           && (r4aRingBufferPeek(&ring) == nullptr)
+           && (r4aRingBufferRead(&ring, &record, sizeof(record)) == false);
+
+    // Write and read enough records to wrap many times, alternating
+    // between peek and read
+    for (sequence = 0; success && (sequence < 1000); sequence++)
+    {
+        recordFill(&record, 1, sequence);
+        length = 12 + (sequence % 60);
+        success = r4aRingBufferWrite(&ring, sequence & 0xff, &record, length);
+        if (sequence & 1)
+        {
+            peek = (uint8_t *)r4aRingBufferPeek(&ring, &type, &length);
+            success = success && peek && (type == (sequence & 0xff))
+                   && (length == (12 + (sequence % 60)))
+                   && (memcmp(peek, &record, length) == 0);
+            r4aRingBufferRelease(&ring);
+        }
+        else
+        {
+            memset(&read, 0, sizeof(read));
+            success = success
+                   && r4aRingBufferRead(&ring, &read, sizeof(read), &type, &length)
+                   && (type == (sequence & 0xff))
+                   && (length == (12 + (sequence % 60)))
+                   && (memcmp(&read, &record, length) == 0);
+        }
+    }
+    success = success && (r4aRingBufferUsedBytes(&ring) == 0);
+
+    // Fill the empty buffer, then drop the next record and an oversize
+    // record
+    success = success && r4aRingBufferBegin(&ring, 256, false, nullptr);
+    for (count = 0; success && r4aRingBufferWrite(&ring, 0, &record, 40); count++)
+        ;
+    success = success && (count == 5) && (ring._recordsDropped == 1)
+           && (r4aRingBufferReserve(&ring, 0, 200) == nullptr)
+           && (ring._recordsDropped == 2) && (ring._bytesDropped == 240);
+    r4aRingBufferEnd(&ring);
+    return testResult("records wrap using pad records and are dropped when full", success);
+}
+
+//*********************************************************************
+// Verify that the consumer stops at an uncommitted record
+static bool testCommit()
+{
+    uint16_t length;
+    RECORD record;
+    RECORD * reserved;
+    bool success;
+
+    memset(&ring, 0, sizeof(ring));
+    success = r4aRingBufferBegin(&ring, 256, false, nullptr);
+
+    // Reserve the first record and write the second
+    reserved = (RECORD *)r4aRingBufferReserve(&ring, 1, 20);
+    success = success && reserved;
+    recordFill(&record, 0, 2);
+    success = success && r4aRingBufferWrite(&ring, 2, &record, 20);
+    success = success && (r4aRingBufferPeek(&ring) == nullptr)
+           && (r4aRingBufferRead(&ring, &record, sizeof(record)) == false);
+
+    // Commit the first record, both records are now available in order
+    if (success)
+    {
+        recordFill(&record, 0, 1);
+        memcpy(reserved, &record, 20);
+        r4aRingBufferCommit(&ring, reserved);
+    }
+    success = success
+           && r4aRingBufferRead(&ring, &record, sizeof(record), nullptr, &length)
+           && (record._sequence == 1) && (length == 20)
+           && r4aRingBufferRead(&ring, &record, sizeof(record))
+           && (record._sequence == 2)
+           && (r4aRingBufferRead(&ring, &record, sizeof(record)) == false);
+    r4aRingBufferEnd(&ring);
+    return testResult("the consumer waits for the commit of the oldest record", success);
+}
+
+//*********************************************************************
+// Verify that the oldest records are overwritten
+static bool testOverwrite()
+{
+    uint32_t expected;
+    RECORD record;
+    uint32_t sequence;
+    bool success;
+
+    memset(&ring, 0, sizeof(ring));
+    success = r4aRingBufferBegin(&ring, 256, true, nullptr)
+           && (r4aRingBufferPeek(&ring) == nullptr);
+
+    // Write 20 records of 48 bytes, only the last 5 fit
+    for (sequence = 0; success && (sequence < 20); sequence++)
+    {
+        recordFill(&record, 0, sequence);
+        success = r4aRingBufferWrite(&ring, 0, &record, 40);
+    }
+    for (expected = 15; success && (expected < 20); expected++)
+        success = r4aRingBufferRead(&ring, &record, sizeof(record))
+               && (record._sequence == expected);
+    success = success && (r4aRingBufferRead(&ring, &record, sizeof(record)) == false)
+           && (ring._recordsDropped == 0) && (ring._recordsOverwritten == 15);
+    r4aRingBufferEnd(&ring);
+    return testResult("the oldest records are overwritten", success);
+}
+
+//*********************************************************************
+// Write records to the ring buffer
+static void * producerThread(void * parameter)
+{
+    PRODUCER * producer;
+    RECORD record;
+    RECORD * reserved;
+    uint32_t sequence;
+
+    producer = (PRODUCER *)parameter;
+    for (sequence = 0; sequence < STRESS_RECORDS; sequence++)
+    {
+        if (producer->_zeroCopy)
+        {
+            // Fill in the record in place
+            reserved = (RECORD *)r4aRingBufferReserve(&ring,
+                                                      producer->_producer,
+                                                      recordLength(sequence));
+            if (reserved)
+            {
+                recordFill(reserved, producer->_producer, sequence);
+                r4aRingBufferCommit(&ring, reserved);
+            }
+        }
+        else
+        {
+            // Copy the record into the buffer
+            recordFill(&record, producer->_producer, sequence);
+            r4aRingBufferWrite(&ring, producer->_producer, &record, recordLength(sequence));
+        }
+
+        // Let the consumer catch up now and then
+        if ((sequence & 0xff) == 0)
+            sched_yield();
+    }
+    sentRecords[producer->_producer] = sequence;
+    __atomic_fetch_add(&producersDone, 1, __ATOMIC_RELEASE);
+    return nullptr;
+}
+
+//*********************************************************************
+// Verify a received record
+static void consumerVerify(const RECORD * record,
+                           uint8_t type,
+                           uint16_t length,
+                           int64_t * lastSequence)
+{
+    if ((!recordVerify(record, length)) || (type != record->_producer)
+        || ((int64_t)record->_sequence <= lastSequence[record->_producer]))
+    {
+        consumerErrors += 1;
+        return;
+    }
+    lastSequence[record->_producer] = record->_sequence;
+    consumerRecords[record->_producer] += 1;
+}
+
+//*********************************************************************
+// Read the records from the ring buffer
+static void * consumerThread(void * parameter)
+{
+    bool done;
+    int index;
+    int64_t lastSequence[MAX_PRODUCERS];
+    uint16_t length;
+    int producers;
+    RECORD record;
+    const RECORD * peek;
+    uint8_t type;
+
+    producers = (int)(intptr_t)parameter;
+    for (index = 0; index < MAX_PRODUCERS; index++)
+        lastSequence[index] = -1;
+    do
+    {
+        // Check for done before reading, the last records are in the
+        // buffer when the producers finish
+        done = (__atomic_load_n(&producersDone, __ATOMIC_ACQUIRE) == producers);
+        while (1)
+        {
+            if (ring._overwrite)
+            {
+                // Copy the record, detects the record being overwritten
+                if (!r4aRingBufferRead(&ring, &record, sizeof(record), &type, &length))
+                    break;
+                consumerVerify(&record, type, length, lastSequence);
+            }
+            else
+            {
+                // Use the record in place
+                peek = (const RECORD *)r4aRingBufferPeek(&ring, &type, &length);
+                if (!peek)
+                    break;
+                consumerVerify(peek, type, length, lastSequence);
+                r4aRingBufferRelease(&ring);
+            }
+        }
+
+        // Let the producers run when the buffer is empty
+        sched_yield();
+    } while (!done);
+    return nullptr;
+}
+
+//*********************************************************************
+// Run the producers against the consumer
+static bool testStress(int producers, bool overwrite, uint32_t bufferBytes)
+{
+    PRODUCER context[MAX_PRODUCERS];
+    pthread_t consumer;
+    uint64_t elapsedUsec;
+    int index;
+    uint64_t received;
+    uint64_t sent;
+    uint64_t startUsec;
+    bool success;
+    char test[128];
+
+    // Initialize the ring buffer
+    memset(&ring, 0, sizeof(ring));
+    memset(consumerRecords, 0, sizeof(consumerRecords));
+    memset(sentRecords, 0, sizeof(sentRecords));
+    consumerErrors = 0;
+    producersDone = 0;
+    success = r4aRingBufferBegin(&ring, bufferBytes, overwrite, nullptr);
+
+    // Start the threads
+    startUsec = usec();
+    pthread_create(&consumer, nullptr, consumerThread, (void *)(intptr_t)producers);
+    for (index = 0; index < producers; index++)
+    {
+        context[index]._producer = index;
+        context[index]._zeroCopy = (index != 0);
+        pthread_create(&context[index]._thread, nullptr, producerThread, &context[index]);
+    }
+
+    // Wait for the threads
+    for (index = 0; index < producers; index++)
+        pthread_join(context[index]._thread, nullptr);
+    pthread_join(consumer, nullptr);
+    elapsedUsec = usec() - startUsec;
+
+    // Every record must be received, dropped or overwritten
+    received = 0;
+    sent = 0;
+    for (index = 0; index < producers; index++)
+    {
+        received += consumerRecords[index];
+        sent += sentRecords[index];
+    }
+    success = success && (consumerErrors == 0)
+           && (r4aRingBufferUsedBytes(&ring) == 0)
+           && (sent == (received + ring._recordsDropped + ring._recordsOverwritten));
+    snprintf(test, sizeof(test),
+             "%d producers, %s, %llu sent, %llu received, %lu dropped, %lu overwritten, %llu errors, %.1f nSec/record",
+             producers,
+             overwrite ? "overwrite" : "drop",
+             (unsigned long long)sent,
+             (unsigned long long)received,
+             (unsigned long)ring._recordsDropped,
+             (unsigned long)ring._recordsOverwritten,
+             (unsigned long long)consumerErrors,
+             (double)elapsedUsec * 1000. / sent);
+    r4aRingBufferEnd(&ring);
+    return testResult(test, success);
+}
+
+//*********************************************************************
+// Test the ring buffer
+int main(int argc, char **argv)
+{
+    bool success;
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    success = testWrap();
+    success &= testCommit();
+    success &= testOverwrite();
+    success &= testStress(1, false, 8192);
+    success &= testStress(3, false, 8192);
+    success &= testStress(1, true, 8192);
+    success &= testStress(3, true, 8192);
+    return success ? 0 : -1;
+}
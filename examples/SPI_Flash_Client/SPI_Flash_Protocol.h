@@ -4,6 +4,7 @@
   Command protocol for the SPI Flash server.
 **********************************************************************/
 
+#include <stdint.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -31,4 +32,80 @@ typedef struct _R4A_SPI_FLASH_COMMAND
     uint8_t command;        // See CMD_* above
 } R4A_SPI_FLASH_COMMAND;
 
+//----------------------------------------
+// Version 2 protocol
+//----------------------------------------
+//
+// Version 2 uses a separate port so that version 1 servers are not
+// confused by the new commands.  The client may send up to window
+// requests before reading the responses.  The server processes the
+// requests in order and sends the responses in the same order.
+//
+//  Request:  R4A_SPI_FLASH_V2_REQUEST [write data]
+//  Response: R4A_SPI_FLASH_V2_RESPONSE [read data or INFO]
+//
+// The crc32 values use CRC-32/ISO-HDLC, the zlib crc32 value.  All
+// values are little endian.
+
+#define SPI_FLASH_V2_SERVER_PORT    6869
+#define SPI_FLASH_V2_MAGIC          0x46413452  // "R4AF"
+#define SPI_FLASH_V2_VERSION        2
+#define SPI_FLASH_V2_SECTOR_BYTES   4096        // Erase sector size
+
+// Version 2 commands
+#define V2_CMD_INFO                 0   // Data: R4A_SPI_FLASH_V2_INFO
+#define V2_CMD_READ_DATA            1   // Data: lengthInBytes of flash data, crc32 of data
+#define V2_CMD_WRITE_DATA           2   // Request data, response crc32 of flash after write
+#define V2_CMD_ERASE_CHIP           3
+#define V2_CMD_ERASE_SECTOR         4   // Erase the 4K sector containing address
+#define V2_CMD_BLOCK_WRITE_ENABLE   5   // address: 1 = write enable, 0 = write protect
+#define V2_CMD_CHECKSUM             6   // Response crc32 of lengthInBytes of flash at address
+#define V2_CMD_SECTOR_CRCS          7   // Data: uint32_t crc32 of each sector, crc32 of data
+
+#define V2_RESPONSE                 0x80    // Set in the response command value
+
+// Version 2 status values
+#define V2_STATUS_SUCCESS           0
+#define V2_STATUS_INVALID_COMMAND   1
+#define V2_STATUS_INVALID_ADDRESS   2   // Address or length outside of the flash
+#define V2_STATUS_INVALID_LENGTH    3   // Length exceeds maxTransfer
+#define V2_STATUS_CRC_ERROR         4   // Write data CRC mismatch
+#define V2_STATUS_WRITE_PROTECTED   5
+#define V2_STATUS_FLASH_ERROR       6   // See flashStatus
+
+// SPI Flash server version 2 request
+typedef struct __attribute__((packed)) _R4A_SPI_FLASH_V2_REQUEST
+{
+    uint32_t magic;         // SPI_FLASH_V2_MAGIC
+    uint32_t address;       // Flash address
+    uint32_t lengthInBytes; // Number of bytes to read, write or checksum
+    uint32_t crc32;         // CRC of the write data, zero otherwise
+    uint16_t tag;           // Returned in the response
+    uint8_t command;        // See V2_CMD_* above
+    uint8_t reserved;
+} R4A_SPI_FLASH_V2_REQUEST;
+
+// SPI Flash server version 2 response
+typedef struct __attribute__((packed)) _R4A_SPI_FLASH_V2_RESPONSE
+{
+    uint32_t magic;         // SPI_FLASH_V2_MAGIC
+    uint32_t address;       // Flash address from the request
+    uint32_t lengthInBytes; // Number of data bytes following the response
+    uint32_t crc32;         // See V2_CMD_* above
+    uint16_t tag;           // Tag from the request
+    uint8_t command;        // Request command | V2_RESPONSE
+    uint8_t status;         // See V2_STATUS_* above
+    uint8_t flashStatus;    // SPI flash status register
+    uint8_t reserved[3];
+} R4A_SPI_FLASH_V2_RESPONSE;
+
+// V2_CMD_INFO response data
+typedef struct __attribute__((packed)) _R4A_SPI_FLASH_V2_INFO
+{
+    uint32_t version;       // SPI_FLASH_V2_VERSION
+    uint32_t flashBytes;    // Size of the SPI flash in bytes
+    uint32_t maxTransfer;   // Maximum read or write lengthInBytes
+    uint32_t window;        // Maximum number of outstanding requests
+} R4A_SPI_FLASH_V2_INFO;
+
 #endif  // __SPI_FLASH_PROTOCOL_H__
@@ -15,10 +15,13 @@
 
 #include "Dump_Buffer.h"
 #include "SPI_Flash_Protocol.h"
+#include "SPI_Flash_V2.h"
 
 #define BUFFER_LENGTH   1024
+#define V2_TRANSFER_LENGTH  (32 * 1024)
 
 uint8_t readData[BUFFER_LENGTH];
+uint8_t v2ReadData[V2_TRANSFER_LENGTH];
 
 //*********************************************************************
 // Read data from the SPI NOR Flash device
@@ -80,6 +83,103 @@ int flashRead(int sockfd,
     return exitStatus;
 }
 
+//*********************************************************************
+// Read data from the SPI NOR Flash device using the version 2 protocol,
+// keep multiple read requests outstanding
+// Inputs:
+//   sockfd: Socket file descriptor
+//   flashAddress: Address in the SPI flash to start reading data
+//   lengthInBytes: Number of bytes to read
+//   file: File descriptor to write the data, -1 displays the data
+// Outputs:
+//   Returns the exit status value
+int flashReadV2(int sockfd,
+                uint32_t flashAddress,
+                size_t lengthInBytes,
+                int file)
+{
+    ssize_t bytesWritten;
+    int exitStatus;
+    R4A_SPI_FLASH_V2_INFO info;
+    uint32_t requestAddress;
+    size_t requestBytes;
+    uint16_t requestTag;
+    uint16_t responseTag;
+    R4A_SPI_FLASH_V2_RESPONSE response;
+    size_t transferLength;
+    uint32_t window;
+
+    do
+    {
+        // Get the server limits
+        exitStatus = flashV2Info(sockfd, &info);
+        if (exitStatus)
+            break;
+        transferLength = V2_TRANSFER_LENGTH;
+        if (transferLength > info.maxTransfer)
+            transferLength = info.maxTransfer;
+        window = info.window ? info.window : 1;
+
+        // Read all of the data
+        requestAddress = flashAddress;
+        requestBytes = lengthInBytes;
+        requestTag = 1;
+        responseTag = 1;
+        while (lengthInBytes)
+        {
+            // Fill the window with read requests
+            while (requestBytes && ((uint16_t)(requestTag - responseTag) < window))
+            {
+                size_t length = requestBytes;
+                if (length > transferLength)
+                    length = transferLength;
+                exitStatus = flashV2Request(sockfd,
+                                            V2_CMD_READ_DATA,
+                                            requestTag++,
+                                            requestAddress,
+                                            length,
+                                            NULL);
+                if (exitStatus)
+                    break;
+                requestAddress += length;
+                requestBytes -= length;
+            }
+            if (exitStatus)
+                break;
+
+            // Get the next response, the CRC is verified by flashV2Response
+            exitStatus = flashV2Response(sockfd,
+                                         V2_CMD_READ_DATA,
+                                         responseTag++,
+                                         &response,
+                                         v2ReadData,
+                                         sizeof(v2ReadData));
+            if (exitStatus)
+                break;
+
+            // Process the received data
+            if (file < 0)
+                dumpBuffer(response.address, v2ReadData, response.lengthInBytes);
+            else
+            {
+                bytesWritten = write(file, v2ReadData, response.lengthInBytes);
+                if (bytesWritten < 0)
+                {
+                    exitStatus = errno;
+                    perror("ERROR: Failed to write data to the file!\r\n");
+                    break;
+                }
+            }
+
+            // Account for the data
+            lengthInBytes -= response.lengthInBytes;
+        }
+    } while (0);
+
+    // Return the read status
+    return exitStatus;
+}
+
 //*********************************************************************
 // Inputs:
 //   argc: Argument count
@@ -90,6 +190,7 @@ int main(int argc, char **argv)
 {
     ssize_t bytesWritten;
     int displayHelp;
+    uint64_t elapsedUsec;
     int exitStatus;
     int file;
     char * fileName;
@@ -97,11 +198,11 @@ int main(int argc, char **argv)
     uint32_t flashOffset;
     size_t lengthInBytes;
     ssize_t offset;
-    struct hostent * server;
-    struct sockaddr_in serverIpAddress;
     char * serverName;
     int sockfd;
+    uint64_t startUsec;
     char * string;
+    size_t totalBytes;
     size_t transferLength;
 
     displayHelp = 1;
@@ -158,37 +259,25 @@ int main(int argc, char **argv)
         exitStatus = 0;
         flashOffset = flashAddress;
 
-        // Translate from a name to an IP address
-        server = gethostbyname( serverName );
-        if (!server)
-        {
-            exitStatus = h_errno;
-            errno = h_errno;
-            perror("ERROR: Server not found!\r\n");
-            break;
-        }
-
-        // Create the socket
-        sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        if (sockfd < 0)
+        // Use the version 2 protocol when the server supports it
+        startUsec = currentUsec();
+        totalBytes = lengthInBytes;
+        sockfd = flashConnect(serverName, SPI_FLASH_V2_SERVER_PORT, 0);
+        if (sockfd >= 0)
         {
-            exitStatus = errno;
-            perror("ERROR: Failed to create the socket!\r\n");
-            break;
+            exitStatus = flashReadV2(sockfd, flashAddress, lengthInBytes, file);
+            lengthInBytes = 0;
         }
 
-        // Initialize the server address
-        memset(&serverIpAddress, 0, sizeof(serverIpAddress));
-        serverIpAddress.sin_family = AF_INET;
-        memcpy(&serverIpAddress.sin_addr.s_addr, server->h_addr, server->h_length);
-        serverIpAddress.sin_port = htons( SPI_FLASH_SERVER_PORT );
-
-        // Attempt to connect to the server
-        if (connect(sockfd,(struct sockaddr *)&serverIpAddress, sizeof(serverIpAddress)))
+        // Fall back to the version 1 protocol
+        else
         {
-            exitStatus = errno;
-            perror("ERROR: Failed to connect to the SPI Flash server!\r\n");
-            break;
+            sockfd = flashConnect(serverName, SPI_FLASH_SERVER_PORT, 1);
+            if (sockfd < 0)
+            {
+                exitStatus = errno;
+                break;
+            }
         }
 
         // Read all of the data
@@ -226,6 +315,15 @@ int main(int argc, char **argv)
             flashAddress += transferLength;
             flashOffset += transferLength;
         }
+
+        // Display the throughput
+        elapsedUsec = currentUsec() - startUsec;
+        if ((exitStatus == 0) && (file >= 0))
+            printf("%ld bytes in %ld.%03ld seconds, %ld KB/s\r\n",
+                   totalBytes,
+                   elapsedUsec / (1000 * 1000),
+                   (elapsedUsec / 1000) % 1000,
+                   elapsedUsec ? (totalBytes * 1000) / elapsedUsec : 0);
     } while (0);
 
     // Close the socket
@@ -0,0 +1,649 @@
+/**********************************************************************
+  SPI_Flash_Server.c
+
+  Linux stand-in for the robot's SPI Flash server.  The flash contents
+  are kept in a file.  Both the version 1 and version 2 protocols are
+  supported so that the client applications may be tested and
+  benchmarked without hardware.  The -l option delays each response to
+  simulate the network latency to the robot.  The -m option reduces the
+  maximum transfer length reported to the clients.
+**********************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "SPI_Flash_V2.h"
+
+#define FLASH_BYTES_DEFAULT     (16 * 1024 * 1024)
+#define MAX_TRANSFER            (64 * 1024)
+#define WINDOW                  8
+
+#define V1_COMMAND_BYTES        sizeof(R4A_SPI_FLASH_COMMAND)
+#define V1_STATUS_PROTECTED     0x10    // STATUS_WPLD
+
+// Response waiting for its due time
+typedef struct _RESPONSE
+{
+    struct _RESPONSE * next;
+    uint64_t dueUsec;       // Time to send the response
+    size_t length;          // Number of bytes in data
+    uint8_t data[];
+} RESPONSE;
+
+uint8_t * flashData;        // Contents of the SPI flash
+uint32_t flashBytes;        // Size of the SPI flash in bytes
+int flashFile;              // File containing the SPI flash data
+uint32_t latencyUsec;       // Delay before sending each response
+uint32_t maxTransfer;       // Maximum read or write length reported to the client
+RESPONSE * responseHead;    // First response to send
+RESPONSE * responseTail;    // Last response to send
+uint8_t rxBuffer[sizeof(R4A_SPI_FLASH_V2_REQUEST) + MAX_TRANSFER];
+size_t rxBytes;             // Number of bytes in rxBuffer
+int writeEnabled;           // Set by the block write enable command
+
+// Connection statistics
+uint64_t bytesRead;
+uint64_t bytesWritten;
+uint32_t requests;
+
+//*********************************************************************
+// Save a range of the flash data in the file
+// Inputs:
+//   address: Flash address of the first byte
+//   length: Number of bytes to save
+void flashSave(uint32_t address, uint32_t length)
+{
+    if (pwrite(flashFile, &flashData[address], length, address) != length)
+        perror("ERROR: Failed to write the flash file!\n");
+}
+
+//*********************************************************************
+// Program the flash, only 1 to 0 transitions are possible
+// Inputs:
+//   address: Flash address of the first byte
+//   data: Buffer containing the data to write
+//   length: Number of bytes to write
+void flashProgram(uint32_t address, const uint8_t * data, uint32_t length)
+{
+    uint32_t index;
+
+    for (index = 0; index < length; index++)
+        flashData[address + index] &= data[index];
+    flashSave(address, length);
+    bytesWritten += length;
+}
+
+//*********************************************************************
+// Determine if the range is within the flash
+// Inputs:
+//   address: Flash address of the first byte
+//   length: Number of bytes
+// Outputs:
+//   Returns true when the range is valid
+int flashRangeValid(uint32_t address, uint32_t length)
+{
+    return (address <= flashBytes) && (length <= (flashBytes - address));
+}
+
+//*********************************************************************
+// Queue a response to be sent after the latency delay
+// Inputs:
+//   header: Address of the response header
+//   headerLength: Number of bytes in the header
+//   data: Address of the response data, may be NULL
+//   dataLength: Number of data bytes
+void responseQueue(const void * header,
+                   size_t headerLength,
+                   const void * data,
+                   size_t dataLength)
+{
+    RESPONSE * response;
+
+    // Allocate the response
+    response = malloc(sizeof(*response) + headerLength + dataLength);
+    if (!response)
+    {
+        fprintf(stderr, "ERROR: Failed to allocate the response!\n");
+        exit(-1);
+    }
+
+    // Build the response
+    response->next = NULL;
+    response->dueUsec = currentUsec() + latencyUsec;
+    response->length = headerLength + dataLength;
+    memcpy(response->data, header, headerLength);
+    if (dataLength)
+        memcpy(&response->data[headerLength], data, dataLength);
+
+    // Add the response to the end of the list
+    if (responseTail)
+        responseTail->next = response;
+    else
+        responseHead = response;
+    responseTail = response;
+}
+
+//*********************************************************************
+// Send the responses that are due
+// Inputs:
+//   sockfd: Socket file descriptor
+// Outputs:
+//   Returns zero when successful or the error number
+int responseSend(int sockfd)
+{
+    int exitStatus;
+    RESPONSE * response;
+
+    exitStatus = 0;
+    while (responseHead && (responseHead->dueUsec <= currentUsec()))
+    {
+        // Remove the response from the list
+        response = responseHead;
+        responseHead = response->next;
+        if (!responseHead)
+            responseTail = NULL;
+
+        // Send the response
+        if (exitStatus == 0)
+            exitStatus = flashSend(sockfd, response->data, response->length);
+        free(response);
+    }
+    return exitStatus;
+}
+
+//*********************************************************************
+// Process a version 1 command
+// Inputs:
+//   cmd: Address of the command
+//   data: Address of the write data
+void processV1Command(R4A_SPI_FLASH_COMMAND * cmd, const uint8_t * data)
+{
+    uint32_t length;
+    R4A_SPI_FLASH_COMMAND response;
+    uint8_t * readData;
+
+    memset(&response, 0, sizeof(response));
+    switch (cmd->command)
+    {
+    default:
+        fprintf(stderr, "WARNING: Unknown version 1 command %d\n", cmd->command);
+        return;
+
+    case CMD_READ_DATA:
+        // Return 0xff for addresses outside of the flash
+        readData = malloc(cmd->lengthInBytes);
+        if (!readData)
+            return;
+        memset(readData, 0xff, cmd->lengthInBytes);
+        if (cmd->address < flashBytes)
+        {
+            length = flashBytes - cmd->address;
+            if (length > cmd->lengthInBytes)
+                length = cmd->lengthInBytes;
+            memcpy(readData, &flashData[cmd->address], length);
+        }
+        responseQueue(readData, cmd->lengthInBytes, NULL, 0);
+        bytesRead += cmd->lengthInBytes;
+        free(readData);
+        return;
+
+    case CMD_WRITE_DATA:
+        response.command = CMD_WRITE_SUCCESS;
+        if (!writeEnabled)
+            response.lengthInBytes = V1_STATUS_PROTECTED;
+        else if (flashRangeValid(cmd->address, cmd->lengthInBytes))
+            flashProgram(cmd->address, data, cmd->lengthInBytes);
+        break;
+
+    case CMD_ERASE_CHIP:
+        response.command = CMD_ERASE_SUCCESS;
+        if (!writeEnabled)
+            response.lengthInBytes = V1_STATUS_PROTECTED;
+        else
+        {
+            memset(flashData, 0xff, flashBytes);
+            flashSave(0, flashBytes);
+        }
+        break;
+
+    case CMD_BLOCK_WRITE_ENABLE:
+        response.command = CMD_BLOCK_ENABLE_SUCCESS;
+        writeEnabled = cmd->address ? 1 : 0;
+        break;
+    }
+    responseQueue(&response, sizeof(response), NULL, 0);
+}
+
+//*********************************************************************
+// Process a version 2 request
+// Inputs:
+//   request: Address of the request
+//   data: Address of the write data
+void processV2Request(R4A_SPI_FLASH_V2_REQUEST * request, const uint8_t * data)
+{
+    R4A_SPI_FLASH_V2_INFO info;
+    uint32_t length;
+    const void * responseData;
+    R4A_SPI_FLASH_V2_RESPONSE response;
+    uint32_t sector;
+    static uint32_t sectorCrc[MAX_TRANSFER / sizeof(uint32_t)];
+    uint32_t sectors;
+
+    // Build the response
+    memset(&response, 0, sizeof(response));
+    response.magic = SPI_FLASH_V2_MAGIC;
+    response.address = request->address;
+    response.tag = request->tag;
+    response.command = request->command | V2_RESPONSE;
+    responseData = NULL;
+    length = request->lengthInBytes;
+
+    switch (request->command)
+    {
+    default:
+        response.status = V2_STATUS_INVALID_COMMAND;
+        break;
+
+    case V2_CMD_INFO:
+        info.version = SPI_FLASH_V2_VERSION;
+        info.flashBytes = flashBytes;
+        info.maxTransfer = maxTransfer;
+        info.window = WINDOW;
+        response.lengthInBytes = sizeof(info);
+        responseData = &info;
+        break;
+
+    case V2_CMD_READ_DATA:
+        if (length > maxTransfer)
+            response.status = V2_STATUS_INVALID_LENGTH;
+        else if (!flashRangeValid(request->address, length))
+            response.status = V2_STATUS_INVALID_ADDRESS;
+        else
+        {
+            response.lengthInBytes = length;
+            response.crc32 = crc32(0, &flashData[request->address], length);
+            responseData = &flashData[request->address];
+            bytesRead += length;
+        }
+        break;
+
+    case V2_CMD_WRITE_DATA:
+        if (length > maxTransfer)
+            response.status = V2_STATUS_INVALID_LENGTH;
+        else if (crc32(0, data, length) != request->crc32)
+            response.status = V2_STATUS_CRC_ERROR;
+        else if (!writeEnabled)
+            response.status = V2_STATUS_WRITE_PROTECTED;
+        else if (!flashRangeValid(request->address, length))
+            response.status = V2_STATUS_INVALID_ADDRESS;
+        else
+        {
+            // Return the CRC of the flash contents to verify the write
+            flashProgram(request->address, data, length);
+            response.crc32 = crc32(0, &flashData[request->address], length);
+        }
+        break;
+
+    case V2_CMD_ERASE_CHIP:
+        if (!writeEnabled)
+            response.status = V2_STATUS_WRITE_PROTECTED;
+        else
+        {
+            memset(flashData, 0xff, flashBytes);
+            flashSave(0, flashBytes);
+        }
+        break;
+
+    case V2_CMD_ERASE_SECTOR:
+        sector = request->address & ~(SPI_FLASH_V2_SECTOR_BYTES - 1);
+        if (!writeEnabled)
+            response.status = V2_STATUS_WRITE_PROTECTED;
+        else if (!flashRangeValid(sector, SPI_FLASH_V2_SECTOR_BYTES))
+            response.status = V2_STATUS_INVALID_ADDRESS;
+        else
+        {
+            memset(&flashData[sector], 0xff, SPI_FLASH_V2_SECTOR_BYTES);
+            flashSave(sector, SPI_FLASH_V2_SECTOR_BYTES);
+        }
+        break;
+
+    case V2_CMD_BLOCK_WRITE_ENABLE:
+        writeEnabled = request->address ? 1 : 0;
+        break;
+
+    case V2_CMD_CHECKSUM:
+        if (!flashRangeValid(request->address, length))
+            response.status = V2_STATUS_INVALID_ADDRESS;
+        else
+            response.crc32 = crc32(0, &flashData[request->address], length);
+        break;
+
+    case V2_CMD_SECTOR_CRCS:
+        sectors = length / SPI_FLASH_V2_SECTOR_BYTES;
+        if ((request->address | length) & (SPI_FLASH_V2_SECTOR_BYTES - 1))
+            response.status = V2_STATUS_INVALID_ADDRESS;
+        else if ((sectors * sizeof(uint32_t)) > maxTransfer)
+            response.status = V2_STATUS_INVALID_LENGTH;
+        else if (!flashRangeValid(request->address, length))
+            response.status = V2_STATUS_INVALID_ADDRESS;
+        else
+        {
+            for (sector = 0; sector < sectors; sector++)
+                sectorCrc[sector] = crc32(0,
+                                          &flashData[request->address + (sector * SPI_FLASH_V2_SECTOR_BYTES)],
+                                          SPI_FLASH_V2_SECTOR_BYTES);
+            response.lengthInBytes = sectors * sizeof(uint32_t);
+            response.crc32 = crc32(0, (uint8_t *)sectorCrc, response.lengthInBytes);
+            responseData = sectorCrc;
+        }
+        break;
+    }
+    responseQueue(&response, sizeof(response), responseData, response.lengthInBytes);
+}
+
+//*********************************************************************
+// Process the complete requests in the receive buffer
+// Inputs:
+//   version2: Set true for the version 2 protocol
+// Outputs:
+//   Returns zero when successful or -1 to close the connection
+int processRequests(int version2)
+{
+    R4A_SPI_FLASH_COMMAND * cmd;
+    size_t dataBytes;
+    size_t headerBytes;
+    R4A_SPI_FLASH_V2_REQUEST * request;
+
+    while (1)
+    {
+        // Determine the request length
+        headerBytes = version2 ? sizeof(*request) : V1_COMMAND_BYTES;
+        if (rxBytes < headerBytes)
+            break;
+        request = (R4A_SPI_FLASH_V2_REQUEST *)rxBuffer;
+        cmd = (R4A_SPI_FLASH_COMMAND *)rxBuffer;
+        dataBytes = 0;
+        if (version2)
+        {
+            if (request->magic != SPI_FLASH_V2_MAGIC)
+            {
+                fprintf(stderr, "ERROR: Invalid request, closing connection!\n");
+                return -1;
+            }
+            if (request->command == V2_CMD_WRITE_DATA)
+                dataBytes = request->lengthInBytes;
+        }
+        else if (cmd->command == CMD_WRITE_DATA)
+            dataBytes = cmd->lengthInBytes;
+
+        // The write data must fit in the receive buffer
+        if (dataBytes > MAX_TRANSFER)
+        {
+            fprintf(stderr, "ERROR: Write of %ld bytes exceeds %d, closing connection!\n",
+                    dataBytes, MAX_TRANSFER);
+            return -1;
+        }
+        if (rxBytes < (headerBytes + dataBytes))
+            break;
+
+        // Process the request
+        requests += 1;
+        if (version2)
+            processV2Request(request, &rxBuffer[headerBytes]);
+        else
+            processV1Command(cmd, &rxBuffer[headerBytes]);
+
+        // Remove the request from the buffer
+        rxBytes -= headerBytes + dataBytes;
+        memmove(rxBuffer, &rxBuffer[headerBytes + dataBytes], rxBytes);
+    }
+    return 0;
+}
+
+//*********************************************************************
+// Serve a client connection
+// Inputs:
+//   sockfd: Socket file descriptor
+//   version2: Set true for the version 2 protocol
+void serveClient(int sockfd, int version2)
+{
+    ssize_t bytesReceived;
+    uint64_t elapsedUsec;
+    struct pollfd fds;
+    uint64_t now;
+    uint64_t startUsec;
+    int timeout;
+
+    printf("Version %d client connected\n", version2 ? 2 : 1);
+    bytesRead = 0;
+    bytesWritten = 0;
+    requests = 0;
+    rxBytes = 0;
+    writeEnabled = 0;
+    startUsec = currentUsec();
+    while (1)
+    {
+        // Wait until the next response is due
+        timeout = -1;
+        if (responseHead)
+        {
+            now = currentUsec();
+            timeout = 0;
+            if (responseHead->dueUsec > now)
+                timeout = (responseHead->dueUsec - now + 999) / 1000;
+        }
+
+        // Wait for a request
+        fds.fd = sockfd;
+        fds.events = POLLIN;
+        fds.revents = 0;
+        if (poll(&fds, 1, timeout) < 0)
+            break;
+
+        // Receive the requests
+        if (fds.revents)
+        {
+            bytesReceived = recv(sockfd,
+                                 &rxBuffer[rxBytes],
+                                 sizeof(rxBuffer) - rxBytes,
+                                 0);
+            if (bytesReceived <= 0)
+                break;
+            rxBytes += bytesReceived;
+            if (processRequests(version2))
+                break;
+        }
+
+        // Send the responses
+        if (responseSend(sockfd))
+            break;
+    }
+
+    // Discard the remaining responses
+    while (responseHead)
+    {
+        RESPONSE * response = responseHead;
+        responseHead = response->next;
+        free(response);
+    }
+    responseTail = NULL;
+    close(sockfd);
+
+    // Display the statistics
+    elapsedUsec = currentUsec() - startUsec;
+    printf("Client disconnected: %d requests, %ld bytes read, %ld bytes written in %ld.%03ld seconds\n",
+           requests, bytesRead, bytesWritten,
+           elapsedUsec / (1000 * 1000), (elapsedUsec / 1000) % 1000);
+}
+
+//*********************************************************************
+// Create a listening socket
+// Inputs:
+//   port: Port number to listen on
+// Outputs:
+//   Returns the socket or -1 upon failure
+int serverListen(uint16_t port)
+{
+    int enable;
+    struct sockaddr_in serverIpAddress;
+    int sockfd;
+
+    sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sockfd < 0)
+    {
+        perror("ERROR: Failed to create the socket!\n");
+        return -1;
+    }
+    enable = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    // Listen for connections
+    memset(&serverIpAddress, 0, sizeof(serverIpAddress));
+    serverIpAddress.sin_family = AF_INET;
+    serverIpAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    serverIpAddress.sin_port = htons( port );
+    if (bind(sockfd, (struct sockaddr *)&serverIpAddress, sizeof(serverIpAddress))
+        || listen(sockfd, 1))
+    {
+        perror("ERROR: Failed to listen for connections!\n");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+//*********************************************************************
+// Inputs:
+//   argc: Argument count
+//   argv: Array of argument values
+// Outputs:
+//   Returns the value to the command line
+int main(int argc, char **argv)
+{
+    int argIndex;
+    int clientfd;
+    int displayHelp;
+    int enable;
+    int exitStatus;
+    off_t fileLength;
+    struct pollfd fds[2];
+    int index;
+
+    displayHelp = 1;
+    exitStatus = -1;
+    flashBytes = FLASH_BYTES_DEFAULT;
+    flashFile = -1;
+    latencyUsec = 0;
+    maxTransfer = MAX_TRANSFER;
+    fds[0].fd = -1;
+    fds[1].fd = -1;
+    do
+    {
+        // Get the options
+        for (argIndex = 1; argIndex < (argc - 1); argIndex += 2)
+        {
+            if (strcmp(argv[argIndex], "-l") == 0)
+                latencyUsec = strtoul(argv[argIndex + 1], NULL, 0);
+            else if (strcmp(argv[argIndex], "-m") == 0)
+                maxTransfer = strtoul(argv[argIndex + 1], NULL, 0);
+            else if (strcmp(argv[argIndex], "-s") == 0)
+                flashBytes = strtoul(argv[argIndex + 1], NULL, 0);
+            else
+                break;
+        }
+        if ((argIndex != (argc - 1)) || (flashBytes == 0)
+            || (maxTransfer == 0) || (maxTransfer > MAX_TRANSFER))
+            break;
+
+        // Help is no longer necessary
+        displayHelp = 0;
+
+        // Open the flash file
+        flashFile = open(argv[argIndex], O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (flashFile < 0)
+        {
+            exitStatus = errno;
+            perror("ERROR: Failed to open the flash file!\n");
+            break;
+        }
+
+        // Read the flash contents, the erased state is 0xff
+        flashData = malloc(flashBytes);
+        if (!flashData)
+        {
+            fprintf(stderr, "ERROR: Failed to allocate the flash data!\n");
+            break;
+        }
+        memset(flashData, 0xff, flashBytes);
+        fileLength = lseek(flashFile, 0, SEEK_END);
+        if (fileLength > flashBytes)
+            fileLength = flashBytes;
+        if ((fileLength > 0) && (pread(flashFile, flashData, fileLength, 0) != fileLength))
+        {
+            exitStatus = errno;
+            perror("ERROR: Failed to read the flash file!\n");
+            break;
+        }
+        if (fileLength < flashBytes)
+            flashSave(fileLength, flashBytes - fileLength);
+
+        // Listen for the version 1 and version 2 clients
+        fds[0].fd = serverListen(SPI_FLASH_SERVER_PORT);
+        fds[1].fd = serverListen(SPI_FLASH_V2_SERVER_PORT);
+        if ((fds[0].fd < 0) || (fds[1].fd < 0))
+            break;
+        printf("SPI Flash server: %d bytes, %d byte transfers, %d uSec latency, ports %d and %d\n",
+               flashBytes, maxTransfer, latencyUsec, SPI_FLASH_SERVER_PORT, SPI_FLASH_V2_SERVER_PORT);
+        exitStatus = 0;
+
+        // Serve one client at a time
+        while (1)
+        {
+            fds[0].events = POLLIN;
+            fds[1].events = POLLIN;
+            fds[0].revents = 0;
+            fds[1].revents = 0;
+            if (poll(fds, 2, -1) < 0)
+            {
+                exitStatus = errno;
+                perror("ERROR: Failed to wait for a client!\n");
+                break;
+            }
+            for (index = 0; index < 2; index++)
+            {
+                if (!fds[index].revents)
+                    continue;
+                clientfd = accept(fds[index].fd, NULL, NULL);
+                if (clientfd < 0)
+                    continue;
+                enable = 1;
+                setsockopt(clientfd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+                serveClient(clientfd, index);
+            }
+        }
+    } while (0);
+
+    // Close the sockets and the file
+    if (fds[0].fd >= 0)
+        close(fds[0].fd);
+    if (fds[1].fd >= 0)
+        close(fds[1].fd);
+    if (flashFile >= 0)
+        close(flashFile);
+
+    // Display the help message
+    if (displayHelp)
+        printf("%s   [-l latency_usec]   [-m max_transfer]   [-s flash_bytes]   flash_file\n",
+               argv[0]);
+
+    // Pass the status to the command line
+    exit(exitStatus);
+}
@@ -0,0 +1,294 @@
+/**********************************************************************
+  SPI_Flash_V2.c
+
+  Support routines for the version 2 SPI Flash protocol
+**********************************************************************/
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "SPI_Flash_V2.h"
+
+//*********************************************************************
+// Compute the CRC-32 value, use zero for the first crc value
+uint32_t crc32(uint32_t crc, const uint8_t * buffer, size_t length)
+{
+    static uint32_t crcTable[256];
+    int bit;
+    int index;
+    uint32_t value;
+
+    // Build the table
+    if (!crcTable[1])
+    {
+        for (index = 0; index < 256; index++)
+        {
+            value = index;
+            for (bit = 0; bit < 8; bit++)
+                value = (value & 1) ? (0xedb88320 ^ (value >> 1)) : (value >> 1);
+            crcTable[index] = value;
+        }
+    }
+
+    // Compute the CRC
+    crc = ~crc;
+    while (length--)
+        crc = crcTable[(crc ^ *buffer++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+//*********************************************************************
+// Get the current time in microseconds
+uint64_t currentUsec()
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return ((uint64_t)now.tv_sec * 1000 * 1000) + now.tv_usec;
+}
+
+//*********************************************************************
+// Connect to the SPI Flash server, returns the socket or -1 upon failure
+int flashConnect(const char * serverName, uint16_t port, int displayError)
+{
+    int enable;
+    struct hostent * server;
+    struct sockaddr_in serverIpAddress;
+    int sockfd;
+
+    do
+    {
+        // Translate from a name to an IP address
+        server = gethostbyname( serverName );
+        if (!server)
+        {
+            errno = h_errno;
+            if (displayError)
+                perror("ERROR: Server not found!\n");
+            break;
+        }
+
+        // Create the socket
+        sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (sockfd < 0)
+        {
+            if (displayError)
+                perror("ERROR: Failed to create the socket!\n");
+            break;
+        }
+
+        // Send the requests without waiting for the previous responses
+        enable = 1;
+        setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        // Initialize the server address
+        memset(&serverIpAddress, 0, sizeof(serverIpAddress));
+        serverIpAddress.sin_family = AF_INET;
+        memcpy(&serverIpAddress.sin_addr.s_addr, server->h_addr, server->h_length);
+        serverIpAddress.sin_port = htons( port );
+
+        // Attempt to connect to the server
+        if (connect(sockfd,(struct sockaddr *)&serverIpAddress, sizeof(serverIpAddress)))
+        {
+            if (displayError)
+                perror("ERROR: Failed to connect to the SPI Flash server!\n");
+            close(sockfd);
+            break;
+        }
+        return sockfd;
+    } while (0);
+    return -1;
+}
+
+//*********************************************************************
+// Receive length bytes from the socket, returns zero or the error number
+int flashRecv(int sockfd, void * buffer, size_t length)
+{
+    ssize_t bytesReceived;
+    uint8_t * data;
+
+    data = (uint8_t *)buffer;
+    while (length)
+    {
+        bytesReceived = recv(sockfd, data, length, 0);
+        if (bytesReceived <= 0)
+            return bytesReceived ? errno : ECONNRESET;
+        data += bytesReceived;
+        length -= bytesReceived;
+    }
+    return 0;
+}
+
+//*********************************************************************
+// Send length bytes to the socket, returns zero or the error number
+int flashSend(int sockfd, const void * buffer, size_t length)
+{
+    ssize_t bytesSent;
+    const uint8_t * data;
+
+    data = (const uint8_t *)buffer;
+    while (length)
+    {
+        bytesSent = send(sockfd, data, length, MSG_NOSIGNAL);
+        if (bytesSent < 0)
+            return errno;
+        data += bytesSent;
+        length -= bytesSent;
+    }
+    return 0;
+}
+
+//*********************************************************************
+// Send a version 2 request followed by the write data
+int flashV2Request(int sockfd,
+                   uint8_t command,
+                   uint16_t tag,
+                   uint32_t address,
+                   uint32_t lengthInBytes,
+                   const uint8_t * writeData)
+{
+    int exitStatus;
+    R4A_SPI_FLASH_V2_REQUEST request;
+
+    // Build the request
+    memset(&request, 0, sizeof(request));
+    request.magic = SPI_FLASH_V2_MAGIC;
+    request.address = address;
+    request.lengthInBytes = lengthInBytes;
+    request.tag = tag;
+    request.command = command;
+    if (writeData)
+        request.crc32 = crc32(0, writeData, lengthInBytes);
+
+    // Send the request and the write data
+    exitStatus = flashSend(sockfd, &request, sizeof(request));
+    if ((exitStatus == 0) && writeData)
+        exitStatus = flashSend(sockfd, writeData, lengthInBytes);
+    if (exitStatus)
+    {
+        errno = exitStatus;
+        perror("ERROR: Failed to send the request!\n");
+    }
+    return exitStatus;
+}
+
+//*********************************************************************
+// Receive a version 2 response and its data, verify the read data CRC
+int flashV2Response(int sockfd,
+                    uint8_t command,
+                    uint16_t tag,
+                    R4A_SPI_FLASH_V2_RESPONSE * response,
+                    uint8_t * buffer,
+                    size_t bufferLength)
+{
+    int exitStatus;
+
+    do
+    {
+        // Get the response header
+        exitStatus = flashRecv(sockfd, response, sizeof(*response));
+        if (exitStatus)
+        {
+            errno = exitStatus;
+            perror("ERROR: Failed to receive the response!\n");
+            break;
+        }
+
+        // Validate the response
+        exitStatus = -1;
+        if ((response->magic != SPI_FLASH_V2_MAGIC)
+            || (response->command != (command | V2_RESPONSE))
+            || (response->tag != tag)
+            || (response->lengthInBytes > bufferLength))
+        {
+            fprintf(stderr, "ERROR: Invalid response, command 0x%02x, tag %d, length %d!\n",
+                    response->command, response->tag, response->lengthInBytes);
+            break;
+        }
+
+        // Get the response data
+        if (response->lengthInBytes)
+        {
+            exitStatus = flashRecv(sockfd, buffer, response->lengthInBytes);
+            if (exitStatus)
+            {
+                errno = exitStatus;
+                perror("ERROR: Failed to receive the response data!\n");
+                break;
+            }
+            exitStatus = -1;
+        }
+
+        // Check the status
+        if (response->status != V2_STATUS_SUCCESS)
+        {
+            fprintf(stderr, "ERROR: 0x%08x: %s, SPI Flash Status: 0x%02x\n",
+                    response->address,
+                    flashV2StatusName(response->status),
+                    response->flashStatus);
+            break;
+        }
+
+        // Verify the read data
+        if (((command == V2_CMD_READ_DATA) || (command == V2_CMD_SECTOR_CRCS))
+            && (crc32(0, buffer, response->lengthInBytes) != response->crc32))
+        {
+            fprintf(stderr, "ERROR: 0x%08x: Read data CRC error!\n", response->address);
+            break;
+        }
+        exitStatus = 0;
+    } while (0);
+
+    // Return the response status
+    return exitStatus;
+}
+
+//*********************************************************************
+// Get the version 2 server limits
+int flashV2Info(int sockfd, R4A_SPI_FLASH_V2_INFO * info)
+{
+    int exitStatus;
+    R4A_SPI_FLASH_V2_RESPONSE response;
+
+    exitStatus = flashV2Request(sockfd, V2_CMD_INFO, 0, 0, 0, NULL);
+    if (exitStatus == 0)
+        exitStatus = flashV2Response(sockfd,
+                                     V2_CMD_INFO,
+                                     0,
+                                     &response,
+                                     (uint8_t *)info,
+                                     sizeof(*info));
+    if ((exitStatus == 0) && (response.lengthInBytes != sizeof(*info)))
+    {
+        fprintf(stderr, "ERROR: Invalid INFO response!\n");
+        exitStatus = -1;
+    }
+    return exitStatus;
+}
+
+//*********************************************************************
+// Get the name of a version 2 status value
+const char * flashV2StatusName(uint8_t status)
+{
+    static const char * statusName[] =
+    {
+        "Success",                  // V2_STATUS_SUCCESS
+        "Invalid command",          // V2_STATUS_INVALID_COMMAND
+        "Invalid address",          // V2_STATUS_INVALID_ADDRESS
+        "Invalid length",           // V2_STATUS_INVALID_LENGTH
+        "Write data CRC error",     // V2_STATUS_CRC_ERROR
+        "Write protected",          // V2_STATUS_WRITE_PROTECTED
+        "Flash error",              // V2_STATUS_FLASH_ERROR
+    };
+
+    if (status < (sizeof(statusName) / sizeof(statusName[0])))
+        return statusName[status];
+    return "Unknown status";
+}
@@ -0,0 +1,53 @@
+/**********************************************************************
+  SPI_Flash_V2.h
+
+  Support routines for the version 2 SPI Flash protocol
+**********************************************************************/
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "SPI_Flash_Protocol.h"
+
+#ifndef __SPI_FLASH_V2_H__
+#define __SPI_FLASH_V2_H__
+
+// Compute the CRC-32 value, use zero for the first crc value
+uint32_t crc32(uint32_t crc, const uint8_t * buffer, size_t length);
+
+// Get the current time in microseconds
+uint64_t currentUsec();
+
+// Connect to the SPI Flash server, returns the socket or -1 upon failure
+int flashConnect(const char * serverName, uint16_t port, int displayError);
+
+// Receive length bytes from the socket, returns zero or the error number
+int flashRecv(int sockfd, void * buffer, size_t length);
+
+// Send length bytes to the socket, returns zero or the error number
+int flashSend(int sockfd, const void * buffer, size_t length);
+
+// Send a version 2 request followed by the write data
+int flashV2Request(int sockfd,
+                   uint8_t command,
+                   uint16_t tag,
+                   uint32_t address,
+                   uint32_t lengthInBytes,
+                   const uint8_t * writeData);
+
+// Receive a version 2 response and its data, verify the read data CRC
+int flashV2Response(int sockfd,
+                    uint8_t command,
+                    uint16_t tag,
+                    R4A_SPI_FLASH_V2_RESPONSE * response,
+                    uint8_t * buffer,
+                    size_t bufferLength);
+
+// Get the version 2 server limits
+int flashV2Info(int sockfd, R4A_SPI_FLASH_V2_INFO * info);
+
+// Get the name of a version 2 status value
+const char * flashV2StatusName(uint8_t status);
+
+#endif  // __SPI_FLASH_V2_H__
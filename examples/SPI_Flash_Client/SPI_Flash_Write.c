@@ -16,8 +16,10 @@
 
 #include "Dump_Buffer.h"
 #include "SPI_Flash_Protocol.h"
+#include "SPI_Flash_V2.h"
 
 #define BUFFER_LENGTH   1024
+#define V2_TRANSFER_LENGTH  (32 * 1024)
 
 uint8_t writeData[BUFFER_LENGTH];
 uint8_t readData[BUFFER_LENGTH];
@@ -358,6 +360,464 @@ void displayDifference(uint32_t flashAddress,
     }
 }
 
+//*********************************************************************
+// Display the write throughput
+// Inputs:
+//   lengthInBytes: Number of bytes written
+//   elapsedUsec: Number of microseconds for the write and verify
+void displayThroughput(size_t lengthInBytes, uint64_t elapsedUsec)
+{
+    printf("%ld bytes in %ld.%03ld seconds, %ld KB/s\n",
+           lengthInBytes,
+           elapsedUsec / (1000 * 1000),
+           (elapsedUsec / 1000) % 1000,
+           elapsedUsec ? (lengthInBytes * 1000) / elapsedUsec : 0);
+}
+
+//*********************************************************************
+// Send a version 2 command without data and wait for the response
+// Inputs:
+//   sockfd: Socket file descriptor
+//   command: V2_CMD_* value
+//   address: Flash address or command parameter
+//   lengthInBytes: Length parameter for the command
+//   response: Address of the buffer to receive the response
+// Outputs:
+//   Returns the exit status value
+int flashV2Command(int sockfd,
+                   uint8_t command,
+                   uint32_t address,
+                   uint32_t lengthInBytes,
+                   R4A_SPI_FLASH_V2_RESPONSE * response)
+{
+    int exitStatus;
+
+    exitStatus = flashV2Request(sockfd, command, 0, address, lengthInBytes, NULL);
+    if (exitStatus == 0)
+        exitStatus = flashV2Response(sockfd, command, 0, response, NULL, 0);
+    return exitStatus;
+}
+
+//*********************************************************************
+// Write the image to the SPI NOR Flash device using the version 2
+// protocol, keep multiple write requests outstanding and verify each
+// write using the CRC of the flash contents returned by the server
+// Inputs:
+//   sockfd: Socket file descriptor
+//   image: Buffer containing the data to write
+//   imageLength: Number of bytes to write
+// Outputs:
+//   Returns the exit status value
+int flashWriteV2(int sockfd, uint8_t * image, size_t imageLength)
+{
+    int exitStatus;
+    R4A_SPI_FLASH_V2_INFO info;
+    uint32_t requestAddress;
+    uint16_t requestTag;
+    R4A_SPI_FLASH_V2_RESPONSE response;
+    uint32_t responseAddress;
+    size_t responseLength;
+    uint16_t responseTag;
+    size_t transferLength;
+    uint32_t window;
+
+    do
+    {
+        // Get the server limits
+        exitStatus = flashV2Info(sockfd, &info);
+        if (exitStatus)
+            break;
+        if (imageLength > info.flashBytes)
+        {
+            exitStatus = -1;
+            fprintf(stderr, "ERROR: Image size %ld exceeds flash size %d!\n",
+                    imageLength, info.flashBytes);
+            break;
+        }
+        transferLength = V2_TRANSFER_LENGTH;
+        if (transferLength > info.maxTransfer)
+            transferLength = info.maxTransfer;
+        window = info.window ? info.window : 1;
+
+        // Erase the SPI flash
+        exitStatus = flashV2Command(sockfd, V2_CMD_ERASE_CHIP, 0, 0, &response);
+        if (exitStatus)
+            break;
+        printf("Chip erased\n");
+
+        // Write all of the data
+        requestAddress = 0;
+        responseAddress = 0;
+        requestTag = 1;
+        responseTag = 1;
+        while (responseAddress < imageLength)
+        {
+            // Fill the window with write requests
+            while ((requestAddress < imageLength)
+                && ((uint16_t)(requestTag - responseTag) < window))
+            {
+                size_t length = imageLength - requestAddress;
+                if (length > transferLength)
+                    length = transferLength;
+                exitStatus = flashV2Request(sockfd,
+                                            V2_CMD_WRITE_DATA,
+                                            requestTag++,
+                                            requestAddress,
+                                            length,
+                                            &image[requestAddress]);
+                if (exitStatus)
+                    break;
+                requestAddress += length;
+            }
+            if (exitStatus)
+                break;
+
+            // Get the next response
+            exitStatus = flashV2Response(sockfd,
+                                         V2_CMD_WRITE_DATA,
+                                         responseTag++,
+                                         &response,
+                                         NULL,
+                                         0);
+            if (exitStatus)
+                break;
+
+            // Verify the flash contents
+            responseLength = imageLength - responseAddress;
+            if (responseLength > transferLength)
+                responseLength = transferLength;
+            if ((response.address != responseAddress)
+                || (response.crc32 != crc32(0, &image[responseAddress], responseLength)))
+            {
+                exitStatus = -1;
+                fprintf(stderr, "ERROR: 0x%08x: Failed to verify data written to flash!\n",
+                        response.address);
+                break;
+            }
+
+            // Account for the data
+            printf("0x%08x\n", responseAddress);
+            responseAddress += responseLength;
+        }
+        if (exitStatus)
+            break;
+
+        // Verify the entire image
+        exitStatus = flashV2Command(sockfd, V2_CMD_CHECKSUM, 0, imageLength, &response);
+        if (exitStatus)
+            break;
+        if (response.crc32 != crc32(0, image, imageLength))
+        {
+            exitStatus = -1;
+            fprintf(stderr, "ERROR: Flash CRC 0x%08x does not match image CRC!\n",
+                    response.crc32);
+            break;
+        }
+        printf("Image CRC 0x%08x verified\n", response.crc32);
+    } while (0);
+
+    // Return the write status
+    return exitStatus;
+}
+
+//*********************************************************************
+// Get the CRC of each flash sector using the version 2 protocol
+// Inputs:
+//   sockfd: Socket file descriptor
+//   info: Address of the server limits
+//   sectors: Number of sectors starting at flash address zero
+//   sectorCrc: Address of the buffer to receive the sector CRCs
+// Outputs:
+//   Returns the exit status value
+int flashV2SectorCrcs(int sockfd,
+                      R4A_SPI_FLASH_V2_INFO * info,
+                      uint32_t sectors,
+                      uint32_t * sectorCrc)
+{
+    uint32_t count;
+    int exitStatus;
+    uint32_t maxSectors;
+    R4A_SPI_FLASH_V2_RESPONSE response;
+    uint32_t sector;
+
+    exitStatus = 0;
+    maxSectors = info->maxTransfer / sizeof(uint32_t);
+    for (sector = 0; sector < sectors; sector += count)
+    {
+        // Request the CRCs for the next group of sectors
+        count = sectors - sector;
+        if (count > maxSectors)
+            count = maxSectors;
+        exitStatus = flashV2Request(sockfd,
+                                    V2_CMD_SECTOR_CRCS,
+                                    0,
+                                    sector * SPI_FLASH_V2_SECTOR_BYTES,
+                                    count * SPI_FLASH_V2_SECTOR_BYTES,
+                                    NULL);
+        if (exitStatus)
+            break;
+        exitStatus = flashV2Response(sockfd,
+                                     V2_CMD_SECTOR_CRCS,
+                                     0,
+                                     &response,
+                                     (uint8_t *)&sectorCrc[sector],
+                                     count * sizeof(uint32_t));
+        if (exitStatus)
+            break;
+        if (response.lengthInBytes != (count * sizeof(uint32_t)))
+        {
+            exitStatus = -1;
+            fprintf(stderr, "ERROR: 0x%08x: Short sector CRC response!\n",
+                    response.address);
+            break;
+        }
+    }
+    return exitStatus;
+}
+
+//*********************************************************************
+// Differential write of the image to the SPI NOR Flash device using
+// the version 2 protocol.  Compare the CRC of each flash sector with
+// the CRC of the image sector and only erase and write the sectors
+// that differ.  Sectors beyond the end of the image are not modified.
+// Inputs:
+//   sockfd: Socket file descriptor
+//   image: Buffer containing the data to write
+//   imageLength: Number of bytes to write
+//   dryRun: Set true to only display the sectors that differ
+// Outputs:
+//   Returns the exit status value
+int flashWriteDiffV2(int sockfd, uint8_t * image, size_t imageLength, int dryRun)
+{
+    uint8_t * changed;
+    size_t changedBytes;
+    uint32_t changedSectors;
+    int exitStatus;
+    uint32_t first;
+    uint32_t * flashCrc;
+    R4A_SPI_FLASH_V2_INFO info;
+    size_t length;
+    uint32_t operation;
+    uint32_t operations;
+    R4A_SPI_FLASH_V2_REQUEST * requests;
+    R4A_SPI_FLASH_V2_RESPONSE response;
+    uint32_t requestIndex;
+    uint32_t responseIndex;
+    uint32_t sector;
+    uint8_t sectorData[SPI_FLASH_V2_SECTOR_BYTES];
+    uint32_t sectors;
+    size_t transferLength;
+    uint32_t window;
+    uint32_t writesPerSector;
+
+    changed = NULL;
+    flashCrc = NULL;
+    requests = NULL;
+    do
+    {
+        // Get the server limits
+        exitStatus = flashV2Info(sockfd, &info);
+        if (exitStatus)
+            break;
+        if (imageLength > info.flashBytes)
+        {
+            exitStatus = -1;
+            fprintf(stderr, "ERROR: Image size %ld exceeds flash size %d!\n",
+                    imageLength, info.flashBytes);
+            break;
+        }
+        if (info.maxTransfer < sizeof(uint32_t))
+        {
+            exitStatus = -1;
+            fprintf(stderr, "ERROR: Server maximum transfer %d bytes is too small!\n",
+                    info.maxTransfer);
+            break;
+        }
+        transferLength = V2_TRANSFER_LENGTH;
+        if (transferLength > info.maxTransfer)
+            transferLength = info.maxTransfer;
+        window = info.window ? info.window : 1;
+
+        // Allocate the sector tables
+        exitStatus = -1;
+        sectors = (imageLength + SPI_FLASH_V2_SECTOR_BYTES - 1) / SPI_FLASH_V2_SECTOR_BYTES;
+        changed = calloc(sectors + 1, 1);
+        flashCrc = malloc((sectors + 1) * sizeof(uint32_t));
+        if ((!changed) || (!flashCrc))
+        {
+            fprintf(stderr, "ERROR: Failed to allocate the sector tables!\n");
+            break;
+        }
+
+        // Get the flash sector CRCs
+        exitStatus = flashV2SectorCrcs(sockfd, &info, sectors, flashCrc);
+        if (exitStatus)
+            break;
+
+        // Compare the flash sectors with the image, the end of the last
+        // image sector is compared against the erased value
+        changedBytes = 0;
+        changedSectors = 0;
+        for (sector = 0; sector < sectors; sector++)
+        {
+            length = imageLength - (sector * SPI_FLASH_V2_SECTOR_BYTES);
+            if (length > SPI_FLASH_V2_SECTOR_BYTES)
+                length = SPI_FLASH_V2_SECTOR_BYTES;
+            memset(sectorData, 0xff, sizeof(sectorData));
+            memcpy(sectorData, &image[sector * SPI_FLASH_V2_SECTOR_BYTES], length);
+            if (crc32(0, sectorData, sizeof(sectorData)) != flashCrc[sector])
+            {
+                changed[sector] = 1;
+                changedBytes += length;
+                changedSectors += 1;
+            }
+        }
+
+        // Display the ranges of sectors that differ
+        for (sector = 0; sector < sectors; sector++)
+        {
+            if (!changed[sector])
+                continue;
+            first = sector;
+            while (changed[sector + 1])
+                sector += 1;
+            printf("0x%08x - 0x%08x: %d sector%s differ%s\n",
+                   first * SPI_FLASH_V2_SECTOR_BYTES,
+                   ((sector + 1) * SPI_FLASH_V2_SECTOR_BYTES) - 1,
+                   sector + 1 - first,
+                   (sector == first) ? "" : "s",
+                   (sector == first) ? "s" : "");
+        }
+
+        // Display the savings
+        printf("%d of %d sectors differ, %ld of %ld bytes to write, %ld bytes (%ld%%) saved\n",
+               changedSectors,
+               sectors,
+               changedBytes,
+               imageLength,
+               imageLength - changedBytes,
+               imageLength ? ((imageLength - changedBytes) * 100) / imageLength : 0);
+        if (dryRun)
+            break;
+
+        // Build the list of erase and write requests, erase each run of
+        // changed sectors and then write the run using large transfers.
+        // Each changed sector needs an erase and, when the server limits
+        // the transfer to less than a sector, multiple writes.
+        writesPerSector = (SPI_FLASH_V2_SECTOR_BYTES + transferLength - 1) / transferLength;
+        requests = malloc(((changedSectors * (1 + writesPerSector)) + 1) * sizeof(*requests));
+        if (!requests)
+        {
+            fprintf(stderr, "ERROR: Failed to allocate the request list!\n");
+            break;
+        }
+        operations = 0;
+        for (sector = 0; sector < sectors; sector++)
+        {
+            if (!changed[sector])
+                continue;
+
+            // Erase the run of changed sectors
+            first = sector;
+            do
+            {
+                requests[operations].command = V2_CMD_ERASE_SECTOR;
+                requests[operations].address = sector * SPI_FLASH_V2_SECTOR_BYTES;
+                requests[operations++].lengthInBytes = 0;
+            } while (changed[++sector]);
+
+            // Write the run of changed sectors
+            for (first *= SPI_FLASH_V2_SECTOR_BYTES;
+                 (first < imageLength) && (first < (sector * SPI_FLASH_V2_SECTOR_BYTES));
+                 first += length)
+            {
+                length = (sector * SPI_FLASH_V2_SECTOR_BYTES) - first;
+                if (length > (imageLength - first))
+                    length = imageLength - first;
+                if (length > transferLength)
+                    length = transferLength;
+                requests[operations].command = V2_CMD_WRITE_DATA;
+                requests[operations].address = first;
+                requests[operations++].lengthInBytes = length;
+            }
+        }
+
+        // Issue the requests keeping the window full
+        exitStatus = 0;
+        requestIndex = 0;
+        for (responseIndex = 0; responseIndex < operations; responseIndex++)
+        {
+            // Fill the window with requests
+            while ((requestIndex < operations)
+                && ((requestIndex - responseIndex) < window))
+            {
+                operation = requestIndex++;
+                exitStatus = flashV2Request(sockfd,
+                                            requests[operation].command,
+                                            (uint16_t)operation,
+                                            requests[operation].address,
+                                            requests[operation].lengthInBytes,
+                                            (requests[operation].command == V2_CMD_WRITE_DATA)
+                                            ? &image[requests[operation].address] : NULL);
+                if (exitStatus)
+                    break;
+            }
+            if (exitStatus)
+                break;
+
+            // Get the next response
+            exitStatus = flashV2Response(sockfd,
+                                         requests[responseIndex].command,
+                                         (uint16_t)responseIndex,
+                                         &response,
+                                         NULL,
+                                         0);
+            if (exitStatus)
+                break;
+
+            // Verify the flash contents
+            if ((requests[responseIndex].command == V2_CMD_WRITE_DATA)
+                && (response.crc32 != crc32(0,
+                                            &image[requests[responseIndex].address],
+                                            requests[responseIndex].lengthInBytes)))
+            {
+                exitStatus = -1;
+                fprintf(stderr, "ERROR: 0x%08x: Failed to verify data written to flash!\n",
+                        response.address);
+                break;
+            }
+            if (requests[responseIndex].command == V2_CMD_WRITE_DATA)
+                printf("0x%08x\n", response.address);
+        }
+        if (exitStatus)
+            break;
+
+        // Verify the entire image
+        exitStatus = flashV2Command(sockfd, V2_CMD_CHECKSUM, 0, imageLength, &response);
+        if (exitStatus)
+            break;
+        if (response.crc32 != crc32(0, image, imageLength))
+        {
+            exitStatus = -1;
+            fprintf(stderr, "ERROR: Flash CRC 0x%08x does not match image CRC!\n",
+                    response.crc32);
+            break;
+        }
+        printf("Image CRC 0x%08x verified\n", response.crc32);
+    } while (0);
+
+    // Done with the tables
+    if (requests)
+        free(requests);
+    if (flashCrc)
+        free(flashCrc);
+    if (changed)
+        free(changed);
+
+    // Return the write status
+    return exitStatus;
+}
+
 //*********************************************************************
 // Inputs:
 //   argc: Argument count
@@ -366,37 +826,55 @@ void displayDifference(uint32_t flashAddress,
 //   Returns the value to the command line
 int main(int argc, char **argv)
 {
+    int argIndex;
     size_t bytesRead;
+    int differential;
     int displayHelp;
+    int dryRun;
     int exitStatus;
     int file;
     size_t fileLength;
     char * fileName;
     uint32_t flashAddress;
     size_t lengthInBytes;
+    uint8_t * image;
     ssize_t offset;
-    struct hostent * server;
-    struct sockaddr_in serverIpAddress;
+    R4A_SPI_FLASH_V2_RESPONSE response;
     char * serverName;
     int sockfd;
+    uint64_t startUsec;
     char * string;
     size_t transferLength;
 
+    differential = 0;
     displayHelp = 1;
+    dryRun = 0;
     exitStatus = -1;
     file = -1;
+    image = NULL;
     sockfd = -1;
     do
     {
+        // Get the options
+        for (argIndex = 1; argIndex < argc; argIndex++)
+        {
+            if (strcmp(argv[argIndex], "-d") == 0)
+                differential = 1;
+            else if (strcmp(argv[argIndex], "-n") == 0)
+                dryRun = 1;
+            else
+                break;
+        }
+
         // Verify the command line contains the correct number of parameters
-        if (argc != 3)
+        if (argIndex != (argc - 2))
             break;
 
         // Get the server name
-        serverName = argv[1];
+        serverName = argv[argIndex];
 
         // Determine if the line contains the file name
-        fileName = argv[2];
+        fileName = argv[argIndex + 1];
 
         // Help is no longer necessary
         displayHelp = 0;
@@ -428,36 +906,61 @@ int main(int argc, char **argv)
             break;
         }
 
-        // Translate from a name to an IP address
-        server = gethostbyname( serverName );
-        if (!server)
+        // Use the version 2 protocol when the server supports it
+        startUsec = currentUsec();
+        sockfd = flashConnect(serverName, SPI_FLASH_V2_SERVER_PORT, 0);
+        if (sockfd >= 0)
         {
-            exitStatus = h_errno;
-            errno = h_errno;
-            perror("ERROR: Server not found!\n");
+            // Read the image into memory
+            image = malloc(fileLength ? fileLength : 1);
+            if (!image)
+            {
+                exitStatus = -1;
+                fprintf(stderr, "ERROR: Failed to allocate the image buffer!\n");
+                break;
+            }
+            if (read(file, image, fileLength) != fileLength)
+            {
+                exitStatus = errno;
+                perror("ERROR: Failed to read data from the file!\n");
+                break;
+            }
+
+            // Only display the sectors that differ
+            if (dryRun)
+            {
+                exitStatus = flashWriteDiffV2(sockfd, image, fileLength, 1);
+                break;
+            }
+
+            // Write the image
+            exitStatus = flashV2Command(sockfd, V2_CMD_BLOCK_WRITE_ENABLE, 1, 0, &response);
+            if (exitStatus == 0)
+            {
+                if (differential)
+                    exitStatus = flashWriteDiffV2(sockfd, image, fileLength, 0);
+                else
+                    exitStatus = flashWriteV2(sockfd, image, fileLength);
+                flashV2Command(sockfd, V2_CMD_BLOCK_WRITE_ENABLE, 0, 0, &response);
+            }
+            if (exitStatus == 0)
+                displayThroughput(fileLength, currentUsec() - startUsec);
             break;
         }
 
-        // Create the socket
-        sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        if (sockfd < 0)
+        // The differential write requires the version 2 protocol
+        if (differential || dryRun)
         {
-            exitStatus = errno;
-            perror("ERROR: Failed to create the socket!\n");
+            exitStatus = -1;
+            fprintf(stderr, "ERROR: Differential write requires a version 2 server!\n");
             break;
         }
 
-        // Initialize the server address
-        memset(&serverIpAddress, 0, sizeof(serverIpAddress));
-        serverIpAddress.sin_family = AF_INET;
-        memcpy(&serverIpAddress.sin_addr.s_addr, server->h_addr, server->h_length);
-        serverIpAddress.sin_port = htons( SPI_FLASH_SERVER_PORT );
-
-        // Attempt to connect to the server
-        if (connect(sockfd,(struct sockaddr *)&serverIpAddress, sizeof(serverIpAddress)))
+        // Fall back to the version 1 protocol
+        sockfd = flashConnect(serverName, SPI_FLASH_SERVER_PORT, 1);
+        if (sockfd < 0)
         {
             exitStatus = errno;
-            perror("ERROR: Failed to connect to the SPI Flash server!\n");
             break;
         }
 
@@ -522,6 +1025,8 @@ int main(int argc, char **argv)
                 lengthInBytes -= transferLength;
                 flashAddress += transferLength;
             }
+            if (exitStatus == 0)
+                displayThroughput(fileLength, currentUsec() - startUsec);
         } while (0);
 
         // Disable block writes
@@ -536,10 +1041,18 @@ int main(int argc, char **argv)
     if (file >= 0)
         close(file);
 
+    // Done with the image
+    if (image)
+        free(image);
+
     // Display the help message
     if (displayHelp)
-        printf("%s   server_name   file_name\n",
+    {
+        printf("%s   [-d]   [-n]   server_name   file_name\n",
                argv[0]);
+        printf("    -d: Only erase and write the sectors that differ\n");
+        printf("    -n: Dry run, display the sectors that differ\n");
+    }
 
     // Pass the status to the command line
     exit(exitStatus);
@@ -0,0 +1,296 @@
+/**********************************************************************
+  Seqlock_Benchmark.cpp
+
+  Program to test the double buffered seqlock (src/Atomic.cpp) for
+  torn reads and compare its publish and read latency against a plain
+  shared structure and a pthread mutex.  One writer thread publishes
+  snapshots whose fields all hold the same value while the reader
+  threads verify each copy.  The program exits with a non-zero status
+  when the seqlock returns a torn or stale snapshot.
+**********************************************************************/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../src/R4A_ESP32_Lock.h"
+#include "../../src/R4A_ESP32_Seqlock.h"
+
+#define MAX_READERS             15
+#define RUN_MSEC                500
+#define SAMPLE_VALUES           16
+
+// Sharing methods
+enum SHARE_TYPE
+{
+    SHARE_SEQLOCK = 0,
+    SHARE_MUTEX,
+    SHARE_PLAIN,
+    SHARE_TYPE_MAX
+};
+
+const char * const shareName[SHARE_TYPE_MAX] =
+{
+    "seqlock",
+    "mutex",
+    "plain",
+};
+
+// Multi-field state, similar to the sensor and motor state shared by
+// the robot loops
+typedef struct _SAMPLE
+{
+    uint32_t _values[SAMPLE_VALUES];    // All values are the same
+} SAMPLE;
+
+// Thread context
+typedef struct _THREAD_CONTEXT
+{
+    pthread_t _thread;
+    int _shareType;             // Sharing method
+    uint64_t _operations;       // Number of publishes or reads
+    uint64_t _nsec;             // Time spent publishing or reading
+    uint64_t _maxNsec;          // Longest publish or read
+    uint64_t _stale;            // Reads older than a previous read
+    uint64_t _torn;             // Reads with mixed values
+} THREAD_CONTEXT;
+
+//****************************************
+// Locals
+//****************************************
+
+volatile bool runStop;
+pthread_mutex_t mutexLock = PTHREAD_MUTEX_INITIALIZER;
+SAMPLE mutexSample;
+volatile SAMPLE plainSample;
+R4A_ESP32_SNAPSHOT<SAMPLE> snapshot;
+
+//*********************************************************************
+// Publish a sample
+void publish(int shareType, const SAMPLE * sample)
+{
+    switch (shareType)
+    {
+    case SHARE_SEQLOCK:
+        snapshot.publish(*sample);
+        break;
+
+    case SHARE_MUTEX:
+        pthread_mutex_lock(&mutexLock);
+        memcpy(&mutexSample, sample, sizeof(*sample));
+        pthread_mutex_unlock(&mutexLock);
+        break;
+
+    case SHARE_PLAIN:
+        memcpy((void *)&plainSample, sample, sizeof(*sample));
+        break;
+    }
+}
+
+//*********************************************************************
+// Get a copy of the latest sample
+void read(int shareType, SAMPLE * sample)
+{
+    switch (shareType)
+    {
+    case SHARE_SEQLOCK:
+        snapshot.read(sample);
+        break;
+
+    case SHARE_MUTEX:
+        pthread_mutex_lock(&mutexLock);
+        memcpy(sample, &mutexSample, sizeof(*sample));
+        pthread_mutex_unlock(&mutexLock);
+        break;
+
+    case SHARE_PLAIN:
+        memcpy(sample, (void *)&plainSample, sizeof(*sample));
+        break;
+    }
+}
+
+//*********************************************************************
+// Account for the time of an operation
+void accountTime(THREAD_CONTEXT * context, uint64_t startNsec)
+{
+    uint64_t nsec;
+
+    nsec = r4aEsp32LockHostNsec() - startNsec;
+    context->_nsec += nsec;
+    if (context->_maxNsec < nsec)
+        context->_maxNsec = nsec;
+    context->_operations += 1;
+}
+
+//*********************************************************************
+// Publish samples until told to stop
+void * writerThread(void * parameter)
+{
+    THREAD_CONTEXT * context;
+    int index;
+    SAMPLE sample;
+    uint64_t startNsec;
+    uint32_t value;
+
+    context = (THREAD_CONTEXT *)parameter;
+    value = 0;
+    while (!runStop)
+    {
+        value += 1;
+        for (index = 0; index < SAMPLE_VALUES; index++)
+            sample._values[index] = value;
+        startNsec = r4aEsp32LockHostNsec();
+        publish(context->_shareType, &sample);
+        accountTime(context, startNsec);
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Read and verify samples until told to stop
+void * readerThread(void * parameter)
+{
+    THREAD_CONTEXT * context;
+    int index;
+    uint32_t previous;
+    SAMPLE sample;
+    uint64_t startNsec;
+
+    context = (THREAD_CONTEXT *)parameter;
+    previous = 0;
+    while (!runStop)
+    {
+        startNsec = r4aEsp32LockHostNsec();
+        read(context->_shareType, &sample);
+        accountTime(context, startNsec);
+
+        // Verify the sample
+        for (index = 1; index < SAMPLE_VALUES; index++)
+            if (sample._values[index] != sample._values[0])
+                break;
+        if (index < SAMPLE_VALUES)
+            context->_torn += 1;
+        else if (sample._values[0] < previous)
+            context->_stale += 1;
+        else
+            previous = sample._values[0];
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Run the writer and readers
+bool runTest(int shareType, int readers)
+{
+    THREAD_CONTEXT context[MAX_READERS + 1];
+    int index;
+    uint64_t maxReadNsec;
+    uint64_t readNsec;
+    uint64_t reads;
+    uint64_t retries;
+    uint64_t stale;
+    int status;
+    bool success;
+    uint64_t torn;
+
+    // Reset the shared data
+    memset(&snapshot, 0, sizeof(snapshot));
+    memset(&mutexSample, 0, sizeof(mutexSample));
+    memset((void *)&plainSample, 0, sizeof(plainSample));
+    runStop = false;
+
+    // Start the writer and the readers
+    memset(context, 0, sizeof(context));
+    for (index = 0; index <= readers; index++)
+    {
+        context[index]._shareType = shareType;
+        status = pthread_create(&context[index]._thread,
+                                nullptr,
+                                index ? readerThread : writerThread,
+                                &context[index]);
+        if (status)
+        {
+            fprintf(stderr, "ERROR: Failed to create thread, %s!\n", strerror(status));
+            exit(status);
+        }
+    }
+
+    // Stop the threads
+    usleep(RUN_MSEC * 1000);
+    runStop = true;
+    for (index = 0; index <= readers; index++)
+        pthread_join(context[index]._thread, nullptr);
+
+    // Sum the reader results
+    maxReadNsec = 0;
+    readNsec = 0;
+    reads = 0;
+    stale = 0;
+    torn = 0;
+    for (index = 1; index <= readers; index++)
+    {
+        readNsec += context[index]._nsec;
+        reads += context[index]._operations;
+        stale += context[index]._stale;
+        torn += context[index]._torn;
+        if (maxReadNsec < context[index]._maxNsec)
+            maxReadNsec = context[index]._maxNsec;
+    }
+    retries = (shareType == SHARE_SEQLOCK) ? snapshot.retries() : 0;
+
+    // Display the results
+    printf("%-8s %7d %11.2f %9.1f %9.1f %12.1f %9.3f %9llu %7llu\n",
+           shareName[shareType],
+           readers,
+           (double)context[0]._operations / RUN_MSEC / 1000.,
+           context[0]._operations ? (double)context[0]._nsec / context[0]._operations : 0.,
+           reads ? (double)readNsec / reads : 0.,
+           (double)maxReadNsec / 1000.,
+           reads ? (double)retries * 100. / reads : 0.,
+           (unsigned long long)torn,
+           (unsigned long long)stale);
+
+    // The plain structure is expected to fail
+    success = (shareType == SHARE_PLAIN) || ((torn == 0) && (stale == 0));
+    return success;
+}
+
+//*********************************************************************
+// Test the seqlock and compare it against the other sharing methods
+int main(int argc, char **argv)
+{
+    int maxReaders;
+    int readers;
+    int shareType;
+    bool success;
+
+    // Get the maximum number of readers
+    maxReaders = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (maxReaders < 1)
+        maxReaders = 1;
+    if (argc == 2)
+        maxReaders = atoi(argv[1]);
+    if ((argc > 2) || (maxReaders < 1) || (maxReaders > MAX_READERS))
+    {
+        fprintf(stderr, "%s   [max_readers]\n", argv[0]);
+        fprintf(stderr, "\n");
+        fprintf(stderr, "max_readers: 1 - %d, defaults to the number of processors - 1\n",
+                MAX_READERS);
+        return -1;
+    }
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // Run the tests
+    success = true;
+    printf("Method   Readers  Pub M/Sec   Pub nS   Read nS  Max Read uS  Retry %%      Torn   Stale\n");
+    for (readers = 1; readers <= maxReaders; readers <<= 1)
+        for (shareType = 0; shareType < SHARE_TYPE_MAX; shareType++)
+            success &= runTest(shareType, readers);
+    printf("%s: seqlock snapshots were %s\n",
+           success ? "PASS" : "FAIL",
+           success ? "never torn or stale" : "torn or stale");
+    return success ? 0 : -1;
+}
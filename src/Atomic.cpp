@@ -8,9 +8,29 @@
     https://en.cppreference.com/w/cpp/atomic/atomic
     https://en.cppreference.com/w/cpp/atomic/memory_order
     https://github.com/SHA2017-badge/xtensa-esp32-elf/blob/master/lib/gcc/xtensa-esp32-elf/5.2.0/include/stdatomic.h
+
+  The ticket lock, seqlock and command queue only depend on
+  R4A_ESP32_Lock.h, R4A_ESP32_Seqlock.h and R4A_ESP32_Queue.h when built
+  on the host, see examples/Lock_Benchmark, examples/Seqlock_Benchmark
+  and examples/Command_Queue_Benchmark.
 **********************************************************************/
 
-#include <R4A_Robot.h>
+#include <string.h>
+
+#ifdef  ESP_PLATFORM
+#include "R4A_ESP32.h"
+#else   // ESP_PLATFORM
+#include "R4A_ESP32_Lock.h"
+#include "R4A_ESP32_Queue.h"
+#include "R4A_ESP32_Seqlock.h"
+#endif  // ESP_PLATFORM
+
+//****************************************
+// Constants
+//****************************************
+
+#define R4A_ESP32_LOCK_SERVING_MASK 0xffff
+#define R4A_ESP32_LOCK_NEXT_ONE     0x10000
 
 //*********************************************************************
 int32_t r4aAtomicAdd32(int32_t * obj, int32_t value, int moBefore)
@@ -82,7 +102,7 @@ void r4aLockAcquire(volatile int32_t * lock, int moBefore, int moAfter)
     expected = 0;
     while (!__atomic_compare_exchange_4(lock,
                                         &expected,
-                                        xPortGetCoreID() + 1,
+                                        R4A_ESP32_LOCK_CORE_ID() + 1,
                                         false,
                                         moBefore,
                                         moAfter))
@@ -97,3 +117,494 @@ void r4aLockRelease(volatile int32_t * lock, int moBefore)
 {
     __atomic_store_4(lock, 0, moBefore);
 }
+
+//*********************************************************************
+// Clear the command queue statistics
+void r4aEsp32CommandQueueClearStats(R4A_ESP32_COMMAND_QUEUE * queue)
+{
+    queue->_full = 0;
+    queue->_timeouts = 0;
+    queue->_drains = 0;
+    queue->_executed = 0;
+    queue->_maxDepth = 0;
+    queue->_maxExecuteUsec = 0;
+    queue->_maxLatencyUsec = 0;
+    queue->_totalLatencyUsec = 0;
+}
+
+//*********************************************************************
+// Execute the posted commands
+uint32_t r4aEsp32CommandQueueDrain(R4A_ESP32_COMMAND_QUEUE * queue,
+                                   uint32_t maxCommands)
+{
+    R4A_ESP32_COMMAND * command;
+    uint32_t count;
+    uint32_t depth;
+    Print * display;
+    uint32_t executeUsec;
+    uint32_t head;
+    uint32_t latencyUsec;
+    intptr_t parameter;
+    uint32_t pass;
+    uint32_t postUsec;
+    R4A_ESP32_COMMAND_ROUTINE routine;
+    uint32_t startUsec;
+
+    // Determine if any commands were posted
+    head = queue->_head;
+    depth = __atomic_load_n(&queue->_tail, __ATOMIC_RELAXED) - head;
+    if (depth == 0)
+        return 0;
+    queue->_drains += 1;
+    if (queue->_maxDepth < depth)
+        queue->_maxDepth = depth;
+
+    // Execute the commands in the order they were posted
+    for (count = 0; count < maxCommands; count++)
+    {
+        // Stop at an entry that is not full, the posting task may still
+        // be filling it
+        command = &queue->_commands[head & queue->_mask];
+        pass = head & ~queue->_mask;
+        if (__atomic_load_n(&command->_sequence, __ATOMIC_ACQUIRE) != (pass + 1))
+            break;
+
+        // Remove the command and free the entry for the next pass,
+        // allowing the routine to post another command
+        display = command->_display;
+        parameter = command->_parameter;
+        postUsec = command->_postUsec;
+        routine = command->_routine;
+        __atomic_store_n(&command->_sequence, pass + queue->_mask + 1, __ATOMIC_RELEASE);
+        head += 1;
+        queue->_head = head;
+
+        // Account for the time waiting in the queue
+        startUsec = (uint32_t)R4A_ESP32_LOCK_USEC();
+        latencyUsec = startUsec - postUsec;
+        queue->_executed += 1;
+        queue->_totalLatencyUsec += latencyUsec;
+        if (queue->_maxLatencyUsec < latencyUsec)
+            queue->_maxLatencyUsec = latencyUsec;
+
+        // Execute the command
+        routine(parameter, display);
+        executeUsec = (uint32_t)R4A_ESP32_LOCK_USEC() - startUsec;
+        if (queue->_maxExecuteUsec < executeUsec)
+            queue->_maxExecuteUsec = executeUsec;
+        __atomic_store_n(&queue->_completed, head, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+//*********************************************************************
+// Post a command for the control loop to execute
+uint32_t r4aEsp32CommandQueuePost(R4A_ESP32_COMMAND_QUEUE * queue,
+                                  R4A_ESP32_COMMAND_ROUTINE routine,
+                                  intptr_t parameter,
+                                  Print * display)
+{
+    R4A_ESP32_COMMAND * command;
+    int32_t difference;
+    uint32_t pass;
+    uint32_t tail;
+
+    // Claim the next entry
+    tail = __atomic_load_n(&queue->_tail, __ATOMIC_RELAXED);
+    while (1)
+    {
+        command = &queue->_commands[tail & queue->_mask];
+        pass = tail & ~queue->_mask;
+        difference = (int32_t)(__atomic_load_n(&command->_sequence, __ATOMIC_ACQUIRE) - pass);
+
+        // The entry is empty, attempt to claim it
+        if (difference == 0)
+        {
+            if (__atomic_compare_exchange_n(&queue->_tail,
+                                            &tail,
+                                            tail + 1,
+                                            true,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED))
+                break;
+        }
+
+        // The entry still holds a command from the previous pass
+        else if (difference < 0)
+        {
+            __atomic_fetch_add(&queue->_full, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+
+        // Another task claimed the entry
+        else
+            tail = __atomic_load_n(&queue->_tail, __ATOMIC_RELAXED);
+    }
+
+    // Fill the entry and then mark it full
+    command->_display = display;
+    command->_parameter = parameter;
+    command->_postUsec = (uint32_t)R4A_ESP32_LOCK_USEC();
+    command->_routine = routine;
+    __atomic_store_n(&command->_sequence, pass + 1, __ATOMIC_RELEASE);
+    return tail + 1;
+}
+
+//*********************************************************************
+// Wait for the control loop to execute a command
+bool r4aEsp32CommandQueueWait(R4A_ESP32_COMMAND_QUEUE * queue,
+                              uint32_t ticket,
+                              uint32_t timeoutUsec)
+{
+    int64_t startUsec;
+
+    startUsec = R4A_ESP32_LOCK_USEC();
+    while ((int32_t)(__atomic_load_n(&queue->_completed, __ATOMIC_ACQUIRE) - ticket) < 0)
+    {
+        if ((R4A_ESP32_LOCK_USEC() - startUsec) >= timeoutUsec)
+        {
+            __atomic_fetch_add(&queue->_timeouts, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        R4A_ESP32_LOCK_YIELD();
+    }
+    return true;
+}
+
+//*********************************************************************
+// Record the owner and the statistics after acquiring the lock
+static void r4aEsp32LockAcquired(R4A_ESP32_LOCK * lock,
+                                 uintptr_t owner,
+                                 bool contended,
+                                 uint32_t spinCycles)
+{
+    lock->_owner = owner;
+    lock->_acquisitions += 1;
+    if (contended)
+    {
+        lock->_contended += 1;
+        lock->_spinCycles += spinCycles;
+        if (lock->_maxSpinCycles < spinCycles)
+            lock->_maxSpinCycles = spinCycles;
+    }
+}
+
+//*********************************************************************
+// Acquire the lock, waiting in request order
+bool r4aEsp32LockAcquire(R4A_ESP32_LOCK * lock)
+{
+    uint32_t backoff;
+    uint32_t delay;
+    uintptr_t owner;
+    uint32_t serving;
+    uint32_t startCycles;
+    uint32_t ticket;
+    uint32_t value;
+
+    // Waiting for a lock already held by this task never ends
+    owner = R4A_ESP32_LOCK_OWNER();
+    if (lock->_owner == owner)
+    {
+        __atomic_fetch_add(&lock->_recursions, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    // Take a ticket
+    value = __atomic_fetch_add(&lock->_ticket, R4A_ESP32_LOCK_NEXT_ONE, __ATOMIC_ACQUIRE);
+    ticket = value >> 16;
+    serving = value & R4A_ESP32_LOCK_SERVING_MASK;
+    if (serving == ticket)
+    {
+        r4aEsp32LockAcquired(lock, owner, false, 0);
+        return true;
+    }
+
+    // Wait for this ticket to be served, backing off longer when further
+    // back in the queue
+    startCycles = R4A_ESP32_LOCK_CYCLES();
+    backoff = R4A_ESP32_LOCK_BACKOFF_MIN;
+    do
+    {
+        if (backoff < R4A_ESP32_LOCK_BACKOFF_MAX)
+        {
+            for (delay = backoff * ((ticket - serving) & R4A_ESP32_LOCK_SERVING_MASK);
+                 delay > 0;
+                 delay--)
+                R4A_ESP32_LOCK_PAUSE();
+            backoff <<= 1;
+        }
+        else
+            R4A_ESP32_LOCK_YIELD();
+        serving = __atomic_load_n(&lock->_ticket, __ATOMIC_ACQUIRE)
+                & R4A_ESP32_LOCK_SERVING_MASK;
+    } while (serving != ticket);
+    r4aEsp32LockAcquired(lock, owner, true, R4A_ESP32_LOCK_CYCLES() - startCycles);
+    return true;
+}
+
+//*********************************************************************
+// Clear the lock statistics
+void r4aEsp32LockClearStats(R4A_ESP32_LOCK * lock)
+{
+    lock->_acquisitions = 0;
+    lock->_contended = 0;
+    lock->_maxSpinCycles = 0;
+    lock->_spinCycles = 0;
+    lock->_timeouts = 0;
+    lock->_recursions = 0;
+    lock->_badReleases = 0;
+}
+
+//*********************************************************************
+// Release the lock
+bool r4aEsp32LockRelease(R4A_ESP32_LOCK * lock)
+{
+    uint32_t next;
+    uint32_t value;
+
+    // Only the owner may release the lock
+    if (lock->_owner != R4A_ESP32_LOCK_OWNER())
+    {
+        __atomic_fetch_add(&lock->_badReleases, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    lock->_owner = 0;
+
+    // Serve the next ticket, other tasks may be taking tickets
+    value = __atomic_load_n(&lock->_ticket, __ATOMIC_RELAXED);
+    do
+    {
+        next = (value & ~R4A_ESP32_LOCK_SERVING_MASK)
+             | ((value + 1) & R4A_ESP32_LOCK_SERVING_MASK);
+    } while (!__atomic_compare_exchange_n(&lock->_ticket,
+                                          &value,
+                                          next,
+                                          true,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+    return true;
+}
+
+//*********************************************************************
+// Attempt to acquire the lock
+bool r4aEsp32LockTryAcquire(R4A_ESP32_LOCK * lock, uint32_t timeoutUsec)
+{
+    uint32_t backoff;
+    bool contended;
+    uint32_t delay;
+    uintptr_t owner;
+    uint32_t startCycles;
+    int64_t startUsec;
+    uint32_t value;
+
+    // Waiting for a lock already held by this task never ends
+    owner = R4A_ESP32_LOCK_OWNER();
+    if (lock->_owner == owner)
+    {
+        __atomic_fetch_add(&lock->_recursions, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    // Take a ticket only when the lock is free
+    startCycles = R4A_ESP32_LOCK_CYCLES();
+    startUsec = R4A_ESP32_LOCK_USEC();
+    backoff = R4A_ESP32_LOCK_BACKOFF_MIN;
+    contended = false;
+    value = __atomic_load_n(&lock->_ticket, __ATOMIC_RELAXED);
+    while (1)
+    {
+        if ((value >> 16) == (value & R4A_ESP32_LOCK_SERVING_MASK))
+        {
+            if (__atomic_compare_exchange_n(&lock->_ticket,
+                                            &value,
+                                            value + R4A_ESP32_LOCK_NEXT_ONE,
+                                            true,
+                                            __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED))
+                break;
+            contended = true;
+            continue;
+        }
+        contended = true;
+
+        // Determine if the wait is over
+        if ((uint64_t)(R4A_ESP32_LOCK_USEC() - startUsec) >= timeoutUsec)
+        {
+            __atomic_fetch_add(&lock->_timeouts, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+
+        // Back off before checking again
+        if (backoff < R4A_ESP32_LOCK_BACKOFF_MAX)
+        {
+            for (delay = backoff; delay > 0; delay--)
+                R4A_ESP32_LOCK_PAUSE();
+            backoff <<= 1;
+        }
+        else
+            R4A_ESP32_LOCK_YIELD();
+        value = __atomic_load_n(&lock->_ticket, __ATOMIC_RELAXED);
+    }
+    r4aEsp32LockAcquired(lock,
+                         owner,
+                         contended,
+                         contended ? R4A_ESP32_LOCK_CYCLES() - startCycles : 0);
+    return true;
+}
+
+//*********************************************************************
+// Publish a snapshot
+void r4aEsp32SeqlockPublish(R4A_ESP32_SEQLOCK * seqlock,
+                            void * buffers,
+                            const void * data,
+                            size_t length)
+{
+    uint32_t sequence;
+
+    // Mark the start of the publish before writing the buffer that does
+    // not hold the latest snapshot
+    sequence = seqlock->_sequence;
+    __atomic_store_n(&seqlock->_sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&((uint8_t *)buffers)[(((sequence >> 1) + 1) & 1) * length], data, length);
+
+    // Publish the snapshot
+    __atomic_store_n(&seqlock->_sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+//*********************************************************************
+// Get a copy of the latest snapshot
+uint32_t r4aEsp32SeqlockRead(R4A_ESP32_SEQLOCK * seqlock,
+                             const void * buffers,
+                             void * data,
+                             size_t length)
+{
+    uint32_t published;
+    uint32_t sequence;
+
+    sequence = __atomic_load_n(&seqlock->_sequence, __ATOMIC_ACQUIRE);
+    while (1)
+    {
+        // Determine if a snapshot is available
+        published = sequence >> 1;
+        if (published == 0)
+            return 0;
+
+        // Copy the latest snapshot
+        memcpy(data, &((const uint8_t *)buffers)[(published & 1) * length], length);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        // The copy is good unless the writer started writing this buffer,
+        // which happens when the second publish starts
+        sequence = __atomic_load_n(&seqlock->_sequence, __ATOMIC_ACQUIRE);
+        if ((sequence - (published << 1)) < 3)
+            return published;
+        __atomic_fetch_add(&seqlock->_retries, 1, __ATOMIC_RELAXED);
+    }
+}
+
+#ifdef  ESP_PLATFORM
+//*********************************************************************
+// Display the command queue statistics
+void r4aEsp32CommandQueueDisplayStats(R4A_ESP32_COMMAND_QUEUE * queue,
+                                      Print * display)
+{
+    uint32_t executed;
+    uint32_t head;
+
+    executed = queue->_executed;
+    head = queue->_head;
+    display->printf("%s command queue: %lu entries\r\n",
+                    queue->_name ? queue->_name : "Unnamed",
+                    queue->_mask + 1);
+    display->printf("    %10lu  Commands posted\r\n", queue->_tail);
+    display->printf("    %10lu  Commands executed\r\n", queue->_completed);
+    display->printf("    %10lu  Current depth\r\n", queue->_tail - head);
+    display->printf("    %10lu  Maximum depth\r\n", queue->_maxDepth);
+    display->printf("    %10lu  Drains executing commands\r\n", queue->_drains);
+    display->printf("    %10lu  Average latency uSec\r\n",
+                    executed ? (uint32_t)(queue->_totalLatencyUsec / executed) : 0);
+    display->printf("    %10lu  Maximum latency uSec\r\n", queue->_maxLatencyUsec);
+    display->printf("    %10lu  Maximum execution uSec\r\n", queue->_maxExecuteUsec);
+    display->printf("    %10lu  Posts refused, queue full\r\n", queue->_full);
+    display->printf("    %10lu  Wait timeouts\r\n", queue->_timeouts);
+}
+
+//*********************************************************************
+// Execute a command on the control loop and wait for it to complete
+void r4aEsp32CommandQueueExecute(R4A_ESP32_COMMAND_QUEUE * queue,
+                                 R4A_ESP32_COMMAND_ROUTINE routine,
+                                 intptr_t parameter,
+                                 Print * display,
+                                 uint32_t warnUsec)
+{
+    uint32_t ticket;
+
+    // Execute the command directly when the control loop is not
+    // draining a queue
+    if (!queue)
+    {
+        routine(parameter, display);
+        return;
+    }
+
+    // Post the command and wait for it to complete.  The command holds
+    // the display address, so the wait continues after the warning until
+    // the command completes, keeping the display valid.
+    ticket = r4aEsp32CommandQueuePost(queue, routine, parameter, display);
+    if (!ticket)
+        display->printf("ERROR: %s command queue is full!\r\n",
+                        queue->_name ? queue->_name : "Unnamed");
+    else if (!r4aEsp32CommandQueueWait(queue, ticket, warnUsec))
+    {
+        display->printf("WARNING: %s command has not completed, waiting!\r\n",
+                        queue->_name ? queue->_name : "Unnamed");
+        while (!r4aEsp32CommandQueueWait(queue, ticket, warnUsec))
+            ;
+    }
+}
+
+//*********************************************************************
+// Display the command queue statistics
+void r4aEsp32CommandQueueMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                                   const char * command,
+                                   Print * display)
+{
+    r4aEsp32CommandQueueDisplayStats((R4A_ESP32_COMMAND_QUEUE *)menuEntry->menuParameter,
+                                     display);
+}
+
+//*********************************************************************
+// Display the lock statistics
+void r4aEsp32LockDisplayStats(R4A_ESP32_LOCK * lock, Print * display)
+{
+    uintptr_t owner;
+
+    owner = lock->_owner;
+    display->printf("%s lock: %s%s\r\n",
+                    lock->_name ? lock->_name : "Unnamed",
+                    owner ? "Held by " : "Free",
+                    owner ? pcTaskGetName((TaskHandle_t)owner) : "");
+    display->printf("    %10lu  Acquisitions\r\n", lock->_acquisitions);
+    display->printf("    %10lu  Contended (%lu%%)\r\n",
+                    lock->_contended,
+                    lock->_acquisitions
+                        ? (uint32_t)(((uint64_t)lock->_contended * 100) / lock->_acquisitions)
+                        : 0);
+    display->printf("    %10lu  Average spin cycles\r\n",
+                    lock->_contended ? (uint32_t)(lock->_spinCycles / lock->_contended) : 0);
+    display->printf("    %10lu  Maximum spin cycles\r\n", lock->_maxSpinCycles);
+    display->printf("    %10lu  Timeouts\r\n", lock->_timeouts);
+    display->printf("    %10lu  Recursive acquires\r\n", lock->_recursions);
+    display->printf("    %10lu  Releases by another task\r\n", lock->_badReleases);
+}
+
+//*********************************************************************
+// Display the lock statistics
+void r4aEsp32LockMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                           const char * command,
+                           Print * display)
+{
+    r4aEsp32LockDisplayStats((R4A_ESP32_LOCK *)menuEntry->menuParameter, display);
+}
+#endif  // ESP_PLATFORM
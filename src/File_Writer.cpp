@@ -0,0 +1,492 @@
+/**********************************************************************
+  File_Writer.cpp
+
+  Robots-For-All (R4A)
+  Buffered file writer, keeps the file open and writes the data to
+  flash from a low priority task
+**********************************************************************/
+
+#include "R4A_ESP32.h"
+
+//****************************************
+// Constants
+//****************************************
+
+#define R4A_ESP32_FILE_WRITER_STACK_BYTES   4096
+#define R4A_ESP32_FILE_WRITER_PRIORITY      (tskIDLE_PRIORITY + 1)
+
+//****************************************
+// Locals
+//****************************************
+
+static R4A_ESP32_FILE_WRITER * r4aEsp32FileWriters; // List of writers
+static portMUX_TYPE r4aEsp32FileWritersLock = portMUX_INITIALIZER_UNLOCKED;
+
+//*********************************************************************
+// Constructor
+R4A_ESP32_FILE_WRITER::R4A_ESP32_FILE_WRITER()
+    : _buffer{nullptr}, _bufferBytes{0}, _bufferedBytes{0}, _bytesDropped{0},
+      _bytesWritten{0}, _flushBytes{0}, _flushCount{0}, _flushMsec{0},
+      _flushRequested{false}, _head{0}, _lastFlushMsec{0},
+      _maxBufferedBytes{0}, _mutex{nullptr}, _recordsDropped{0},
+      _recordsQueued{0}, _stop{false}, _tail{0}, _task{nullptr}
+{
+    portMUX_INITIALIZE(&_lock);
+
+    // Add this writer to the list of writers
+    portENTER_CRITICAL(&r4aEsp32FileWritersLock);
+    _next = r4aEsp32FileWriters;
+    r4aEsp32FileWriters = this;
+    portEXIT_CRITICAL(&r4aEsp32FileWritersLock);
+}
+
+//*********************************************************************
+// Destructor
+R4A_ESP32_FILE_WRITER::~R4A_ESP32_FILE_WRITER()
+{
+    R4A_ESP32_FILE_WRITER ** previous;
+
+    end();
+    if (_mutex)
+        vSemaphoreDelete(_mutex);
+
+    // Remove this writer from the list of writers
+    portENTER_CRITICAL(&r4aEsp32FileWritersLock);
+    for (previous = &r4aEsp32FileWriters; *previous; previous = &(*previous)->_next)
+        if (*previous == this)
+        {
+            *previous = _next;
+            break;
+        }
+    portEXIT_CRITICAL(&r4aEsp32FileWritersLock);
+}
+
+//*********************************************************************
+// Open the file and start the flush task
+bool R4A_ESP32_FILE_WRITER::begin(const char * path,
+                                  const char * mode,
+                                  const char * header,
+                                  uint32_t bufferBytes,
+                                  uint32_t flushBytes,
+                                  uint32_t flushMsec,
+                                  Print * display)
+{
+    BaseType_t status;
+    bool success;
+
+    // Only one file at a time
+    end();
+
+    // Validate the thresholds
+    if ((bufferBytes == 0) || (flushBytes == 0) || (flushBytes > bufferBytes))
+    {
+        if (display)
+            display->printf("ERROR: Invalid file writer buffer sizes!\r\n");
+        return false;
+    }
+
+    // Get the mutex that serializes the file writes
+    if (!mutexCreate())
+    {
+        if (display)
+            display->printf("ERROR: Failed to allocate the file writer mutex!\r\n");
+        return false;
+    }
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+
+    success = false;
+    do
+    {
+        // Allocate the ring buffer
+        _buffer = (uint8_t *)r4aMalloc(bufferBytes, "File writer buffer (_buffer)");
+        if (!_buffer)
+        {
+            if (display)
+                display->printf("ERROR: Failed to allocate the file writer buffer!\r\n");
+            break;
+        }
+
+        // Open the file
+        _file = LittleFS.open(path, mode, true);
+        if (!_file)
+        {
+            if (display)
+                display->printf("ERROR: Failed to open file %s!\r\n", path);
+            break;
+        }
+
+        // Initialize the writer
+        _bufferBytes = bufferBytes;
+        _bufferedBytes = 0;
+        _bytesDropped = 0;
+        _bytesWritten = 0;
+        _flushBytes = flushBytes;
+        _flushCount = 0;
+        _flushMsec = flushMsec;
+        _flushRequested = false;
+        _head = 0;
+        _lastFlushMsec = millis();
+        _maxBufferedBytes = 0;
+        _path = String(path);
+        _recordsDropped = 0;
+        _recordsQueued = 0;
+        _stop = false;
+        _tail = 0;
+
+        // Write the header when the file is empty
+        if (header && (_file.size() == 0)
+            && (!r4aEsp32NvmWriteFileString(_file, header, strlen(header))))
+        {
+            if (display)
+                display->printf("ERROR: Failed to write the header to file %s\r\n", path);
+            break;
+        }
+        success = true;
+    } while (0);
+
+    // Release the resources upon failure
+    if (!success)
+        release();
+    xSemaphoreGive(_mutex);
+    if (!success)
+        return false;
+
+    // Start the flush task
+    status = xTaskCreate(flushTask,
+                         "File writer",
+                         R4A_ESP32_FILE_WRITER_STACK_BYTES,
+                         this,
+                         R4A_ESP32_FILE_WRITER_PRIORITY,
+                         (TaskHandle_t *)&_task);
+    if (status != pdPASS)
+    {
+        _task = nullptr;
+        if (display)
+            display->printf("ERROR: Failed to create the file writer task!\r\n");
+        end();
+        return false;
+    }
+
+    // The writer is ready for use
+    return true;
+}
+
+//*********************************************************************
+// Close the writers using the file before the file is removed, renamed
+// or replaced
+void R4A_ESP32_FILE_WRITER::closeFile(const char * path)
+{
+    R4A_ESP32_FILE_WRITER * writer;
+
+    do
+    {
+        // Locate an open writer for the file
+        portENTER_CRITICAL(&r4aEsp32FileWritersLock);
+        for (writer = r4aEsp32FileWriters; writer; writer = writer->_next)
+            if (writer->isOpen() && (strcmp(writer->_path.c_str(), path) == 0))
+                break;
+        portEXIT_CRITICAL(&r4aEsp32FileWritersLock);
+
+        // Write the buffered data and close the file
+        if (writer)
+            writer->end();
+    } while (writer);
+}
+
+//*********************************************************************
+// Display the writer statistics
+void R4A_ESP32_FILE_WRITER::displayStats(Print * display)
+{
+    display->printf("File writer: %s\r\n", isOpen() ? path() : "Not open");
+    display->printf("    %10lu  Records queued\r\n", _recordsQueued);
+    display->printf("    %10lu  Records dropped\r\n", _recordsDropped);
+    display->printf("    %10lu  Bytes dropped\r\n", _bytesDropped);
+    display->printf("    %10lu  Bytes written\r\n", _bytesWritten);
+    display->printf("    %10lu  Flushes\r\n", _flushCount);
+    display->printf("    %10lu / %lu  Bytes buffered\r\n", _bufferedBytes, _bufferBytes);
+    display->printf("    %10lu  Maximum bytes buffered\r\n", _maxBufferedBytes);
+}
+
+//*********************************************************************
+// Stop the flush task, write the buffered data and close the file
+void R4A_ESP32_FILE_WRITER::end()
+{
+    // Stop the flush task
+    if (_task)
+    {
+        _stop = true;
+        xTaskNotifyGive(_task);
+        while (_task)
+            delay(1);
+    }
+
+    // The mutex exists once begin was called, hold it while closing the
+    // file since another task may be flushing the buffer
+    if (_mutex)
+    {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        release();
+        xSemaphoreGive(_mutex);
+    }
+}
+
+//*********************************************************************
+// Write the buffered data to the file
+void R4A_ESP32_FILE_WRITER::flush()
+{
+    flushBuffer();
+}
+
+//*********************************************************************
+// Request the flush task to write the buffered data to the file
+void R4A_ESP32_FILE_WRITER::flushAsync()
+{
+    TaskHandle_t task;
+
+    task = _task;
+    if (task)
+    {
+        _flushRequested = true;
+        xTaskNotifyGive(task);
+    }
+}
+
+//*********************************************************************
+// Write the buffered data to the file
+bool R4A_ESP32_FILE_WRITER::flushBuffer()
+{
+    bool success;
+
+    // The writer was never opened
+    if (!_mutex)
+        return true;
+
+    // Only one writer to the file at a time, the file may have been
+    // closed by another task
+    success = true;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_file && _buffer)
+        success = writeBuffer();
+    xSemaphoreGive(_mutex);
+    return success;
+}
+
+//*********************************************************************
+// Write the buffered data to the file when a threshold is reached
+void R4A_ESP32_FILE_WRITER::flushTask(void * parameter)
+{
+    uint32_t bufferedBytes;
+    bool flushRequested;
+    R4A_ESP32_FILE_WRITER * writer;
+
+    writer = (R4A_ESP32_FILE_WRITER *)parameter;
+    while (!writer->_stop)
+    {
+        // Wait for the size threshold, the time threshold or a request
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(writer->_flushMsec));
+        flushRequested = writer->_flushRequested;
+        writer->_flushRequested = false;
+
+        // Flush the buffer when a threshold is reached
+        bufferedBytes = writer->_bufferedBytes;
+        if (bufferedBytes
+            && (flushRequested
+                || (bufferedBytes >= writer->_flushBytes)
+                || ((millis() - writer->_lastFlushMsec) >= writer->_flushMsec)))
+            writer->flushBuffer();
+    }
+
+    // Let end know that the task is done
+    writer->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+//*********************************************************************
+// Determine if the file is open
+bool R4A_ESP32_FILE_WRITER::isOpen()
+{
+    return (_buffer != nullptr) && _file;
+}
+
+//*********************************************************************
+// Create the mutex on first use
+bool R4A_ESP32_FILE_WRITER::mutexCreate()
+{
+    SemaphoreHandle_t expected;
+    SemaphoreHandle_t mutex;
+
+    if (!__atomic_load_n(&_mutex, __ATOMIC_ACQUIRE))
+    {
+        mutex = xSemaphoreCreateMutex();
+        if (!mutex)
+            return false;
+
+        // Another task may have created the mutex
+        expected = nullptr;
+        if (!__atomic_compare_exchange_n(&_mutex,
+                                         &expected,
+                                         mutex,
+                                         false,
+                                         __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE))
+            vSemaphoreDelete(mutex);
+    }
+    return true;
+}
+
+//*********************************************************************
+// Get the file path
+const char * R4A_ESP32_FILE_WRITER::path()
+{
+    return _path.c_str();
+}
+
+//*********************************************************************
+// Get the number of dropped records
+uint32_t R4A_ESP32_FILE_WRITER::recordsDropped()
+{
+    return _recordsDropped;
+}
+
+//*********************************************************************
+// Write the buffered data, close the file and free the ring buffer, the
+// caller holds the mutex
+void R4A_ESP32_FILE_WRITER::release()
+{
+    uint8_t * buffer;
+
+    // Write the remaining data to the file
+    if (_file && _buffer)
+        writeBuffer();
+
+    // Prevent further writes to the ring buffer
+    portENTER_CRITICAL(&_lock);
+    buffer = _buffer;
+    _buffer = nullptr;
+    _bufferedBytes = 0;
+    portEXIT_CRITICAL(&_lock);
+
+    // Done with the file
+    if (_file)
+        _file.close();
+
+    // Release the ring buffer
+    if (buffer)
+        r4aFree(buffer, "File writer buffer (_buffer)");
+}
+
+//*********************************************************************
+// Place a single byte record into the ring buffer
+size_t R4A_ESP32_FILE_WRITER::write(uint8_t data)
+{
+    return write(&data, 1);
+}
+
+//*********************************************************************
+// Place a record into the ring buffer, never blocks on the file
+size_t R4A_ESP32_FILE_WRITER::write(const uint8_t * buffer, size_t length)
+{
+    uint32_t bufferedBytes;
+    uint32_t bytes;
+    bool dropped;
+    TaskHandle_t task;
+
+    if (length == 0)
+        return 0;
+
+    // Copy the record into the ring buffer
+    portENTER_CRITICAL(&_lock);
+    bufferedBytes = _bufferedBytes;
+    dropped = (_buffer == nullptr) || (length > (_bufferBytes - bufferedBytes));
+    if (dropped)
+    {
+        _recordsDropped += 1;
+        _bytesDropped += length;
+    }
+    else
+    {
+        // Split the copy when the record wraps
+        bytes = _bufferBytes - _head;
+        if (bytes > length)
+            bytes = length;
+        memcpy(&_buffer[_head], buffer, bytes);
+        if (bytes < length)
+            memcpy(_buffer, &buffer[bytes], length - bytes);
+        _head += length;
+        if (_head >= _bufferBytes)
+            _head -= _bufferBytes;
+
+        // Account for the record
+        _bufferedBytes = bufferedBytes + length;
+        if (_maxBufferedBytes < _bufferedBytes)
+            _maxBufferedBytes = _bufferedBytes;
+        _recordsQueued += 1;
+    }
+    task = _task;
+    portEXIT_CRITICAL(&_lock);
+    if (dropped)
+        return 0;
+
+    // Wake the flush task when crossing the size threshold
+    if (task && (bufferedBytes < _flushBytes)
+        && ((bufferedBytes + length) >= _flushBytes))
+        xTaskNotifyGive(task);
+    return length;
+}
+
+//*********************************************************************
+// Write the buffered data to the file, the caller holds the mutex
+bool R4A_ESP32_FILE_WRITER::writeBuffer()
+{
+    uint32_t bufferedBytes;
+    uint32_t bytes;
+    uint32_t bytesWritten;
+    bool success;
+    uint32_t tail;
+    size_t written;
+
+    // Snapshot the ring buffer, producers only add data after the head
+    bytesWritten = _bytesWritten;
+    portENTER_CRITICAL(&_lock);
+    bufferedBytes = _bufferedBytes;
+    tail = _tail;
+    portEXIT_CRITICAL(&_lock);
+
+    // Write the contiguous portions of the buffer
+    success = true;
+    while (bufferedBytes)
+    {
+        bytes = _bufferBytes - tail;
+        if (bytes > bufferedBytes)
+            bytes = bufferedBytes;
+        written = _file.write(&_buffer[tail], bytes);
+        _bytesWritten += written;
+        bufferedBytes -= written;
+
+        // Release the space in the ring buffer
+        tail += written;
+        if (tail >= _bufferBytes)
+            tail = 0;
+        portENTER_CRITICAL(&_lock);
+        _tail = tail;
+        _bufferedBytes -= written;
+        portEXIT_CRITICAL(&_lock);
+
+        // Leave the data in the buffer if the write fails
+        if (written != bytes)
+        {
+            log_e("ERROR: Failed to write to file %s", _path.c_str());
+            success = false;
+            break;
+        }
+    }
+
+    // Push the data to flash
+    if (bytesWritten != _bytesWritten)
+    {
+        _file.flush();
+        _flushCount += 1;
+    }
+    _lastFlushMsec = millis();
+    return success;
+}
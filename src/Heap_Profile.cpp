@@ -0,0 +1,485 @@
+/**********************************************************************
+  Heap_Profile.cpp
+
+  Robots-For-All (R4A)
+  Account for the heap usage by the text tag passed to r4aMalloc and
+  r4aDmaMalloc
+
+  When r4aEsp32HeapProfileEnable is true, each allocation is preceded
+  by a small header holding the tag index, size and allocation time.
+  The buffer address is added to a table of live profiled buffers.
+  r4aFree and r4aDmaFree only locate the header of buffers found in the
+  table, buffers allocated while profiling was disabled are freed
+  without touching the memory preceding them.  When the table is full
+  the allocation is not profiled and is counted as untracked.
+**********************************************************************/
+
+#include "R4A_ESP32.h"
+
+//****************************************
+// Constants
+//****************************************
+
+#define R4A_ESP32_HEAP_PROFILE_BUFFERS_MAX  ((R4A_ESP32_HEAP_PROFILE_BUFFERS * 3) / 4)
+#define R4A_ESP32_HEAP_PROFILE_OTHER        R4A_ESP32_HEAP_PROFILE_TAGS
+
+//****************************************
+// Types
+//****************************************
+
+// Header preceding each profiled buffer
+typedef struct _R4A_ESP32_HEAP_PROFILE_HEADER
+{
+    uint32_t _bytes;            // Number of bytes requested
+    uint32_t _msec;             // millis() value when allocated
+    uint8_t _tagIndex;          // Index into the tag table
+    uint8_t _psram;             // Buffer is in PSRAM
+    uint16_t _reserved;
+    uint32_t _reserved2;
+} R4A_ESP32_HEAP_PROFILE_HEADER;
+
+// Heap usage for a tag
+typedef struct _R4A_ESP32_HEAP_PROFILE_TAG
+{
+    const char * _tag;          // Text passed to r4aMalloc, nullptr for other
+    uint32_t _liveBytes;        // Bytes currently allocated
+    uint32_t _liveCount;        // Buffers currently allocated
+    uint32_t _peakBytes;        // Maximum value of _liveBytes
+    uint32_t _psramBytes;       // Bytes currently allocated in PSRAM
+    uint32_t _allocations;      // Number of allocations
+    uint32_t _frees;            // Number of frees
+    uint32_t _lifetime[R4A_ESP32_HEAP_PROFILE_BUCKETS]; // Buffer lifetimes
+} R4A_ESP32_HEAP_PROFILE_TAG;
+
+//****************************************
+// Globals
+//****************************************
+
+bool r4aEsp32HeapProfileEnable;
+
+//****************************************
+// Locals
+//****************************************
+
+static volatile uint32_t r4aEsp32HeapProfileBufferCount;   // Live profiled buffers
+static void * r4aEsp32HeapProfileBuffers[R4A_ESP32_HEAP_PROFILE_BUFFERS];
+static portMUX_TYPE r4aEsp32HeapProfileLock = portMUX_INITIALIZER_UNLOCKED;
+static R4A_ESP32_HEAP_PROFILE_TAG r4aEsp32HeapProfileTags[R4A_ESP32_HEAP_PROFILE_TAGS + 1];
+static uint32_t r4aEsp32HeapProfileTagCount;
+static uint32_t r4aEsp32HeapProfileUntracked;   // Allocations not profiled, buffer table full
+
+//*********************************************************************
+// Get the buffer table index for a buffer address
+static uint32_t r4aEsp32HeapProfileBufferHash(void * buffer)
+{
+    return ((((uintptr_t)buffer) >> 3) * 2654435761u) >> 16;
+}
+
+//*********************************************************************
+// Add a profiled buffer to the buffer table, must be called with the
+// lock held.  Returns false when the table is full.
+static bool r4aEsp32HeapProfileBufferAdd(void * buffer)
+{
+    uint32_t index;
+
+    if (r4aEsp32HeapProfileBufferCount >= R4A_ESP32_HEAP_PROFILE_BUFFERS_MAX)
+        return false;
+    index = r4aEsp32HeapProfileBufferHash(buffer);
+    while (r4aEsp32HeapProfileBuffers[index & (R4A_ESP32_HEAP_PROFILE_BUFFERS - 1)])
+        index += 1;
+    r4aEsp32HeapProfileBuffers[index & (R4A_ESP32_HEAP_PROFILE_BUFFERS - 1)] = buffer;
+    r4aEsp32HeapProfileBufferCount += 1;
+    return true;
+}
+
+//*********************************************************************
+// Remove a buffer from the buffer table, must be called with the lock
+// held.  Returns true when the buffer was profiled.
+static bool r4aEsp32HeapProfileBufferRemove(void * buffer)
+{
+    uint32_t empty;
+    uint32_t home;
+    uint32_t index;
+    const uint32_t mask = R4A_ESP32_HEAP_PROFILE_BUFFERS - 1;
+
+    // Locate the buffer
+    index = r4aEsp32HeapProfileBufferHash(buffer);
+    while (r4aEsp32HeapProfileBuffers[index & mask] != buffer)
+    {
+        if (r4aEsp32HeapProfileBuffers[index & mask] == nullptr)
+            return false;
+        index += 1;
+    }
+
+    // Remove the buffer and move the following entries of the probe
+    // sequence back into the hole, no tombstones are needed
+    empty = index & mask;
+    r4aEsp32HeapProfileBuffers[empty] = nullptr;
+    r4aEsp32HeapProfileBufferCount -= 1;
+    for (index = (empty + 1) & mask;
+         r4aEsp32HeapProfileBuffers[index];
+         index = (index + 1) & mask)
+    {
+        // Move the entry when the hole is between its home and its slot
+        home = r4aEsp32HeapProfileBufferHash(r4aEsp32HeapProfileBuffers[index]) & mask;
+        if (((index - home) & mask) >= ((index - empty) & mask))
+        {
+            r4aEsp32HeapProfileBuffers[empty] = r4aEsp32HeapProfileBuffers[index];
+            r4aEsp32HeapProfileBuffers[index] = nullptr;
+            empty = index;
+        }
+    }
+    return true;
+}
+
+//*********************************************************************
+// Locate or add the tag, must be called with the lock held
+static uint8_t r4aEsp32HeapProfileTagIndex(const char * text)
+{
+    uint32_t index;
+    uint32_t probes;
+
+    // Hash the tag address, string literals have a fixed address
+    index = (((uintptr_t)text) * 2654435761u) >> 16;
+    for (probes = 0; probes < R4A_ESP32_HEAP_PROFILE_TAGS; probes++)
+    {
+        index &= R4A_ESP32_HEAP_PROFILE_TAGS - 1;
+        if (r4aEsp32HeapProfileTags[index]._tag == text)
+            return index;
+        if (r4aEsp32HeapProfileTags[index]._tag == nullptr)
+        {
+            r4aEsp32HeapProfileTags[index]._tag = text;
+            r4aEsp32HeapProfileTagCount += 1;
+            return index;
+        }
+        index += 1;
+    }
+
+    // The table is full
+    return R4A_ESP32_HEAP_PROFILE_OTHER;
+}
+
+//*********************************************************************
+// Account for an allocation and return the buffer following the header
+void * r4aEsp32HeapProfileAlloc(void * block,
+                                size_t numberOfBytes,
+                                const char * text)
+{
+    uint8_t * buffer;
+    R4A_ESP32_HEAP_PROFILE_HEADER * header;
+    R4A_ESP32_HEAP_PROFILE_TAG * tag;
+
+    // Fill in the header
+    header = (R4A_ESP32_HEAP_PROFILE_HEADER *)block;
+    buffer = (uint8_t *)(header + 1);
+    header->_bytes = numberOfBytes;
+    header->_msec = millis();
+    header->_psram = r4aEsp32IsAddressInPSRAM(block);
+    header->_reserved = 0;
+    header->_reserved2 = 0;
+
+    // Remember the profiled buffer, don't profile the buffer when the
+    // table is full
+    portENTER_CRITICAL(&r4aEsp32HeapProfileLock);
+    if (!r4aEsp32HeapProfileBufferAdd(buffer))
+    {
+        r4aEsp32HeapProfileUntracked += 1;
+        portEXIT_CRITICAL(&r4aEsp32HeapProfileLock);
+        return block;
+    }
+
+    // Update the tag statistics
+    header->_tagIndex = r4aEsp32HeapProfileTagIndex(text);
+    tag = &r4aEsp32HeapProfileTags[header->_tagIndex];
+    tag->_allocations += 1;
+    tag->_liveCount += 1;
+    tag->_liveBytes += numberOfBytes;
+    if (header->_psram)
+        tag->_psramBytes += numberOfBytes;
+    if (tag->_peakBytes < tag->_liveBytes)
+        tag->_peakBytes = tag->_liveBytes;
+    portEXIT_CRITICAL(&r4aEsp32HeapProfileLock);
+    return buffer;
+}
+
+//*********************************************************************
+// Account for a free and return the address of the block to free
+void * r4aEsp32HeapProfileFree(void * buffer)
+{
+    int bucket;
+    R4A_ESP32_HEAP_PROFILE_HEADER * header;
+    uint32_t limit;
+    uint32_t msec;
+    R4A_ESP32_HEAP_PROFILE_TAG * tag;
+
+    // Only the buffers in the buffer table have a profile header
+    if ((!r4aEsp32HeapProfileBufferCount) || (!buffer))
+        return buffer;
+    msec = millis();
+    portENTER_CRITICAL(&r4aEsp32HeapProfileLock);
+    if (!r4aEsp32HeapProfileBufferRemove(buffer))
+    {
+        portEXIT_CRITICAL(&r4aEsp32HeapProfileLock);
+        return buffer;
+    }
+    header = ((R4A_ESP32_HEAP_PROFILE_HEADER *)buffer) - 1;
+
+    // Determine the lifetime bucket, each bucket is 4 times longer
+    msec -= header->_msec;
+    limit = 1;
+    for (bucket = 0; (bucket < (R4A_ESP32_HEAP_PROFILE_BUCKETS - 1)) && (msec >= limit); bucket++)
+        limit <<= 2;
+
+    // Update the tag statistics
+    tag = &r4aEsp32HeapProfileTags[header->_tagIndex];
+    tag->_frees += 1;
+    tag->_liveCount -= 1;
+    tag->_liveBytes -= header->_bytes;
+    if (header->_psram)
+        tag->_psramBytes -= header->_bytes;
+    tag->_lifetime[bucket] += 1;
+    portEXIT_CRITICAL(&r4aEsp32HeapProfileLock);
+    return header;
+}
+
+//*********************************************************************
+// Get a consistent copy of the tag statistics
+static void r4aEsp32HeapProfileGet(int index, R4A_ESP32_HEAP_PROFILE_TAG * tag)
+{
+    portENTER_CRITICAL(&r4aEsp32HeapProfileLock);
+    memcpy(tag, &r4aEsp32HeapProfileTags[index], sizeof(*tag));
+    portEXIT_CRITICAL(&r4aEsp32HeapProfileLock);
+}
+
+//*********************************************************************
+// Sort the tags by live bytes, largest first
+static int r4aEsp32HeapProfileSort(uint8_t * order)
+{
+    int count;
+    int index;
+    int slot;
+
+    count = 0;
+    for (index = 0; index <= R4A_ESP32_HEAP_PROFILE_TAGS; index++)
+    {
+        // Skip the unused entries
+        if (r4aEsp32HeapProfileTags[index]._allocations == 0)
+            continue;
+
+        // Insert the entry
+        for (slot = count; slot > 0; slot--)
+        {
+            if (r4aEsp32HeapProfileTags[order[slot - 1]]._liveBytes
+                >= r4aEsp32HeapProfileTags[index]._liveBytes)
+                break;
+            order[slot] = order[slot - 1];
+        }
+        order[slot] = index;
+        count += 1;
+    }
+    return count;
+}
+
+//*********************************************************************
+// Format a tag as a JSON object
+static size_t r4aEsp32HeapProfileJson(char * buffer,
+                                      R4A_ESP32_HEAP_PROFILE_TAG * tag,
+                                      bool first)
+{
+    int bucket;
+    size_t length;
+    const char * text;
+
+    // Add the tag, replace the characters needing an escape
+    length = sprintf(buffer, "%s{\"tag\":\"", first ? "" : ",");
+    text = tag->_tag ? tag->_tag : "Other";
+    while (*text && (length < R4A_ESP32_HEAP_PROFILE_TAG_LENGTH))
+    {
+        buffer[length++] = ((*text == '"') || (*text == '\\') || ((uint8_t)*text < ' '))
+                         ? '?' : *text;
+        text += 1;
+    }
+
+    // Add the statistics
+    length += sprintf(&buffer[length],
+                      "\",\"liveBytes\":%lu,\"liveCount\":%lu,\"peakBytes\":%lu,"
+                      "\"psramBytes\":%lu,\"allocations\":%lu,\"frees\":%lu,\"lifetime\":[",
+                      tag->_liveBytes,
+                      tag->_liveCount,
+                      tag->_peakBytes,
+                      tag->_psramBytes,
+                      tag->_allocations,
+                      tag->_frees);
+    for (bucket = 0; bucket < R4A_ESP32_HEAP_PROFILE_BUCKETS; bucket++)
+        length += sprintf(&buffer[length], "%s%lu", bucket ? "," : "", tag->_lifetime[bucket]);
+    length += sprintf(&buffer[length], "]}");
+    return length;
+}
+
+//*********************************************************************
+// Display the tags using the most heap
+void r4aEsp32HeapProfileDisplay(int count, Print * display)
+{
+    int index;
+    uint8_t order[R4A_ESP32_HEAP_PROFILE_TAGS + 1];
+    R4A_ESP32_HEAP_PROFILE_TAG tag;
+    int tags;
+
+    if (count <= 0)
+        count = R4A_ESP32_HEAP_PROFILE_TAGS + 1;
+    display->printf("Heap profile: %s, %lu tags, %lu buffers, %lu untracked\r\n",
+                    r4aEsp32HeapProfileEnable ? "Enabled" : "Disabled",
+                    r4aEsp32HeapProfileTagCount,
+                    r4aEsp32HeapProfileBufferCount,
+                    r4aEsp32HeapProfileUntracked);
+    tags = r4aEsp32HeapProfileSort(order);
+    if (tags == 0)
+        return;
+
+    // Display the top consumers
+    display->printf("    Live Bytes  Peak Bytes  PSRAM Bytes   Live  Allocations    Frees  Tag\r\n");
+    for (index = 0; (index < tags) && (index < count); index++)
+    {
+        r4aEsp32HeapProfileGet(order[index], &tag);
+        display->printf("    %10lu  %10lu  %11lu  %5lu  %11lu  %7lu  %s\r\n",
+                        tag._liveBytes,
+                        tag._peakBytes,
+                        tag._psramBytes,
+                        tag._liveCount,
+                        tag._allocations,
+                        tag._frees,
+                        tag._tag ? tag._tag : "Other");
+    }
+    if (tags > count)
+        display->printf("    %d more tags\r\n", tags - count);
+}
+
+//*********************************************************************
+// Dump the tags using the most heap as JSON
+void r4aEsp32HeapProfileDump(int count, Print * display)
+{
+    char buffer[R4A_ESP32_HEAP_PROFILE_JSON_BYTES];
+    int index;
+    uint8_t order[R4A_ESP32_HEAP_PROFILE_TAGS + 1];
+    R4A_ESP32_HEAP_PROFILE_TAG tag;
+    int tags;
+
+    if (count <= 0)
+        count = R4A_ESP32_HEAP_PROFILE_TAGS + 1;
+    display->printf("{\"enabled\":%s,\"untracked\":%lu,\"bucketMsec\":\"4^n\",\"tags\":[",
+                    r4aEsp32HeapProfileEnable ? "true" : "false",
+                    r4aEsp32HeapProfileUntracked);
+    tags = r4aEsp32HeapProfileSort(order);
+    for (index = 0; (index < tags) && (index < count); index++)
+    {
+        r4aEsp32HeapProfileGet(order[index], &tag);
+        r4aEsp32HeapProfileJson(buffer, &tag, index == 0);
+        display->print(buffer);
+    }
+    display->printf("]}\r\n");
+}
+
+//*********************************************************************
+// Send the tags using the most heap as JSON, the optional top=N query
+// parameter selects the number of tags
+esp_err_t r4aEsp32HeapProfileHandler(httpd_req_t * request)
+{
+    char buffer[R4A_ESP32_HEAP_PROFILE_JSON_BYTES];
+    int count;
+    int index;
+    size_t length;
+    uint8_t order[R4A_ESP32_HEAP_PROFILE_TAGS + 1];
+    char query[32];
+    esp_err_t status;
+    R4A_ESP32_HEAP_PROFILE_TAG tag;
+    int tags;
+    char value[8];
+
+    // Get the number of tags
+    count = R4A_ESP32_HEAP_PROFILE_TAGS + 1;
+    if ((httpd_req_get_url_query_str(request, query, sizeof(query)) == ESP_OK)
+        && (httpd_query_key_value(query, "top", value, sizeof(value)) == ESP_OK))
+        count = atoi(value);
+    if (count <= 0)
+        count = R4A_ESP32_HEAP_PROFILE_TAGS + 1;
+
+    // Start the JSON object
+    httpd_resp_set_type(request, "application/json");
+    length = sprintf(buffer, "{\"enabled\":%s,\"untracked\":%lu,\"bucketMsec\":\"4^n\",\"tags\":[",
+                     r4aEsp32HeapProfileEnable ? "true" : "false",
+                     r4aEsp32HeapProfileUntracked);
+    status = httpd_resp_send_chunk(request, buffer, length);
+
+    // Send the top consumers
+    tags = r4aEsp32HeapProfileSort(order);
+    for (index = 0; (status == ESP_OK) && (index < tags) && (index < count); index++)
+    {
+        r4aEsp32HeapProfileGet(order[index], &tag);
+        length = r4aEsp32HeapProfileJson(buffer, &tag, index == 0);
+        status = httpd_resp_send_chunk(request, buffer, length);
+    }
+
+    // Finish the JSON object
+    if (status == ESP_OK)
+        status = httpd_resp_send_chunk(request, "]}\n", 3);
+    if (status == ESP_OK)
+        status = httpd_resp_send_chunk(request, NULL, 0);
+    return status;
+}
+
+//*********************************************************************
+// Display the tags using the most heap
+void r4aEsp32HeapProfileMenuDisplay(const struct _R4A_MENU_ENTRY * menuEntry,
+                                    const char * command,
+                                    Print * display)
+{
+    r4aEsp32HeapProfileDisplay(menuEntry->menuParameter, display);
+}
+
+//*********************************************************************
+// Dump the tags using the most heap as JSON
+void r4aEsp32HeapProfileMenuDump(const struct _R4A_MENU_ENTRY * menuEntry,
+                                 const char * command,
+                                 Print * display)
+{
+    r4aEsp32HeapProfileDump(menuEntry->menuParameter, display);
+}
+
+//*********************************************************************
+// Reset the peaks and counters
+void r4aEsp32HeapProfileMenuReset(const struct _R4A_MENU_ENTRY * menuEntry,
+                                  const char * command,
+                                  Print * display)
+{
+    r4aEsp32HeapProfileReset();
+}
+
+//*********************************************************************
+// Toggle the heap profiling
+void r4aEsp32HeapProfileMenuToggle(const struct _R4A_MENU_ENTRY * menuEntry,
+                                   const char * command,
+                                   Print * display)
+{
+    r4aEsp32HeapProfileEnable = !r4aEsp32HeapProfileEnable;
+    display->printf("Heap profiling %s\r\n",
+                    r4aEsp32HeapProfileEnable ? "enabled" : "disabled");
+}
+
+//*********************************************************************
+// Reset the peaks and counters, the live values are kept
+void r4aEsp32HeapProfileReset()
+{
+    int index;
+    R4A_ESP32_HEAP_PROFILE_TAG * tag;
+
+    portENTER_CRITICAL(&r4aEsp32HeapProfileLock);
+    for (index = 0; index <= R4A_ESP32_HEAP_PROFILE_TAGS; index++)
+    {
+        tag = &r4aEsp32HeapProfileTags[index];
+        tag->_peakBytes = tag->_liveBytes;
+        tag->_allocations = tag->_liveCount;
+        tag->_frees = 0;
+        memset(tag->_lifetime, 0, sizeof(tag->_lifetime));
+    }
+    portEXIT_CRITICAL(&r4aEsp32HeapProfileLock);
+}
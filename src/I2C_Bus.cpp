@@ -7,8 +7,38 @@
 
 #include "R4A_ESP32.h"
 
+#define I2C_PROBE_TIMEOUT_MSEC          5
 #define I2C_TIMEOUT_MSEC                500
 
+// Protect the transaction statistics
+static portMUX_TYPE r4aEsp32I2cStatsLock = portMUX_INITIALIZER_UNLOCKED;
+
+//*********************************************************************
+// Record the I2C transaction in the bus statistics
+static void r4aEsp32I2cBusRecord(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                                 R4A_I2C_ADDRESS_t i2cAddress,
+                                 size_t bytes,
+                                 esp_err_t status,
+                                 int64_t startUsec)
+{
+    uint32_t usec;
+
+    usec = esp_timer_get_time() - startUsec;
+    portENTER_CRITICAL(&r4aEsp32I2cStatsLock);
+    r4aEsp32I2cStatsRecord(&esp32I2cBus->_stats, i2cAddress, bytes, status, usec);
+    portEXIT_CRITICAL(&r4aEsp32I2cStatsLock);
+
+    // The device did not respond, report it missing until the bus is
+    // scanned again
+    if ((status == ESP_FAIL) || (status == ESP_ERR_INVALID_STATE) || (status == ESP_ERR_TIMEOUT))
+    {
+        i2cAddress &= 0x7f;
+        __atomic_fetch_and(&esp32I2cBus->_present[i2cAddress >> 5],
+                           ~(1 << (i2cAddress & 31)),
+                           __ATOMIC_RELAXED);
+    }
+}
+
 //*********************************************************************
 // Initialize the I2C bus
 bool r4aEsp32I2cBusBegin(R4A_ESP32_I2C_BUS * esp32I2cBus,
@@ -41,6 +71,9 @@ bool r4aEsp32I2cBusBegin(R4A_ESP32_I2C_BUS * esp32I2cBus,
             break;
         }
 
+        // Scan the bus again on the next presence check
+        esp32I2cBus->_presentValid = false;
+
         // Enumerate the I2C devices
         if (enumerate)
         {
@@ -53,25 +86,26 @@ bool r4aEsp32I2cBusBegin(R4A_ESP32_I2C_BUS * esp32I2cBus,
 }
 
 //*********************************************************************
-// Ping an I2C device and see if it responds
+// Determine if an I2C device is present
 // Return true if device detected, false otherwise
 bool r4aI2cBusEnumerateDevice(R4A_I2C_BUS * i2cBus, R4A_I2C_ADDRESS_t i2cAddress)
 {
     R4A_ESP32_I2C_BUS  * esp32I2cBus;
-    esp_err_t status;
 
     // Get access to the ESP32 specific data
     esp32I2cBus = (R4A_ESP32_I2C_BUS *)i2cBus;
 
-    // Check for an I2C device
-    status = i2cWrite(esp32I2cBus->_busNumber,
-                      i2cAddress,
-                      nullptr,
-                      0,
-                      I2C_TIMEOUT_MSEC);
-
-    // Return the I2C device found status
-    return (status == ESP_OK);
+    // The reserved addresses are never probed
+    if ((i2cAddress < R4A_ESP32_I2C_FIRST_ADDRESS) || (i2cAddress > R4A_ESP32_I2C_LAST_ADDRESS))
+        return false;
+
+    // Scan the bus once and then again after the refresh interval, a
+    // missing device may have been added or may have failed to respond
+    // to a previous transaction.  Otherwise answer from the presence map.
+    if ((!esp32I2cBus->_presentValid)
+        || ((millis() - esp32I2cBus->_refreshMsec) >= R4A_ESP32_I2C_REFRESH_MSEC))
+        r4aEsp32I2cRefresh(esp32I2cBus);
+    return (esp32I2cBus->_present[i2cAddress >> 5] >> (i2cAddress & 31)) & 1;
 }
 
 //*********************************************************************
@@ -85,6 +119,7 @@ bool r4aI2cBusRead(R4A_I2C_BUS * i2cBus,
 {
     size_t bytesRead;
     R4A_ESP32_I2C_BUS  * esp32I2cBus;
+    int64_t startUsec;
     esp_err_t status;
 
     do
@@ -96,12 +131,19 @@ bool r4aI2cBusRead(R4A_I2C_BUS * i2cBus,
         bytesRead = 0;
 
         // Read the data from the I2C device into the I2C RX buffer
+        startUsec = esp_timer_get_time();
         status = i2cRead(esp32I2cBus->_busNumber,
                          i2cAddress,
                          readBuffer,
                          readByteCount,
                          I2C_TIMEOUT_MSEC,
                          &bytesRead);
+        r4aEsp32I2cBusRecord(esp32I2cBus,
+                             i2cAddress,
+                             bytesRead,
+                             ((status == ESP_OK) && (bytesRead != readByteCount))
+                             ? ESP_ERR_INVALID_SIZE : status,
+                             startUsec);
 
         // Display the I2C transaction results
         if (display)
@@ -129,6 +171,7 @@ bool r4aI2cBusWrite(R4A_I2C_BUS * i2cBus,
 {
     size_t bytesWritten;
     R4A_ESP32_I2C_BUS  * esp32I2cBus;
+    int64_t startUsec;
     esp_err_t status;
 
     do
@@ -155,11 +198,15 @@ bool r4aI2cBusWrite(R4A_I2C_BUS * i2cBus,
         // Send the data to the device
 
         if (dataByteCount)
+        {
+            startUsec = esp_timer_get_time();
             status = i2cWrite(esp32I2cBus->_busNumber,
                               i2cAddress,
                               dataBuffer,
                               dataByteCount,
                               I2C_TIMEOUT_MSEC);
+            r4aEsp32I2cBusRecord(esp32I2cBus, i2cAddress, dataByteCount, status, startUsec);
+        }
 
     } while (0);
 
@@ -185,6 +232,7 @@ bool r4aI2cBusWriteRead(R4A_I2C_BUS * i2cBus,
 {
     size_t bytesRead;
     R4A_ESP32_I2C_BUS  * esp32I2cBus;
+    int64_t startUsec;
     esp_err_t status;
 
     do
@@ -196,6 +244,7 @@ bool r4aI2cBusWriteRead(R4A_I2C_BUS * i2cBus,
         bytesRead = 0;
 
         // Read the data from the I2C device into the I2C RX buffer
+        startUsec = esp_timer_get_time();
         status = i2cWriteReadNonStop(esp32I2cBus->_busNumber,
                          i2cAddress,
                          dataBuffer,
@@ -204,6 +253,12 @@ bool r4aI2cBusWriteRead(R4A_I2C_BUS * i2cBus,
                          readByteCount,
                          I2C_TIMEOUT_MSEC,
                          &bytesRead);
+        r4aEsp32I2cBusRecord(esp32I2cBus,
+                             i2cAddress,
+                             dataByteCount + bytesRead,
+                             ((status == ESP_OK) && (bytesRead != readByteCount))
+                             ? ESP_ERR_INVALID_SIZE : status,
+                             startUsec);
 
         // Display the I2C transaction results
         if (display)
@@ -219,3 +274,201 @@ bool r4aI2cBusWriteRead(R4A_I2C_BUS * i2cBus,
         *bytesReadAddr = bytesRead;
     return (status == ESP_OK) && (bytesRead == readByteCount);
 }
+
+//*********************************************************************
+// Probe the I2C bus and update the cached device presence map
+void r4aEsp32I2cMenuRefresh(const struct _R4A_MENU_ENTRY * menuEntry,
+                            const char * command,
+                            Print * display)
+{
+    int devices;
+    int64_t startUsec;
+
+    startUsec = esp_timer_get_time();
+    devices = r4aEsp32I2cRefresh((R4A_ESP32_I2C_BUS *)menuEntry->menuParameter);
+    display->printf("%d I2C devices found in %lld uSec\r\n",
+                    devices,
+                    esp_timer_get_time() - startUsec);
+}
+
+//*********************************************************************
+// Display the I2C transaction statistics
+void r4aEsp32I2cMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                          const char * command,
+                          Print * display)
+{
+    r4aEsp32I2cStatsDisplay((R4A_ESP32_I2C_BUS *)menuEntry->menuParameter, display);
+}
+
+//*********************************************************************
+// Clear the I2C transaction statistics
+void r4aEsp32I2cMenuStatsClear(const struct _R4A_MENU_ENTRY * menuEntry,
+                               const char * command,
+                               Print * display)
+{
+    r4aEsp32I2cStatsClear((R4A_ESP32_I2C_BUS *)menuEntry->menuParameter);
+}
+
+//*********************************************************************
+// Dump the I2C transaction statistics in JSON format
+void r4aEsp32I2cMenuStatsDump(const struct _R4A_MENU_ENTRY * menuEntry,
+                              const char * command,
+                              Print * display)
+{
+    r4aEsp32I2cStatsDump((R4A_ESP32_I2C_BUS *)menuEntry->menuParameter, display);
+}
+
+//*********************************************************************
+// Probe an I2C device using a short timeout and update the presence map
+bool r4aEsp32I2cProbe(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                      R4A_I2C_ADDRESS_t i2cAddress)
+{
+    uint32_t mask;
+    bool present;
+
+    // Check for an I2C device
+    i2cAddress &= 0x7f;
+    present = (i2cWrite(esp32I2cBus->_busNumber,
+                        i2cAddress,
+                        nullptr,
+                        0,
+                        I2C_PROBE_TIMEOUT_MSEC) == ESP_OK);
+
+    // Update the presence map
+    mask = 1 << (i2cAddress & 31);
+    if (present)
+        __atomic_fetch_or(&esp32I2cBus->_present[i2cAddress >> 5], mask, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_and(&esp32I2cBus->_present[i2cAddress >> 5], ~mask, __ATOMIC_RELAXED);
+    return present;
+}
+
+//*********************************************************************
+// Probe a range of I2C addresses and update the presence map
+int r4aEsp32I2cRefresh(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                       R4A_I2C_ADDRESS_t firstAddress,
+                       R4A_I2C_ADDRESS_t lastAddress)
+{
+    int devices;
+    int i2cAddress;
+
+    devices = 0;
+    if (firstAddress < R4A_ESP32_I2C_FIRST_ADDRESS)
+        firstAddress = R4A_ESP32_I2C_FIRST_ADDRESS;
+    for (i2cAddress = firstAddress;
+         (i2cAddress <= lastAddress) && (i2cAddress <= R4A_ESP32_I2C_LAST_ADDRESS);
+         i2cAddress++)
+        if (r4aEsp32I2cProbe(esp32I2cBus, i2cAddress))
+            devices += 1;
+
+    // The presence map is valid after scanning the entire bus
+    if ((firstAddress == R4A_ESP32_I2C_FIRST_ADDRESS) && (lastAddress >= R4A_ESP32_I2C_LAST_ADDRESS))
+    {
+        esp32I2cBus->_refreshMsec = millis();
+        esp32I2cBus->_presentValid = true;
+    }
+    return devices;
+}
+
+//*********************************************************************
+// Clear the I2C transaction statistics
+void r4aEsp32I2cStatsClear(R4A_ESP32_I2C_BUS * esp32I2cBus)
+{
+    portENTER_CRITICAL(&r4aEsp32I2cStatsLock);
+    memset(&esp32I2cBus->_stats, 0, sizeof(esp32I2cBus->_stats));
+    portEXIT_CRITICAL(&r4aEsp32I2cStatsLock);
+}
+
+//*********************************************************************
+// Get a consistent copy of the statistics for a device
+static bool r4aEsp32I2cStatsGet(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                                uint8_t index,
+                                R4A_ESP32_I2C_DEVICE_STATS * deviceStats)
+{
+    bool valid;
+
+    portENTER_CRITICAL(&r4aEsp32I2cStatsLock);
+    valid = (index < esp32I2cBus->_stats._devices);
+    if (valid)
+        *deviceStats = esp32I2cBus->_stats._device[index];
+    portEXIT_CRITICAL(&r4aEsp32I2cStatsLock);
+    return valid;
+}
+
+//*********************************************************************
+// Display the I2C transaction statistics
+void r4aEsp32I2cStatsDisplay(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                             Print * display)
+{
+    int bucket;
+    R4A_ESP32_I2C_DEVICE_STATS deviceStats;
+    uint8_t index;
+
+    display->printf("I2C bus %d statistics\r\n", esp32I2cBus->_busNumber);
+    if (esp32I2cBus->_stats._dropped)
+        display->printf("    %lu transactions not recorded, device table full\r\n",
+                        esp32I2cBus->_stats._dropped);
+    display->printf("    Address  Transactions       Bytes   NAKs  Timeouts  Errors  Avg uSec  P50 uSec  P99 uSec  Max uSec\r\n");
+    for (index = 0; r4aEsp32I2cStatsGet(esp32I2cBus, index, &deviceStats); index++)
+    {
+        display->printf("       0x%02x  %12lu  %10lu  %5lu  %8lu  %6lu  %8lu  %8lu  %8lu  %8lu\r\n",
+                        deviceStats._i2cAddress,
+                        deviceStats._transactions,
+                        deviceStats._bytes,
+                        deviceStats._naks,
+                        deviceStats._timeouts,
+                        deviceStats._errors,
+                        deviceStats._transactions
+                            ? (uint32_t)(deviceStats._totalUsec / deviceStats._transactions) : 0,
+                        r4aEsp32I2cStatsPercentile(&deviceStats, 50),
+                        r4aEsp32I2cStatsPercentile(&deviceStats, 99),
+                        deviceStats._maxUsec);
+
+        // Display the latency histogram
+        display->printf("             ");
+        for (bucket = 0; bucket < R4A_ESP32_I2C_HISTOGRAM_BUCKETS; bucket++)
+            if (deviceStats._histogram[bucket])
+                display->printf(" %s%lu:%lu",
+                                (bucket == (R4A_ESP32_I2C_HISTOGRAM_BUCKETS - 1)) ? ">=" : "<",
+                                (bucket == (R4A_ESP32_I2C_HISTOGRAM_BUCKETS - 1))
+                                    ? (uint32_t)(32 << (bucket - 1)) : (uint32_t)(32 << bucket),
+                                deviceStats._histogram[bucket]);
+        display->printf(" uSec\r\n");
+    }
+}
+
+//*********************************************************************
+// Dump the I2C transaction statistics in JSON format
+void r4aEsp32I2cStatsDump(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                          Print * display)
+{
+    int bucket;
+    R4A_ESP32_I2C_DEVICE_STATS deviceStats;
+    uint8_t index;
+
+    display->printf("{\"bus\":%d,\"dropped\":%lu,\"bucketUsec\":32,\"devices\":[",
+                    esp32I2cBus->_busNumber,
+                    esp32I2cBus->_stats._dropped);
+    for (index = 0; r4aEsp32I2cStatsGet(esp32I2cBus, index, &deviceStats); index++)
+    {
+        display->printf("%s{\"address\":%d,\"transactions\":%lu,\"bytes\":%lu,"
+                        "\"naks\":%lu,\"timeouts\":%lu,\"errors\":%lu,"
+                        "\"totalUsec\":%llu,\"p50Usec\":%lu,\"p99Usec\":%lu,"
+                        "\"maxUsec\":%lu,\"histogram\":[",
+                        index ? "," : "",
+                        deviceStats._i2cAddress,
+                        deviceStats._transactions,
+                        deviceStats._bytes,
+                        deviceStats._naks,
+                        deviceStats._timeouts,
+                        deviceStats._errors,
+                        deviceStats._totalUsec,
+                        r4aEsp32I2cStatsPercentile(&deviceStats, 50),
+                        r4aEsp32I2cStatsPercentile(&deviceStats, 99),
+                        deviceStats._maxUsec);
+        for (bucket = 0; bucket < R4A_ESP32_I2C_HISTOGRAM_BUCKETS; bucket++)
+            display->printf("%s%lu", bucket ? "," : "", deviceStats._histogram[bucket]);
+        display->printf("]}");
+    }
+    display->printf("]}\r\n");
+}
@@ -0,0 +1,326 @@
+/**********************************************************************
+  I2C_Scheduler.cpp
+
+  Robots-For-All (R4A)
+  Perform periodic I2C device jobs from a task and publish the results
+**********************************************************************/
+
+#include "R4A_ESP32.h"
+
+//****************************************
+// Constants
+//****************************************
+
+#define R4A_ESP32_I2C_SCHEDULER_IDLE_MSEC       100
+#define R4A_ESP32_I2C_SCHEDULER_PRIORITY        (tskIDLE_PRIORITY + 3)
+#define R4A_ESP32_I2C_SCHEDULER_STACK_BYTES     4096
+
+//****************************************
+// Locals
+//****************************************
+
+// Protect the posted write data
+static portMUX_TYPE r4aEsp32I2cJobLock = portMUX_INITIALIZER_UNLOCKED;
+
+//*********************************************************************
+// Publish the data read from the device
+static void r4aEsp32I2cJobPublish(R4A_ESP32_I2C_JOB * job,
+                                  const uint8_t * data,
+                                  int64_t usec,
+                                  bool success)
+{
+    // Update the snapshot
+    if (success)
+    {
+        memcpy(job->_snapshot._data, data, job->_readBytes);
+        job->_snapshot._usec = usec;
+        job->_snapshot._reads += 1;
+    }
+    else
+        job->_snapshot._errors += 1;
+    job->_snapshot._failed = !success;
+
+    // Publish the snapshot
+    job->_published.publish(job->_snapshot);
+}
+
+//*********************************************************************
+// Perform the I2C transactions for a job
+static void r4aEsp32I2cJobRun(R4A_ESP32_I2C_SCHEDULER * scheduler,
+                              R4A_ESP32_I2C_JOB * job,
+                              bool readDue)
+{
+    size_t bytesRead;
+    uint8_t data[R4A_ESP32_I2C_JOB_BYTES];
+    int64_t endUsec;
+    int64_t startUsec;
+    bool success;
+    uint8_t writeBytes;
+    uint32_t writePosted;
+
+    startUsec = esp_timer_get_time();
+
+    // Get the latest posted write data
+    portENTER_CRITICAL(&r4aEsp32I2cJobLock);
+    writePosted = job->_writePosted;
+    writeBytes = job->_writeBytes;
+    memcpy(data, job->_writeData, writeBytes);
+    portEXIT_CRITICAL(&r4aEsp32I2cJobLock);
+
+    // Write the data to the device, older posted data is skipped
+    if (writePosted != job->_writeDone)
+    {
+        job->_writesCoalesced += writePosted - job->_writeDone - 1;
+        job->_writeDone = writePosted;
+        job->_writes += 1;
+        if (!r4aI2cBusWrite(scheduler->_i2cBus,
+                            job->_i2cAddress,
+                            data,
+                            writeBytes,
+                            nullptr))
+            r4aEsp32I2cJobPublish(job, nullptr, 0, false);
+    }
+
+    // Read the data from the device
+    if (readDue)
+    {
+        if (job->_commandBytes)
+            success = r4aI2cBusWriteRead(scheduler->_i2cBus,
+                                         job->_i2cAddress,
+                                         job->_command,
+                                         job->_commandBytes,
+                                         data,
+                                         job->_readBytes,
+                                         &bytesRead,
+                                         nullptr);
+        else
+            success = r4aI2cBusRead(scheduler->_i2cBus,
+                                    job->_i2cAddress,
+                                    data,
+                                    job->_readBytes,
+                                    &bytesRead,
+                                    nullptr);
+        r4aEsp32I2cJobPublish(job, data, esp_timer_get_time(), success);
+    }
+
+    // Update the job duration
+    endUsec = esp_timer_get_time();
+    if (job->_maxUsec < (uint32_t)(endUsec - startUsec))
+        job->_maxUsec = endUsec - startUsec;
+}
+
+//*********************************************************************
+// Perform the I2C jobs when they are due
+static void r4aEsp32I2cSchedulerTask(void * parameter)
+{
+    int64_t currentUsec;
+    R4A_ESP32_I2C_JOB * job;
+    int64_t nextUsec;
+    bool readDue;
+    R4A_ESP32_I2C_SCHEDULER * scheduler;
+    TickType_t ticks;
+
+    scheduler = (R4A_ESP32_I2C_SCHEDULER *)parameter;
+    while (!scheduler->_stop)
+    {
+        // Walk the job table
+        currentUsec = esp_timer_get_time();
+        nextUsec = currentUsec + (R4A_ESP32_I2C_SCHEDULER_IDLE_MSEC * 1000);
+        for (job = scheduler->_jobs; job < &scheduler->_jobs[scheduler->_jobCount]; job++)
+        {
+            // Perform the job when a read is due or a write is posted
+            readDue = job->_readBytes && (currentUsec >= job->_nextUsec);
+            if (readDue || (job->_writePosted != job->_writeDone))
+            {
+                r4aEsp32I2cJobRun(scheduler, job, readDue);
+
+                // Schedule the next read, skip missed periods
+                if (readDue)
+                {
+                    if (scheduler->_maxLateUsec < (uint32_t)(currentUsec - job->_nextUsec))
+                        scheduler->_maxLateUsec = currentUsec - job->_nextUsec;
+                    job->_nextUsec += job->_periodMsec * 1000;
+                    if (job->_nextUsec <= currentUsec)
+                        job->_nextUsec = currentUsec + (job->_periodMsec * 1000);
+                }
+            }
+
+            // Determine when the next read is due
+            if (job->_readBytes && (nextUsec > job->_nextUsec))
+                nextUsec = job->_nextUsec;
+        }
+        scheduler->_passes += 1;
+
+        // Wait for the next read or a posted write
+        currentUsec = esp_timer_get_time();
+        if (nextUsec > currentUsec)
+        {
+            ticks = pdMS_TO_TICKS((nextUsec - currentUsec + 999) / 1000);
+            ulTaskNotifyTake(pdTRUE, ticks ? ticks : 1);
+        }
+    }
+
+    // The task is done
+    scheduler->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+//*********************************************************************
+// Get the latest data published by an I2C job
+bool r4aEsp32I2cJobSnapshot(R4A_ESP32_I2C_JOB * job,
+                            R4A_ESP32_I2C_SNAPSHOT * snapshot)
+{
+    // Nothing is published until the first transaction completes
+    if (!job->_published.read(snapshot))
+    {
+        memset(snapshot, 0, sizeof(*snapshot));
+        return false;
+    }
+    return (snapshot->_reads != 0);
+}
+
+//*********************************************************************
+// Post data to write to the I2C device
+bool r4aEsp32I2cJobWrite(R4A_ESP32_I2C_SCHEDULER * scheduler,
+                         R4A_ESP32_I2C_JOB * job,
+                         const uint8_t * data,
+                         size_t length)
+{
+    TaskHandle_t task;
+
+    // Validate the length
+    if (length > R4A_ESP32_I2C_JOB_BYTES)
+        return false;
+
+    // Replace any data not yet written
+    portENTER_CRITICAL(&r4aEsp32I2cJobLock);
+    memcpy(job->_writeData, data, length);
+    job->_writeBytes = length;
+    job->_writePosted += 1;
+    portEXIT_CRITICAL(&r4aEsp32I2cJobLock);
+
+    // Wake the scheduler task
+    task = scheduler->_task;
+    if (task)
+        xTaskNotifyGive(task);
+    return true;
+}
+
+//*********************************************************************
+// Start the I2C scheduler task
+bool r4aEsp32I2cSchedulerBegin(R4A_ESP32_I2C_SCHEDULER * scheduler,
+                               R4A_I2C_BUS * i2cBus,
+                               R4A_ESP32_I2C_JOB * jobs,
+                               uint8_t jobCount,
+                               BaseType_t core,
+                               Print * display)
+{
+    int64_t currentUsec;
+    uint8_t index;
+    BaseType_t status;
+
+    // Only one task per scheduler
+    r4aEsp32I2cSchedulerEnd(scheduler);
+
+    // Validate the job table
+    for (index = 0; index < jobCount; index++)
+    {
+        if ((jobs[index]._readBytes > R4A_ESP32_I2C_JOB_BYTES)
+            || (jobs[index]._readBytes && (jobs[index]._periodMsec == 0)))
+        {
+            if (display)
+                display->printf("ERROR: Invalid I2C job %s!\r\n", jobs[index]._name);
+            return false;
+        }
+    }
+
+    // Start the first reads immediately
+    currentUsec = esp_timer_get_time();
+    for (index = 0; index < jobCount; index++)
+        jobs[index]._nextUsec = currentUsec;
+
+    // Initialize the scheduler
+    scheduler->_i2cBus = i2cBus;
+    scheduler->_jobs = jobs;
+    scheduler->_jobCount = jobCount;
+    scheduler->_maxLateUsec = 0;
+    scheduler->_passes = 0;
+    scheduler->_stop = false;
+
+    // Start the scheduler task
+    status = xTaskCreatePinnedToCore(r4aEsp32I2cSchedulerTask,
+                                     "I2C scheduler",
+                                     R4A_ESP32_I2C_SCHEDULER_STACK_BYTES,
+                                     scheduler,
+                                     R4A_ESP32_I2C_SCHEDULER_PRIORITY,
+                                     (TaskHandle_t *)&scheduler->_task,
+                                     core);
+    if (status != pdPASS)
+    {
+        scheduler->_task = nullptr;
+        if (display)
+            display->printf("ERROR: Failed to create the I2C scheduler task!\r\n");
+        return false;
+    }
+    return true;
+}
+
+//*********************************************************************
+// Display the I2C scheduler statistics
+void r4aEsp32I2cSchedulerDisplayStats(R4A_ESP32_I2C_SCHEDULER * scheduler,
+                                      Print * display)
+{
+    int64_t ageUsec;
+    int64_t currentUsec;
+    R4A_ESP32_I2C_JOB * job;
+    R4A_ESP32_I2C_SNAPSHOT snapshot;
+
+    display->printf("I2C scheduler: %s\r\n", scheduler->_task ? "Running" : "Stopped");
+    display->printf("    %10lu  Passes\r\n", scheduler->_passes);
+    display->printf("    %10lu  Maximum uSec late\r\n", scheduler->_maxLateUsec);
+    if (scheduler->_jobCount == 0)
+        return;
+
+    // Display the job statistics
+    currentUsec = esp_timer_get_time();
+    display->printf("    Address  Reads  Errors  Writes  Coalesced  Max uSec  Age uSec  Name\r\n");
+    for (job = scheduler->_jobs; job < &scheduler->_jobs[scheduler->_jobCount]; job++)
+    {
+        ageUsec = r4aEsp32I2cJobSnapshot(job, &snapshot) ? currentUsec - snapshot._usec : -1;
+        display->printf("       0x%02x %6lu %7lu %7lu %10lu %9lu %9lld  %s\r\n",
+                        job->_i2cAddress,
+                        snapshot._reads,
+                        snapshot._errors,
+                        job->_writes,
+                        job->_writesCoalesced,
+                        job->_maxUsec,
+                        ageUsec,
+                        job->_name);
+    }
+}
+
+//*********************************************************************
+// Stop the I2C scheduler task
+void r4aEsp32I2cSchedulerEnd(R4A_ESP32_I2C_SCHEDULER * scheduler)
+{
+    TaskHandle_t task;
+
+    task = scheduler->_task;
+    if (task)
+    {
+        scheduler->_stop = true;
+        xTaskNotifyGive(task);
+        while (scheduler->_task)
+            delay(1);
+    }
+}
+
+//*********************************************************************
+// Display the I2C scheduler statistics
+void r4aEsp32I2cSchedulerMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                                   const char * command,
+                                   Print * display)
+{
+    r4aEsp32I2cSchedulerDisplayStats((R4A_ESP32_I2C_SCHEDULER *)menuEntry->menuParameter,
+                                     display);
+}
@@ -0,0 +1,94 @@
+/**********************************************************************
+  I2C_Stats.cpp
+
+  Robots-For-All (R4A)
+  I2C transaction statistics
+
+  This file only depends on R4A_ESP32_I2C_Stats.h so that the statistics
+  may be built on the host, see examples/I2C_Stats_Test.
+**********************************************************************/
+
+#include "R4A_ESP32_I2C_Stats.h"
+
+//*********************************************************************
+// Get the latency percentile from the histogram
+uint32_t r4aEsp32I2cStatsPercentile(const R4A_ESP32_I2C_DEVICE_STATS * deviceStats,
+                                    uint32_t percent)
+{
+    int bucket;
+    uint64_t count;
+    uint64_t target;
+    uint32_t usec;
+
+    // Determine the number of transactions within the percentile
+    if (percent > 100)
+        percent = 100;
+    target = (((uint64_t)deviceStats->_transactions * percent) + 99) / 100;
+    if (target == 0)
+        return 0;
+
+    // Locate the bucket containing the target transaction
+    count = 0;
+    for (bucket = 0; bucket < (R4A_ESP32_I2C_HISTOGRAM_BUCKETS - 1); bucket++)
+    {
+        count += deviceStats->_histogram[bucket];
+        if (count >= target)
+        {
+            // Use the end of the bucket, the maximum when it is smaller
+            usec = (32 << bucket) - 1;
+            return (usec < deviceStats->_maxUsec) ? usec : deviceStats->_maxUsec;
+        }
+    }
+
+    // The last bucket has no upper limit
+    return deviceStats->_maxUsec;
+}
+
+//*********************************************************************
+// Record an I2C transaction
+void r4aEsp32I2cStatsRecord(R4A_ESP32_I2C_STATS * stats,
+                            uint8_t i2cAddress,
+                            size_t bytes,
+                            esp_err_t status,
+                            uint32_t usec)
+{
+    int bucket;
+    R4A_ESP32_I2C_DEVICE_STATS * deviceStats;
+    uint8_t index;
+
+    // Locate the statistics for this device
+    i2cAddress &= 0x7f;
+    index = stats->_index[i2cAddress];
+    if (index == 0)
+    {
+        // Assign an entry to the device
+        if (stats->_devices >= R4A_ESP32_I2C_STATS_DEVICES)
+        {
+            stats->_dropped += 1;
+            return;
+        }
+        index = ++stats->_devices;
+        stats->_index[i2cAddress] = index;
+        stats->_device[index - 1]._i2cAddress = i2cAddress;
+    }
+    deviceStats = &stats->_device[index - 1];
+
+    // Account for the transaction
+    deviceStats->_transactions += 1;
+    deviceStats->_bytes += bytes;
+    deviceStats->_totalUsec += usec;
+    if (deviceStats->_maxUsec < usec)
+        deviceStats->_maxUsec = usec;
+    if (status == ESP_ERR_TIMEOUT)
+        deviceStats->_timeouts += 1;
+    else if ((status == ESP_FAIL) || (status == ESP_ERR_INVALID_STATE))
+        deviceStats->_naks += 1;
+    else if (status != ESP_OK)
+        deviceStats->_errors += 1;
+
+    // Update the latency histogram, bucket n holds (32 << (n - 1)) <= usec < (32 << n)
+    bucket = (usec < 32) ? 0 : (32 - __builtin_clz(usec)) - 5;
+    if (bucket >= R4A_ESP32_I2C_HISTOGRAM_BUCKETS)
+        bucket = R4A_ESP32_I2C_HISTOGRAM_BUCKETS - 1;
+    deviceStats->_histogram[bucket] += 1;
+}
@@ -19,6 +19,13 @@
 
 bool r4aMallocDebug;
 size_t r4aMallocMaxBytes = 128;
+R4A_ESP32_POOL r4aEsp32Pool;
+
+// Blocks of 16, 32, 64, 128, 256 and 512 bytes, 44 KB total
+const uint16_t r4aEsp32PoolDefaultBlocks[R4A_ESP32_POOL_CLASSES] =
+{
+    256, 256, 128, 64, 32, 16
+};
 
 //*********************************************************************
 // User defined delete function, see https://en.cppreference.com/w/cpp/memory/new/operator_delete
@@ -120,7 +127,7 @@ void r4aDmaFree(void * buffer, const char * text)
                       buffer, r4aMemoryLocation(buffer), text);
 
     // Free the DMA buffer
-    free(buffer);
+    free(r4aEsp32HeapProfileFree(buffer));
 }
 
 //*********************************************************************
@@ -133,9 +140,15 @@ void r4aDmaFree(void * buffer, const char * text)
 void * r4aDmaMalloc(size_t numberOfBytes, const char * text)
 {
     void * buffer;
+    bool profile;
 
-    // Attempt to allocate the DMA buffer
-    buffer = (uint8_t *)heap_caps_malloc(numberOfBytes, MALLOC_CAP_DMA);
+    // Attempt to allocate the DMA buffer, leave room for the profile header
+    profile = r4aEsp32HeapProfileEnable;
+    buffer = (uint8_t *)heap_caps_malloc(numberOfBytes
+                                         + (profile ? R4A_ESP32_HEAP_PROFILE_HEADER_BYTES : 0),
+                                         MALLOC_CAP_DMA);
+    if (buffer && profile)
+        buffer = r4aEsp32HeapProfileAlloc(buffer, numberOfBytes, text);
 
     // Display the malloc operation
     if (r4aMallocDebug)
@@ -157,13 +170,17 @@ void * r4aDmaMalloc(size_t numberOfBytes, const char * text)
 //   text: Text to display when debugging is enabled
 void r4aFree(void * buffer, const char * text)
 {
+    void * block;
+
     // Display the free operation
     if (r4aMallocDebug)
         Serial.printf("%p: %s, Freeing %s\r\n",
                       buffer, r4aMemoryLocation(buffer), text);
 
-    // Free the buffer
-    free(buffer);
+    // Return pool blocks to the pool, free the others
+    block = r4aEsp32HeapProfileFree(buffer);
+    if (!r4aEsp32PoolFree(&r4aEsp32Pool, block, xPortGetCoreID()))
+        free(block);
 }
 
 //*********************************************************************
@@ -176,6 +193,8 @@ void r4aFree(void * buffer, const char * text)
 void * r4aMalloc(size_t numberOfBytes, const char * text)
 {
     void * buffer;
+    size_t bytes;
+    bool profile;
     static bool psramCheckDone;
     static bool psramAvailable;
 
@@ -188,11 +207,22 @@ void * r4aMalloc(size_t numberOfBytes, const char * text)
         log_v("PSRAM: %s", psramAvailable ? "Available" : "NOT available");
     }
 
-    // Attempt to allocate the buffer
-    if ((r4aMallocMaxBytes < numberOfBytes) && psramAvailable)
-        buffer = ps_malloc(numberOfBytes);
+    // Leave room for the profile header
+    profile = r4aEsp32HeapProfileEnable;
+    bytes = numberOfBytes + (profile ? R4A_ESP32_HEAP_PROFILE_HEADER_BYTES : 0);
+
+    // Attempt to allocate the buffer from the pool, then from the heap
+    buffer = nullptr;
+    if (r4aEsp32Pool._end && (bytes <= R4A_ESP32_POOL_MAX_BYTES))
+        buffer = r4aEsp32PoolAlloc(&r4aEsp32Pool, bytes, xPortGetCoreID());
+    if (buffer)
+        ;
+    else if ((r4aMallocMaxBytes < numberOfBytes) && psramAvailable)
+        buffer = ps_malloc(bytes);
     else
-        buffer = malloc(numberOfBytes);
+        buffer = malloc(bytes);
+    if (buffer && profile)
+        buffer = r4aEsp32HeapProfileAlloc(buffer, numberOfBytes, text);
 
     // Display the malloc operation
     if (r4aMallocDebug)
@@ -231,3 +261,85 @@ const char * r4aMemoryLocation(void * addr)
         return "ROM";
     return "Unknown";
 }
+
+//*********************************************************************
+// Allocate the memory pool from internal SRAM
+bool r4aEsp32PoolBegin(const uint16_t * blockCounts, Print * display)
+{
+    size_t bytes;
+    void * memory;
+
+    // Only allocate the pool once
+    if (r4aEsp32Pool._end)
+        return true;
+
+    // Allocate the pool memory
+    bytes = r4aEsp32PoolBytes(blockCounts);
+    memory = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!memory)
+    {
+        if (display)
+            display->printf("ERROR: Failed to allocate %d bytes for the memory pool!\r\n", bytes);
+        return false;
+    }
+
+    // Build the free lists
+    r4aEsp32PoolInit(&r4aEsp32Pool, memory, blockCounts);
+    return true;
+}
+
+//*********************************************************************
+// Display the memory pool statistics
+void r4aEsp32PoolDisplayStats(Print * display)
+{
+    size_t freeBytes;
+    int index;
+    size_t largestBlock;
+    R4A_ESP32_POOL_CLASS * poolClass;
+
+    // Display the pool statistics
+    if (r4aEsp32Pool._end == nullptr)
+        display->printf("Memory pool: Not allocated\r\n");
+    else
+    {
+        display->printf("Memory pool: %p - %p, %d bytes\r\n",
+                        r4aEsp32Pool._base,
+                        r4aEsp32Pool._end - 1,
+                        r4aEsp32Pool._end - r4aEsp32Pool._base);
+        display->printf("    Bytes  Blocks  In Use  High Water  Allocations  Exhausted  Steals  Avg Request\r\n");
+        for (index = 0; index < R4A_ESP32_POOL_CLASSES; index++)
+        {
+            poolClass = &r4aEsp32Pool._class[index];
+            display->printf("    %5lu  %6lu  %6lu  %10lu  %11lu  %9lu  %6lu  %11lu\r\n",
+                            poolClass->_blockBytes,
+                            poolClass->_blocks,
+                            poolClass->_inUse,
+                            poolClass->_highWater,
+                            poolClass->_allocations,
+                            poolClass->_exhausted,
+                            poolClass->_steals,
+                            poolClass->_allocations
+                                ? (uint32_t)(poolClass->_requestedBytes / poolClass->_allocations)
+                                : 0);
+        }
+    }
+
+    // Display the heap fragmentation
+    freeBytes = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    display->printf("Internal heap: %d bytes free, largest block %d bytes, %d%% fragmented\r\n",
+                    freeBytes,
+                    largestBlock,
+                    freeBytes ? 100 - ((largestBlock * 100) / freeBytes) : 0);
+    display->printf("Internal heap: %d bytes minimum free\r\n",
+                    heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+}
+
+//*********************************************************************
+// Display the memory pool statistics
+void r4aEsp32PoolMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                           const char * command,
+                           Print * display)
+{
+    r4aEsp32PoolDisplayStats(display);
+}
@@ -5,12 +5,28 @@
   Load data from and store data to non-volatile memory (NVM).
 **********************************************************************/
 
+#ifdef  ESP_PLATFORM
 #include "R4A_ESP32.h"
+#include <esp_rom_crc.h>        // IDF built-in
+#else   // ESP_PLATFORM
+#include "NVM_Host.h"           // Host stand-ins, see examples/NVM_Test
+#include "R4A_ESP32_NVM.h"
+#endif  // ESP_PLATFORM
 
 //****************************************
 // Constants
 //****************************************
 
+#define R4A_ESP32_NVM_BINARY_EXTENSION  ".bin"
+#define R4A_ESP32_NVM_BINARY_MAGIC      0x4e413452  // "R4AN"
+#define R4A_ESP32_NVM_CRC_BUFFER_BYTES  1024
+#define R4A_ESP32_NVM_INDEX_TABLES      4           // Parameter tables with an index
+#define R4A_ESP32_NVM_BINARY_VERSION    3
+#define R4A_ESP32_NVM_JOURNAL_EXTENSION ".jnl"
+#define R4A_ESP32_NVM_STREAM_BUFFER_BYTES   4096
+#define R4A_ESP32_NVM_STREAM_TIMEOUT_MSEC   5000
+#define R4A_ESP32_NVM_TEMP_EXTENSION    ".tmp"
+
 const char * r4aEsp32NvmTypeTable[] =
 {
     "nullptr",      //  0
@@ -28,14 +44,246 @@ const char * r4aEsp32NvmTypeTable[] =
     "const char *", // 12
 };
 
+//****************************************
+// Types
+//****************************************
+
+//  +--------+---------+---------+--------+
+//  | Header | Record0 | Record1 | ...... | Strings
+//  +--------+---------+---------+--------+
+//
+// The binary parameter file contains one record for each entry in the
+// parameter table, indexed by the parameter position in the table.
+// The string values follow the records.  The CRC covers both the
+// records and the strings.  The header also holds the size, last write
+// time and CRC of the text parameter file, the binary file is only used
+// while the text file is unchanged.  The CRC of the text file is only
+// computed when the size and time do not prove the text file unchanged.
+typedef struct _R4A_ESP32_NVM_BINARY_HEADER
+{
+    uint32_t _magic;            // R4A_ESP32_NVM_BINARY_MAGIC
+    uint16_t _version;          // R4A_ESP32_NVM_BINARY_VERSION
+    uint16_t _recordBytes;      // sizeof(R4A_ESP32_NVM_BINARY_RECORD)
+    uint32_t _parameterCount;   // Number of records in the file
+    uint32_t _tableHash;        // Hash of the parameter names and types
+    uint32_t _stringBytes;      // Number of bytes in the string area
+    uint32_t _textBytes;        // Size of the text parameter file
+    uint32_t _textCrc;          // CRC-32 of the text parameter file
+    uint32_t _textTime;         // Last write time of the text parameter file
+    uint32_t _crc;              // CRC-32 of the records and strings
+} R4A_ESP32_NVM_BINARY_HEADER;
+
+typedef struct _R4A_ESP32_NVM_BINARY_RECORD
+{
+    uint64_t _value;            // Value or string offset in string area
+    uint32_t _length;           // String length including the zero
+    uint8_t _type;              // Type of value in this record
+    uint8_t _reserved[3];       // Zero
+} R4A_ESP32_NVM_BINARY_RECORD;
+
+// Parameter table lookup index, built when the defaults are set or the
+// parameters are read and never freed
+typedef struct _R4A_ESP32_NVM_INDEX
+{
+    const R4A_ESP32_NVM_PARAMETER * _parameterTable; // Table being indexed
+    int _parameterCount;        // Number of entries in the table
+    uint16_t * _addressIndex;   // Table indexes sorted by value address
+    uint16_t * _nameIndex;      // Table indexes sorted by name
+} R4A_ESP32_NVM_INDEX;
+
 //****************************************
 // Globals
 //****************************************
 
 bool r4aEsp32NvmDebug; // Set to true to enable debug output
+volatile bool r4aEsp32NvmJournalCompactionNeeded; // Set when the journal is too large
+size_t r4aEsp32NvmJournalMaxBytes = 4096; // Journal size triggering compaction
+
+//****************************************
+// Locals
+//****************************************
+
+static SemaphoreHandle_t r4aEsp32NvmFileMutex; // Serialize the parameter file changes
+static R4A_ESP32_NVM_INDEX r4aEsp32NvmIndexes[R4A_ESP32_NVM_INDEX_TABLES];
+static uint32_t r4aEsp32NvmIndexSlots;  // Number of claimed indexes
 
 //*********************************************************************
 // Support routines
+//*********************************************************************
+// Get the path to the binary parameter file
+// Inputs:
+//   filePath: Path to the text parameter file
+// Outputs:
+//   Returns the path to the binary parameter file
+String r4aEsp32NvmBinaryFilePath(const char * filePath)
+{
+    return String(filePath) + String(R4A_ESP32_NVM_BINARY_EXTENSION);
+}
+
+//*********************************************************************
+// Get the path to the parameter journal file
+// Inputs:
+//   filePath: Path to the text parameter file
+// Outputs:
+//   Returns the path to the parameter journal file
+String r4aEsp32NvmJournalFilePath(const char * filePath)
+{
+    return String(filePath) + String(R4A_ESP32_NVM_JOURNAL_EXTENSION);
+}
+
+//*********************************************************************
+// Serialize the changes to the parameter values, the parameter files
+// and the journal.  The mutex is recursive since the API routines call
+// each other.
+void r4aEsp32NvmFileLock()
+{
+    SemaphoreHandle_t expected;
+    SemaphoreHandle_t mutex;
+
+    // Create the mutex on first use
+    if (!__atomic_load_n(&r4aEsp32NvmFileMutex, __ATOMIC_ACQUIRE))
+    {
+        mutex = xSemaphoreCreateRecursiveMutex();
+        if (!mutex)
+            r4aReportFatalError("r4aEsp32NvmFileLock: Failed to allocate the mutex!");
+
+        // Another task may have created the mutex
+        expected = nullptr;
+        if (!__atomic_compare_exchange_n(&r4aEsp32NvmFileMutex,
+                                         &expected,
+                                         mutex,
+                                         false,
+                                         __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE))
+            vSemaphoreDelete(mutex);
+    }
+    xSemaphoreTakeRecursive(r4aEsp32NvmFileMutex, portMAX_DELAY);
+}
+
+//*********************************************************************
+// Allow other tasks to change the parameters
+void r4aEsp32NvmFileUnlock()
+{
+    xSemaphoreGiveRecursive(r4aEsp32NvmFileMutex);
+}
+
+//*********************************************************************
+// Get the lookup index for the parameter table
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parameterCount: Number of entries in the parameter table
+// Outputs:
+//   Returns the address of the index or nullptr if the index was not
+//   built for this table
+const R4A_ESP32_NVM_INDEX * r4aEsp32NvmGetIndex(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                                int parameterCount)
+{
+    R4A_ESP32_NVM_INDEX * index;
+
+    // Indexes are never freed, once published an index may be used
+    // without a lock
+    for (index = r4aEsp32NvmIndexes;
+         index < &r4aEsp32NvmIndexes[R4A_ESP32_NVM_INDEX_TABLES];
+         index++)
+        if ((__atomic_load_n(&index->_parameterTable, __ATOMIC_ACQUIRE) == parameterTable)
+            && (index->_parameterCount == parameterCount))
+            return index;
+    return nullptr;
+}
+
+//*********************************************************************
+// Build the lookup index for the parameter table
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parameterCount: Number of entries in the parameter table
+void r4aEsp32NvmIndexBuild(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                           int parameterCount)
+{
+    uint16_t * addressIndex;
+    int high;
+    int i;
+    R4A_ESP32_NVM_INDEX * index;
+    int low;
+    int middle;
+    uint16_t * nameIndex;
+    uint32_t slot;
+
+    // Use the existing index when it describes this table
+    if (r4aEsp32NvmGetIndex(parameterTable, parameterCount))
+        return;
+
+    // Verify the table size
+    if ((parameterCount <= 0) || (parameterCount > 0xffff))
+        return;
+
+    // Allocate the index tables
+    addressIndex = (uint16_t *)r4aMalloc(parameterCount * sizeof(*addressIndex),
+                                         "NVM address index (addressIndex)");
+    nameIndex = (uint16_t *)r4aMalloc(parameterCount * sizeof(*nameIndex),
+                                      "NVM name index (nameIndex)");
+    if ((!addressIndex) || (!nameIndex))
+    {
+        if (addressIndex)
+            r4aFree((void *)addressIndex, "NVM address index (addressIndex)");
+        if (nameIndex)
+            r4aFree((void *)nameIndex, "NVM name index (nameIndex)");
+        return;
+    }
+
+    // Binary insertion sort of the table entries.  Equal entries are
+    // placed after the existing entries, so the lookups return the
+    // first matching entry in the parameter table.
+    for (i = 0; i < parameterCount; i++)
+    {
+        // Locate the position for the address
+        low = 0;
+        high = i;
+        while (low < high)
+        {
+            middle = (low + high) >> 1;
+            if ((uintptr_t)parameterTable[addressIndex[middle]].addr
+                <= (uintptr_t)parameterTable[i].addr)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        memmove(&addressIndex[low + 1], &addressIndex[low], (i - low) * sizeof(*addressIndex));
+        addressIndex[low] = i;
+
+        // Locate the position for the name
+        low = 0;
+        high = i;
+        while (low < high)
+        {
+            middle = (low + high) >> 1;
+            if (r4aStricmp(parameterTable[nameIndex[middle]].name, parameterTable[i].name) <= 0)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        memmove(&nameIndex[low + 1], &nameIndex[low], (i - low) * sizeof(*nameIndex));
+        nameIndex[low] = i;
+    }
+
+    // Claim an index slot, the lookups search the table when the slots
+    // are exhausted.  Two tasks building the same index at the same
+    // time each claim a slot, the lookups use the first one.
+    slot = __atomic_fetch_add(&r4aEsp32NvmIndexSlots, 1, __ATOMIC_RELAXED);
+    if (slot >= R4A_ESP32_NVM_INDEX_TABLES)
+    {
+        r4aFree((void *)addressIndex, "NVM address index (addressIndex)");
+        r4aFree((void *)nameIndex, "NVM name index (nameIndex)");
+        return;
+    }
+
+    // Save the index, then publish it by setting the table address
+    index = &r4aEsp32NvmIndexes[slot];
+    index->_addressIndex = addressIndex;
+    index->_nameIndex = nameIndex;
+    index->_parameterCount = parameterCount;
+    __atomic_store_n(&index->_parameterTable, parameterTable, __ATOMIC_RELEASE);
+}
+
 //*********************************************************************
 // Parse the value parameter
 // Inputs:
@@ -299,6 +547,93 @@ void r4aEsp32NvmSetParameterValue(const R4A_ESP32_NVM_PARAMETER * parameter,
     }
 }
 
+//*********************************************************************
+// Get the size and last write time of a file
+// Inputs:
+//   filePath: Path to the file
+//   lastWrite: Address to receive the last write time in seconds, zero
+//              when the file system does not record the time
+// Outputs:
+//   Returns the size of the file in bytes or zero if the file does not
+//   exist
+static size_t r4aEsp32NvmFileInfo(const char * filePath, uint32_t * lastWrite)
+{
+    File file;
+    size_t fileBytes;
+
+    *lastWrite = 0;
+    fileBytes = 0;
+    if (LittleFS.exists(filePath))
+    {
+        file = LittleFS.open(filePath, "r");
+        if (file)
+        {
+            fileBytes = file.size();
+            *lastWrite = (uint32_t)file.getLastWrite();
+            file.close();
+        }
+    }
+    return fileBytes;
+}
+
+//*********************************************************************
+// Get the size and CRC of the text parameter file
+// Inputs:
+//   filePath: Path to the text parameter file
+//   crc: Address to receive the CRC-32 of the file data
+// Outputs:
+//   Returns the size of the file in bytes or zero if the file does not
+//   exist or can't be read
+size_t r4aEsp32NvmTextFileCrc(const char * filePath, uint32_t * crc)
+{
+    uint8_t * buffer;
+    size_t bytesRead;
+    size_t fileBytes;
+    File textFile;
+
+    *crc = 0;
+    buffer = nullptr;
+    fileBytes = 0;
+    do
+    {
+        // Open the text file
+        if (!LittleFS.exists(filePath))
+            break;
+        textFile = LittleFS.open(filePath, "r");
+        if (!textFile)
+            break;
+
+        // Allocate the read buffer
+        buffer = (uint8_t *)r4aMalloc(R4A_ESP32_NVM_CRC_BUFFER_BYTES,
+                                      "NVM CRC buffer (buffer)");
+        if (!buffer)
+            break;
+
+        // Compute the CRC of the file data
+        while (1)
+        {
+            bytesRead = textFile.read(buffer, R4A_ESP32_NVM_CRC_BUFFER_BYTES);
+            if ((bytesRead == 0) || (bytesRead > R4A_ESP32_NVM_CRC_BUFFER_BYTES))
+                break;
+            *crc = esp_rom_crc32_le(*crc, buffer, bytesRead);
+            fileBytes += bytesRead;
+        }
+
+        // Don't match the file when a read fails
+        if (fileBytes != textFile.size())
+            fileBytes = 0;
+    } while (0);
+
+    // Done with the buffer
+    if (buffer)
+        r4aFree(buffer, "NVM CRC buffer (buffer)");
+
+    // Done with the file
+    if (textFile)
+        textFile.close();
+    return fileBytes;
+}
+
 //*********************************************************************
 // Write a string and zero termination to the parameter file
 bool r4aEsp32NvmWriteFileString(File &file, const char * string)
@@ -595,44 +930,17 @@ void r4aEsp32NvmDisplayParameters(const R4A_ESP32_NVM_PARAMETER * parameterTable
                                   int parameterCount,
                                   Print * display)
 {
-    int i;
-    uint16_t * index;
-    int j;
-    uint16_t temp;
+    const R4A_ESP32_NVM_INDEX * index;
 
     // Display the call
     log_v("r4aEsp32NvmDisplayParameters(%p, %d, %p)", (void *)parameterTable, parameterCount, (void *)display);
 
-    // Allocate the parameter index table
-    index = (uint16_t *)r4aMalloc(parameterCount * sizeof(*index), "Parameter index table (index)");
+    // Get the parameter index sorted by name
+    index = r4aEsp32NvmGetIndex(parameterTable, parameterCount);
     if (index)
-    {
-        // Initialize the index table
-        for (i = 0; i < parameterCount; i++)
-            index[i] = i;
-
-        // Bubble sort the parameter table
-        for (i = 0; i < (parameterCount - 1); i++)
-        {
-            for (j = i + 1; j < parameterCount; j++)
-            {
-                if (r4aStricmp(parameterTable[index[i]].name, parameterTable[index[j]].name) > 0)
-                {
-                    // Switch the entries
-                    temp = index[i];
-                    index[i] = index[j];
-                    index[j] = temp;
-                }
-            }
-        }
-
-        // Display the parameters as listed in the parameter table
-        for (i = 0; i < parameterCount; i++)
-            r4aEsp32NvmDisplayParameter(&parameterTable[index[i]], display);
-
-        // Done with the index table
-        r4aFree((void *)index, "Parameter index table (index)");
-    }
+        // Display the parameters in alphabetical order
+        for (int parameter = 0; parameter < parameterCount; parameter++)
+            r4aEsp32NvmDisplayParameter(&parameterTable[index->_nameIndex[parameter]], display);
     else
         // Display the parameters as listed in the parameter table
         for (int parameter = 0; parameter < parameterCount; parameter++)
@@ -770,6 +1078,9 @@ void r4aEsp32NvmGetDefaultParameters(const R4A_ESP32_NVM_PARAMETER * parameterTa
     // Display the call
     log_v("r4aEsp32NvmGetDefaultParameters(%p, %d)", (void *)parameterTable, parameterCount);
 
+    // Build the lookup index for the table
+    r4aEsp32NvmIndexBuild(parameterTable, parameterCount);
+
     // Walk the list of parameters
     for (int index = 0; index < parameterCount; index++)
     {
@@ -799,6 +1110,7 @@ void r4aEsp32NvmGetDefaultParameters(const R4A_ESP32_NVM_PARAMETER * parameterTa
     }
 }
 
+#ifdef  ESP_PLATFORM
 //*********************************************************************
 // Get a set of parameters
 // Returns true if successful and false upon failure
@@ -906,6 +1218,7 @@ bool r4aEsp32NvmGetParameters(const char ** filePath,
     }
     return false;
 }
+#endif  // ESP_PLATFORM
 
 //*********************************************************************
 // Get a string from the parameter file
@@ -938,6 +1251,264 @@ bool r4aEsp32NvmGetString(const char ** string, const char ** data, size_t * fil
     return stringValid;
 }
 
+//*********************************************************************
+// Append a parameter value to the parameter journal
+bool r4aEsp32NvmJournalAppend(const char * filePath,
+                              const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                              int parameterCount,
+                              const R4A_ESP32_NVM_PARAMETER * parameter,
+                              Print * display,
+                              bool debug)
+{
+    size_t journalBytes;
+    File journalFile;
+    String journalPath;
+    const char * path;
+    bool success;
+
+    // Display the call
+    log_v("r4aEsp32NvmJournalAppend(%p, %p, %d, %p, %p, %d)", (void *)filePath, (void *)parameterTable, parameterCount, (void *)parameter, (void *)display, debug);
+
+    // Don't allow compaction between the append and the journal size check
+    r4aEsp32NvmFileLock();
+
+    // Open the journal file, the journal only holds the changes to an
+    // existing parameter file
+    journalPath = r4aEsp32NvmJournalFilePath(filePath);
+    path = journalPath.c_str();
+    success = false;
+    if (!LittleFS.exists(filePath))
+        journalFile = File();
+    else
+    {
+        journalFile = LittleFS.open(path, FILE_APPEND);
+        if ((!journalFile) && display)
+            display->printf("ERROR: Failed to open file %s!\r\n", path);
+    }
+    if (journalFile)
+    {
+        //  +-------+---+-------+---+-------+---+-------+---+
+        //  | Name  | 0 | Type  | 0 | Value | 0 | CR/LF | 0 |
+        //  +-------+---+-------+---+-------+---+-------+---+
+        //
+        // Append the parameter using the parameter file format
+        success = r4aEsp32NvmWriteParameterValue(journalFile,
+                                                 parameter,
+                                                 display,
+                                                 debug);
+        journalBytes = journalFile.size();
+        journalFile.close();
+
+        // Request compaction when the journal gets too large
+        if (journalBytes >= r4aEsp32NvmJournalMaxBytes)
+            r4aEsp32NvmJournalCompactionNeeded = true;
+    }
+
+    // Write the parameter file when it does not exist or when the
+    // journal write fails, this also removes the journal
+    if (!success)
+        success = r4aEsp32NvmWriteParameters(filePath,
+                                             parameterTable,
+                                             parameterCount,
+                                             display,
+                                             debug);
+    r4aEsp32NvmFileUnlock();
+    return success;
+}
+
+//*********************************************************************
+// Merge the parameter journal into the parameter file
+bool r4aEsp32NvmJournalCompact(const char * filePath,
+                               const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                               int parameterCount,
+                               Print * display)
+{
+    String binaryPath;
+    String journalPath;
+    bool success;
+    String tempBinaryPath;
+    String tempPath;
+
+    // Display the call
+    log_v("r4aEsp32NvmJournalCompact(%p, %p, %d, %p)", (void *)filePath, (void *)parameterTable, parameterCount, (void *)display);
+
+    // Get the file paths
+    binaryPath = r4aEsp32NvmBinaryFilePath(filePath);
+    journalPath = r4aEsp32NvmJournalFilePath(filePath);
+    tempPath = String(filePath) + String(R4A_ESP32_NVM_TEMP_EXTENSION);
+    tempBinaryPath = r4aEsp32NvmBinaryFilePath(tempPath.c_str());
+
+    // The journal records contain absolute values, replaying the journal
+    // on top of the new parameter file produces the same values.  A
+    // failure at any step leaves a parameter file and journal that
+    // restore the current values.
+    r4aEsp32NvmFileLock();
+    r4aEsp32NvmJournalCompactionNeeded = false;
+    success = false;
+    do
+    {
+        // Write the current parameter values to the temporary files
+        if (!r4aEsp32NvmWriteParameters(tempPath.c_str(),
+                                        parameterTable,
+                                        parameterCount,
+                                        nullptr))
+        {
+            if (display)
+                display->printf("ERROR: Failed to write %s!\r\n", tempPath.c_str());
+            break;
+        }
+
+        // Replace the parameter files
+        if (LittleFS.exists(binaryPath.c_str()))
+            LittleFS.remove(binaryPath.c_str());
+        if (!r4aEsp32NvmReplaceFile(tempPath.c_str(), filePath, display))
+            break;
+        if (!r4aEsp32NvmReplaceFile(tempBinaryPath.c_str(), binaryPath.c_str(), display))
+            break;
+
+        // Remove the journal
+        if (LittleFS.exists(journalPath.c_str()))
+            LittleFS.remove(journalPath.c_str());
+        success = true;
+    } while (0);
+    r4aEsp32NvmFileUnlock();
+    return success;
+}
+
+//*********************************************************************
+// Replay the parameter journal
+bool r4aEsp32NvmJournalReplay(const char * filePath,
+                              const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                              int parameterCount,
+                              Print * display)
+{
+    size_t bytesRead;
+    bool compactJournal;
+    size_t fileBytes;
+    File journalFile;
+    String journalPath;
+    uint8_t * nvmData;
+    const char * path;
+    bool status;
+
+    // Display the call
+    log_v("r4aEsp32NvmJournalReplay(%p, %p %d, %p)", (void *) filePath, (void *)parameterTable, parameterCount, (void *)display);
+
+    // Allocate the available parameter bitmap
+    int parameterBytes = (parameterCount + 7) >> 3;
+    uint8_t availableParameters[parameterBytes];
+    memset(availableParameters, 0, parameterBytes);
+
+    // Get the journal path
+    journalPath = r4aEsp32NvmJournalFilePath(filePath);
+    path = journalPath.c_str();
+
+    // Don't allow appends while the journal is read and compacted
+    r4aEsp32NvmFileLock();
+    compactJournal = false;
+    nvmData = nullptr;
+    status = true;
+    do
+    {
+        // Determine if the journal exists
+        if (!LittleFS.exists(path))
+            break;
+
+        // Open the journal file
+        status = false;
+        journalFile = LittleFS.open(path, "r");
+        if (!journalFile)
+        {
+            if (display)
+                display->printf("ERROR: Failed to open file %s!\r\n", path);
+            break;
+        }
+
+        // Determine the file size
+        fileBytes = journalFile.size();
+        if (!fileBytes)
+        {
+            status = true;
+            break;
+        }
+
+        // Allocate the file data buffer
+        nvmData = (uint8_t *)r4aMalloc(fileBytes, "NVM journal data buffer (nvmData)");
+        if (!nvmData)
+        {
+            if (display && (display != &Serial))
+                display->println("ERROR: Failed to allocate read buffer!");
+            break;
+        }
+
+        // Read the file into memory
+        bytesRead = journalFile.read(nvmData, fileBytes);
+        if (bytesRead != fileBytes)
+        {
+            if (display)
+                display->println("ERROR: Failed to read file into memory!");
+            break;
+        }
+
+        if (display)
+            display->printf("Applying parameter changes from %s\r\n", path);
+
+        // Apply the journal entries in order, a partially written
+        // entry at the end of the journal is ignored
+        if (!r4aEsp32NvmParseParameters(parameterTable,
+                                        parameterCount,
+                                        (const char *)nvmData,
+                                        fileBytes,
+                                        availableParameters,
+                                        display))
+        {
+            if (display)
+                display->printf("WARNING: Ignoring the invalid entry in %s\r\n", path);
+            compactJournal = true;
+        }
+
+        // Request compaction when the journal is too large
+        if (fileBytes >= r4aEsp32NvmJournalMaxBytes)
+            r4aEsp32NvmJournalCompactionNeeded = true;
+        status = true;
+    } while (0);
+
+    // Free the journal data
+    if (nvmData)
+        r4aFree((void *)nvmData, "NVM journal data buffer (nvmData)");
+
+    // Close the file
+    if (journalFile)
+        journalFile.close();
+
+    // Remove the invalid entry now, entries appended after it would be
+    // ignored
+    if (compactJournal)
+        r4aEsp32NvmJournalCompact(filePath,
+                                  parameterTable,
+                                  parameterCount,
+                                  display);
+    r4aEsp32NvmFileUnlock();
+
+    // Return status indicating if the journal was successfully replayed
+    return status;
+}
+
+//*********************************************************************
+// Compact the parameter journal when necessary
+void r4aEsp32NvmJournalUpdate(const char * filePath,
+                              const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                              int parameterCount,
+                              Print * display)
+{
+    if (r4aEsp32NvmJournalCompactionNeeded)
+        r4aEsp32NvmJournalCompact(filePath,
+                                  parameterTable,
+                                  parameterCount,
+                                  display);
+}
+
+#ifdef  ESP_PLATFORM
 //*********************************************************************
 // Display all of the parameters
 void r4aEsp32NvmMenuDisplayParameters(const struct _R4A_MENU_ENTRY * menuEntry,
@@ -1033,6 +1604,11 @@ void r4aEsp32NvmMenuFileCopy(const R4A_MENU_ENTRY * menuEntry,
         destFilePath = String("/") + String(destFileName);
         destPath = destFilePath.c_str();
 
+        // Write the buffered data to the source file and close the
+        // buffered writers using the files
+        R4A_ESP32_FILE_WRITER::closeFile(srcPath);
+        R4A_ESP32_FILE_WRITER::closeFile(destPath);
+
         // Attempt to open the destination file
         destFile = LittleFS.open(destPath, FILE_WRITE);
         if (!destFile)
@@ -1239,6 +1815,10 @@ void r4aEsp32NvmMenuFileMove(const R4A_MENU_ENTRY * menuEntry,
         destFilePath = String("/") + String(destFileName);
         destPath = destFilePath.c_str();
 
+        // Close the buffered writers using the files
+        R4A_ESP32_FILE_WRITER::closeFile(srcPath);
+        R4A_ESP32_FILE_WRITER::closeFile(destPath);
+
         // Rename the file
         if (LittleFS.rename(srcPath, destPath) == false)
         {
@@ -1269,7 +1849,8 @@ void r4aEsp32NvmMenuFileRemove(const R4A_MENU_ENTRY * menuEntry,
     filePath = String("/") + fileName;
     name = filePath.c_str();
 
-    // Delete the file
+    // Close the buffered writers using the file, then delete the file
+    R4A_ESP32_FILE_WRITER::closeFile(name);
     removed = LittleFS.remove(name);
     if (display)
     {
@@ -1322,25 +1903,23 @@ void r4aEsp32NvmMenuHttpFileGet(const R4A_MENU_ENTRY * menuEntry,
                                 const char * command,
                                 Print * display)
 {
-    int bytesWritten;
-    File file;
     const char * fileName;
     HTTPClient http;
     int httpStatus;
-    size_t length;
+    String newPath;
     const char * path;
-    String payload;
     const char * url;
     String urlString;
 
     do
     {
         // Get the URL
-        length = 0;
         urlString = r4aMenuGetParameters(menuEntry, command);
         url = urlString.c_str();
 
-        // Get the web page
+        // Get the web page, HTTP 1.0 prevents chunked transfer encoding
+        // allowing the body to be copied directly from the connection
+        http.useHTTP10(true);
         http.begin(url);
         httpStatus = http.GET();
         if (httpStatus <= 0)
@@ -1350,6 +1929,12 @@ void r4aEsp32NvmMenuHttpFileGet(const R4A_MENU_ENTRY * menuEntry,
                                 http.errorToString(httpStatus).c_str());
             break;
         }
+        if (httpStatus != HTTP_CODE_OK)
+        {
+            if (display)
+                display->printf("ERROR: HTTP GET failed, status: %d\r\n", httpStatus);
+            break;
+        }
 
         // Get the file name
         path = url;
@@ -1367,35 +1952,22 @@ void r4aEsp32NvmMenuHttpFileGet(const R4A_MENU_ENTRY * menuEntry,
         else
             path = "/index.html";
 
-
-        // Attempt to open the destination file
-        file = LittleFS.open(path, FILE_WRITE);
-        if (!file)
+        // Copy the body into the file.  The parameter file is downloaded
+        // into a new file which then replaces the parameter file, its
+        // binary parameter file and its journal.
+        if (parameterFilePath && (strcmp(path, parameterFilePath) == 0))
         {
-            if (display)
-                display->printf("ERROR: Failed to open file %s!\r\n", path);
-            break;
+            newPath = String(path) + String(".new");
+            if (r4aEsp32NvmStreamToFile(http.getStreamPtr(),
+                                        http.getSize(),
+                                        newPath.c_str(),
+                                        display))
+                r4aEsp32NvmReplaceParameterFile(newPath.c_str(), path, display);
         }
-
-        // Determine the response length
-        payload = http.getString();
-        length = payload.length();
-
-        // Write the data to the destination file
-        bytesWritten = file.write((uint8_t *)payload.c_str(), length);
-        length -= bytesWritten;
-        if(length > 0)
-            display->printf("ERROR: Error writing to file %s\r\n", path);
+        else
+            r4aEsp32NvmStreamToFile(http.getStreamPtr(), http.getSize(), path, display);
     } while (0);
 
-    // Done with the files
-    if (file)
-        file.close();
-
-    // Delete the file if necessary
-    if (length)
-        LittleFS.remove(path);
-
     // Done with the HTTP client
     http.end();
 }
@@ -1518,6 +2090,7 @@ void r4aEsp32NvmMenuParameterSet(const struct _R4A_MENU_ENTRY * menuEntry,
                                     display);
     }
 }
+#endif  // ESP_PLATFORM
 
 //*********************************************************************
 // Clear a parameter by setting its value to zero
@@ -1539,14 +2112,18 @@ void r4aEsp32NvmParameterClear(const char * filePath,
     }
     else
     {
-        // Clear the parameter
+        // Clear the parameter, don't allow compaction to write the
+        // parameter files between the change and the journal append
+        r4aEsp32NvmFileLock();
         r4aEsp32NvmSetParameterValue(parameter, 0);
 
-        // Write the parameters to the file
-        r4aEsp32NvmWriteParameters(filePath,
-                                   parameterTable,
-                                   parameterCount,
-                                   display);
+        // Record the change in the parameter journal
+        r4aEsp32NvmJournalAppend(filePath,
+                                 parameterTable,
+                                 parameterCount,
+                                 parameter,
+                                 display);
+        r4aEsp32NvmFileUnlock();
 
         // Display the updated parameter value
         r4aEsp32NvmDisplayParameter(parameter, display);
@@ -1560,14 +2137,39 @@ const R4A_ESP32_NVM_PARAMETER * r4aEsp32NvmParameterLookup(const R4A_ESP32_NVM_P
                                                            void * address,
                                                            Print * display)
 {
+    int high;
     int index;
+    int low;
+    int middle;
+    const R4A_ESP32_NVM_INDEX * nvmIndex;
     const R4A_ESP32_NVM_PARAMETER * parameter;
 
     // Display the call
     log_v("r4aEsp32NvmParameterLookup(%p, %d, %p, %p)", (void *)parameterTable, parameterCount, address, (void *)display);
 
-    // Look up the parameter
+    // Look up the parameter using a binary search of the index
     parameter = nullptr;
+    nvmIndex = r4aEsp32NvmGetIndex(parameterTable, parameterCount);
+    if (nvmIndex)
+    {
+        low = 0;
+        high = parameterCount;
+        while (low < high)
+        {
+            middle = (low + high) >> 1;
+            if ((uintptr_t)parameterTable[nvmIndex->_addressIndex[middle]].addr
+                < (uintptr_t)address)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if ((low < parameterCount)
+            && (parameterTable[nvmIndex->_addressIndex[low]].addr == address))
+            parameter = &parameterTable[nvmIndex->_addressIndex[low]];
+        return parameter;
+    }
+
+    // No index available, search the table
     for (index = 0; index < parameterCount; index++)
     {
         if (parameterTable[index].addr == address)
@@ -1586,14 +2188,38 @@ const R4A_ESP32_NVM_PARAMETER * r4aEsp32NvmParameterLookup(const R4A_ESP32_NVM_P
                                                            const char * name,
                                                            Print * display)
 {
+    int high;
     int index;
+    int low;
+    int middle;
+    const R4A_ESP32_NVM_INDEX * nvmIndex;
     const R4A_ESP32_NVM_PARAMETER * parameter;
 
     // Display the call
     log_v("r4aEsp32NvmParameterLookup(%p %d, %p, %p)", (void *)parameterTable, parameterCount, (const void *)name, (void *)display);
 
-    // Look up the parameter
+    // Look up the parameter using a binary search of the index
     parameter = nullptr;
+    nvmIndex = r4aEsp32NvmGetIndex(parameterTable, parameterCount);
+    if (nvmIndex)
+    {
+        low = 0;
+        high = parameterCount;
+        while (low < high)
+        {
+            middle = (low + high) >> 1;
+            if (r4aStricmp(parameterTable[nvmIndex->_nameIndex[middle]].name, name) < 0)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if ((low < parameterCount)
+            && (r4aStricmp(parameterTable[nvmIndex->_nameIndex[low]].name, name) == 0))
+            parameter = &parameterTable[nvmIndex->_nameIndex[low]];
+        return parameter;
+    }
+
+    // No index available, search the table
     for (index = 0; index < parameterCount; index++)
     {
         if (r4aStricmp(parameterTable[index].name, name) == 0)
@@ -1622,15 +2248,20 @@ bool r4aEsp32NvmParameterSet(const char * filePath,
     {
         bool success;
 
-        // Successful conversion, set the value
+        // Successful conversion, set the value.  Don't allow compaction
+        // to write the parameter files between the change and the
+        // journal append.
+        r4aEsp32NvmFileLock();
         r4aEsp32NvmSetParameterValue(parameter, value.u64);
 
-        // Write the parameters to the file
-        success = r4aEsp32NvmWriteParameters(filePath,
-                                             parameterTable,
-                                             parameterCount,
-                                             display,
-                                             debug);
+        // Record the change in the parameter journal
+        success = r4aEsp32NvmJournalAppend(filePath,
+                                           parameterTable,
+                                           parameterCount,
+                                           parameter,
+                                           display,
+                                           debug);
+        r4aEsp32NvmFileUnlock();
 
         // Display the updated parameter value
         if (success)
@@ -1737,6 +2368,225 @@ bool r4aEsp32NvmParseParameters(const R4A_ESP32_NVM_PARAMETER * parameterTable,
     return validParameters;
 }
 
+//*********************************************************************
+// Read the parameters from the binary parameter file
+bool r4aEsp32NvmReadBinaryParameters(const char * filePath,
+                                     const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                     int parameterCount,
+                                     Print * display)
+{
+    String binaryPath;
+    size_t bytesRead;
+    size_t fileBytes;
+    R4A_ESP32_NVM_BINARY_HEADER * header;
+    int index;
+    uint8_t * nvmData;
+    const R4A_ESP32_NVM_PARAMETER * parameter;
+    File parameterFile;
+    const char * path;
+    const R4A_ESP32_NVM_BINARY_RECORD * record;
+    const R4A_ESP32_NVM_BINARY_RECORD * records;
+    bool status;
+    char * stringValue;
+    const char * strings;
+    size_t textBytes;
+    uint32_t textCrc;
+    bool textCrcChecked;
+    uint32_t textTime;
+    R4A_ESP32_NVM_VALUE value;
+
+    // Display the call
+    log_v("r4aEsp32NvmReadBinaryParameters(%p, %p %d, %p)", (void *) filePath, (void *)parameterTable, parameterCount, (void *)display);
+
+    // Get the binary file path
+    binaryPath = r4aEsp32NvmBinaryFilePath(filePath);
+    path = binaryPath.c_str();
+
+    nvmData = nullptr;
+    status = false;
+    textCrcChecked = false;
+    textTime = 0;
+    do
+    {
+        // Determine if the file exists, the text file is used if not
+        if (!LittleFS.exists(path))
+            break;
+
+        // Open the binary parameter file
+        parameterFile = LittleFS.open(path, "r");
+        if (!parameterFile)
+        {
+            if (display)
+                display->printf("ERROR: Failed to open file %s!\r\n", path);
+            break;
+        }
+
+        // Determine the file size
+        fileBytes = parameterFile.size();
+        if (fileBytes < sizeof(R4A_ESP32_NVM_BINARY_HEADER))
+        {
+            if (display)
+                display->printf("WARNING: Binary parameter file %s is too short!\r\n", path);
+            break;
+        }
+
+        // Allocate the file data buffer
+        nvmData = (uint8_t *)r4aMalloc(fileBytes, "NVM binary data buffer (nvmData)");
+        if (!nvmData)
+        {
+            if (display && (display != &Serial))
+                display->println("ERROR: Failed to allocate read buffer!");
+            break;
+        }
+
+        // Read the file into memory
+        bytesRead = parameterFile.read(nvmData, fileBytes);
+        if (bytesRead != fileBytes)
+        {
+            if (display)
+                display->println("ERROR: Failed to read file into memory!");
+            break;
+        }
+
+        // Validate the file format
+        header = (R4A_ESP32_NVM_BINARY_HEADER *)nvmData;
+        if ((header->_magic != R4A_ESP32_NVM_BINARY_MAGIC)
+            || (header->_version != R4A_ESP32_NVM_BINARY_VERSION)
+            || (header->_recordBytes != sizeof(R4A_ESP32_NVM_BINARY_RECORD)))
+        {
+            if (display)
+                display->printf("WARNING: Unknown binary parameter file format in %s!\r\n", path);
+            break;
+        }
+
+        // Fall back to the text file when the parameter table changes
+        if ((header->_parameterCount != (uint32_t)parameterCount)
+            || (header->_tableHash != r4aEsp32NvmTableHash(parameterTable, parameterCount)))
+        {
+            if (display)
+                display->printf("Parameter table changed, ignoring %s\r\n", path);
+            break;
+        }
+
+        // Verify the file length
+        if (fileBytes != (sizeof(R4A_ESP32_NVM_BINARY_HEADER)
+                          + (parameterCount * sizeof(R4A_ESP32_NVM_BINARY_RECORD))
+                          + header->_stringBytes))
+        {
+            if (display)
+                display->printf("WARNING: Binary parameter file %s has invalid length!\r\n", path);
+            break;
+        }
+
+        // Verify the CRC
+        if (header->_crc != esp_rom_crc32_le(0,
+                                             &nvmData[sizeof(R4A_ESP32_NVM_BINARY_HEADER)],
+                                             fileBytes - sizeof(R4A_ESP32_NVM_BINARY_HEADER)))
+        {
+            if (display)
+                display->printf("WARNING: Bad CRC in binary parameter file %s!\r\n", path);
+            break;
+        }
+
+        // Fall back to the text file when it was changed or replaced.  A
+        // matching size and last write time prove the text file unchanged
+        // when the binary file was written in a later second, otherwise an
+        // edit in the same second keeps the time and the CRC of the text
+        // file must be compared.
+        textBytes = r4aEsp32NvmFileInfo(filePath, &textTime);
+        if ((header->_textBytes != textBytes)
+            || (!textTime)
+            || (header->_textTime != textTime)
+            || (textTime >= (uint32_t)parameterFile.getLastWrite()))
+        {
+            textCrcChecked = true;
+            if ((header->_textBytes != r4aEsp32NvmTextFileCrc(filePath, &textCrc))
+                || (header->_textCrc != textCrc))
+            {
+                if (display)
+                    display->printf("Parameter file %s changed, ignoring %s\r\n", filePath, path);
+                break;
+            }
+        }
+
+        // Validate the records before changing any of the parameters
+        records = (const R4A_ESP32_NVM_BINARY_RECORD *)&header[1];
+        strings = (const char *)&records[parameterCount];
+        for (index = 0; index < parameterCount; index++)
+        {
+            parameter = &parameterTable[index];
+            record = &records[index];
+            if (record->_type == R4A_ESP32_NVM_PT_NULLPTR)
+            {
+                if ((parameter->type != R4A_ESP32_NVM_PT_NULLPTR)
+                    && (parameter->type != R4A_ESP32_NVM_PT_P_CHAR))
+                    break;
+            }
+            else if (record->_type != parameter->type)
+                break;
+            else if ((record->_type == R4A_ESP32_NVM_PT_P_CHAR)
+                && ((record->_length == 0)
+                    || ((record->_value + record->_length) > header->_stringBytes)
+                    || strings[record->_value + record->_length - 1]))
+                break;
+        }
+        if (index < parameterCount)
+        {
+            if (display)
+                display->printf("WARNING: Invalid record for %s in %s!\r\n",
+                                parameterTable[index].name, path);
+            break;
+        }
+
+        if (display)
+            display->printf("Loading parameters from %s\r\n", path);
+
+        // Set the parameter values
+        for (index = 0; index < parameterCount; index++)
+        {
+            parameter = &parameterTable[index];
+            record = &records[index];
+            value.u64 = record->_value;
+            if (record->_type == R4A_ESP32_NVM_PT_NULLPTR)
+                value.u64 = 0;
+            else if (record->_type == R4A_ESP32_NVM_PT_P_CHAR)
+            {
+                // Allocate the string value
+                stringValue = (char *)r4aMalloc(record->_length, "NVM char value (newValue)");
+                if (!stringValue)
+                {
+                    if (display && (display != &Serial))
+                        display->println("ERROR: Failed to allocate parameter value string!");
+                    break;
+                }
+                memcpy(stringValue, &strings[record->_value], record->_length);
+                value.pcc = stringValue;
+            }
+            r4aEsp32NvmSetParameterValue(parameter, value.u64);
+        }
+        status = (index == parameterCount);
+    } while (0);
+
+    // Free the NVM data
+    if (nvmData)
+        r4aFree((void *)nvmData, "NVM binary data buffer (nvmData)");
+
+    // Close the file
+    if (parameterFile)
+        parameterFile.close();
+
+    // Rewrite the binary file once the time has moved past the text file
+    // write, the next load then skips the CRC of the text file
+    if (status && textCrcChecked && textTime && ((uint32_t)time(nullptr) > textTime))
+        r4aEsp32NvmWriteBinaryParameters(filePath,
+                                         parameterTable,
+                                         parameterCount,
+                                         display);
+
+    // Return status indicating if the parameters were successfully read
+    return status;
+}
+
 //*********************************************************************
 // Read a line from the file
 // Inputs:
@@ -1751,30 +2601,35 @@ bool r4aEsp32NvmReadLine(File * file,
                 size_t lineLength,
                 Print * display)
 {
-    size_t bytesAvailable;
+    size_t bytesRead;
     uint8_t data;
-    uint8_t * lineEnd;
-
-    // Walk the data in the file until the buffer is full
-    lineEnd = &line[lineLength - 1];
-    while (line < lineEnd)
-    {
-        // Determine if there is more data in the file
-        bytesAvailable = file->available();
-        if (bytesAvailable == 0)
-            break;
+    size_t index;
+    size_t offset;
+    size_t position;
 
-        // Read the next character from the file
-        data = file->read();
+    // Read a block of data from the file
+    position = file->position();
+    bytesRead = file->read(line, lineLength - 1);
+    if ((bytesRead == 0) || (bytesRead >= lineLength))
+        return false;
 
-        // Check for the end of the line
+    // Walk the data in the buffer, discarding the zero bytes
+    offset = 0;
+    for (index = 0; index < bytesRead; index++)
+    {
+        data = line[index];
         if (data)
         {
-            *line++ = data;
+            line[offset++] = data;
+
+            // Check for the end of the line
             if (data == '\n')
             {
                 // Zero terminate the string of characters
-                *line = 0;
+                line[offset] = 0;
+
+                // Position the file at the start of the next line
+                file->seek(position + index + 1);
                 return true;
             }
         }
@@ -1784,12 +2639,162 @@ bool r4aEsp32NvmReadLine(File * file,
     return false;
 }
 
+//*********************************************************************
+// Initialize the line reader
+bool r4aEsp32NvmLineReaderBegin(R4A_ESP32_NVM_LINE_READER * reader,
+                                File * file,
+                                uint8_t * buffer,
+                                size_t bufferBytes)
+{
+    // Verify the buffer
+    if ((!buffer) || (bufferBytes < 2))
+        return false;
+
+    // Initialize the reader
+    reader->_buffer = buffer;
+    reader->_bufferBytes = bufferBytes;
+    reader->_endOfFile = false;
+    reader->_error = false;
+    reader->_file = file;
+    reader->_head = 0;
+    reader->_lineCount = 0;
+    reader->_tail = 0;
+    return true;
+}
+
+//*********************************************************************
+// Get the next line from the file
+char * r4aEsp32NvmLineReaderGetLine(R4A_ESP32_NVM_LINE_READER * reader,
+                                    size_t * lineLength,
+                                    Print * display)
+{
+    uint8_t * buffer;
+    size_t bytesRead;
+    size_t bytesToRead;
+    size_t length;
+    uint8_t * line;
+    uint8_t * lineEnd;
+
+    buffer = reader->_buffer;
+    while (1)
+    {
+        // Look for the end of the line in the buffered data
+        line = &buffer[reader->_head];
+        length = reader->_tail - reader->_head;
+        lineEnd = (uint8_t *)memchr(line, '\n', length);
+        if (lineEnd)
+        {
+            length = lineEnd - line;
+            reader->_head += length + 1;
+            break;
+        }
+
+        // Return the last line which does not end with a linefeed
+        if (reader->_endOfFile)
+        {
+            if (!length)
+                return nullptr;
+            lineEnd = &line[length];
+            reader->_head = reader->_tail;
+            break;
+        }
+
+        // Move the start of the line to the beginning of the buffer
+        if (reader->_head)
+        {
+            memmove(buffer, line, length);
+            reader->_head = 0;
+            reader->_tail = length;
+        }
+
+        // Leave room for the zero termination
+        bytesToRead = reader->_bufferBytes - 1 - reader->_tail;
+        if (!bytesToRead)
+        {
+            if (display)
+                display->printf("ERROR: Line %d longer than %d bytes!\r\n",
+                                reader->_lineCount + 1, reader->_bufferBytes - 1);
+            reader->_endOfFile = true;
+            reader->_error = true;
+            reader->_head = reader->_tail;
+            return nullptr;
+        }
+
+        // Refill the buffer
+        bytesRead = reader->_file->read(&buffer[reader->_tail], bytesToRead);
+        if ((bytesRead == 0) || (bytesRead > bytesToRead))
+            reader->_endOfFile = true;
+        else
+            reader->_tail += bytesRead;
+    }
+
+    // Zero terminate the line and remove the carriage return
+    *lineEnd = 0;
+    if (length && (line[length - 1] == '\r'))
+        line[--length] = 0;
+
+    // Return the line
+    reader->_lineCount += 1;
+    if (lineLength)
+        *lineLength = length;
+    return (char *)line;
+}
+
 //*********************************************************************
 // Read the parameters from a file
 bool r4aEsp32NvmReadParameters(const char * filePath,
                                const R4A_ESP32_NVM_PARAMETER * parameterTable,
                                int parameterCount,
                                Print * display)
+{
+    bool status;
+
+    // Display the call
+    log_v("r4aEsp32NvmReadParameters(%p, %p %d, %p)", (void *) filePath, (void *)parameterTable, parameterCount, (void *)display);
+
+    // Build the lookup index used while parsing the parameters
+    r4aEsp32NvmIndexBuild(parameterTable, parameterCount);
+
+    // Don't allow the parameter files to change during the read
+    r4aEsp32NvmFileLock();
+
+    // Use the binary parameter file when it matches the parameter table
+    status = r4aEsp32NvmReadBinaryParameters(filePath,
+                                             parameterTable,
+                                             parameterCount,
+                                             display);
+    if (!status)
+    {
+        // Parse the text parameter file
+        status = r4aEsp32NvmReadTextParameters(filePath,
+                                               parameterTable,
+                                               parameterCount,
+                                               display);
+
+        // Create the binary parameter file to speed up the next load
+        if (status)
+            r4aEsp32NvmWriteBinaryParameters(filePath,
+                                             parameterTable,
+                                             parameterCount,
+                                             display);
+    }
+
+    // Apply the parameter changes made after the file was written
+    if (status)
+        r4aEsp32NvmJournalReplay(filePath,
+                                 parameterTable,
+                                 parameterCount,
+                                 display);
+    r4aEsp32NvmFileUnlock();
+    return status;
+}
+
+//*********************************************************************
+// Read the parameters from the text parameter file
+bool r4aEsp32NvmReadTextParameters(const char * filePath,
+                                   const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                   int parameterCount,
+                                   Print * display)
 {
     size_t bytesRead;
     size_t fileBytes;
@@ -1798,7 +2803,7 @@ bool r4aEsp32NvmReadParameters(const char * filePath,
     bool status;
 
     // Display the call
-    log_v("r4aEsp32NvmReadParameters(%p, %p %d, %p)", (void *) filePath, (void *)parameterTable, parameterCount, (void *)display);
+    log_v("r4aEsp32NvmReadTextParameters(%p, %p %d, %p)", (void *) filePath, (void *)parameterTable, parameterCount, (void *)display);
 
     // Allocate the available parameter bitmap
     int parameterBytes = (parameterCount + 7) >> 3;
@@ -1884,6 +2889,424 @@ bool r4aEsp32NvmReadParameters(const char * filePath,
     return status;
 }
 
+//*********************************************************************
+// Replace a file with a new file
+bool r4aEsp32NvmReplaceFile(const char * newFilePath,
+                            const char * filePath,
+                            Print * display)
+{
+    // Display the call
+    log_v("r4aEsp32NvmReplaceFile(%p, %p, %p)", (void *)newFilePath, (void *)filePath, (void *)display);
+
+    // Close the buffered writers using the files
+    R4A_ESP32_FILE_WRITER::closeFile(newFilePath);
+    R4A_ESP32_FILE_WRITER::closeFile(filePath);
+
+    // Attempt to rename the file, LittleFS replaces an existing file
+    if (LittleFS.rename(newFilePath, filePath))
+        return true;
+
+    // Remove the existing file and try again
+    if (LittleFS.exists(filePath))
+        LittleFS.remove(filePath);
+    if (LittleFS.rename(newFilePath, filePath))
+        return true;
+    if (display)
+        display->printf("ERROR: Failed to rename %s to %s!\r\n", newFilePath, filePath);
+    return false;
+}
+
+//*********************************************************************
+// Replace the text parameter file, discarding the binary parameter file
+// and the journal which describe the previous parameter file
+bool r4aEsp32NvmReplaceParameterFile(const char * newFilePath,
+                                     const char * filePath,
+                                     Print * display)
+{
+    String binaryPath;
+    String journalPath;
+    bool status;
+
+    // Display the call
+    log_v("r4aEsp32NvmReplaceParameterFile(%p, %p, %p)", (void *)newFilePath, (void *)filePath, (void *)display);
+
+    binaryPath = r4aEsp32NvmBinaryFilePath(filePath);
+    journalPath = r4aEsp32NvmJournalFilePath(filePath);
+
+    // Don't allow a journal append or compaction during the replace
+    r4aEsp32NvmFileLock();
+
+    // Remove the journal before replacing the file, a crash must not
+    // apply the journal entries to the new parameter file.  The binary
+    // parameter file is rebuilt by the next r4aEsp32NvmReadParameters.
+    if (LittleFS.exists(journalPath.c_str()))
+        LittleFS.remove(journalPath.c_str());
+    if (LittleFS.exists(binaryPath.c_str()))
+        LittleFS.remove(binaryPath.c_str());
+
+    // Replace the parameter file
+    status = r4aEsp32NvmReplaceFile(newFilePath, filePath, display);
+    r4aEsp32NvmFileUnlock();
+    return status;
+}
+
+//*********************************************************************
+// Copy the data from a network connection into a file
+bool r4aEsp32NvmStreamToFile(Client * client,
+                             int32_t length,
+                             const char * filePath,
+                             Print * display)
+{
+    uint8_t * buffer;
+    int bytesRead;
+    size_t bytesWritten;
+    uint32_t elapsedMsec;
+    File file;
+    uint32_t lastDataMsec;
+    uint32_t startMsec;
+    bool success;
+    const char * tempFilePath;
+    String tempPath;
+    size_t totalBytes;
+
+    // Display the call
+    log_v("r4aEsp32NvmStreamToFile(%p, %ld, %p, %p)", (void *)client, length, (void *)filePath, (void *)display);
+
+    // Write the data to a temporary file
+    tempPath = String(filePath) + String(R4A_ESP32_NVM_TEMP_EXTENSION);
+    tempFilePath = tempPath.c_str();
+    buffer = nullptr;
+    success = false;
+    totalBytes = 0;
+    do
+    {
+        // Verify the connection
+        if (!client)
+        {
+            if (display)
+                display->printf("ERROR: No connection to read!\r\n");
+            break;
+        }
+
+        // Allocate the transfer buffer
+        buffer = (uint8_t *)r4aMalloc(R4A_ESP32_NVM_STREAM_BUFFER_BYTES,
+                                      "Stream buffer (buffer)");
+        if (!buffer)
+        {
+            if (display)
+                display->printf("ERROR: Failed to allocate the stream buffer!\r\n");
+            break;
+        }
+
+        // Open the temporary file
+        file = LittleFS.open(tempFilePath, FILE_WRITE);
+        if (!file)
+        {
+            if (display)
+                display->printf("ERROR: Failed to open file %s!\r\n", tempFilePath);
+            break;
+        }
+
+        // Copy the data a buffer at a time
+        startMsec = millis();
+        lastDataMsec = startMsec;
+        success = true;
+        while ((length < 0) || (totalBytes < (size_t)length))
+        {
+            // Read the available data
+            bytesRead = client->available();
+            if (bytesRead > 0)
+            {
+                if (bytesRead > R4A_ESP32_NVM_STREAM_BUFFER_BYTES)
+                    bytesRead = R4A_ESP32_NVM_STREAM_BUFFER_BYTES;
+                if ((length >= 0) && ((size_t)bytesRead > (length - totalBytes)))
+                    bytesRead = length - totalBytes;
+                bytesRead = client->read(buffer, bytesRead);
+            }
+
+            // Wait for data, a failed read is handled the same way since
+            // available may report data that read does not return
+            if (bytesRead <= 0)
+            {
+                // Done when the connection closes, the length check
+                // below detects an early close
+                if ((!client->connected()) && (client->available() <= 0))
+                    break;
+
+                // Give up when the data stops arriving
+                if ((millis() - lastDataMsec) >= R4A_ESP32_NVM_STREAM_TIMEOUT_MSEC)
+                {
+                    if (display)
+                        display->printf("ERROR: Timeout waiting for data!\r\n");
+                    success = false;
+                    break;
+                }
+                delay(1);
+                continue;
+            }
+            lastDataMsec = millis();
+
+            // Write the data to the file
+            bytesWritten = file.write(buffer, bytesRead);
+            totalBytes += bytesWritten;
+            if (bytesWritten != (size_t)bytesRead)
+            {
+                if (display)
+                    display->printf("ERROR: Failed to write to file %s!\r\n", tempFilePath);
+                success = false;
+                break;
+            }
+        }
+        elapsedMsec = millis() - startMsec;
+        file.close();
+
+        // Verify that all of the data was received
+        if (success && (length >= 0) && (totalBytes != (size_t)length))
+        {
+            if (display)
+                display->printf("ERROR: Connection closed after %u of %ld bytes!\r\n",
+                                totalBytes, length);
+            success = false;
+        }
+        if (!success)
+            break;
+
+        // Replace the file
+        success = r4aEsp32NvmReplaceFile(tempFilePath, filePath, display);
+        if (!success)
+            break;
+
+        // Display the throughput
+        if (display)
+            display->printf("%s: %u bytes in %lu mSec, %lu bytes/sec\r\n",
+                            filePath,
+                            totalBytes,
+                            elapsedMsec,
+                            elapsedMsec ? (uint32_t)((totalBytes * 1000ull) / elapsedMsec) : 0);
+    } while (0);
+
+    // Remove the partial file
+    if ((!success) && LittleFS.exists(tempFilePath))
+        LittleFS.remove(tempFilePath);
+
+    // Done with the buffer
+    if (buffer)
+        r4aFree(buffer, "Stream buffer (buffer)");
+    return success;
+}
+
+//*********************************************************************
+// Compute the hash of the parameter names and types
+uint32_t r4aEsp32NvmTableHash(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                              int parameterCount)
+{
+    uint32_t hash;
+    const char * name;
+
+    // Compute the FNV-1a hash including the zero terminations
+    hash = 2166136261ul;
+    for (int index = 0; index < parameterCount; index++)
+    {
+        name = parameterTable[index].name;
+        do
+        {
+            hash = (hash ^ (uint8_t)*name) * 16777619ul;
+        } while (*name++);
+        hash = (hash ^ parameterTable[index].type) * 16777619ul;
+    }
+    return hash;
+}
+
+//*********************************************************************
+// Write the parameters to the binary parameter file
+bool r4aEsp32NvmWriteBinaryParameters(const char * filePath,
+                                      const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                      int parameterCount,
+                                      Print * display)
+{
+    String binaryPath;
+    size_t bytesWritten;
+    size_t fileBytes;
+    R4A_ESP32_NVM_BINARY_HEADER * header;
+    int index;
+    size_t length;
+    uint8_t * nvmData;
+    const R4A_ESP32_NVM_PARAMETER * parameter;
+    File parameterFile;
+    const char * path;
+    R4A_ESP32_NVM_BINARY_RECORD * record;
+    R4A_ESP32_NVM_BINARY_RECORD * records;
+    bool status;
+    size_t stringBytes;
+    char * strings;
+    R4A_ESP32_NVM_VALUE value;
+
+    // Display the call
+    log_v("r4aEsp32NvmWriteBinaryParameters(%p, %p %d, %p)", (void *) filePath, (void *)parameterTable, parameterCount, (void *)display);
+
+    // Don't allow the parameter files to change during the write
+    r4aEsp32NvmFileLock();
+
+    // Get the binary file path
+    binaryPath = r4aEsp32NvmBinaryFilePath(filePath);
+    path = binaryPath.c_str();
+
+    // Determine the size of the string area
+    stringBytes = 0;
+    for (index = 0; index < parameterCount; index++)
+    {
+        parameter = &parameterTable[index];
+        if ((parameter->type == R4A_ESP32_NVM_PT_P_CHAR)
+            && *(const char **)(parameter->addr))
+            stringBytes += strlen(*(const char **)(parameter->addr)) + 1;
+    }
+    fileBytes = sizeof(R4A_ESP32_NVM_BINARY_HEADER)
+              + (parameterCount * sizeof(R4A_ESP32_NVM_BINARY_RECORD))
+              + stringBytes;
+
+    nvmData = nullptr;
+    status = false;
+    do
+    {
+        // Allocate the file data buffer
+        nvmData = (uint8_t *)r4aMalloc(fileBytes, "NVM binary data buffer (nvmData)");
+        if (!nvmData)
+        {
+            if (display && (display != &Serial))
+                display->println("ERROR: Failed to allocate write buffer!");
+            break;
+        }
+        memset(nvmData, 0, fileBytes);
+        header = (R4A_ESP32_NVM_BINARY_HEADER *)nvmData;
+        records = (R4A_ESP32_NVM_BINARY_RECORD *)&header[1];
+        strings = (char *)&records[parameterCount];
+
+        // Build the records, values are saved in the same form used by
+        // r4aEsp32NvmSetParameterValue
+        stringBytes = 0;
+        for (index = 0; index < parameterCount; index++)
+        {
+            parameter = &parameterTable[index];
+            record = &records[index];
+            value.u64 = 0;
+            switch (parameter->type)
+            {
+            default:
+                if (display)
+                    display->printf("ERROR: Invalid parameter type: %d\r\n", parameter->type);
+                r4aReportFatalError("r4aEsp32NvmWriteBinaryParameters: Invalid parameter type!");
+                break;
+
+            case R4A_ESP32_NVM_PT_BOOL:
+                value.u64 = *(bool *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_INT8:
+                value.i64 = *(int8_t *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_UINT8:
+                value.u64 = *(uint8_t *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_INT16:
+                value.i64 = *(int16_t *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_UINT16:
+                value.u64 = *(uint16_t *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_INT32:
+                value.i64 = *(int32_t *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_UINT32:
+                value.u64 = *(uint32_t *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_INT64:
+            case R4A_ESP32_NVM_PT_UINT64:
+                value.u64 = *(uint64_t *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_FLOAT:
+                value.d = *(float *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_DOUBLE:
+                value.d = *(double *)(parameter->addr);
+                break;
+
+            case R4A_ESP32_NVM_PT_NULLPTR:
+                break;
+
+            case R4A_ESP32_NVM_PT_P_CHAR:
+                value.pcc = *(const char **)(parameter->addr);
+                if (!value.pcc)
+                    break;
+
+                // Place the string into the string area
+                length = strlen(value.pcc) + 1;
+                memcpy(&strings[stringBytes], value.pcc, length);
+                record->_length = length;
+                record->_type = R4A_ESP32_NVM_PT_P_CHAR;
+                record->_value = stringBytes;
+                stringBytes += length;
+                continue;
+            }
+            record->_type = parameter->type;
+            if (parameter->type == R4A_ESP32_NVM_PT_P_CHAR)
+                record->_type = R4A_ESP32_NVM_PT_NULLPTR;
+            record->_value = value.u64;
+        }
+
+        // Build the header
+        header->_magic = R4A_ESP32_NVM_BINARY_MAGIC;
+        header->_version = R4A_ESP32_NVM_BINARY_VERSION;
+        header->_recordBytes = sizeof(R4A_ESP32_NVM_BINARY_RECORD);
+        header->_parameterCount = parameterCount;
+        header->_tableHash = r4aEsp32NvmTableHash(parameterTable, parameterCount);
+        header->_stringBytes = stringBytes;
+        header->_textBytes = r4aEsp32NvmTextFileCrc(filePath, &header->_textCrc);
+        r4aEsp32NvmFileInfo(filePath, &header->_textTime);
+        header->_crc = esp_rom_crc32_le(0,
+                                        &nvmData[sizeof(R4A_ESP32_NVM_BINARY_HEADER)],
+                                        fileBytes - sizeof(R4A_ESP32_NVM_BINARY_HEADER));
+
+        // Write the file with a single write
+        parameterFile = LittleFS.open(path, "w");
+        if (!parameterFile)
+        {
+            if (display)
+                display->printf("ERROR: Failed to create file %s!\r\n", path);
+            break;
+        }
+        bytesWritten = parameterFile.write(nvmData, fileBytes);
+        if (bytesWritten != fileBytes)
+        {
+            if (display)
+                display->printf("ERROR: Failed to write file %s!\r\n", path);
+            break;
+        }
+        status = true;
+    } while (0);
+
+    // Free the NVM data
+    if (nvmData)
+        r4aFree((void *)nvmData, "NVM binary data buffer (nvmData)");
+
+    // Close the file
+    if (parameterFile)
+        parameterFile.close();
+
+    // Remove the partial file, the text file is used instead
+    if ((!status) && LittleFS.exists(path))
+        LittleFS.remove(path);
+    r4aEsp32NvmFileUnlock();
+    return status;
+}
+
 //*********************************************************************
 // Write the parameters to a file
 bool r4aEsp32NvmWriteParameters(const char * filePath,
@@ -1897,6 +3320,9 @@ bool r4aEsp32NvmWriteParameters(const char * filePath,
     // Display the call
     log_v("r4aEsp32NvmWriteParameters(%p, %p %d, %p, %d)", (void *) filePath, (void *)parameterTable, parameterCount, (void *)display, debug);
 
+    // Don't allow journal appends during the write
+    r4aEsp32NvmFileLock();
+
     // Attempt to open the file
     success = false;
     log_v("Opening the parameter file %s for write", (void *) filePath);
@@ -1934,5 +3360,27 @@ bool r4aEsp32NvmWriteParameters(const char * filePath,
         // Done with the file
         parameterFile.close();
     }
+
+    // Keep the binary parameter file in sync with the text file
+    if (success)
+    {
+        success = r4aEsp32NvmWriteBinaryParameters(filePath,
+                                                   parameterTable,
+                                                   parameterCount,
+                                                   display);
+
+        // The parameter file contains all of the journal changes
+        String journalPath = r4aEsp32NvmJournalFilePath(filePath);
+        if (LittleFS.exists(journalPath.c_str()))
+            LittleFS.remove(journalPath.c_str());
+        r4aEsp32NvmJournalCompactionNeeded = false;
+    }
+    else
+    {
+        String binaryPath = r4aEsp32NvmBinaryFilePath(filePath);
+        if (LittleFS.exists(binaryPath.c_str()))
+            LittleFS.remove(binaryPath.c_str());
+    }
+    r4aEsp32NvmFileUnlock();
     return success;
 }
@@ -11,6 +11,8 @@
 // Types
 //****************************************
 
+#define R4A_OV2640_PIPELINE_FRAMES  2   // Encode one image while sending another
+
 typedef struct _R4A_WEB_PAGE_ENABLES
 {
     int _valueId;
@@ -27,6 +29,38 @@ typedef struct _R4A_WEB_PAGE_VALUES
     int _maxValue;
 } R4A_WEB_PAGE_VALUES;
 
+// JPEG image encoded from a staged frame buffer
+typedef struct _R4A_OV2640_FRAME
+{
+    uint8_t * _buffer;          // JPEG image buffer
+    size_t _bufferBytes;        // Size of the JPEG image buffer in bytes
+    size_t _length;             // Number of bytes in the JPEG image
+    struct timeval _timestamp;  // Time the image was captured
+} R4A_OV2640_FRAME;
+
+// Encode images on one core while the web server sends the previous image
+typedef struct _R4A_OV2640_PIPELINE
+{
+    R4A_OV2640_FRAME _frame[R4A_OV2640_PIPELINE_FRAMES];    // JPEG images
+    QueueHandle_t _freeQueue;       // Frames available for encoding
+    QueueHandle_t _readyQueue;      // Frames ready to send
+    R4A_OV2640_PROCESS_WEB_SERVER_FRAME_BUFFER _processFrame;
+    camera_fb_t _staging;           // Copy of the camera frame buffer
+    size_t _stagingBytes;           // Size of the staging buffer in bytes
+    volatile bool _stop;            // Set to stop the encode task
+    volatile TaskHandle_t _task;    // Encode task
+} R4A_OV2640_PIPELINE;
+
+// Stream sent by a separate task, leaving the web server task available
+// for other requests and streams
+typedef struct _R4A_OV2640_STREAM
+{
+    httpd_req_t * _request;         // Asynchronous copy of the request
+    R4A_OV2640_PROCESS_WEB_SERVER_FRAME_BUFFER _processFrame;
+    R4A_OV2640_STREAM_STATS * _stats;   // Statistics entry for this stream
+    int64_t _frameUsec;             // Time between frames, zero for maximum
+} R4A_OV2640_STREAM;
+
 //****************************************
 // Constants
 //****************************************
@@ -98,11 +132,40 @@ const R4A_PIXEL_FORMAT_MASK_t r4aOv2640SupportedPixelFormats = 0
     | SUPPORTED(R4A_PIXEL_FORMAT_YUV422)
 ;
 
+#define R4A_OV2640_JPEG_HEADER_BYTES    1024    // Space for the JPEG headers
+#define R4A_OV2640_JPEG_QUALITY         80
+
+#define R4A_OV2640_PIPELINE_TIMEOUT_MSEC    2000
+
+#define R4A_OV2640_PIPELINE_CORE            0
+#define R4A_OV2640_PIPELINE_PRIORITY        (tskIDLE_PRIORITY + 2)
+#define R4A_OV2640_PIPELINE_STACK_BYTES     4096
+
+#define R4A_OV2640_STREAM_BOUNDARY      "r4aOv2640Frame"
+
+#define R4A_OV2640_STREAM_PRIORITY      (tskIDLE_PRIORITY + 2)
+#define R4A_OV2640_STREAM_STACK_BYTES   4096
+
+const char * const r4aOv2640StreamContentType = "multipart/x-mixed-replace;boundary=" R4A_OV2640_STREAM_BOUNDARY;
+const char * const r4aOv2640StreamPartHeader = "\r\n--" R4A_OV2640_STREAM_BOUNDARY "\r\n"
+                                               "Content-Type: image/jpeg\r\n"
+                                               "Content-Length: %u\r\n"
+                                               "X-Timestamp: %lld.%06ld\r\n"
+                                               "\r\n";
+
+//****************************************
+// Globals
+//****************************************
+
+uint8_t r4aOv2640StreamFps = 15;    // Default stream frame rate, zero for maximum
+R4A_OV2640_STREAM_STATS r4aOv2640StreamStats[R4A_OV2640_STREAM_MAX];
+R4A_OV2640_TIMING r4aOv2640Timing;  // Image capture, encode and send times
+
 //****************************************
 // Locals
 //****************************************
 
-bool r4aOV2640JpegDisplayTime;  // Set to true to display the JPEG conversion time
+static R4A_OV2640_STREAM r4aOv2640Streams[R4A_OV2640_STREAM_MAX];
 
 //*********************************************************************
 // Display a group of registers
@@ -232,30 +295,178 @@ void r4aOv2640DumpRegisters(Print * display)
     } while (0);
 }
 
+//*********************************************************************
+// Wait for a camera frame buffer
+static camera_fb_t * r4aOv2640FrameBufferGet(int64_t * getUsec)
+{
+    camera_fb_t * frameBuffer;
+    int64_t startUsec;
+
+    startUsec = esp_timer_get_time();
+    frameBuffer = r4aCameraFrameBufferGet();
+    *getUsec = esp_timer_get_time();
+    if (frameBuffer)
+    {
+        r4aOv2640Timing._captured += 1;
+        r4aOv2640Timing._captureUsec += *getUsec - startUsec;
+    }
+    return frameBuffer;
+}
+
+//*********************************************************************
+// Return the frame buffer to the camera driver
+static void r4aOv2640FrameBufferFree(camera_fb_t * frameBuffer, int64_t getUsec)
+{
+    uint32_t holdUsec;
+
+    r4aCameraFrameBufferFree(frameBuffer);
+
+    // Account for the time the camera driver was without this buffer
+    holdUsec = (uint32_t)(esp_timer_get_time() - getUsec);
+    r4aOv2640Timing._holdUsec += holdUsec;
+    if (r4aOv2640Timing._maxHoldUsec < holdUsec)
+        r4aOv2640Timing._maxHoldUsec = holdUsec;
+}
+
+//*********************************************************************
+// Add a chunk of the JPEG image to the frame
+static size_t r4aOv2640FrameEncodeChunk(void * arg,
+                                        size_t index,
+                                        const void * data,
+                                        size_t len)
+{
+    R4A_OV2640_FRAME * frame;
+
+    frame = (R4A_OV2640_FRAME *)arg;
+    if ((frame->_length + len) > frame->_bufferBytes)
+        return 0;
+    memcpy(&frame->_buffer[frame->_length], data, len);
+    frame->_length += len;
+    return len;
+}
+
+//*********************************************************************
+// Convert the staged image into a JPEG image
+static bool r4aOv2640FrameEncode(camera_fb_t * image, R4A_OV2640_FRAME * frame)
+{
+    size_t bufferBytes;
+    bool encoded;
+    int64_t startUsec;
+
+    startUsec = esp_timer_get_time();
+
+    // Grow the JPEG buffer, the image size plus the JPEG headers is
+    // the upper bound
+    bufferBytes = image->len + R4A_OV2640_JPEG_HEADER_BYTES;
+    if (frame->_bufferBytes < bufferBytes)
+    {
+        if (frame->_buffer)
+            r4aFree(frame->_buffer, "OV2640 JPEG buffer (_buffer)");
+        frame->_bufferBytes = 0;
+        frame->_buffer = (uint8_t *)r4aMalloc(bufferBytes, "OV2640 JPEG buffer (_buffer)");
+        if (!frame->_buffer)
+        {
+            r4aOv2640Timing._encodeFailures += 1;
+            return false;
+        }
+        frame->_bufferBytes = bufferBytes;
+    }
+
+    // Build the JPEG image
+    frame->_length = 0;
+    frame->_timestamp = image->timestamp;
+    if (image->format == PIXFORMAT_JPEG)
+        encoded = (r4aOv2640FrameEncodeChunk(frame, 0, image->buf, image->len) == image->len);
+    else
+        encoded = frame2jpg_cb(image,
+                               R4A_OV2640_JPEG_QUALITY,
+                               r4aOv2640FrameEncodeChunk,
+                               frame);
+
+    // Account for the encode time
+    if (encoded)
+    {
+        r4aOv2640Timing._encoded += 1;
+        r4aOv2640Timing._encodeUsec += esp_timer_get_time() - startUsec;
+    }
+    else
+        r4aOv2640Timing._encodeFailures += 1;
+    return encoded;
+}
+
+//*********************************************************************
+// Copy the image into the staging buffer and return the frame buffer
+// to the camera driver
+static bool r4aOv2640FrameStage(camera_fb_t * frameBuffer,
+                                int64_t getUsec,
+                                camera_fb_t * staging,
+                                size_t * stagingBytes)
+{
+    uint8_t * buffer;
+    int64_t startUsec;
+
+    startUsec = esp_timer_get_time();
+
+    // Grow the staging buffer, large buffers are allocated in PSRAM
+    buffer = staging->buf;
+    if (*stagingBytes < frameBuffer->len)
+    {
+        if (buffer)
+            r4aFree(buffer, "OV2640 staging buffer (buf)");
+        *stagingBytes = 0;
+        buffer = (uint8_t *)r4aMalloc(frameBuffer->len, "OV2640 staging buffer (buf)");
+        if (buffer)
+            *stagingBytes = frameBuffer->len;
+    }
+
+    // Copy the image and its description
+    if (buffer)
+    {
+        memcpy(buffer, frameBuffer->buf, frameBuffer->len);
+        *staging = *frameBuffer;
+        r4aOv2640Timing._staged += 1;
+        r4aOv2640Timing._copyUsec += esp_timer_get_time() - startUsec;
+    }
+    staging->buf = buffer;
+
+    // Return the frame buffer to the camera driver
+    r4aOv2640FrameBufferFree(frameBuffer, getUsec);
+    return (buffer != nullptr);
+}
+
 //*********************************************************************
 // JPEG image web page handler
 esp_err_t r4aOv2640JpegHandler(httpd_req_t *request)
 {
-    int64_t endTime;
+    const uint8_t * buffer;
     camera_fb_t * frameBuffer;
+    int64_t getUsec;
+    camera_fb_t * image;
+    R4A_OV2640_FRAME jpeg;
+    size_t length;
     R4A_OV2640_PROCESS_WEB_SERVER_FRAME_BUFFER processFrame;
-    int64_t startTime;
+    bool staged;
+    camera_fb_t staging;
+    size_t stagingBytes;
+    int64_t startUsec;
     esp_err_t status;
+    char timestamp[32];
 
     // Get the OV2640 data structure address
     processFrame = (R4A_OV2640_PROCESS_WEB_SERVER_FRAME_BUFFER)request->user_ctx;
 
+    memset(&jpeg, 0, sizeof(jpeg));
+    memset(&staging, 0, sizeof(staging));
+    stagingBytes = 0;
     do
     {
-        startTime = esp_timer_get_time();
-        frameBuffer = nullptr;
         status = ESP_FAIL;
 
         // Claim the camera
         r4aWebServerCameraUserAdd();
 
         // Wait for a frame buffer
-        frameBuffer = r4aCameraFrameBufferGet();
+        frameBuffer = r4aOv2640FrameBufferGet(&getUsec);
 
         // Release the camera
         r4aWebServerCameraUserRemove();
@@ -268,55 +479,260 @@ esp_err_t r4aOv2640JpegHandler(httpd_req_t *request)
             break;
         }
 
+        // Return the frame buffer to the camera driver before encoding
+        // and sending a non-JPEG image
+        image = frameBuffer;
+        if (frameBuffer->format != PIXFORMAT_JPEG)
+        {
+            image = &staging;
+            staged = r4aOv2640FrameStage(frameBuffer, getUsec, &staging, &stagingBytes);
+            frameBuffer = nullptr;
+            if (!staged)
+            {
+                Serial.println("ERROR: Failed to allocate the staging buffer");
+                httpd_resp_send_500(request);
+                break;
+            }
+        }
+
         // Build the response header
         httpd_resp_set_type(request, "image/jpeg");
         httpd_resp_set_hdr(request, "Content-Disposition", "inline; filename=capture.jpg");
         httpd_resp_set_hdr(request, "Access-Control-Allow-Origin", "*");
 
         // Add the timestamp to the header
-        char timestamp[32];
         snprintf(timestamp, sizeof(timestamp), "%lld.%06ld",
-                 frameBuffer->timestamp.tv_sec, frameBuffer->timestamp.tv_usec);
+                 image->timestamp.tv_sec, image->timestamp.tv_usec);
         httpd_resp_set_hdr(request, "X-Timestamp", (const char *)timestamp);
 
         // Process the frame buffer
         if (processFrame)
-            processFrame(frameBuffer, &Serial);
+            processFrame(image, &Serial);
 
-        // Send the captured image
-        if (frameBuffer->format == PIXFORMAT_JPEG)
-        {
-            status = httpd_resp_send(request, (const char *)frameBuffer->buf, frameBuffer->len);
-            if (status != ESP_OK)
-                break;
-        }
-        else
+        // Convert the image to JPEG
+        buffer = image->buf;
+        length = image->len;
+        if (image == &staging)
         {
-            // Break the image into multiple chunks
-            R4A_JPEG_CHUNKING_T jchunk = {request, 0};
-            status = frame2jpg_cb(frameBuffer,
-                                  80,
-                                  r4aOv2640SendJpegChunk,
-                                  &jchunk) ? ESP_OK : ESP_FAIL;
-            if (status != ESP_OK)
-                break;
-            status = httpd_resp_send_chunk(request, NULL, 0);
-            if (status != ESP_OK)
+            if (!r4aOv2640FrameEncode(&staging, &jpeg))
+            {
+                Serial.println("ERROR: Failed to convert the image to JPEG");
+                httpd_resp_send_500(request);
                 break;
+            }
+            buffer = jpeg._buffer;
+            length = jpeg._length;
         }
-        endTime = esp_timer_get_time();
-        if (r4aOV2640JpegDisplayTime)
-            Serial.printf("JPG: %lu bytes %lu mSec", (uint32_t)(frameBuffer->len),
-                          (uint32_t)((endTime - startTime) / 1000));
-        status = ESP_OK;
+
+        // Send the captured image
+        startUsec = esp_timer_get_time();
+        status = httpd_resp_send(request, (const char *)buffer, length);
+        if (status != ESP_OK)
+            break;
+        r4aOv2640Timing._sent += 1;
+        r4aOv2640Timing._sendUsec += esp_timer_get_time() - startUsec;
     } while (0);
 
     // Return the frame buffer
     if (frameBuffer)
-        r4aCameraFrameBufferFree(frameBuffer);
+        r4aOv2640FrameBufferFree(frameBuffer, getUsec);
+
+    // Release the staging buffers
+    if (staging.buf)
+        r4aFree(staging.buf, "OV2640 staging buffer (buf)");
+    if (jpeg._buffer)
+        r4aFree(jpeg._buffer, "OV2640 JPEG buffer (_buffer)");
     return status;
 }
 
+//*********************************************************************
+// Display the stream statistics
+void r4aOv2640MenuStreamStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                              const char * command,
+                              Print * display)
+{
+    r4aOv2640StreamDisplayStats(display);
+}
+
+//*********************************************************************
+// Display the image timing
+void r4aOv2640MenuTiming(const struct _R4A_MENU_ENTRY * menuEntry,
+                         const char * command,
+                         Print * display)
+{
+    r4aOv2640TimingDisplay(display);
+}
+
+//*********************************************************************
+// Get the most recent JPEG image from the pipeline
+static R4A_OV2640_FRAME * r4aOv2640PipelineFrameGet(R4A_OV2640_PIPELINE * pipeline)
+{
+    R4A_OV2640_FRAME * frame;
+    R4A_OV2640_FRAME * newerFrame;
+
+    // Wait for an image
+    if (xQueueReceive(pipeline->_readyQueue,
+                      &frame,
+                      pdMS_TO_TICKS(R4A_OV2640_PIPELINE_TIMEOUT_MSEC)) != pdTRUE)
+        return nullptr;
+
+    // Skip the older images
+    while (xQueueReceive(pipeline->_readyQueue, &newerFrame, 0) == pdTRUE)
+    {
+        xQueueSend(pipeline->_freeQueue, &frame, 0);
+        frame = newerFrame;
+    }
+    return frame;
+}
+
+//*********************************************************************
+// Return the JPEG image to the pipeline
+static void r4aOv2640PipelineFrameRelease(R4A_OV2640_PIPELINE * pipeline,
+                                          R4A_OV2640_FRAME * frame)
+{
+    xQueueSend(pipeline->_freeQueue, &frame, 0);
+}
+
+//*********************************************************************
+// Stop the encode task and release the pipeline resources
+static void r4aOv2640PipelineStop(R4A_OV2640_PIPELINE * pipeline)
+{
+    int index;
+
+    // Stop the encode task
+    if (pipeline->_task)
+    {
+        pipeline->_stop = true;
+        while (pipeline->_task)
+            delay(1);
+    }
+
+    // Release the queues
+    if (pipeline->_freeQueue)
+    {
+        vQueueDelete(pipeline->_freeQueue);
+        pipeline->_freeQueue = nullptr;
+    }
+    if (pipeline->_readyQueue)
+    {
+        vQueueDelete(pipeline->_readyQueue);
+        pipeline->_readyQueue = nullptr;
+    }
+
+    // Release the buffers
+    for (index = 0; index < R4A_OV2640_PIPELINE_FRAMES; index++)
+    {
+        if (pipeline->_frame[index]._buffer)
+        {
+            r4aFree(pipeline->_frame[index]._buffer, "OV2640 JPEG buffer (_buffer)");
+            pipeline->_frame[index]._buffer = nullptr;
+        }
+    }
+    if (pipeline->_staging.buf)
+    {
+        r4aFree(pipeline->_staging.buf, "OV2640 staging buffer (buf)");
+        pipeline->_staging.buf = nullptr;
+    }
+}
+
+//*********************************************************************
+// Capture and encode images while the web server sends the previous image
+static void r4aOv2640PipelineTask(void * parameter)
+{
+    R4A_OV2640_FRAME * frame;
+    camera_fb_t * frameBuffer;
+    int64_t getUsec;
+    R4A_OV2640_PIPELINE * pipeline;
+
+    pipeline = (R4A_OV2640_PIPELINE *)parameter;
+    while (!pipeline->_stop)
+    {
+        // Wait for the web server to release a JPEG buffer
+        if (xQueueReceive(pipeline->_freeQueue, &frame, pdMS_TO_TICKS(100)) != pdTRUE)
+            continue;
+
+        // Copy the image into the staging buffer, returning the frame
+        // buffer to the camera driver before encoding the image
+        frameBuffer = r4aOv2640FrameBufferGet(&getUsec);
+        if (frameBuffer
+            && r4aOv2640FrameStage(frameBuffer,
+                                   getUsec,
+                                   &pipeline->_staging,
+                                   &pipeline->_stagingBytes))
+        {
+            // Process the image
+            if (pipeline->_processFrame)
+                pipeline->_processFrame(&pipeline->_staging, &Serial);
+
+            // Hand the JPEG image to the web server
+            if (r4aOv2640FrameEncode(&pipeline->_staging, frame))
+            {
+                xQueueSend(pipeline->_readyQueue, &frame, portMAX_DELAY);
+                continue;
+            }
+        }
+
+        // Return the buffer and try again
+        xQueueSend(pipeline->_freeQueue, &frame, portMAX_DELAY);
+        delay(10);
+    }
+
+    // Let the stop routine know that the task is done
+    pipeline->_task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+//*********************************************************************
+// Start the encode task
+static bool r4aOv2640PipelineStart(R4A_OV2640_PIPELINE * pipeline,
+                                   R4A_OV2640_PROCESS_WEB_SERVER_FRAME_BUFFER processFrame)
+{
+    R4A_OV2640_FRAME * frame;
+    int index;
+    BaseType_t status;
+
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->_processFrame = processFrame;
+    do
+    {
+        // Allocate the queues
+        pipeline->_freeQueue = xQueueCreate(R4A_OV2640_PIPELINE_FRAMES, sizeof(frame));
+        pipeline->_readyQueue = xQueueCreate(R4A_OV2640_PIPELINE_FRAMES, sizeof(frame));
+        if ((!pipeline->_freeQueue) || (!pipeline->_readyQueue))
+        {
+            Serial.println("ERROR: Failed to allocate the OV2640 pipeline queues");
+            break;
+        }
+
+        // All of the JPEG buffers are available for encoding
+        for (index = 0; index < R4A_OV2640_PIPELINE_FRAMES; index++)
+        {
+            frame = &pipeline->_frame[index];
+            xQueueSend(pipeline->_freeQueue, &frame, 0);
+        }
+
+        // Start the encode task
+        status = xTaskCreatePinnedToCore(r4aOv2640PipelineTask,
+                                         "OV2640 pipeline",
+                                         R4A_OV2640_PIPELINE_STACK_BYTES,
+                                         pipeline,
+                                         R4A_OV2640_PIPELINE_PRIORITY,
+                                         (TaskHandle_t *)&pipeline->_task,
+                                         R4A_OV2640_PIPELINE_CORE);
+        if (status != pdPASS)
+        {
+            pipeline->_task = nullptr;
+            Serial.println("ERROR: Failed to create the OV2640 pipeline task");
+            break;
+        }
+        return true;
+    } while (0);
+
+    // Release the resources
+    r4aOv2640PipelineStop(pipeline);
+    return false;
+}
+
 //*********************************************************************
 // Encode the JPEG image
 size_t r4aOv2640SendJpegChunk(void * arg,
@@ -438,6 +854,313 @@ bool r4aOv2640Setup(const R4A_OV2640_SETUP * ov2640Parameters,
     return cameraInitialized;
 }
 
+//*********************************************************************
+// Display the stream statistics
+void r4aOv2640StreamDisplayStats(Print * display)
+{
+    uint32_t elapsedMsec;
+    uint32_t frames;
+    int index;
+    R4A_OV2640_STREAM_STATS * stats;
+
+    for (index = 0; index < R4A_OV2640_STREAM_MAX; index++)
+    {
+        stats = &r4aOv2640StreamStats[index];
+        if (stats->_startUsec == 0)
+            continue;
+
+        // Compute the rates
+        frames = stats->_frames;
+        elapsedMsec = (uint32_t)((stats->_endUsec - stats->_startUsec) / 1000);
+        display->printf("Stream %d: %s, target %lu fps\r\n", index,
+                        stats->_active ? "Active" : "Closed", stats->_fps);
+        display->printf("    %10lu  Frames\r\n", frames);
+        display->printf("    %10lu  Late frames\r\n", stats->_framesLate);
+        display->printf("    %10llu  Bytes\r\n", stats->_bytes);
+        display->printf("    %10lu  mSec\r\n", elapsedMsec);
+        if (elapsedMsec)
+        {
+            display->printf("    %10.2f  Frames / second\r\n",
+                            (double)frames * 1000. / (double)elapsedMsec);
+            display->printf("    %10llu  Bytes / second\r\n",
+                            stats->_bytes * 1000 / elapsedMsec);
+        }
+        if (frames)
+        {
+            display->printf("    %10llu  Average capture uSec\r\n", stats->_captureUsec / frames);
+            display->printf("    %10llu  Average send uSec\r\n", stats->_sendUsec / frames);
+        }
+    }
+}
+
+//*********************************************************************
+// Send JPEG images to the browser until the browser closes the
+// connection
+static void r4aOv2640StreamTask(void * parameter)
+{
+    size_t bytes;
+    R4A_OV2640_FRAME * frame;
+    camera_fb_t * frameBuffer;
+    int64_t getUsec;
+    uint8_t * jpegBuffer;
+    size_t length;
+    int64_t nextFrameUsec;
+    char partHeader[160];
+    R4A_OV2640_PIPELINE pipeline;
+    httpd_req_t * request;
+    int64_t startUsec;
+    R4A_OV2640_STREAM_STATS * stats;
+    esp_err_t status;
+    R4A_OV2640_STREAM * stream;
+    struct timeval timestamp;
+
+    stream = (R4A_OV2640_STREAM *)parameter;
+    request = stream->_request;
+    stats = stream->_stats;
+
+    // Build the response header
+    httpd_resp_set_type(request, r4aOv2640StreamContentType);
+    httpd_resp_set_hdr(request, "Access-Control-Allow-Origin", "*");
+
+    // Claim the camera for the life of the stream
+    r4aWebServerCameraUserAdd();
+
+    // Encode non-JPEG images on another core while sending the previous
+    // image.  For JPEG images the camera driver captures the next frame
+    // into another frame buffer while this frame is being sent.
+    status = ESP_OK;
+    memset(&pipeline, 0, sizeof(pipeline));
+    if ((r4aCameraGetPixelFormat() != PIXFORMAT_JPEG)
+        && (!r4aOv2640PipelineStart(&pipeline, stream->_processFrame)))
+        status = ESP_FAIL;
+
+    // Send frames until the browser closes the connection
+    nextFrameUsec = stats->_startUsec;
+    while (status == ESP_OK)
+    {
+        // Wait until the next frame is due, skip ahead instead of
+        // bursting when the frames are late
+        if (stream->_frameUsec)
+        {
+            startUsec = esp_timer_get_time();
+            if (nextFrameUsec > startUsec)
+                delay((uint32_t)((nextFrameUsec - startUsec) / 1000));
+            else if ((startUsec - nextFrameUsec) >= stream->_frameUsec)
+            {
+                stats->_framesLate += 1;
+                nextFrameUsec = startUsec;
+            }
+            nextFrameUsec += stream->_frameUsec;
+        }
+
+        // Wait for an image
+        startUsec = esp_timer_get_time();
+        frame = nullptr;
+        frameBuffer = nullptr;
+        if (pipeline._task)
+        {
+            // Get the JPEG image encoded by the pipeline
+            frame = r4aOv2640PipelineFrameGet(&pipeline);
+            stats->_captureUsec += esp_timer_get_time() - startUsec;
+            if (!frame)
+            {
+                Serial.println("ERROR: Failed to capture and encode the image");
+                status = ESP_FAIL;
+                break;
+            }
+            jpegBuffer = frame->_buffer;
+            bytes = frame->_length;
+            timestamp = frame->_timestamp;
+        }
+        else
+        {
+            // Get the JPEG image from the camera
+            frameBuffer = r4aOv2640FrameBufferGet(&getUsec);
+            stats->_captureUsec += esp_timer_get_time() - startUsec;
+            if (!frameBuffer)
+            {
+                Serial.println("ERROR: Failed to capture the image");
+                status = ESP_FAIL;
+                break;
+            }
+            if (frameBuffer->format != PIXFORMAT_JPEG)
+            {
+                r4aOv2640FrameBufferFree(frameBuffer, getUsec);
+                Serial.println("ERROR: Pixel format changed during the stream");
+                status = ESP_FAIL;
+                break;
+            }
+
+            // Process the frame buffer
+            if (stream->_processFrame)
+                stream->_processFrame(frameBuffer, &Serial);
+            jpegBuffer = frameBuffer->buf;
+            bytes = frameBuffer->len;
+            timestamp = frameBuffer->timestamp;
+        }
+
+        // Send the part header and the image
+        startUsec = esp_timer_get_time();
+        length = snprintf(partHeader, sizeof(partHeader), r4aOv2640StreamPartHeader,
+                          bytes, timestamp.tv_sec, timestamp.tv_usec);
+        status = httpd_resp_send_chunk(request, partHeader, length);
+        if (status == ESP_OK)
+            status = httpd_resp_send_chunk(request, (const char *)jpegBuffer, bytes);
+
+        // Release the image
+        if (frameBuffer)
+            r4aOv2640FrameBufferFree(frameBuffer, getUsec);
+        else
+            r4aOv2640PipelineFrameRelease(&pipeline, frame);
+
+        // Account for the frame
+        stats->_endUsec = esp_timer_get_time();
+        stats->_sendUsec += stats->_endUsec - startUsec;
+        if (status == ESP_OK)
+        {
+            stats->_bytes += bytes;
+            stats->_frames += 1;
+            r4aOv2640Timing._sent += 1;
+            r4aOv2640Timing._sendUsec += stats->_endUsec - startUsec;
+        }
+    }
+
+    // Done with the camera
+    r4aOv2640PipelineStop(&pipeline);
+    r4aWebServerCameraUserRemove();
+
+    // Return the request to the web server which closes the connection
+    httpd_req_async_handler_complete(request);
+
+    // Release the statistics entry, leave the values for display
+    r4aAtomicStore32(&stats->_active, 0, __ATOMIC_RELEASE);
+    vTaskDelete(nullptr);
+}
+
+//*********************************************************************
+// Start a stream task to send JPEG images to the browser as a multipart
+// response
+esp_err_t r4aOv2640StreamHandler(httpd_req_t *request)
+{
+    httpd_req_t * asyncRequest;
+    int32_t expected;
+    uint32_t fps;
+    int index;
+    char query[32];
+    R4A_OV2640_STREAM_STATS * stats;
+    esp_err_t status;
+    R4A_OV2640_STREAM * stream;
+    BaseType_t taskStatus;
+    char value[8];
+
+    // Get the target frame rate, /uri?fps=n overrides the default
+    fps = r4aOv2640StreamFps;
+    if ((httpd_req_get_url_query_str(request, query, sizeof(query)) == ESP_OK)
+        && (httpd_query_key_value(query, "fps", value, sizeof(value)) == ESP_OK))
+        fps = strtoul(value, nullptr, 10);
+
+    // Claim a statistics entry for this stream
+    stats = nullptr;
+    for (index = 0; index < R4A_OV2640_STREAM_MAX; index++)
+    {
+        expected = 0;
+        if (r4aAtomicCompare32(&r4aOv2640StreamStats[index]._active,
+                               &expected,
+                               1,
+                               false,
+                               __ATOMIC_ACQUIRE,
+                               __ATOMIC_RELAXED))
+        {
+            stats = &r4aOv2640StreamStats[index];
+            break;
+        }
+    }
+    if (!stats)
+    {
+        httpd_resp_set_status(request, "503 Service Unavailable");
+        return httpd_resp_send(request, "Too many camera streams", HTTPD_RESP_USE_STRLEN);
+    }
+    stats->_bytes = 0;
+    stats->_captureUsec = 0;
+    stats->_fps = fps;
+    stats->_frames = 0;
+    stats->_framesLate = 0;
+    stats->_sendUsec = 0;
+    stats->_startUsec = esp_timer_get_time();
+    stats->_endUsec = stats->_startUsec;
+
+    do
+    {
+        // Take ownership of the request, the web server task returns to
+        // handling other requests while the stream task sends the images
+        status = httpd_req_async_handler_begin(request, &asyncRequest);
+        if (status != ESP_OK)
+        {
+            Serial.printf("ERROR: Failed to start the asynchronous stream, error: %d!\r\n", status);
+            break;
+        }
+
+        // Describe the stream
+        stream = &r4aOv2640Streams[index];
+        stream->_request = asyncRequest;
+        stream->_processFrame = (R4A_OV2640_PROCESS_WEB_SERVER_FRAME_BUFFER)request->user_ctx;
+        stream->_stats = stats;
+        stream->_frameUsec = fps ? (1000 * 1000) / fps : 0;
+
+        // Start the stream task
+        taskStatus = xTaskCreate(r4aOv2640StreamTask,
+                                 "OV2640 stream",
+                                 R4A_OV2640_STREAM_STACK_BYTES,
+                                 stream,
+                                 R4A_OV2640_STREAM_PRIORITY,
+                                 nullptr);
+        if (taskStatus != pdPASS)
+        {
+            Serial.println("ERROR: Failed to create the OV2640 stream task");
+            httpd_req_async_handler_complete(asyncRequest);
+            status = ESP_FAIL;
+            break;
+        }
+        return ESP_OK;
+    } while (0);
+
+    // Release the statistics entry
+    r4aAtomicStore32(&stats->_active, 0, __ATOMIC_RELEASE);
+    return status;
+}
+
+//*********************************************************************
+// Display the image timing
+void r4aOv2640TimingDisplay(Print * display)
+{
+    R4A_OV2640_TIMING timing;
+
+    // Snapshot the values
+    timing = r4aOv2640Timing;
+
+    // Display the camera frame buffer usage
+    display->printf("OV2640 image timing\r\n");
+    display->printf("    %10lu  Frames captured\r\n", timing._captured);
+    if (timing._captured)
+    {
+        display->printf("    %10llu  Average capture uSec\r\n", timing._captureUsec / timing._captured);
+        display->printf("    %10llu  Average frame buffer hold uSec\r\n", timing._holdUsec / timing._captured);
+        display->printf("    %10lu  Maximum frame buffer hold uSec\r\n", timing._maxHoldUsec);
+    }
+
+    // Display the staging, encoding and send times
+    display->printf("    %10lu  Frames staged\r\n", timing._staged);
+    if (timing._staged)
+        display->printf("    %10llu  Average copy uSec\r\n", timing._copyUsec / timing._staged);
+    display->printf("    %10lu  Frames encoded\r\n", timing._encoded);
+    display->printf("    %10lu  Encode failures\r\n", timing._encodeFailures);
+    if (timing._encoded)
+        display->printf("    %10llu  Average encode uSec\r\n", timing._encodeUsec / timing._encoded);
+    display->printf("    %10lu  Frames sent\r\n", timing._sent);
+    if (timing._sent)
+        display->printf("    %10llu  Average send uSec\r\n", timing._sendUsec / timing._sent);
+}
+
 //*********************************************************************
 // Add the supported pixel formats
 void r4aOv2640WebPageAddPixelFormats(String &webPage)
@@ -0,0 +1,205 @@
+/**********************************************************************
+  Pool.cpp
+
+  Robots-For-All (R4A)
+  Size class memory pool with lock-free per core free lists
+
+  This file only depends on R4A_ESP32_Pool.h so that the pool may be
+  built on the host, see examples/Memory_Pool_Benchmark.
+**********************************************************************/
+
+#include <string.h>
+
+#include "R4A_ESP32_Pool.h"
+
+//****************************************
+// Constants
+//****************************************
+
+#define R4A_ESP32_POOL_ALIGN        16
+#define R4A_ESP32_POOL_BLOCK_MASK   0xffff
+#define R4A_ESP32_POOL_TAG_ONE      0x10000
+
+//*********************************************************************
+// Remove a block from a free list
+static uint8_t * r4aEsp32PoolPop(R4A_ESP32_POOL_CLASS * poolClass, int core)
+{
+    uint8_t * block;
+    uint32_t head;
+    uint32_t next;
+
+    // The tag changes with each push and pop, causing the compare and
+    // exchange to fail when another CPU or task modified the list.  The
+    // link is read from the block before the compare and exchange, the
+    // value is discarded when the block was allocated by someone else.
+    head = __atomic_load_n(&poolClass->_head[core], __ATOMIC_ACQUIRE);
+    do
+    {
+        if ((head & R4A_ESP32_POOL_BLOCK_MASK) == 0)
+            return nullptr;
+        block = poolClass->_base
+              + (((head & R4A_ESP32_POOL_BLOCK_MASK) - 1) * poolClass->_blockBytes);
+        next = ((head + R4A_ESP32_POOL_TAG_ONE) & ~R4A_ESP32_POOL_BLOCK_MASK)
+             | (*(volatile uint32_t *)block & R4A_ESP32_POOL_BLOCK_MASK);
+    } while (!__atomic_compare_exchange_n(&poolClass->_head[core],
+                                          &head,
+                                          next,
+                                          true,
+                                          __ATOMIC_ACQUIRE,
+                                          __ATOMIC_ACQUIRE));
+    return block;
+}
+
+//*********************************************************************
+// Add a block to a free list
+static void r4aEsp32PoolPush(R4A_ESP32_POOL_CLASS * poolClass,
+                             int core,
+                             uint8_t * block)
+{
+    uint32_t head;
+    uint32_t next;
+    uint32_t number;
+
+    number = ((block - poolClass->_base) / poolClass->_blockBytes) + 1;
+    head = __atomic_load_n(&poolClass->_head[core], __ATOMIC_RELAXED);
+    do
+    {
+        *(volatile uint32_t *)block = head & R4A_ESP32_POOL_BLOCK_MASK;
+        next = ((head + R4A_ESP32_POOL_TAG_ONE) & ~R4A_ESP32_POOL_BLOCK_MASK) | number;
+    } while (!__atomic_compare_exchange_n(&poolClass->_head[core],
+                                          &head,
+                                          next,
+                                          true,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+//*********************************************************************
+// Allocate a block from the pool
+void * r4aEsp32PoolAlloc(R4A_ESP32_POOL * pool, size_t numberOfBytes, int core)
+{
+    uint8_t * block;
+    uint32_t highWater;
+    int index;
+    uint32_t inUse;
+    R4A_ESP32_POOL_CLASS * poolClass;
+
+    // Locate the size class
+    if (numberOfBytes > R4A_ESP32_POOL_MAX_BYTES)
+        return nullptr;
+    for (index = 0; numberOfBytes > (size_t)(R4A_ESP32_POOL_MIN_BYTES << index); index++)
+        ;
+    poolClass = &pool->_class[index];
+    core %= R4A_ESP32_POOL_CORES;
+
+    // Use this core's free list, take a block from the other core's
+    // free list when this core's free list is empty
+    block = r4aEsp32PoolPop(poolClass, core);
+    if (!block)
+    {
+        block = r4aEsp32PoolPop(poolClass, core ^ 1);
+        if (!block)
+        {
+            __atomic_fetch_add(&poolClass->_exhausted, 1, __ATOMIC_RELAXED);
+            return nullptr;
+        }
+        __atomic_fetch_add(&poolClass->_steals, 1, __ATOMIC_RELAXED);
+    }
+
+    // Update the statistics
+    __atomic_fetch_add(&poolClass->_allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&poolClass->_requestedBytes, numberOfBytes, __ATOMIC_RELAXED);
+    inUse = __atomic_add_fetch(&poolClass->_inUse, 1, __ATOMIC_RELAXED);
+    highWater = __atomic_load_n(&poolClass->_highWater, __ATOMIC_RELAXED);
+    while ((highWater < inUse)
+        && (!__atomic_compare_exchange_n(&poolClass->_highWater,
+                                         &highWater,
+                                         inUse,
+                                         true,
+                                         __ATOMIC_RELAXED,
+                                         __ATOMIC_RELAXED)))
+        ;
+    return block;
+}
+
+//*********************************************************************
+// Determine the number of bytes of memory needed for the pool
+size_t r4aEsp32PoolBytes(const uint16_t * blockCounts)
+{
+    size_t bytes;
+    int index;
+
+    bytes = R4A_ESP32_POOL_ALIGN - 1;
+    for (index = 0; index < R4A_ESP32_POOL_CLASSES; index++)
+        bytes += (size_t)blockCounts[index] * (R4A_ESP32_POOL_MIN_BYTES << index);
+    return bytes;
+}
+
+//*********************************************************************
+// Free a block
+bool r4aEsp32PoolFree(R4A_ESP32_POOL * pool, void * buffer, int core)
+{
+    uint8_t * block;
+    int index;
+    R4A_ESP32_POOL_CLASS * poolClass;
+
+    // Determine if the buffer is in the pool
+    block = (uint8_t *)buffer;
+    if ((block < pool->_base) || (block >= pool->_end))
+        return false;
+
+    // Locate the size class
+    for (index = 0; index < R4A_ESP32_POOL_CLASSES; index++)
+    {
+        poolClass = &pool->_class[index];
+        if (block < poolClass->_end)
+            break;
+    }
+
+    // Return the block to this core's free list
+    r4aEsp32PoolPush(poolClass, core % R4A_ESP32_POOL_CORES, block);
+    __atomic_fetch_sub(&poolClass->_inUse, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+//*********************************************************************
+// Divide the memory into blocks and build the free lists
+void r4aEsp32PoolInit(R4A_ESP32_POOL * pool,
+                      void * memory,
+                      const uint16_t * blockCounts)
+{
+    uint8_t * base;
+    uint32_t block;
+    uint8_t * data;
+    int index;
+    R4A_ESP32_POOL_CLASS * poolClass;
+
+    // Align the first block
+    memset(pool, 0, sizeof(*pool));
+    base = (uint8_t *)(((uintptr_t)memory + R4A_ESP32_POOL_ALIGN - 1)
+                       & ~(uintptr_t)(R4A_ESP32_POOL_ALIGN - 1));
+    data = base;
+
+    // Divide the memory into size classes
+    for (index = 0; index < R4A_ESP32_POOL_CLASSES; index++)
+    {
+        poolClass = &pool->_class[index];
+        poolClass->_base = data;
+        poolClass->_blockBytes = R4A_ESP32_POOL_MIN_BYTES << index;
+        poolClass->_blocks = blockCounts[index];
+        if (poolClass->_blocks > R4A_ESP32_POOL_BLOCK_MASK - 1)
+            poolClass->_blocks = R4A_ESP32_POOL_BLOCK_MASK - 1;
+        data += poolClass->_blocks * poolClass->_blockBytes;
+        poolClass->_end = data;
+
+        // Split the blocks between the free lists
+        for (block = poolClass->_blocks; block > 0; block--)
+            r4aEsp32PoolPush(poolClass,
+                             block % R4A_ESP32_POOL_CORES,
+                             poolClass->_base + ((block - 1) * poolClass->_blockBytes));
+    }
+
+    // Enable the pool after the free lists are built
+    pool->_base = base;
+    __atomic_store_n(&pool->_end, data, __ATOMIC_RELEASE);
+}
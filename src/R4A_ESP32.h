@@ -16,6 +16,7 @@
 
 #include <esp_camera.h>         // IDF built-in, needed for OV2640 camera
 #include <esp_http_server.h>    // IDF built-in, needed for camera web server
+#include <esp_rom_crc.h>        // IDF built-in, CRC-32 computation
 #include <esp_wifi.h>           // IDF built-in
 #include <esp32-hal-i2c.h>      // Built-in
 #include <esp32-hal-spi.h>      // IDF built-in
@@ -29,8 +30,15 @@
 #include <R4A_Robot.h>          // Robots-For-All robot support
 #include <R4A_I2C.h>            // Robots-For-All I2C support
 #include "R4A_ESP32_GPIO.h"     // Robots-For-All ESP32 GPIO declarations
+#include "R4A_ESP32_I2C_Stats.h" // Robots-For-All I2C transaction statistics declarations
 #include "R4A_ESP32_I2S.h"      // Robots-For-All ESP32 I2S Controller declarations
 #include "R4A_ESP32_LEDC.h"     // Robots-For-All ESP32 LED Controller declarations
+#include "R4A_ESP32_Lock.h"     // Robots-For-All ticket lock declarations
+#include "R4A_ESP32_NVM.h"      // Robots-For-All NVM parameter file declarations
+#include "R4A_ESP32_Pool.h"     // Robots-For-All size class memory pool declarations
+#include "R4A_ESP32_Queue.h"    // Robots-For-All command queue declarations
+#include "R4A_ESP32_Ring_Buffer.h" // Robots-For-All ring buffer declarations
+#include "R4A_ESP32_Seqlock.h"  // Robots-For-All double buffered seqlock declarations
 #include "R4A_ESP32_SPI.h"      // Robots-For-All ESP32 SPI declarations
 #include "R4A_ESP32_Timer.h"    // Robots-For-All ESP32 Timer declarations
 #include "R4A_WiFi.h"           // Robots-For-All WiFi support
@@ -543,6 +551,43 @@ int r4aCameraSetWpcEnable(int enable);
 // Verify the camera tables
 void r4aEsp32CameraVerifyTables();
 
+//****************************************
+// Command Queue API
+//****************************************
+
+// Display the command queue statistics
+// Inputs:
+//   queue: Address of the R4A_ESP32_COMMAND_QUEUE data structure
+//   display: Device used for output
+void r4aEsp32CommandQueueDisplayStats(R4A_ESP32_COMMAND_QUEUE * queue,
+                                      Print * display = &Serial);
+
+// Execute a command on the control loop and wait for it to complete.
+// A warning is displayed when the command takes longer than warnUsec,
+// the wait then continues until the command completes.
+// Inputs:
+//   queue: Address of the R4A_ESP32_COMMAND_QUEUE data structure, when
+//          nullptr the routine is called directly
+//   routine: Routine for the control loop to execute
+//   parameter: Parameter for the routine
+//   display: Device used for output
+//   warnUsec: Microseconds to wait before displaying the warning
+void r4aEsp32CommandQueueExecute(R4A_ESP32_COMMAND_QUEUE * queue,
+                                 R4A_ESP32_COMMAND_ROUTINE routine,
+                                 intptr_t parameter,
+                                 Print * display,
+                                 uint32_t warnUsec);
+
+// Display the command queue statistics
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry,
+//              menuParameter is the address of the R4A_ESP32_COMMAND_QUEUE
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32CommandQueueMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                                   const char * command,
+                                   Print * display);
+
 //****************************************
 // ESP32 API
 //****************************************
@@ -714,6 +759,147 @@ void r4aEsp32MenuSystemReset(const struct _R4A_MENU_ENTRY * menuEntry,
                              const char * command,
                              Print * display);
 
+//****************************************
+// File Writer API
+//****************************************
+
+// The file writer keeps the file open and places each record into a
+// RAM ring buffer.  A low priority task writes the buffered data to the
+// file when either the size or time threshold is reached.  Records are
+// never split, a record is dropped when it does not fit in the buffer.
+class R4A_ESP32_FILE_WRITER : public Print
+{
+  private:
+
+    uint8_t * _buffer;          // Ring buffer
+    uint32_t _bufferBytes;      // Size of the ring buffer in bytes
+    volatile uint32_t _bufferedBytes; // Number of bytes in the ring buffer
+    volatile uint32_t _bytesDropped;  // Number of bytes dropped
+    volatile uint32_t _bytesWritten;  // Number of bytes written to the file
+    File _file;                 // File receiving the data
+    uint32_t _flushBytes;       // Flush when this many bytes are buffered
+    volatile uint32_t _flushCount;    // Number of times the buffer was flushed
+    uint32_t _flushMsec;        // Flush buffered data after this many milliseconds
+    volatile bool _flushRequested; // Request the flush task to write the buffer
+    uint32_t _head;             // Offset in the buffer for the next record
+    uint32_t _lastFlushMsec;    // Time of the last flush in milliseconds
+    portMUX_TYPE _lock;         // Synchronize the producers and the flush task
+    uint32_t _maxBufferedBytes; // Maximum number of bytes in the ring buffer
+    SemaphoreHandle_t _mutex;   // Serialize the file writes, kept for the writer's life
+    R4A_ESP32_FILE_WRITER * _next; // Next writer in the list of writers
+    String _path;               // Path to the file
+    volatile uint32_t _recordsDropped; // Number of records dropped
+    volatile uint32_t _recordsQueued;  // Number of records placed in the buffer
+    volatile bool _stop;        // Request the flush task to exit
+    uint32_t _tail;             // Offset in the buffer of the oldest data
+    volatile TaskHandle_t _task;  // Flush task
+
+    // Write the buffered data to the file
+    // Outputs:
+    //   Returns true if all of the buffered data was written
+    bool flushBuffer();
+
+    // Write the buffered data to the file when a threshold is reached
+    // Inputs:
+    //   parameter: Address of the R4A_ESP32_FILE_WRITER object
+    static void flushTask(void * parameter);
+
+    // Create the mutex on first use
+    // Outputs:
+    //   Returns true if the mutex exists
+    bool mutexCreate();
+
+    // Write the buffered data, close the file and free the ring buffer,
+    // the caller must hold the mutex
+    void release();
+
+    // Write the buffered data to the file, the caller must hold the mutex
+    // Outputs:
+    //   Returns true if all of the buffered data was written
+    bool writeBuffer();
+
+  public:
+
+    // Constructor
+    R4A_ESP32_FILE_WRITER();
+
+    // Destructor
+    ~R4A_ESP32_FILE_WRITER();
+
+    // Open the file and start the flush task
+    // Inputs:
+    //   path: Path to the file
+    //   mode: Mode used to open the file, FILE_APPEND or FILE_WRITE
+    //   header: Zero terminated string written when the file is empty
+    //   bufferBytes: Size of the ring buffer in bytes
+    //   flushBytes: Flush the buffer when this many bytes are buffered
+    //   flushMsec: Flush the buffer after this many milliseconds
+    //   display: Device used for output
+    // Outputs:
+    //   Returns true if the writer was successfully started
+    bool begin(const char * path,
+               const char * mode = FILE_APPEND,
+               const char * header = nullptr,
+               uint32_t bufferBytes = 4096,
+               uint32_t flushBytes = 1024,
+               uint32_t flushMsec = 1000,
+               Print * display = &Serial);
+
+    // Close the writers using the file before the file is removed,
+    // renamed or replaced
+    // Inputs:
+    //   path: Path to the file
+    static void closeFile(const char * path);
+
+    // Display the writer statistics
+    // Inputs:
+    //   display: Device used for output
+    void displayStats(Print * display = &Serial);
+
+    // Stop the flush task, write the buffered data and close the file
+    void end();
+
+    // Write the buffered data to the file
+    void flush();
+
+    // Request the flush task to write the buffered data to the file,
+    // does not wait for the write
+    void flushAsync();
+
+    // Determine if the file is open
+    // Outputs:
+    //   Returns true if the file is open
+    bool isOpen();
+
+    // Get the file path
+    // Outputs:
+    //   Returns the path to the file or an empty string
+    const char * path();
+
+    // Get the number of dropped records
+    // Outputs:
+    //   Returns the number of records dropped since begin was called
+    uint32_t recordsDropped();
+
+    // Make the other Print::write routines visible
+    using Print::write;
+
+    // Place a single byte record into the ring buffer
+    // Inputs:
+    //   data: Byte to buffer
+    // Outputs:
+    //   Returns the number of bytes buffered
+    size_t write(uint8_t data);
+
+    // Place a record into the ring buffer, never blocks on the file
+    // Inputs:
+    //   buffer: Address of the record
+    //   length: Number of bytes in the record
+    // Outputs:
+    //   Returns the number of bytes buffered, zero if the record was dropped
+    size_t write(const uint8_t * buffer, size_t length);
+};
+
 //****************************************
 // GPIO API
 //****************************************
@@ -787,6 +973,103 @@ void r4aEsp32GpioValidateTables();
 //   display: Device used for output
 void r4aEsp32HeapDisplay(Print * display = &Serial);
 
+//****************************************
+// Heap Profile API
+//****************************************
+
+#define R4A_ESP32_HEAP_PROFILE_BUCKETS      10  // Lifetime buckets, powers of 4 from 1 mSec
+#define R4A_ESP32_HEAP_PROFILE_BUFFERS      1024    // Power of 2, table of live profiled buffers
+#define R4A_ESP32_HEAP_PROFILE_HEADER_BYTES 16  // Bytes preceding each profiled buffer
+#define R4A_ESP32_HEAP_PROFILE_JSON_BYTES   384 // Buffer size for a JSON tag entry
+#define R4A_ESP32_HEAP_PROFILE_TAG_LENGTH   64  // Maximum tag length in the JSON output
+#define R4A_ESP32_HEAP_PROFILE_TAGS         64  // Power of 2, later tags are counted as Other
+
+extern bool r4aEsp32HeapProfileEnable;  // Set true to profile the following allocations
+
+// Account for an allocation, called by r4aMalloc and r4aDmaMalloc
+// Inputs:
+//   block: Address of the allocated block, R4A_ESP32_HEAP_PROFILE_HEADER_BYTES
+//          larger than the request
+//   numberOfBytes: Number of bytes requested
+//   text: Tag for the allocation, the tag address is hashed
+// Outputs:
+//   Returns the buffer address to return to the caller
+void * r4aEsp32HeapProfileAlloc(void * block,
+                                size_t numberOfBytes,
+                                const char * text);
+
+// Display the tags using the most heap
+// Inputs:
+//   count: Maximum number of tags to display, zero for all
+//   display: Device used for output
+void r4aEsp32HeapProfileDisplay(int count = 0, Print * display = &Serial);
+
+// Dump the tags using the most heap as JSON
+// Inputs:
+//   count: Maximum number of tags to dump, zero for all
+//   display: Device used for output
+void r4aEsp32HeapProfileDump(int count = 0, Print * display = &Serial);
+
+// Account for a free, called by r4aFree and r4aDmaFree.  Only buffers
+// found in the table of live profiled buffers have a header, the memory
+// preceding other buffers is never read.
+// Inputs:
+//   buffer: Address of the buffer passed to the free routine
+// Outputs:
+//   Returns the address of the block to free, the buffer address when
+//   the buffer was allocated without profiling
+void * r4aEsp32HeapProfileFree(void * buffer);
+
+// Send the tags using the most heap as JSON, the optional top=N query
+// parameter limits the number of tags
+// Inputs:
+//   request: Address of a HTTP request object
+// Outputs:
+//   Returns the response status
+esp_err_t r4aEsp32HeapProfileHandler(httpd_req_t * request);
+
+// Display the tags using the most heap
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry,
+//              menuParameter is the number of tags, zero for all
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32HeapProfileMenuDisplay(const struct _R4A_MENU_ENTRY * menuEntry,
+                                    const char * command,
+                                    Print * display);
+
+// Dump the tags using the most heap as JSON
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry,
+//              menuParameter is the number of tags, zero for all
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32HeapProfileMenuDump(const struct _R4A_MENU_ENTRY * menuEntry,
+                                 const char * command,
+                                 Print * display);
+
+// Reset the peaks and counters
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32HeapProfileMenuReset(const struct _R4A_MENU_ENTRY * menuEntry,
+                                  const char * command,
+                                  Print * display);
+
+// Toggle the heap profiling
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32HeapProfileMenuToggle(const struct _R4A_MENU_ENTRY * menuEntry,
+                                   const char * command,
+                                   Print * display);
+
+// Reset the peaks, allocation, free and lifetime counters, the live
+// byte and buffer counts are kept
+void r4aEsp32HeapProfileReset();
+
 //****************************************
 // HTTP API
 //****************************************
@@ -811,10 +1094,18 @@ typedef struct _R4A_TAG_NAME_T
 // ESP32 I2C Bus support
 //****************************************
 
+#define R4A_ESP32_I2C_FIRST_ADDRESS     0x08    // Lowest 7-bit device address, lower are reserved
+#define R4A_ESP32_I2C_LAST_ADDRESS      0x77    // Highest 7-bit device address, higher are reserved
+#define R4A_ESP32_I2C_REFRESH_MSEC      (60 * 1000) // Presence checks scan the bus again after this interval
+
 typedef struct _R4A_ESP32_I2C_BUS
 {
     R4A_I2C_BUS _i2cBus;
     uint8_t _busNumber;     // Number of the I2C bus
+    volatile bool _presentValid;    // Set after the first bus scan
+    volatile uint32_t _present[128 / 32];   // Bit set for each device that responded, cleared on NAK or timeout
+    volatile uint32_t _refreshMsec; // Time of the last bus scan
+    R4A_ESP32_I2C_STATS _stats; // Transaction statistics
 } R4A_ESP32_I2C_BUS;
 
 // Initialize the I2C bus
@@ -836,6 +1127,216 @@ bool r4aEsp32I2cBusBegin(R4A_ESP32_I2C_BUS * esp32I2cBus,
                          Print * display = &Serial,
                          Print * debug = nullptr);
 
+// Probe the I2C bus and update the cached device presence map
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry, the
+//              menu parameter is the address of the R4A_ESP32_I2C_BUS
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32I2cMenuRefresh(const struct _R4A_MENU_ENTRY * menuEntry,
+                            const char * command,
+                            Print * display);
+
+// Display the I2C transaction statistics
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry, the
+//              menu parameter is the address of the R4A_ESP32_I2C_BUS
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32I2cMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                          const char * command,
+                          Print * display);
+
+// Clear the I2C transaction statistics
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry, the
+//              menu parameter is the address of the R4A_ESP32_I2C_BUS
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32I2cMenuStatsClear(const struct _R4A_MENU_ENTRY * menuEntry,
+                               const char * command,
+                               Print * display);
+
+// Dump the I2C transaction statistics in JSON format
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry, the
+//              menu parameter is the address of the R4A_ESP32_I2C_BUS
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32I2cMenuStatsDump(const struct _R4A_MENU_ENTRY * menuEntry,
+                              const char * command,
+                              Print * display);
+
+// Probe an I2C device using a short timeout and update the presence map
+// Inputs:
+//   esp32I2cBus: Address of a R4A_ESP32_I2C_BUS data structure
+//   i2cAddress: Address of the I2C device
+// Outputs:
+//   Returns true if the device responded and false otherwise
+bool r4aEsp32I2cProbe(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                      R4A_I2C_ADDRESS_t i2cAddress);
+
+// Probe a range of I2C addresses and update the presence map.  The first
+// r4aI2cBusEnumerateDevice call scans the bus, later calls are answered
+// from the presence map.  A NAK or timeout clears the bit for the
+// device.  Missing devices are found again by this routine, the "ir"
+// menu command or the scan done by r4aI2cBusEnumerateDevice once
+// R4A_ESP32_I2C_REFRESH_MSEC have passed.  The reserved addresses are
+// never probed.
+// Inputs:
+//   esp32I2cBus: Address of a R4A_ESP32_I2C_BUS data structure
+//   firstAddress: First I2C address to probe
+//   lastAddress: Last I2C address to probe
+// Outputs:
+//   Returns the number of devices that responded in the range
+int r4aEsp32I2cRefresh(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                       R4A_I2C_ADDRESS_t firstAddress = R4A_ESP32_I2C_FIRST_ADDRESS,
+                       R4A_I2C_ADDRESS_t lastAddress = R4A_ESP32_I2C_LAST_ADDRESS);
+
+// Clear the I2C transaction statistics
+// Inputs:
+//   esp32I2cBus: Address of a R4A_ESP32_I2C_BUS data structure
+void r4aEsp32I2cStatsClear(R4A_ESP32_I2C_BUS * esp32I2cBus);
+
+// Display the I2C transaction statistics
+// Inputs:
+//   esp32I2cBus: Address of a R4A_ESP32_I2C_BUS data structure
+//   display: Device used for output
+void r4aEsp32I2cStatsDisplay(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                             Print * display = &Serial);
+
+// Dump the I2C transaction statistics in JSON format, one object per device
+// Inputs:
+//   esp32I2cBus: Address of a R4A_ESP32_I2C_BUS data structure
+//   display: Device used for output
+void r4aEsp32I2cStatsDump(R4A_ESP32_I2C_BUS * esp32I2cBus,
+                          Print * display = &Serial);
+
+//****************************************
+// ESP32 I2C Scheduler API
+//****************************************
+
+// The I2C scheduler task performs a table of periodic device jobs so that
+// the control loop does not wait on the I2C bus.  Each job may write the
+// data posted by r4aEsp32I2cJobWrite and then read the device.  Multiple
+// writes posted before the task runs are coalesced into a single bus write
+// of the latest data.  The read data is published with a timestamp in a
+// snapshot which the control loop copies without taking a lock.
+
+#define R4A_ESP32_I2C_JOB_BYTES         32  // Maximum read or write data bytes
+
+// Data published by an I2C job
+typedef struct _R4A_ESP32_I2C_SNAPSHOT
+{
+    int64_t _usec;          // esp_timer_get_time value when the data was read
+    uint32_t _reads;        // Number of successful reads
+    uint32_t _errors;       // Number of failed transactions
+    bool _failed;           // True when the last transaction failed
+    uint8_t _data[R4A_ESP32_I2C_JOB_BYTES]; // Last data read from the device
+} R4A_ESP32_I2C_SNAPSHOT;
+
+// Periodic I2C device job
+typedef struct _R4A_ESP32_I2C_JOB
+{
+    // Constant values
+    const char * _name;             // Name of the job
+    R4A_I2C_ADDRESS_t _i2cAddress;  // Address of the I2C device
+    const uint8_t * _command;       // Bytes written before the read, may be nullptr
+    uint8_t _commandBytes;          // Number of command bytes
+    uint8_t _readBytes;             // Number of bytes to read, zero for write only jobs
+    uint32_t _periodMsec;           // Milliseconds between reads, zero for write only jobs
+
+    // Write data posted by r4aEsp32I2cJobWrite
+    uint8_t _writeData[R4A_ESP32_I2C_JOB_BYTES];
+    uint8_t _writeBytes;            // Number of bytes in _writeData
+    volatile uint32_t _writePosted; // Incremented for each posted write
+    uint32_t _writeDone;            // Value of _writePosted last written
+
+    // Published data, _snapshot is only accessed by the scheduler task
+    R4A_ESP32_I2C_SNAPSHOT _snapshot;
+    R4A_ESP32_SNAPSHOT<R4A_ESP32_I2C_SNAPSHOT> _published;
+
+    // Scheduler values
+    int64_t _nextUsec;              // Time of the next read
+    uint32_t _maxUsec;              // Maximum job duration in microseconds
+    uint32_t _writes;               // Number of bus writes
+    uint32_t _writesCoalesced;      // Number of posted writes that were replaced
+} R4A_ESP32_I2C_JOB;
+
+// I2C scheduler
+typedef struct _R4A_ESP32_I2C_SCHEDULER
+{
+    R4A_I2C_BUS * _i2cBus;          // I2C bus used by the jobs
+    R4A_ESP32_I2C_JOB * _jobs;      // Table of jobs
+    uint8_t _jobCount;              // Number of entries in the job table
+    volatile bool _stop;            // Set to stop the task
+    volatile TaskHandle_t _task;    // Scheduler task handle
+    uint32_t _passes;               // Number of passes through the job table
+    uint32_t _maxLateUsec;          // Maximum microseconds a read was late
+} R4A_ESP32_I2C_SCHEDULER;
+
+// Get the latest data published by an I2C job
+// Inputs:
+//   job: Address of the R4A_ESP32_I2C_JOB
+//   snapshot: Address of the buffer to receive the snapshot
+// Outputs:
+//   Returns true when the snapshot contains data and false before the
+//   first successful read
+bool r4aEsp32I2cJobSnapshot(R4A_ESP32_I2C_JOB * job,
+                            R4A_ESP32_I2C_SNAPSHOT * snapshot);
+
+// Post data to write to the I2C device, replaces any data not yet written
+// Inputs:
+//   scheduler: Address of the R4A_ESP32_I2C_SCHEDULER
+//   job: Address of the R4A_ESP32_I2C_JOB
+//   data: Address of the data to write
+//   length: Number of bytes to write
+// Outputs:
+//   Returns true if the data was posted and false if length is too large
+bool r4aEsp32I2cJobWrite(R4A_ESP32_I2C_SCHEDULER * scheduler,
+                         R4A_ESP32_I2C_JOB * job,
+                         const uint8_t * data,
+                         size_t length);
+
+// Start the I2C scheduler task
+// Inputs:
+//   scheduler: Address of the R4A_ESP32_I2C_SCHEDULER
+//   i2cBus: Address of the I2C bus used by the jobs
+//   jobs: Address of the job table
+//   jobCount: Number of entries in the job table
+//   core: Core on which the scheduler task runs
+//   display: Device used for error output
+// Outputs:
+//   Returns true if the task was started and false upon failure
+bool r4aEsp32I2cSchedulerBegin(R4A_ESP32_I2C_SCHEDULER * scheduler,
+                               R4A_I2C_BUS * i2cBus,
+                               R4A_ESP32_I2C_JOB * jobs,
+                               uint8_t jobCount,
+                               BaseType_t core,
+                               Print * display = &Serial);
+
+// Display the I2C scheduler statistics
+// Inputs:
+//   scheduler: Address of the R4A_ESP32_I2C_SCHEDULER
+//   display: Device used for output
+void r4aEsp32I2cSchedulerDisplayStats(R4A_ESP32_I2C_SCHEDULER * scheduler,
+                                      Print * display = &Serial);
+
+// Stop the I2C scheduler task
+// Inputs:
+//   scheduler: Address of the R4A_ESP32_I2C_SCHEDULER
+void r4aEsp32I2cSchedulerEnd(R4A_ESP32_I2C_SCHEDULER * scheduler);
+
+// Display the I2C scheduler statistics
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry, the
+//              menu parameter is the address of the R4A_ESP32_I2C_SCHEDULER
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32I2cSchedulerMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                                   const char * command,
+                                   Print * display);
+
 //****************************************
 // I2S API
 //****************************************
@@ -951,231 +1452,60 @@ void r4aEsp32MenuLedCDisplaySummary(const R4A_MENU_ENTRY * menuEntry,
                                     Print * display);
 
 //****************************************
-// Memory API
-//****************************************
-
-extern bool r4aMallocDebug;
-extern size_t r4aMallocMaxBytes;
-
-//****************************************
-// NVM API
+// Lock API
 //****************************************
 
-#define R4A_ESP32_NVM_STRING(x)     ((uint64_t)(intptr_t)(const char *)x)
-#define R4A_ESP32_NVM_FLOAT_CONV    ((double)(0x10000000ull))
-#define R4A_ESP32_NVM_FLT(x)        ((uint64_t)(((double)x) * R4A_ESP32_NVM_FLOAT_CONV))
-
-enum R4A_ESP32_NVM_PARAMETER_TYPE
-{
-    R4A_ESP32_NVM_PT_NULLPTR = 0,
-    R4A_ESP32_NVM_PT_BOOL,        //  1
-    R4A_ESP32_NVM_PT_INT8,        //  2
-    R4A_ESP32_NVM_PT_UINT8,       //  3
-    R4A_ESP32_NVM_PT_INT16,       //  4
-    R4A_ESP32_NVM_PT_UINT16,      //  5
-    R4A_ESP32_NVM_PT_INT32,       //  6
-    R4A_ESP32_NVM_PT_UINT32,      //  7
-    R4A_ESP32_NVM_PT_INT64,       //  8
-    R4A_ESP32_NVM_PT_UINT64,      //  9
-    R4A_ESP32_NVM_PT_FLOAT,       // 10
-    R4A_ESP32_NVM_PT_DOUBLE,      // 11
-    R4A_ESP32_NVM_PT_P_CHAR,      // 12
-};
-
-typedef union
-{
-    bool     b;
-    int8_t   i8;
-    uint8_t  u8;
-    int16_t  i16;
-    uint16_t u16;
-    int32_t  i32;
-    uint32_t u32;
-    int64_t  i64;
-    uint64_t u64;
-    double   d;     // Float values are cast when read and written
-    const char * pcc;
-    void * pv;
-} R4A_ESP32_NVM_VALUE;
-
-typedef struct _R4A_ESP32_NVM_PARAMETER
-{
-    bool required;
-    uint8_t type;
-    uint64_t minimum;
-    uint64_t maximum;
-    void * addr;
-    const char * name;
-    uint64_t value;
-} R4A_ESP32_NVM_PARAMETER;
-
-extern const char * parameterFilePath; // Path to the parameter file
-extern const R4A_ESP32_NVM_PARAMETER nvmParameters[];
-extern const int nvmParameterCount;
-extern bool r4aEsp32NvmDebug; // Set to true to enable debug output
-
-// Clear a parameter by setting its value to zero
-// Inputs:
-//   filePath: Path to the file to be stored in NVM
-//   parameterTable: Address of the first entry in the parameter table
-//   parameterCount: Number of entries in the parameter table
-//   name: Name of the parameter to be cleared
-//   display: Device used for output
-void r4aEsp32NvmParameterClear(const char * filePath,
-                               const R4A_ESP32_NVM_PARAMETER * parameterTable,
-                               int parameterCount,
-                               const char * name,
-                               Print * display = &Serial);
-
-// Display a parameter
-// Inputs:
-//   parameter: Address of the entry in the parameter table to display
-//   display: Device used for output
-void r4aEsp32NvmDisplayParameter(const R4A_ESP32_NVM_PARAMETER * parameter,
-                                 Print * display = &Serial);
-
-// Display the parameters
-// Inputs:
-//   parameterTable: Address of the first entry in the parameter table
-//   parameterCount: Number of entries in the parameter table
-//   display: Device used for output
-void r4aEsp32NvmDisplayParameters(const R4A_ESP32_NVM_PARAMETER * parameterTable,
-                                  int parameterCount,
-                                  Print * display = &Serial);
-
-// Dump the parameter file
-// Inputs:
-//   filePath: Path to the file contained in the NVM
-//   display: Device used for output
-void r4aEsp32NvmDumpParameterFile(const char * filePath,
-                                  Print * display = &Serial);
-
-// Display the contents of the file
+// Display the lock statistics
 // Inputs:
-//   filePath: Name of the file to dump
+//   lock: Address of the R4A_ESP32_LOCK data structure
 //   display: Device used for output
-void r4aEsp32NvmFileCat(String filePath, Print * display);
-
-// Get the default set of parameters
-// Inputs:
-//   parameterTable: Address of the first entry in the parameter table
-//   parametersCount: Number of parameters in the table
-void r4aEsp32NvmGetDefaultParameters(const R4A_ESP32_NVM_PARAMETER * parameterTable,
-                                     int parametersCount);
-
-// Get a set of parameters
-// Inputs:
-//   filePath: Address of the address of the path to the file contained in the NVM
-//   display: Device used for output, may be nullptr
-//   debug:   Set to true to enable parameter debugging
-// Outputs:
-//   Returns true if successful and false upon failure
-bool r4aEsp32NvmGetParameters(const char ** filePath,
-                              Print * display = nullptr,
-                              bool debug = r4aEsp32NvmDebug);
+void r4aEsp32LockDisplayStats(R4A_ESP32_LOCK * lock, Print * display = &Serial);
 
-// Look up a parameter by address
+// Display the lock statistics
 // Inputs:
-//   parameterTable: Address of the first entry in the parameter table
-//   parameterCount: Number of entries in the parameter table
-//   address: Address of the parameter value
-//   display: Device used for output
-// Outputs:
-//   Returns the address of the found entry in the parameter table or
-//   nullptr if the parameter was not found
-const R4A_ESP32_NVM_PARAMETER * r4aEsp32NvmParameterLookup(const R4A_ESP32_NVM_PARAMETER * parameterTable,
-                                                           int parameterCount,
-                                                           void * address,
-                                                           Print * display);
-
-// Look up a parameter by name
-// Inputs:
-//   parameterTable: Address of the first entry in the parameter table
-//   parameterCount: Number of entries in the parameter table
-//   name: Name of the parameter to be found
+//   menuEntry: Address of the object describing the menu entry,
+//              menuParameter is the address of the R4A_ESP32_LOCK
+//   command: Zero terminated command string
 //   display: Device used for output
-// Outputs:
-//   Returns the address of the found entry in the parameter table or
-//   nullptr if the parameter was not found
-const R4A_ESP32_NVM_PARAMETER * r4aEsp32NvmParameterLookup(const R4A_ESP32_NVM_PARAMETER * parameterTable,
-                                                           int parameterCount,
-                                                           const char * name,
-                                                           Print * display = &Serial);
+void r4aEsp32LockMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                           const char * command,
+                           Print * display);
 
-// Set a parameter value
-// Inputs:
-//   filePath: Path to the file to be stored in NVM
-//   parameterTable: Address of the first entry in the parameter table
-//   parametersCount: Number of parameters in the table
-//   parameter: Address of the specified parameter in the table
-//   valueString: Character string containing the new value
-//   display: Device used for output
-bool r4aEsp32NvmParameterSet(const char * filePath,
-                             const R4A_ESP32_NVM_PARAMETER * parameterTable,
-                             int parameterCount,
-                             const R4A_ESP32_NVM_PARAMETER * parameter,
-                             const char * valueString,
-                             Print * display = &Serial,
-                             bool debug = r4aEsp32NvmDebug);
+//****************************************
+// Memory API
+//****************************************
 
-// Read a line from the file
-// Inputs:
-//   file: Address of the File object
-//   line: Address of the buffer to receive the zero terminated line
-//   lineLength: Number of bytes in the buffer
-//   display: Device used for output, passed to computeWayPoint
-// Outputs:
-//   Returns true if the line was successfully read
-bool r4aEsp32NvmReadLine(File * file,
-                uint8_t * line,
-                size_t lineLength,
-                Print * display);
+extern bool r4aMallocDebug;
+extern size_t r4aMallocMaxBytes;
+extern R4A_ESP32_POOL r4aEsp32Pool;         // Pool used by r4aMalloc
+extern const uint16_t r4aEsp32PoolDefaultBlocks[R4A_ESP32_POOL_CLASSES];
 
-// Read the parameters from a file
+// Display the memory pool statistics
 // Inputs:
-//   filePath: Path to the file contained in the NVM
-//   parameterTable: Address of the first entry in the parameter table
-//   parametersCount: Number of parameters in the table
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
 //   display: Device used for output
-// Outputs:
-//   Returns true if successful and false upon failure
-bool r4aEsp32NvmReadParameters(const char * filePath,
-                               const R4A_ESP32_NVM_PARAMETER * parameterTable,
-                               int parametersCount,
-                               Print * display = &Serial);
-
-// Write a string to the parameter file
-// Inputs:
-//   file: File to which the string is written
-//   string: Address of a zero terminated string of characters
-// Outputs:
-//   Returns true if all of the data was successfully written and false
-//   upon error
-bool r4aEsp32NvmWriteFileString(File &file, const char * string);
+void r4aEsp32PoolMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                           const char * command,
+                           Print * display);
 
-// Write a string to the parameter file
+// Allocate the memory pool from internal SRAM.  Once started, r4aMalloc
+// and the global new operators allocate requests of up to
+// R4A_ESP32_POOL_MAX_BYTES from the pool, falling back to the heap when
+// the size class has no free blocks.  Call this routine early in setup,
+// the pool is never released.
 // Inputs:
-//   file: File to which the string is written
-//   string: Address of a zero terminated string of characters
-//   length: Length of the string in bytes
+//   blockCounts: Number of blocks for each size class
+//   display: Device used for error output
 // Outputs:
-//   Returns true if all of the data was successfully written and false
-//   upon error
-bool r4aEsp32NvmWriteFileString(File &file, const char * string, size_t length);
+//   Returns true if the pool was allocated and false upon failure
+bool r4aEsp32PoolBegin(const uint16_t * blockCounts = r4aEsp32PoolDefaultBlocks,
+                       Print * display = &Serial);
 
-// Write the parameters to a file
+// Display the memory pool statistics
 // Inputs:
-//   filePath: Path to the file to be stored in NVM
-//   parameterTable: Address of the first entry in the parameter table
-//   parametersCount: Number of parameters in the table
 //   display: Device used for output
-// Outputs:
-//   Returns true if successful and false upon failure
-bool r4aEsp32NvmWriteParameters(const char * filePath,
-                                const R4A_ESP32_NVM_PARAMETER * parameterTable,
-                                int parametersCount,
-                                Print * display = &Serial,
-                                bool debug = r4aEsp32NvmDebug);
+void r4aEsp32PoolDisplayStats(Print * display = &Serial);
 
 //****************************************
 // NVM Menu API
@@ -1375,6 +1705,39 @@ typedef struct _R4A_OV2640_SETUP
     uint8_t _frameBufferCount;      // Number of frame buffers to allocate
 } R4A_OV2640_SETUP;
 
+#define R4A_OV2640_STREAM_MAX       2   // Maximum number of simultaneous streams
+
+// OV2640 stream statistics, the values remain after the stream closes
+typedef struct _R4A_OV2640_STREAM_STATS
+{
+    int32_t _active;                // Non-zero while the stream is running
+    uint32_t _fps;                  // Target frame rate, zero for maximum
+    uint32_t _frames;               // Number of frames sent
+    uint32_t _framesLate;           // Number of frames that missed the frame time
+    uint64_t _bytes;                // Number of image bytes sent
+    uint64_t _captureUsec;          // Total time waiting for frame buffers
+    uint64_t _sendUsec;             // Total time sending the frames
+    int64_t _startUsec;             // Time the stream started
+    int64_t _endUsec;               // Time the last frame was sent
+} R4A_OV2640_STREAM_STATS;
+
+// OV2640 image timing, the non-JPEG images are copied into a staging
+// buffer so that the frame buffer is returned before encoding the image
+typedef struct _R4A_OV2640_TIMING
+{
+    uint32_t _captured;             // Number of frame buffers received
+    uint32_t _staged;               // Number of images copied to the staging buffer
+    uint32_t _encoded;              // Number of images converted to JPEG
+    uint32_t _encodeFailures;       // Number of JPEG conversion failures
+    uint32_t _sent;                 // Number of images sent
+    uint32_t _maxHoldUsec;          // Longest time holding a frame buffer
+    uint64_t _captureUsec;          // Total time waiting for frame buffers
+    uint64_t _holdUsec;             // Total time holding frame buffers
+    uint64_t _copyUsec;             // Total time copying to the staging buffer
+    uint64_t _encodeUsec;           // Total time converting images to JPEG
+    uint64_t _sendUsec;             // Total time sending the images
+} R4A_OV2640_TIMING;
+
 // Display a group of registers
 // Inputs:
 //   firstRegister: The register address of the first register to be displayed
@@ -1396,6 +1759,24 @@ void r4aOv2640DumpRegisters(Print * display = &Serial);
 //   Returns operation status
 esp_err_t r4aOv2640JpegHandler(httpd_req_t *request);
 
+// Display the stream statistics
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aOv2640MenuStreamStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                              const char * command,
+                              Print * display);
+
+// Display the image timing
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aOv2640MenuTiming(const struct _R4A_MENU_ENTRY * menuEntry,
+                         const char * command,
+                         Print * display);
+
 // Encode the JPEG image
 // Inputs:
 //   arg: Address of a R4A_JPEG_CHUNKING_T data structure
@@ -1418,6 +1799,29 @@ size_t r4aOv2640SendJpegChunk(void * arg,
 bool r4aOv2640Setup(const R4A_OV2640_SETUP * parameters,
                     Print * display = &Serial);
 
+// Display the stream statistics
+// Inputs:
+//   display: Address of Print object for output
+void r4aOv2640StreamDisplayStats(Print * display = &Serial);
+
+// Stream JPEG images to the browser using a multipart/x-mixed-replace
+// response.  The handler hands the request to a stream task which holds
+// the connection until the browser closes it, leaving the web server task
+// free to serve other requests and up to R4A_OV2640_STREAM_MAX streams.
+// Non-JPEG images are encoded by a pipeline task while the previous image
+// is sent.  The URI option fps=n overrides the default frame rate, zero
+// sends frames as fast as possible.
+// Inputs:
+//   request: Request from the browser
+// Outputs:
+//   Returns operation status
+esp_err_t r4aOv2640StreamHandler(httpd_req_t *request);
+
+// Display the image timing
+// Inputs:
+//   display: Address of Print object for output
+void r4aOv2640TimingDisplay(Print * display = &Serial);
+
 // Build web page describing the OV2640
 // Inputs:
 //   request: Address of a httpd_req_t data structure
@@ -1434,7 +1838,9 @@ void r4aOv2640WebPageAddButton(String &webPage,
                                const char * currentWebPage,
                                const char * buttonText);
 
-extern bool r4aOv2640JpegDisplayTime;   // Set to true to display the JPEG conversion time
+extern uint8_t r4aOv2640StreamFps;      // Default stream frame rate, zero for maximum
+extern R4A_OV2640_STREAM_STATS r4aOv2640StreamStats[R4A_OV2640_STREAM_MAX];
+extern R4A_OV2640_TIMING r4aOv2640Timing;   // Image capture, encode and send times
 
 // Supported frame sizes and pixel formats
 extern const R4A_FRAME_SIZE_MASK_t r4aOv2640SupportedFrameSizes;
@@ -1446,6 +1852,94 @@ extern const R4A_PIXEL_FORMAT_MASK_t r4aOv2640SupportedPixelFormats;
 
 typedef spi_device_handle_t * R4A_SPI_CONTEXT;
 
+#define R4A_ESP32_SPI_DEVICE_MAX    6   // Devices with queues and statistics
+#define R4A_ESP32_SPI_QUEUE_SIZE    7   // Queued transactions per device
+
+struct _R4A_ESP32_SPI_TRANSACTION;
+
+// Called when a queued SPI transaction completes
+// Inputs:
+//   transaction: Address of the completed R4A_ESP32_SPI_TRANSACTION
+//   success: True when the transaction was successful
+typedef void (* R4A_ESP32_SPI_CALLBACK)(struct _R4A_ESP32_SPI_TRANSACTION * transaction,
+                                        bool success);
+
+// The transaction and its buffers must remain valid until completion
+typedef struct _R4A_ESP32_SPI_TRANSACTION
+{
+    spi_transaction_t _transaction;     // ESP-IDF transaction
+    const R4A_SPI_DEVICE * _spiDevice;  // SPI device performing the transaction
+    R4A_ESP32_SPI_CALLBACK _callback;   // Completion routine, may be nullptr
+    void * _context;                    // Caller data for the completion routine
+    int64_t _startUsec;                 // Time the transaction was submitted
+    volatile int64_t _doneUsec;         // Time the transaction completed
+} R4A_ESP32_SPI_TRANSACTION;
+
+// Double buffered frame engine for LED strings, see r4aEsp32SpiFrameTransfer
+typedef struct _R4A_ESP32_SPI_FRAME
+{
+    uint8_t * _buffer[2];       // DMA buffers, one filling while the other is sent
+    R4A_ESP32_SPI_TRANSACTION _transaction[2];
+    size_t _bufferBytes;        // Size of each DMA buffer
+    size_t _length;             // Length of the last frame sent
+    uint8_t _next;              // Index of the buffer to fill next
+    bool _force;                // Send the next frame even if unchanged
+    bool _inFlight;             // Previous frame not yet complete
+
+    // Statistics
+    uint32_t _frames;           // Frames sent
+    uint32_t _skipped;          // Unchanged frames not sent
+    uint64_t _latencyUsec;      // Total request to completion time
+    uint32_t _latencyUsecMax;   // Maximum request to completion time
+} R4A_ESP32_SPI_FRAME;
+
+// Per-device queue state and statistics
+typedef struct _R4A_ESP32_SPI_DEVICE_STATE
+{
+    const R4A_SPI_DEVICE * _spiDevice;  // Device using this entry, nullptr when free
+    bool _batchActive;          // Bus held by r4aEsp32SpiBatchBegin
+    TaskHandle_t _batchTask;    // Task holding the bus for the batch
+    uint32_t _inFlight;         // Queued transactions not yet completed
+    int64_t _busStartUsec;      // Time the bus was acquired
+    R4A_ESP32_SPI_FRAME * _frame;   // Frame engine, allocated on first use
+    SemaphoreHandle_t _frameMutex;  // Serializes the frame engine between tasks
+
+    // Statistics
+    uint32_t _transactions;     // Completed transactions
+    uint32_t _polled;           // Transactions using polling
+    uint32_t _queued;           // Transactions using the queue
+    uint32_t _errors;           // Failed transactions
+    uint64_t _bytes;            // Data bytes transferred
+    uint64_t _busUsec;          // Time the bus was held
+    uint64_t _latencyUsec;      // Total submit to completion time
+    uint32_t _latencyUsecMax;   // Maximum submit to completion time
+} R4A_ESP32_SPI_DEVICE_STATE;
+
+extern R4A_ESP32_SPI_DEVICE_STATE r4aEsp32SpiDeviceState[R4A_ESP32_SPI_DEVICE_MAX];
+extern uint32_t r4aEsp32SpiPollBytes;   // Use polling for transfers of this size or smaller
+
+// Start a batch of queued transactions, acquire the SPI bus and select
+// the device.  The bus is held until r4aEsp32SpiBatchEnd is called.
+// Only the calling task may queue transactions or end the batch, other
+// tasks using the device wait for the bus.
+// Inputs:
+//   spiDevice: Address of an R4A_SPI_DEVICE data structure
+//   display: Address of Print object for output, may be nullptr
+// Outputs:
+//   Return true if successful and false upon failure
+bool r4aEsp32SpiBatchBegin(const R4A_SPI_DEVICE * spiDevice,
+                           Print * display = nullptr);
+
+// Wait for the queued transactions to complete, deselect the device and
+// release the SPI bus
+// Inputs:
+//   spiDevice: Address of an R4A_SPI_DEVICE data structure
+//   display: Address of Print object for output, may be nullptr
+// Outputs:
+//   Return true if successful and false upon failure
+bool r4aEsp32SpiBatchEnd(const R4A_SPI_DEVICE * spiDevice,
+                         Print * display = nullptr);
+
 // Initialize the SPI controller
 // Inputs:
 //   spiBus: Address of an R4A_SPI_BUS data structure
@@ -1455,6 +1949,16 @@ typedef spi_device_handle_t * R4A_SPI_CONTEXT;
 bool r4aEsp32SpiBegin(const R4A_SPI_BUS * spiBus,
                       Print * display = nullptr);
 
+// Get the results of the completed transactions and call their
+// completion routines
+// Inputs:
+//   spiDevice: Address of an R4A_SPI_DEVICE data structure
+//   ticksToWait: Number of ticks to wait for the first completion
+// Outputs:
+//   Returns the number of completed transactions
+int r4aEsp32SpiComplete(const R4A_SPI_DEVICE * spiDevice,
+                        TickType_t ticksToWait);
+
 // Translate a controller number into a controller base register address
 // Inputs:
 //   number: Number of the SPI controller (0 - 3)
@@ -1478,12 +1982,46 @@ spi_device_handle_t * r4aEsp32SpiDeviceHandleAddr(const R4A_SPI_DEVICE * spiDevi
 bool r4aEsp32SpiDeviceHandleInit(const R4A_SPI_DEVICE * spiDevice,
                                  Print * display = nullptr);
 
+// Display the SPI device statistics
+// Inputs:
+//   display: Address of Print object for output
+void r4aEsp32SpiDisplayStats(Print * display = &Serial);
+
 // Display the SPI registers
 // Inputs:
 //   spiAddress: Address of the SPI controller
 //   display: Address of Print object for output
 void r4aEsp32SpiDisplayRegisters(uintptr_t spiAddress, Print * display = &Serial);
 
+// Send the next frame even if it has not changed
+// Inputs:
+//   spiDevice: Address of an R4A_SPI_DEVICE data structure
+void r4aEsp32SpiFrameForce(const R4A_SPI_DEVICE * spiDevice);
+
+// Frame transfer routine for LED strings, use as the R4A_SPI_BUS
+// transfer routine.  Unchanged frames are skipped, a changed frame is
+// copied into the idle DMA buffer while the previous frame is being
+// sent and queued without waiting for completion.  Transfers with
+// receive data use r4aEsp32SpiTransfer.
+// Inputs:
+//   spiDevice: Address of an R4A_SPI_DEVICE data structure
+//   txDmaBuffer: Address of the buffer containing the data to send
+//   rxDmaBuffer: Address of the receive data buffer, maybe nullptr
+//   length: Number of data bytes in the buffer
+//   display: Address of Print object for output, maybe nullptr
+// Outputs:
+//   Return true if successful and false upon failure
+bool r4aEsp32SpiFrameTransfer(const struct _R4A_SPI_DEVICE * spiDevice,
+                              const uint8_t * txDmaBuffer,
+                              uint8_t * rxDmaBuffer,
+                              size_t length,
+                              Print * display = nullptr);
+
+// Wait for the previous frame to be sent
+// Inputs:
+//   spiDevice: Address of an R4A_SPI_DEVICE data structure
+void r4aEsp32SpiFrameWait(const R4A_SPI_DEVICE * spiDevice);
+
 // Get the SPI clock frequency
 // Inputs:
 //   spi: Address of the SPI controller
@@ -1492,6 +2030,37 @@ void r4aEsp32SpiDisplayRegisters(uintptr_t spiAddress, Print * display = &Serial
 //   Return the SPI controller clock frequency
 uint32_t r4aEsp32SpiGetClock(R4A_ESP32_SPI_REGS * spi, Print * display = nullptr);
 
+// Display the SPI device statistics
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32SpiMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                          const char * command,
+                          Print * display);
+
+// Queue a SPI transaction, r4aEsp32SpiBatchBegin must be called first.
+// Small transfers use polling when no other transactions are queued.
+// Inputs:
+//   transaction: Address of an R4A_ESP32_SPI_TRANSACTION data structure
+//   spiDevice: Address of an R4A_SPI_DEVICE data structure
+//   txDmaBuffer: Address of the buffer containing the data to send, maybe nullptr
+//   rxDmaBuffer: Address of the receive data buffer, maybe nullptr
+//   length: Number of data bytes in the buffer
+//   callback: Completion routine address, may be nullptr
+//   context: Caller data for the completion routine
+//   display: Address of Print object for output, maybe nullptr
+// Outputs:
+//   Return true if successful and false upon failure
+bool r4aEsp32SpiQueue(R4A_ESP32_SPI_TRANSACTION * transaction,
+                      const R4A_SPI_DEVICE * spiDevice,
+                      const uint8_t * txDmaBuffer,
+                      uint8_t * rxDmaBuffer,
+                      size_t length,
+                      R4A_ESP32_SPI_CALLBACK callback = nullptr,
+                      void * context = nullptr,
+                      Print * display = nullptr);
+
 // Transfer the data to the SPI device
 // Inputs:
 //   spiDevice: Address of an R4A_SPI_DEVICE data structure
@@ -1543,6 +2112,100 @@ void r4aEsp32TimerDisplayRegs(Print * display = &Serial);
 
 extern int r4aEsp32WpPointsToAverage;      // Number of points to average
 extern const char * r4aEsp32WpFileName;    // Waypoint file name
+extern R4A_ESP32_FILE_WRITER r4aEsp32WpWriter; // Buffered waypoint file writer
+
+#define R4A_ESP32_WP_COMMENT_BYTES      23
+
+typedef struct _R4A_ESP32_WP_POINT
+{
+    double _latitude;           // Latitude in degrees (-90 to 90)
+    double _longitude;          // Longitude in degrees (-180 to 180)
+    double _altitude;           // Altitude in meters
+    float _horizontalAccuracy;  // Horizontal accuracy in meters
+    float _horizontalAccuracyStdDev; // Horizontal accuracy standard deviation in meters
+    float _heading;             // Heading to the next point in degrees (0 to 360)
+    float _distance;            // Distance to the next point in meters
+    uint8_t _satellitesInView;  // Number of satellites in view
+    char _comment[R4A_ESP32_WP_COMMENT_BYTES]; // Zero terminated comment
+} R4A_ESP32_WP_POINT;
+
+typedef struct _R4A_ESP32_WP_FILE
+{
+    File _file;                 // Binary waypoint file
+    uint32_t _pointCount;       // Number of points in the file
+} R4A_ESP32_WP_FILE;
+
+// Close the binary waypoint file
+// Inputs:
+//   wpFile: Address of the binary waypoint file object
+void r4aEsp32WpBinaryClose(R4A_ESP32_WP_FILE * wpFile);
+
+// Get the path to the binary waypoint file
+// Outputs:
+//   Returns the path to the binary waypoint file
+String r4aEsp32WpBinaryFilePath();
+
+// Open the binary waypoint file
+// Inputs:
+//   wpFile: Address of the binary waypoint file object
+//   path: Path to the binary waypoint file
+//   display: Device used for output
+// Outputs:
+//   Returns true if the file was successfully opened
+bool r4aEsp32WpBinaryOpen(R4A_ESP32_WP_FILE * wpFile,
+                          const char * path,
+                          Print * display = &Serial);
+
+// Read a point from the binary waypoint file
+// Inputs:
+//   wpFile: Address of the binary waypoint file object
+//   index: Zero based index of the point in the file
+//   point: Address of the buffer to receive the point
+//   display: Device used for output
+// Outputs:
+//   Returns true if the point was successfully read
+bool r4aEsp32WpBinaryReadPoint(R4A_ESP32_WP_FILE * wpFile,
+                               uint32_t index,
+                               R4A_ESP32_WP_POINT * point,
+                               Print * display = &Serial);
+
+// Compute the heading and distance between two points
+// Inputs:
+//   latitude1: Latitude of the first point in degrees
+//   longitude1: Longitude of the first point in degrees
+//   latitude2: Latitude of the second point in degrees
+//   longitude2: Longitude of the second point in degrees
+//   heading: Address to receive the initial heading in degrees (0 to 360)
+//   distance: Address to receive the great circle distance in meters
+void r4aEsp32WpComputeSegment(double latitude1,
+                              double longitude1,
+                              double latitude2,
+                              double longitude2,
+                              float * heading,
+                              float * distance);
+
+// Convert a text waypoint file into a binary waypoint file
+// Inputs:
+//   textPath: Path to the text waypoint file
+//   binaryPath: Path to the binary waypoint file
+//   display: Device used for output
+// Outputs:
+//   Returns true if the file was successfully converted
+bool r4aEsp32WpConvertToBinary(const char * textPath,
+                               const char * binaryPath,
+                               Print * display = &Serial);
+
+// Convert a binary waypoint file into a text waypoint file.  The text is
+// written to <textPath>.tmp which replaces the text file when complete.
+// Inputs:
+//   binaryPath: Path to the binary waypoint file
+//   textPath: Path to the text waypoint file
+//   display: Device used for output
+// Outputs:
+//   Returns true if the file was successfully converted
+bool r4aEsp32WpConvertToText(const char * binaryPath,
+                             const char * textPath,
+                             Print * display = &Serial);
 
 // Add a point to the waypoint file
 // Inputs:
@@ -1553,6 +2216,24 @@ void r4aEsp32WpMenuAddPoint(const R4A_MENU_ENTRY * menuEntry,
                             const char * command,
                             Print * display);
 
+// Convert the waypoint file into a binary waypoint file
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32WpMenuConvertToBinary(const R4A_MENU_ENTRY * menuEntry,
+                                   const char * command,
+                                   Print * display);
+
+// Convert the binary waypoint file into the waypoint file
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32WpMenuConvertToText(const R4A_MENU_ENTRY * menuEntry,
+                                 const char * command,
+                                 Print * display);
+
 // Display a point from the waypoint file
 // Inputs:
 //   menuEntry: Address of the object describing the menu entry
@@ -1580,7 +2261,40 @@ void r4aEsp32WpMenuPrintFile(const R4A_MENU_ENTRY * menuEntry,
                              const char * command,
                              Print * display);
 
-// Read a from the waypoint file
+// Display the waypoint file writer statistics
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32WpMenuWriterStats(const R4A_MENU_ENTRY * menuEntry,
+                               const char * command,
+                               Print * display);
+
+// Parse a point line from the waypoint file
+// Inputs:
+//   line: Zero terminated line from the waypoint file
+//   latitude: Address to receive latitude in degrees
+//   longitude: Address to receive longitude in degrees
+//   altitude: Address to receive altitude in meters
+//   horizontalAccuracy: Address to receive horizontal accuracy in meters
+//   horizontalAccuracyStdDev: Address to receive horizontal accuracy standard deviation in meters
+//   satellitesInView: Address to receive the number of satellites feeding the GNSS receiver
+//   comment: Address of the String to receive the comment
+//   display: Device used for output
+// Outputs:
+//   Returns true if the point was successfully parsed
+bool r4aEsp32WpParsePoint(char * line,
+                          double * latitude,
+                          double * longitude,
+                          double * altitude,
+                          double * horizontalAccuracy,
+                          double * horizontalAccuracyStdDev,
+                          uint8_t * satellitesInView,
+                          String * comment,
+                          Print * display);
+
+// Read a from the waypoint file.  The routine buffers the file data
+// between calls, only one waypoint file may be read at a time.
 // Inputs:
 //   file: Address of tha address of the waypoint file object
 //   fileSize: Address of the value to receive the file size
@@ -1604,6 +2318,30 @@ bool r4aEsp32WpReadPoint(File * file,
                          String * comment,
                          Print * display);
 
+// Read a point from the waypoint file using a line reader
+// Inputs:
+//   reader: Address of the line reader object for the waypoint file
+//   latitude: Address to receive latitude in degrees
+//   longitude: Address to receive longitude in degrees
+//   altitude: Address to receive altitude in meters
+//   horizontalAccuracy: Address to receive horizontal accuracy in meters
+//   horizontalAccuracyStdDev: Address to receive horizontal accuracy standard deviation in meters
+//   satellitesInView: Address to receive the number of satellites feeding the GNSS receiver
+//   comment: Address of the String to receive the comment
+//   display: Device used for output
+// Outputs:
+//   Returns true if the point was found and false when no more points
+//   are available
+bool r4aEsp32WpReadPoint(R4A_ESP32_NVM_LINE_READER * reader,
+                         double * latitude,
+                         double * longitude,
+                         double * altitude,
+                         double * horizontalAccuracy,
+                         double * horizontalAccuracyStdDev,
+                         uint8_t * satellitesInView,
+                         String * comment,
+                         Print * display);
+
 //****************************************
 // Web Server API
 //****************************************
@@ -1631,19 +2369,31 @@ typedef bool (* R4A_WEB_SERVER_REGISTER_ERROR_HANDLERS)(struct _R4A_WEB_SERVER *
 //   false upon failure
 typedef bool (* R4A_WEB_SERVER_REGISTER_URI_HANDLERS)(struct _R4A_WEB_SERVER * object);
 
+// Called after an uploaded file replaces the previous file
+// Inputs:
+//   object: Address of a R4A_WEB_SERVER data structure
+//   filePath: Path to the file in the NVM
+typedef void (* R4A_WEB_SERVER_UPLOAD_COMPLETE)(struct _R4A_WEB_SERVER * object,
+                                                const char * filePath);
+
 typedef struct _R4A_WEB_SERVER
 {
     R4A_WEB_SERVER_CONFIG_UPDATE _configUpdate;
     R4A_WEB_SERVER_REGISTER_ERROR_HANDLERS _registerErrorHandlers;
     R4A_WEB_SERVER_REGISTER_URI_HANDLERS _registerUriHandlers;
+    R4A_WEB_SERVER_UPLOAD_COMPLETE _uploadComplete; // Optional, may be nullptr
     uint16_t _port;             // Port number for the web server
     httpd_handle_t _webServer;  // HTTP server object
+    uint8_t * _buffer;          // File I/O buffer, reused by each request
+    size_t _bufferBytes;        // Size of the file I/O buffer in bytes
 } R4A_WEB_SERVER;
 
+extern uint32_t r4aWebServerBufferBytes;    // File I/O buffer size per web server
 extern bool r4aWebServerEnable;     // Set true to enable the web server
 extern Print * r4aWebServerDebug;   // Address of a Print object for web server debugging
 extern const char * r4aWebServerDownloadArea;   // Directory path for the download area
 extern const char * r4aWebServerNvmArea;   // Directory path for the NVM download area
+extern const char * r4aWebServerUploadPassword; // Basic authorization password for uploads, nullptr disables uploads
 
 // Add a camera user
 void r4aWebServerCameraUserAdd();
@@ -1671,18 +2421,46 @@ bool webServerCheckExtension(R4A_WEB_SERVER * object,
 //   to the browser
 esp_err_t r4aWebServerError (httpd_req_t *request, httpd_err_code_t error);
 
-// Download a file from the robot to the browser
+// Download a file from the robot to the browser.  Supports single byte
+// Range requests, ETag, If-None-Match, Last-Modified, If-Modified-Since
+// and precompressed .gz files.  A directory path returns a JSON listing.
 // Inputs:
 //   request: Address of a HTTP request object
 // Outputs:
 //   Returns the file download status
 esp_err_t r4aWebServerFileDownload(httpd_req_t *request);
 
+// Upload a file from the browser to the robot using PUT or POST.  The
+// request body is written to <file>.tmp which replaces the file when the
+// upload completes.  An optional X-CRC32 header (hex, CRC-32/ISO-HDLC,
+// the zlib crc32 value) is verified before replacing the file.  The
+// request must supply r4aWebServerUploadPassword using Basic
+// authorization, uploads are disabled until the password is set.
+// Replacing the parameter file also removes its binary parameter file
+// and journal.
+// Inputs:
+//   request: Address of a HTTP request object
+// Outputs:
+//   Returns the file upload status
+esp_err_t r4aWebServerFileUpload(httpd_req_t *request);
+
 // Initialize the web server
 // Inputs:
 //   cameraUser: Bit number of the camera user
 void r4aWebServerInit(uint8_t cameraUser);
 
+// Measure the LittleFS read speed in MB/s of a file for each download
+// buffer size from 1024 to 32768 bytes to select r4aWebServerBufferBytes.
+// The file is read using the r4aWebServerFileDownload read loop, the
+// time to send the data to the browser is not included.
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aWebServerMenuBufferSpeed(const R4A_MENU_ENTRY * menuEntry,
+                                 const char * command,
+                                 Print * display);
+
 // Start the web server
 // Inputs:
 //   object: Address of a R4A_WEB_SERVER data structure
@@ -1702,6 +2480,14 @@ void r4aWebServerStop(R4A_WEB_SERVER * object);
 //   wifiConnected: True when WiFi has an IP address and false otherwise
 void r4aWebServerUpdate(R4A_WEB_SERVER * object, bool wifiConnected);
 
+// Upload complete routine which reads the parameters again when the
+// parameter file (parameterFilePath) is replaced
+// Inputs:
+//   object: Address of a R4A_WEB_SERVER data structure
+//   filePath: Path to the file in the NVM
+void r4aWebServerUploadReloadParameters(R4A_WEB_SERVER * object,
+                                        const char * filePath);
+
 //****************************************
 // WiFi
 //****************************************
@@ -0,0 +1,81 @@
+/**********************************************************************
+  R4A_ESP32_I2C_Stats.h
+
+  Robots-For-All (R4A)
+  I2C transaction statistics declarations
+
+  Each device address gets transaction, byte, NAK, timeout and error
+  counters, the total and maximum latency, and a power of two latency
+  histogram starting at 32 uSec.  This file does not depend on the
+  Arduino environment so that the statistics may be built on the host
+  for testing, see examples/I2C_Stats_Test.
+**********************************************************************/
+
+#ifndef __R4A_ESP32_I2C_STATS_H__
+#define __R4A_ESP32_I2C_STATS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef  ESP_PLATFORM
+#include <esp_err.h>            // IDF built-in
+#else   // ESP_PLATFORM
+typedef int esp_err_t;
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_TIMEOUT         0x107
+#endif  // ESP_PLATFORM
+
+#define R4A_ESP32_I2C_HISTOGRAM_BUCKETS 12  // Latency buckets, powers of 2 from 32 uSec
+#define R4A_ESP32_I2C_STATS_DEVICES     16  // Maximum number of devices with statistics
+
+// I2C transaction statistics for a device
+typedef struct _R4A_ESP32_I2C_DEVICE_STATS
+{
+    uint64_t _totalUsec;    // Total microseconds spent in transactions
+    uint32_t _transactions; // Number of transactions
+    uint32_t _bytes;        // Number of bytes written and read
+    uint32_t _naks;         // Number of transactions not acknowledged
+    uint32_t _timeouts;     // Number of transactions that timed out
+    uint32_t _errors;       // Number of other failures, including short reads
+    uint32_t _maxUsec;      // Longest transaction in microseconds
+    uint32_t _histogram[R4A_ESP32_I2C_HISTOGRAM_BUCKETS]; // Bucket n: < (32 << n) uSec, last: longer
+    uint8_t _i2cAddress;    // Address of the I2C device
+} R4A_ESP32_I2C_DEVICE_STATS;
+
+// I2C transaction statistics for a bus
+typedef struct _R4A_ESP32_I2C_STATS
+{
+    R4A_ESP32_I2C_DEVICE_STATS _device[R4A_ESP32_I2C_STATS_DEVICES];
+    uint8_t _index[128];    // _device index + 1 for each address, zero when unassigned
+    uint8_t _devices;       // Number of _device entries in use
+    uint32_t _dropped;      // Transactions not recorded, the _device table is full
+} R4A_ESP32_I2C_STATS;
+
+// Get the latency percentile from the histogram
+// Inputs:
+//   deviceStats: Address of the R4A_ESP32_I2C_DEVICE_STATS data structure
+//   percent: Percentage of the transactions, 1 - 100
+// Outputs:
+//   Returns the microseconds within which at least percent of the
+//   transactions completed, rounded up to the end of the histogram
+//   bucket and limited by the maximum latency.  Returns zero when no
+//   transactions were recorded.
+uint32_t r4aEsp32I2cStatsPercentile(const R4A_ESP32_I2C_DEVICE_STATS * deviceStats,
+                                    uint32_t percent);
+
+// Record an I2C transaction, the caller serializes access to the statistics
+// Inputs:
+//   stats: Address of the R4A_ESP32_I2C_STATS data structure
+//   i2cAddress: Address of the I2C device
+//   bytes: Number of bytes transferred
+//   status: Status of the transaction
+//   usec: Duration of the transaction in microseconds
+void r4aEsp32I2cStatsRecord(R4A_ESP32_I2C_STATS * stats,
+                            uint8_t i2cAddress,
+                            size_t bytes,
+                            esp_err_t status,
+                            uint32_t usec);
+
+#endif  // __R4A_ESP32_I2C_STATS_H__
@@ -0,0 +1,131 @@
+/**********************************************************************
+  R4A_ESP32_Lock.h
+
+  Robots-For-All (R4A)
+  Ticket lock declarations
+
+  The ticket lock grants the lock in request order, so neither core is
+  starved when both cores contend for the lock.  Waiters back off
+  exponentially, scaled by their position in the queue, which reduces
+  the memory traffic on the lock word.  The lock tracks its owner to
+  detect recursive acquires and releases by another task, and keeps
+  acquisition and spin statistics.
+
+  The lock spins, hold it only for short sections of code.  A waiting
+  task that is preempted delays the tasks holding later tickets, so
+  once the backoff reaches its maximum the waiting task yields the CPU
+  between checks, allowing the lock holder or the next ticket holder
+  on the same core to run.
+
+  This file does not depend on the Arduino environment so that the lock
+  may be built on the host for testing and benchmarking.
+**********************************************************************/
+
+#ifndef __R4A_ESP32_LOCK_H__
+#define __R4A_ESP32_LOCK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef  ESP_PLATFORM
+#include <esp_cpu.h>            // IDF built-in, esp_cpu_get_cycle_count
+#include <esp_timer.h>          // IDF built-in, esp_timer_get_time
+#include <freertos/FreeRTOS.h>  // IDF built-in
+#include <freertos/task.h>      // IDF built-in, xTaskGetCurrentTaskHandle
+
+#define R4A_ESP32_LOCK_CORE_ID()    xPortGetCoreID()
+#define R4A_ESP32_LOCK_CYCLES()     ((uint32_t)esp_cpu_get_cycle_count())
+#define R4A_ESP32_LOCK_OWNER()      ((uintptr_t)xTaskGetCurrentTaskHandle())
+#define R4A_ESP32_LOCK_PAUSE()      __asm__ __volatile__ ("nop")
+#define R4A_ESP32_LOCK_USEC()       esp_timer_get_time()
+#define R4A_ESP32_LOCK_YIELD()      taskYIELD()
+
+#else   // ESP_PLATFORM
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// Return the host time in nanoseconds
+static inline uint64_t r4aEsp32LockHostNsec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ull) + now.tv_nsec;
+}
+
+#define R4A_ESP32_LOCK_CORE_ID()    0
+#define R4A_ESP32_LOCK_OWNER()      ((uintptr_t)pthread_self())
+#define R4A_ESP32_LOCK_USEC()       ((int64_t)(r4aEsp32LockHostNsec() / 1000))
+#define R4A_ESP32_LOCK_YIELD()      sched_yield()
+#if defined(__x86_64__) || defined(__i386__)
+#define R4A_ESP32_LOCK_CYCLES()     ((uint32_t)__builtin_ia32_rdtsc())
+#define R4A_ESP32_LOCK_PAUSE()      __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define R4A_ESP32_LOCK_CYCLES()     ((uint32_t)r4aEsp32LockHostNsec())
+#define R4A_ESP32_LOCK_PAUSE()      __asm__ __volatile__ ("yield")
+#else
+#define R4A_ESP32_LOCK_CYCLES()     ((uint32_t)r4aEsp32LockHostNsec())
+#define R4A_ESP32_LOCK_PAUSE()      __asm__ __volatile__ ("" ::: "memory")
+#endif
+
+#endif  // ESP_PLATFORM
+
+#define R4A_ESP32_LOCK_BACKOFF_MIN  4       // Pauses after the first check
+#define R4A_ESP32_LOCK_BACKOFF_MAX  256     // Maximum pauses per waiting task
+
+// Ticket lock
+typedef struct _R4A_ESP32_LOCK
+{
+    const char * _name;                 // Name displayed with the statistics
+    volatile uint32_t _ticket;          // (Next ticket << 16) | ticket being served
+    volatile uintptr_t _owner;          // Task holding the lock, zero when free
+
+    // Statistics, updated while holding the lock
+    uint32_t _acquisitions;             // Number of times the lock was acquired
+    uint32_t _contended;                // Acquisitions that had to wait
+    uint32_t _maxSpinCycles;            // Longest wait in CPU cycles
+    uint64_t _spinCycles;               // Total CPU cycles spent waiting
+
+    // Statistics, updated without the lock
+    volatile uint32_t _timeouts;        // Try acquire calls that timed out
+    volatile uint32_t _recursions;      // Acquire calls by the owner
+    volatile uint32_t _badReleases;     // Release calls by a task not owning the lock
+} R4A_ESP32_LOCK;
+
+// Initialize a R4A_ESP32_LOCK
+#define R4A_ESP32_LOCK_INITIALIZER(name)    {name, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+
+// Acquire the lock, waiting in request order
+// Inputs:
+//   lock: Address of the R4A_ESP32_LOCK data structure
+// Outputs:
+//   Returns true when the lock is acquired and false when the calling
+//   task already holds the lock
+bool r4aEsp32LockAcquire(R4A_ESP32_LOCK * lock);
+
+// Clear the lock statistics
+// Inputs:
+//   lock: Address of the R4A_ESP32_LOCK data structure
+void r4aEsp32LockClearStats(R4A_ESP32_LOCK * lock);
+
+// Release the lock
+// Inputs:
+//   lock: Address of the R4A_ESP32_LOCK data structure
+// Outputs:
+//   Returns true when the lock is released and false when the calling
+//   task does not hold the lock
+bool r4aEsp32LockRelease(R4A_ESP32_LOCK * lock);
+
+// Attempt to acquire the lock.  This routine does not take a ticket so
+// it is not fair, it acquires the lock only when the lock is free.
+// Inputs:
+//   lock: Address of the R4A_ESP32_LOCK data structure
+//   timeoutUsec: Microseconds to wait for the lock, zero for a single attempt
+// Outputs:
+//   Returns true when the lock is acquired and false upon timeout or
+//   when the calling task already holds the lock
+bool r4aEsp32LockTryAcquire(R4A_ESP32_LOCK * lock, uint32_t timeoutUsec);
+
+#endif  // __R4A_ESP32_LOCK_H__
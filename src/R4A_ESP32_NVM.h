@@ -0,0 +1,448 @@
+/**********************************************************************
+  R4A_ESP32_NVM.h
+
+  Robots-For-All (R4A)
+  Non-volatile memory (NVM) parameter file declarations
+
+  This file uses the Arduino File, Client, Print and String classes
+  and must be included after them.  The host test programs supply
+  stand-ins for these classes so that the parameter file support may
+  be built on the host for testing and benchmarking.
+**********************************************************************/
+
+#ifndef __R4A_ESP32_NVM_H__
+#define __R4A_ESP32_NVM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define R4A_ESP32_NVM_STRING(x)     ((uint64_t)(intptr_t)(const char *)x)
+#define R4A_ESP32_NVM_FLOAT_CONV    ((double)(0x10000000ull))
+#define R4A_ESP32_NVM_FLT(x)        ((uint64_t)(((double)x) * R4A_ESP32_NVM_FLOAT_CONV))
+
+enum R4A_ESP32_NVM_PARAMETER_TYPE
+{
+    R4A_ESP32_NVM_PT_NULLPTR = 0,
+    R4A_ESP32_NVM_PT_BOOL,        //  1
+    R4A_ESP32_NVM_PT_INT8,        //  2
+    R4A_ESP32_NVM_PT_UINT8,       //  3
+    R4A_ESP32_NVM_PT_INT16,       //  4
+    R4A_ESP32_NVM_PT_UINT16,      //  5
+    R4A_ESP32_NVM_PT_INT32,       //  6
+    R4A_ESP32_NVM_PT_UINT32,      //  7
+    R4A_ESP32_NVM_PT_INT64,       //  8
+    R4A_ESP32_NVM_PT_UINT64,      //  9
+    R4A_ESP32_NVM_PT_FLOAT,       // 10
+    R4A_ESP32_NVM_PT_DOUBLE,      // 11
+    R4A_ESP32_NVM_PT_P_CHAR,      // 12
+};
+
+typedef union
+{
+    bool     b;
+    int8_t   i8;
+    uint8_t  u8;
+    int16_t  i16;
+    uint16_t u16;
+    int32_t  i32;
+    uint32_t u32;
+    int64_t  i64;
+    uint64_t u64;
+    double   d;     // Float values are cast when read and written
+    const char * pcc;
+    void * pv;
+} R4A_ESP32_NVM_VALUE;
+
+typedef struct _R4A_ESP32_NVM_PARAMETER
+{
+    bool required;
+    uint8_t type;
+    uint64_t minimum;
+    uint64_t maximum;
+    void * addr;
+    const char * name;
+    uint64_t value;
+} R4A_ESP32_NVM_PARAMETER;
+
+typedef struct _R4A_ESP32_NVM_LINE_READER
+{
+    uint8_t * _buffer;      // Buffer containing the file data
+    size_t _bufferBytes;    // Number of bytes in the buffer
+    bool _endOfFile;        // Set when all of the file data was read
+    bool _error;            // Set when a line does not fit in the buffer
+    File * _file;           // File being read
+    size_t _head;           // Offset of the next line in the buffer
+    int _lineCount;         // Number of lines returned
+    size_t _tail;           // Offset of the end of the data in the buffer
+} R4A_ESP32_NVM_LINE_READER;
+
+extern const char * parameterFilePath; // Path to the parameter file
+extern const R4A_ESP32_NVM_PARAMETER nvmParameters[];
+extern const int nvmParameterCount;
+extern bool r4aEsp32NvmDebug; // Set to true to enable debug output
+extern volatile bool r4aEsp32NvmJournalCompactionNeeded; // Set when the journal is too large
+extern size_t r4aEsp32NvmJournalMaxBytes; // Journal size triggering compaction
+
+// Clear a parameter by setting its value to zero
+// Inputs:
+//   filePath: Path to the file to be stored in NVM
+//   parameterTable: Address of the first entry in the parameter table
+//   parameterCount: Number of entries in the parameter table
+//   name: Name of the parameter to be cleared
+//   display: Device used for output
+void r4aEsp32NvmParameterClear(const char * filePath,
+                               const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                               int parameterCount,
+                               const char * name,
+                               Print * display = &Serial);
+
+// Display a parameter
+// Inputs:
+//   parameter: Address of the entry in the parameter table to display
+//   display: Device used for output
+void r4aEsp32NvmDisplayParameter(const R4A_ESP32_NVM_PARAMETER * parameter,
+                                 Print * display = &Serial);
+
+// Display the parameters
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parameterCount: Number of entries in the parameter table
+//   display: Device used for output
+void r4aEsp32NvmDisplayParameters(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                  int parameterCount,
+                                  Print * display = &Serial);
+
+// Dump the parameter file
+// Inputs:
+//   filePath: Path to the file contained in the NVM
+//   display: Device used for output
+void r4aEsp32NvmDumpParameterFile(const char * filePath,
+                                  Print * display = &Serial);
+
+// Display the contents of the file
+// Inputs:
+//   filePath: Name of the file to dump
+//   display: Device used for output
+void r4aEsp32NvmFileCat(String filePath, Print * display);
+
+// Serialize the changes to the parameter values and the parameter files,
+// the lock may be taken again by the task holding it
+void r4aEsp32NvmFileLock();
+
+// Release the parameter file lock
+void r4aEsp32NvmFileUnlock();
+
+// Get the default set of parameters
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+void r4aEsp32NvmGetDefaultParameters(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                     int parametersCount);
+
+// Get a set of parameters
+// Inputs:
+//   filePath: Address of the address of the path to the file contained in the NVM
+//   display: Device used for output, may be nullptr
+//   debug:   Set to true to enable parameter debugging
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmGetParameters(const char ** filePath,
+                              Print * display = nullptr,
+                              bool debug = r4aEsp32NvmDebug);
+
+// Append a parameter value to the parameter journal
+// Inputs:
+//   filePath: Path to the parameter file contained in the NVM, the
+//             journal file path adds the .jnl extension
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   parameter: Address of the parameter to add to the journal
+//   display: Device used for output
+//   debug:   Set to true to enable parameter debugging
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmJournalAppend(const char * filePath,
+                              const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                              int parametersCount,
+                              const R4A_ESP32_NVM_PARAMETER * parameter,
+                              Print * display = &Serial,
+                              bool debug = r4aEsp32NvmDebug);
+
+// Merge the parameter journal into the parameter file
+// Inputs:
+//   filePath: Path to the parameter file contained in the NVM
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   display: Device used for output, may be nullptr
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmJournalCompact(const char * filePath,
+                               const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                               int parametersCount,
+                               Print * display = nullptr);
+
+// Replay the parameter journal
+// Inputs:
+//   filePath: Path to the parameter file contained in the NVM
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmJournalReplay(const char * filePath,
+                              const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                              int parametersCount,
+                              Print * display = &Serial);
+
+// Compact the parameter journal when necessary, call from a background
+// loop when the robot is not running
+// Inputs:
+//   filePath: Path to the parameter file contained in the NVM
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   display: Device used for output, may be nullptr
+void r4aEsp32NvmJournalUpdate(const char * filePath,
+                              const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                              int parametersCount,
+                              Print * display = nullptr);
+
+// Initialize the line reader
+// Inputs:
+//   reader: Address of the line reader object
+//   file: Address of the open File object
+//   buffer: Address of the buffer, must be longer than the longest line
+//   bufferBytes: Number of bytes in the buffer
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmLineReaderBegin(R4A_ESP32_NVM_LINE_READER * reader,
+                                File * file,
+                                uint8_t * buffer,
+                                size_t bufferBytes);
+
+// Get the next line from the file
+// Inputs:
+//   reader: Address of the line reader object
+//   lineLength: Address to receive the line length in bytes, may be nullptr
+//   display: Device used for output, may be nullptr
+// Outputs:
+//   Returns the address of the zero terminated line within the reader's
+//   buffer without the CR and LF, or nullptr at the end of the file.  The
+//   line is valid until the next call.
+char * r4aEsp32NvmLineReaderGetLine(R4A_ESP32_NVM_LINE_READER * reader,
+                                    size_t * lineLength = nullptr,
+                                    Print * display = nullptr);
+
+// Look up a parameter by address.  The lookup uses the index built by
+// r4aEsp32NvmGetDefaultParameters and r4aEsp32NvmReadParameters and
+// searches the table when the index is not available.
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parameterCount: Number of entries in the parameter table
+//   address: Address of the parameter value
+//   display: Device used for output
+// Outputs:
+//   Returns the address of the found entry in the parameter table or
+//   nullptr if the parameter was not found
+const R4A_ESP32_NVM_PARAMETER * r4aEsp32NvmParameterLookup(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                                           int parameterCount,
+                                                           void * address,
+                                                           Print * display);
+
+// Look up a parameter by name.  The lookup uses the index built by
+// r4aEsp32NvmGetDefaultParameters and r4aEsp32NvmReadParameters and
+// searches the table when the index is not available.
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parameterCount: Number of entries in the parameter table
+//   name: Name of the parameter to be found
+//   display: Device used for output
+// Outputs:
+//   Returns the address of the found entry in the parameter table or
+//   nullptr if the parameter was not found
+const R4A_ESP32_NVM_PARAMETER * r4aEsp32NvmParameterLookup(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                                           int parameterCount,
+                                                           const char * name,
+                                                           Print * display = &Serial);
+
+// Set a parameter value
+// Inputs:
+//   filePath: Path to the file to be stored in NVM
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   parameter: Address of the specified parameter in the table
+//   valueString: Character string containing the new value
+//   display: Device used for output
+bool r4aEsp32NvmParameterSet(const char * filePath,
+                             const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                             int parameterCount,
+                             const R4A_ESP32_NVM_PARAMETER * parameter,
+                             const char * valueString,
+                             Print * display = &Serial,
+                             bool debug = r4aEsp32NvmDebug);
+
+// Parse the parameter file data
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   nvmData: Address of the parameter file data
+//   fileBytes: Number of bytes of parameter file data
+//   availableParameters: Bitmap of parameters found in the data
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmParseParameters(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                int parametersCount,
+                                const char * nvmData,
+                                size_t fileBytes,
+                                uint8_t * availableParameters,
+                                Print * display);
+
+// Read the parameters from the binary parameter file
+// Inputs:
+//   filePath: Path to the text parameter file contained in the NVM, the
+//             binary file path adds the .bin extension
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false when the text file must be used
+bool r4aEsp32NvmReadBinaryParameters(const char * filePath,
+                                     const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                     int parametersCount,
+                                     Print * display = &Serial);
+
+// Read a line from the file.  Each call reads a block and seeks back to
+// the start of the next line, use the line reader to read a whole file.
+// Inputs:
+//   file: Address of the File object
+//   line: Address of the buffer to receive the zero terminated line
+//   lineLength: Number of bytes in the buffer
+//   display: Device used for output, passed to computeWayPoint
+// Outputs:
+//   Returns true if the line was successfully read
+bool r4aEsp32NvmReadLine(File * file,
+                uint8_t * line,
+                size_t lineLength,
+                Print * display);
+
+// Read the parameters from a file
+// Inputs:
+//   filePath: Path to the file contained in the NVM
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmReadParameters(const char * filePath,
+                               const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                               int parametersCount,
+                               Print * display = &Serial);
+
+// Read the parameters from the text parameter file
+// Inputs:
+//   filePath: Path to the file contained in the NVM
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmReadTextParameters(const char * filePath,
+                                   const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                   int parametersCount,
+                                   Print * display = &Serial);
+
+// Replace a file with a new file
+// Inputs:
+//   newFilePath: Path to the new file contained in the NVM
+//   filePath: Path to the file being replaced
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmReplaceFile(const char * newFilePath,
+                            const char * filePath,
+                            Print * display = &Serial);
+
+// Replace the text parameter file with a new file.  The binary
+// parameter file and the journal are removed since they describe the
+// previous parameter file.
+// Inputs:
+//   newFilePath: Path to the new parameter file contained in the NVM
+//   filePath: Path to the parameter file being replaced
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmReplaceParameterFile(const char * newFilePath,
+                                     const char * filePath,
+                                     Print * display = &Serial);
+
+// Copy the data from a network connection into a file.  The data is
+// written to a temporary file which replaces the file upon success.
+// Inputs:
+//   client: Address of the Client object supplying the data
+//   length: Number of bytes to copy, -1 copies until the connection closes
+//   filePath: Path to the file being written
+//   display: Device used for output, displays the throughput
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmStreamToFile(Client * client,
+                             int32_t length,
+                             const char * filePath,
+                             Print * display = &Serial);
+
+// Compute the hash of the parameter names and types
+// Inputs:
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+// Outputs:
+//   Returns the 32-bit hash value of the parameter table
+uint32_t r4aEsp32NvmTableHash(const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                              int parametersCount);
+
+// Write the parameters to the binary parameter file
+// Inputs:
+//   filePath: Path to the text parameter file contained in the NVM, the
+//             binary file path adds the .bin extension
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmWriteBinaryParameters(const char * filePath,
+                                      const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                      int parametersCount,
+                                      Print * display = &Serial);
+
+// Write a string to the parameter file
+// Inputs:
+//   file: File to which the string is written
+//   string: Address of a zero terminated string of characters
+// Outputs:
+//   Returns true if all of the data was successfully written and false
+//   upon error
+bool r4aEsp32NvmWriteFileString(File &file, const char * string);
+
+// Write a string to the parameter file
+// Inputs:
+//   file: File to which the string is written
+//   string: Address of a zero terminated string of characters
+//   length: Length of the string in bytes
+// Outputs:
+//   Returns true if all of the data was successfully written and false
+//   upon error
+bool r4aEsp32NvmWriteFileString(File &file, const char * string, size_t length);
+
+// Write the parameters to a file
+// Inputs:
+//   filePath: Path to the file to be stored in NVM
+//   parameterTable: Address of the first entry in the parameter table
+//   parametersCount: Number of parameters in the table
+//   display: Device used for output
+// Outputs:
+//   Returns true if successful and false upon failure
+bool r4aEsp32NvmWriteParameters(const char * filePath,
+                                const R4A_ESP32_NVM_PARAMETER * parameterTable,
+                                int parametersCount,
+                                Print * display = &Serial,
+                                bool debug = r4aEsp32NvmDebug);
+
+#endif  // __R4A_ESP32_NVM_H__
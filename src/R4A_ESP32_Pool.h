@@ -0,0 +1,88 @@
+/**********************************************************************
+  R4A_ESP32_Pool.h
+
+  Robots-For-All (R4A)
+  Size class memory pool declarations
+
+  The pool memory is allocated once and divided into fixed size blocks,
+  one region per size class.  Each size class keeps a free list per core.
+  The free lists are lock-free stacks using a tagged head, so allocation
+  and free never take a lock and never fragment the heap.  This file
+  does not depend on the Arduino environment so that the pool may be
+  built on the host for benchmarking.
+**********************************************************************/
+
+#ifndef __R4A_ESP32_POOL_H__
+#define __R4A_ESP32_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define R4A_ESP32_POOL_CLASSES      6   // Block sizes: 16, 32, 64, 128, 256, 512
+#define R4A_ESP32_POOL_CORES        2   // Number of free lists per size class
+#define R4A_ESP32_POOL_MIN_BYTES    16  // Smallest block size
+#define R4A_ESP32_POOL_MAX_BYTES    (R4A_ESP32_POOL_MIN_BYTES << (R4A_ESP32_POOL_CLASSES - 1))
+
+// Blocks of a single size
+typedef struct _R4A_ESP32_POOL_CLASS
+{
+    uint8_t * _base;            // Address of the first block
+    uint8_t * _end;             // Address following the last block
+    uint32_t _blockBytes;       // Number of bytes in each block
+    uint32_t _blocks;           // Number of blocks
+    volatile uint32_t _head[R4A_ESP32_POOL_CORES]; // Free list: (tag << 16) | (block + 1)
+
+    // Statistics
+    volatile uint32_t _allocations;     // Number of blocks allocated
+    volatile uint32_t _exhausted;       // Allocations failed, no free blocks
+    volatile uint32_t _highWater;       // Maximum number of blocks in use
+    volatile uint32_t _inUse;           // Number of blocks in use
+    volatile uint32_t _steals;          // Blocks taken from another core's free list
+    volatile uint64_t _requestedBytes;  // Total bytes requested by the allocations
+} R4A_ESP32_POOL_CLASS;
+
+// Memory pool
+typedef struct _R4A_ESP32_POOL
+{
+    R4A_ESP32_POOL_CLASS _class[R4A_ESP32_POOL_CLASSES];
+    uint8_t * _base;            // Address of the first block of the pool
+    uint8_t * _end;             // Address following the last block, nullptr until initialized
+} R4A_ESP32_POOL;
+
+// Allocate a block from the pool
+// Inputs:
+//   pool: Address of the R4A_ESP32_POOL data structure
+//   numberOfBytes: Number of bytes to allocate
+//   core: Number of the core making the request
+// Outputs:
+//   Returns the block address or nullptr when the request is too large
+//   or the size class has no free blocks
+void * r4aEsp32PoolAlloc(R4A_ESP32_POOL * pool, size_t numberOfBytes, int core);
+
+// Determine the number of bytes of memory needed for the pool
+// Inputs:
+//   blockCounts: Number of blocks for each size class
+// Outputs:
+//   Returns the number of bytes to pass to r4aEsp32PoolInit
+size_t r4aEsp32PoolBytes(const uint16_t * blockCounts);
+
+// Free a block
+// Inputs:
+//   pool: Address of the R4A_ESP32_POOL data structure
+//   buffer: Address of the buffer to free
+//   core: Number of the core making the request
+// Outputs:
+//   Returns true if the buffer was returned to the pool and false if the
+//   buffer is not part of the pool
+bool r4aEsp32PoolFree(R4A_ESP32_POOL * pool, void * buffer, int core);
+
+// Divide the memory into blocks and build the free lists
+// Inputs:
+//   pool: Address of the R4A_ESP32_POOL data structure
+//   memory: Address of r4aEsp32PoolBytes bytes of memory
+//   blockCounts: Number of blocks for each size class
+void r4aEsp32PoolInit(R4A_ESP32_POOL * pool,
+                      void * memory,
+                      const uint16_t * blockCounts);
+
+#endif  // __R4A_ESP32_POOL_H__
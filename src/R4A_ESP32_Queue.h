@@ -0,0 +1,123 @@
+/**********************************************************************
+  R4A_ESP32_Queue.h
+
+  Robots-For-All (R4A)
+  Command queue declarations
+
+  The command queue moves work requested by the menus, telnet and the
+  web server onto the control loop.  Any number of tasks post commands
+  into the bounded queue without a lock, the control loop drains the
+  queue at a point where the robot state is consistent and executes
+  the commands in the order they were posted.
+
+  Each entry holds a sequence value indicating whether the entry is
+  empty or full for the current pass through the queue.  A task posting
+  a command claims the next entry by advancing the tail with a compare
+  and exchange, fills the entry and then marks it full.  The control
+  loop is the only task removing commands, so it advances the head
+  without an atomic operation.  All of the values start at zero, so a
+  queue declared as a global is ready to use.
+
+  This file does not depend on the Arduino environment so that the
+  queue may be built on the host for testing and benchmarking.
+**********************************************************************/
+
+#ifndef __R4A_ESP32_QUEUE_H__
+#define __R4A_ESP32_QUEUE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Print;
+
+// Routine executed by the control loop
+// Inputs:
+//   parameter: Value passed to r4aEsp32CommandQueuePost
+//   display: Device used for output, passed to r4aEsp32CommandQueuePost
+typedef void (* R4A_ESP32_COMMAND_ROUTINE)(intptr_t parameter, Print * display);
+
+// Command queue entry
+typedef struct _R4A_ESP32_COMMAND
+{
+    volatile uint32_t _sequence;        // Pass value when empty, pass value + 1 when full
+    uint32_t _postUsec;                 // Time the command was posted
+    R4A_ESP32_COMMAND_ROUTINE _routine; // Routine to execute
+    intptr_t _parameter;                // Parameter for the routine
+    Print * _display;                   // Device used for output
+} R4A_ESP32_COMMAND;
+
+// Command queue
+typedef struct _R4A_ESP32_COMMAND_QUEUE
+{
+    const char * _name;                 // Name displayed with the statistics
+    R4A_ESP32_COMMAND * _commands;      // Array of entries
+    uint32_t _mask;                     // Number of entries - 1, entries must be a power of 2
+    volatile uint32_t _tail;            // Number of commands posted
+    volatile uint32_t _head;            // Number of commands removed by the control loop
+    volatile uint32_t _completed;       // Number of commands executed
+
+    // Statistics, updated by the posting tasks
+    volatile uint32_t _full;            // Posts refused because the queue was full
+    volatile uint32_t _timeouts;        // Waits that timed out
+
+    // Statistics, updated by the control loop
+    uint32_t _drains;                   // Calls to r4aEsp32CommandQueueDrain finding commands
+    uint32_t _executed;                 // Commands executed since the statistics were cleared
+    uint32_t _maxDepth;                 // Most commands waiting at a drain
+    uint32_t _maxExecuteUsec;           // Longest command execution
+    uint32_t _maxLatencyUsec;           // Longest time from post to execution
+    uint64_t _totalLatencyUsec;         // Total time from post to execution
+} R4A_ESP32_COMMAND_QUEUE;
+
+// Initialize a R4A_ESP32_COMMAND_QUEUE
+// Inputs:
+//   name: Name displayed with the statistics
+//   commands: Array of R4A_ESP32_COMMAND, the number of entries must be
+//             a power of 2
+#define R4A_ESP32_COMMAND_QUEUE_INITIALIZER(name, commands)         \
+    {name, commands, (sizeof(commands) / sizeof(commands[0])) - 1,  \
+     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}
+
+// Clear the queue statistics
+// Inputs:
+//   queue: Address of the R4A_ESP32_COMMAND_QUEUE data structure
+void r4aEsp32CommandQueueClearStats(R4A_ESP32_COMMAND_QUEUE * queue);
+
+// Execute the posted commands, only the control loop may call this
+// routine
+// Inputs:
+//   queue: Address of the R4A_ESP32_COMMAND_QUEUE data structure
+//   maxCommands: Maximum number of commands to execute, limits the time
+//                spent in this routine
+// Outputs:
+//   Returns the number of commands executed
+uint32_t r4aEsp32CommandQueueDrain(R4A_ESP32_COMMAND_QUEUE * queue,
+                                   uint32_t maxCommands);
+
+// Post a command for the control loop to execute
+// Inputs:
+//   queue: Address of the R4A_ESP32_COMMAND_QUEUE data structure
+//   routine: Routine for the control loop to execute
+//   parameter: Parameter for the routine
+//   display: Device used for output, must remain valid until the
+//            command completes
+// Outputs:
+//   Returns the ticket to pass to r4aEsp32CommandQueueWait, zero when
+//   the queue is full
+uint32_t r4aEsp32CommandQueuePost(R4A_ESP32_COMMAND_QUEUE * queue,
+                                  R4A_ESP32_COMMAND_ROUTINE routine,
+                                  intptr_t parameter,
+                                  Print * display);
+
+// Wait for the control loop to execute a command
+// Inputs:
+//   queue: Address of the R4A_ESP32_COMMAND_QUEUE data structure
+//   ticket: Value returned by r4aEsp32CommandQueuePost
+//   timeoutUsec: Microseconds to wait for the command
+// Outputs:
+//   Returns true when the command completed and false upon timeout
+bool r4aEsp32CommandQueueWait(R4A_ESP32_COMMAND_QUEUE * queue,
+                              uint32_t ticket,
+                              uint32_t timeoutUsec);
+
+#endif  // __R4A_ESP32_QUEUE_H__
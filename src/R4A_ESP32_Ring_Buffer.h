@@ -0,0 +1,157 @@
+/**********************************************************************
+  R4A_ESP32_Ring_Buffer.h
+
+  Robots-For-All (R4A)
+  Multiple producer, single consumer ring buffer declarations
+
+  This file uses the Arduino Print class and must be included after it.
+  The host test program supplies a stand-in for Print so that the ring
+  buffer may be built on the host for testing.
+**********************************************************************/
+
+#ifndef __R4A_ESP32_RING_BUFFER_H__
+#define __R4A_ESP32_RING_BUFFER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The ring buffer holds variable length records.  Producers on either
+// core reserve space, fill in the record in place and then commit it.
+// A single consumer either peeks at the oldest record and releases it
+// when done or copies the record out of the buffer.  Each record starts
+// with an R4A_RING_BUFFER_HEADER and is padded to an 8 byte boundary.
+// A record never wraps, a pad record fills the end of the buffer.
+//
+// When overwrite is enabled, a full buffer discards the oldest committed
+// records, the consumer must use r4aRingBufferRead to detect a record
+// being overwritten while it is read.  Otherwise new records are dropped.
+
+#define R4A_RING_BUFFER_CACHE_LINE_BYTES    32  // Separate producer and consumer data
+#define R4A_RING_BUFFER_MAX_RECORD_BYTES    65535
+
+#define R4A_RING_BUFFER_FLAG_PAD            1   // Skip this record
+
+typedef struct _R4A_RING_BUFFER_HEADER
+{
+    uint32_t _position;     // Free running offset of the record when committed
+    uint16_t _length;       // Number of data bytes in the record
+    uint8_t _type;          // Record type, defined by the application
+    uint8_t _flags;         // R4A_RING_BUFFER_FLAG_*
+} R4A_RING_BUFFER_HEADER;
+
+typedef struct _R4A_RING_BUFFER
+{
+    // Constant after r4aRingBufferBegin
+    uint8_t * _buffer;      // Buffer containing the records
+    uint32_t _bufferBytes;  // Power of 2 number of bytes in the buffer
+    bool _overwrite;        // Overwrite the oldest records when full
+
+    // Updated by the producers
+    alignas(R4A_RING_BUFFER_CACHE_LINE_BYTES)
+    volatile uint32_t _head;            // Free running offset of the next record
+    volatile uint32_t _bytesDropped;    // Number of bytes dropped
+    volatile uint32_t _recordsDropped;  // Number of records dropped
+    volatile uint32_t _recordsOverwritten; // Number of records overwritten
+
+    // Updated by the consumer or by a producer when overwriting
+    alignas(R4A_RING_BUFFER_CACHE_LINE_BYTES)
+    volatile uint32_t _tail;            // Free running offset of the oldest record
+} R4A_RING_BUFFER;
+
+// Initialize the ring buffer, allocating the buffer if necessary
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+//   bufferBytes: Power of 2 number of bytes in the buffer
+//   overwrite: Set true to overwrite the oldest records when full
+//   display: Device used for output
+// Outputs:
+//   Returns true if the ring buffer is ready for use
+bool r4aRingBufferBegin(R4A_RING_BUFFER * ring,
+                        uint32_t bufferBytes,
+                        bool overwrite = false,
+                        Print * display = &Serial);
+
+// Commit a record making it available to the consumer
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+//   data: Address returned by r4aRingBufferReserve
+void r4aRingBufferCommit(R4A_RING_BUFFER * ring, void * data);
+
+// Display the ring buffer statistics
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+//   display: Device used for output
+void r4aRingBufferDisplayStats(R4A_RING_BUFFER * ring,
+                               Print * display = &Serial);
+
+// Free the ring buffer
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+void r4aRingBufferEnd(R4A_RING_BUFFER * ring);
+
+// Get the oldest committed record without removing it from the buffer,
+// not supported when overwrite is enabled
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+//   type: Address to receive the record type, may be nullptr
+//   length: Address to receive the record length, may be nullptr
+// Outputs:
+//   Returns the address of the record data or nullptr if no record is
+//   available
+void * r4aRingBufferPeek(R4A_RING_BUFFER * ring,
+                         uint8_t * type = nullptr,
+                         uint16_t * length = nullptr);
+
+// Copy the oldest committed record out of the buffer and remove it
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+//   data: Address of the buffer to receive the record data
+//   dataBytes: Size of the data buffer in bytes, longer records are truncated
+//   type: Address to receive the record type, may be nullptr
+//   length: Address to receive the record length, may be nullptr
+// Outputs:
+//   Returns true if a record was read
+bool r4aRingBufferRead(R4A_RING_BUFFER * ring,
+                       void * data,
+                       uint16_t dataBytes,
+                       uint8_t * type = nullptr,
+                       uint16_t * length = nullptr);
+
+// Remove the record returned by r4aRingBufferPeek
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+void r4aRingBufferRelease(R4A_RING_BUFFER * ring);
+
+// Reserve space for a record in the ring buffer, never blocks
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+//   type: Record type, defined by the application
+//   length: Number of data bytes in the record
+// Outputs:
+//   Returns the address of the record data or nullptr if the record was
+//   dropped
+void * r4aRingBufferReserve(R4A_RING_BUFFER * ring,
+                            uint8_t type,
+                            uint16_t length);
+
+// Get the number of bytes in use
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+// Outputs:
+//   Returns the number of bytes used by reserved and committed records
+uint32_t r4aRingBufferUsedBytes(R4A_RING_BUFFER * ring);
+
+// Copy a record into the ring buffer
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+//   type: Record type, defined by the application
+//   data: Address of the record data
+//   length: Number of data bytes in the record
+// Outputs:
+//   Returns true if the record was added to the buffer
+bool r4aRingBufferWrite(R4A_RING_BUFFER * ring,
+                        uint8_t type,
+                        const void * data,
+                        uint16_t length);
+
+#endif  // __R4A_ESP32_RING_BUFFER_H__
@@ -0,0 +1,101 @@
+/**********************************************************************
+  R4A_ESP32_Seqlock.h
+
+  Robots-For-All (R4A)
+  Double buffered sequence lock declarations
+
+  A single writer publishes snapshots of a structure without waiting
+  and any number of readers get a consistent copy without a lock.  The
+  writer fills the buffer not holding the latest snapshot and then
+  publishes it.  Readers copy the latest snapshot and only retry when
+  the writer starts filling that same buffer during the copy, which
+  requires two publishes during a single read.
+
+  This file does not depend on the Arduino environment so that the
+  seqlock may be built on the host for testing and benchmarking.
+**********************************************************************/
+
+#ifndef __R4A_ESP32_SEQLOCK_H__
+#define __R4A_ESP32_SEQLOCK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Sequence lock
+typedef struct _R4A_ESP32_SEQLOCK
+{
+    volatile uint32_t _sequence;    // 2 * publishes, odd while publishing
+    volatile uint32_t _retries;     // Number of copies repeated by readers
+} R4A_ESP32_SEQLOCK;
+
+// Publish a snapshot, only one task may publish snapshots
+// Inputs:
+//   seqlock: Address of the R4A_ESP32_SEQLOCK data structure
+//   buffers: Address of two consecutive buffers of length bytes
+//   data: Address of the data to publish
+//   length: Number of bytes in the snapshot
+void r4aEsp32SeqlockPublish(R4A_ESP32_SEQLOCK * seqlock,
+                            void * buffers,
+                            const void * data,
+                            size_t length);
+
+// Get a copy of the latest snapshot
+// Inputs:
+//   seqlock: Address of the R4A_ESP32_SEQLOCK data structure
+//   buffers: Address of two consecutive buffers of length bytes
+//   data: Address of the buffer to receive the snapshot
+//   length: Number of bytes in the snapshot
+// Outputs:
+//   Returns the number of snapshots published, zero when no snapshot
+//   was published and data is unchanged
+uint32_t r4aEsp32SeqlockRead(R4A_ESP32_SEQLOCK * seqlock,
+                             const void * buffers,
+                             void * data,
+                             size_t length);
+
+// Typed snapshot, initialize with {} or as a global
+template <typename T>
+class R4A_ESP32_SNAPSHOT
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "R4A_ESP32_SNAPSHOT requires a type that may be copied with memcpy");
+
+  public:
+
+    R4A_ESP32_SEQLOCK _seqlock;
+    T _buffer[2];
+
+    // Publish a snapshot, only one task may publish snapshots
+    // Inputs:
+    //   value: Snapshot to publish
+    void publish(const T & value)
+    {
+        r4aEsp32SeqlockPublish(&_seqlock, _buffer, &value, sizeof(T));
+    }
+
+    // Get the number of snapshots published
+    uint32_t publishes()
+    {
+        return _seqlock._sequence >> 1;
+    }
+
+    // Get a copy of the latest snapshot
+    // Inputs:
+    //   value: Address of the buffer to receive the snapshot
+    // Outputs:
+    //   Returns the number of snapshots published, zero when no
+    //   snapshot was published and value is unchanged
+    uint32_t read(T * value)
+    {
+        return r4aEsp32SeqlockRead(&_seqlock, _buffer, value, sizeof(T));
+    }
+
+    // Get the number of copies repeated by readers
+    uint32_t retries()
+    {
+        return _seqlock._retries;
+    }
+};
+
+#endif  // __R4A_ESP32_SEQLOCK_H__
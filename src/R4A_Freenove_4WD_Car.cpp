@@ -59,6 +59,7 @@ const R4A_CAMERA_PINS r4a4wdCarOv2640Pins =
 //****************************************
 
 R4A_Freenove_4WD_Car r4aFreenove4wdCar;
+R4A_ESP32_COMMAND_QUEUE * r4a4wdCarCommandQueue;
 
 //*********************************************************************
 // Constructor
@@ -447,8 +448,88 @@ void R4A_Freenove_4WD_Car::ledsUpdate(uint32_t currentMsec,
         }
     }
 
-    // Update the LED colors
+    // Update the LED colors, r4aEsp32SpiFrameTransfer skips the SPI
+    // transfer when the colors have not changed.  A forced update is
+    // always sent and is complete before returning.
+    if (forceUpdate && r4aLEDSpi)
+        r4aEsp32SpiFrameForce(r4aLEDSpi);
     r4aLEDUpdate(true);
+    if (forceUpdate && r4aLEDSpi)
+        r4aEsp32SpiFrameWait(r4aLEDSpi);
+}
+
+//*********************************************************************
+// Toggle the backup lights, executed by the control loop
+// Inputs:
+//   parameter: Not used
+//   display: Device used for output
+static void r4aLedCommandBackup(intptr_t parameter, Print * display)
+{
+    car.backupLightsToggle();
+}
+
+//*********************************************************************
+// Toggle the brake lights, executed by the control loop
+// Inputs:
+//   parameter: Not used
+//   display: Device used for output
+static void r4aLedCommandBrake(intptr_t parameter, Print * display)
+{
+    car.brakeLightsToggle();
+}
+
+//*********************************************************************
+// Toggle the headlights, executed by the control loop
+// Inputs:
+//   parameter: Not used
+//   display: Device used for output
+static void r4aLedCommandHeadlights(intptr_t parameter, Print * display)
+{
+    car.headlightsToggle();
+}
+
+//*********************************************************************
+// Turn off all the LEDs, executed by the control loop
+// Inputs:
+//   parameter: Not used
+//   display: Device used for output
+static void r4aLedCommandOff(intptr_t parameter, Print * display)
+{
+    car.backupLightsOff();
+    car.brakeLightsOff();
+    car.headlightsOff();
+    car.ledsTurnOff();
+    r4aLEDsOff();
+}
+
+//*********************************************************************
+// Turn left indicator, executed by the control loop
+// Inputs:
+//   parameter: Not used
+//   display: Device used for output
+static void r4aLedCommandTurnLeft(intptr_t parameter, Print * display)
+{
+    car.ledsTurnLeft();
+}
+
+//*********************************************************************
+// Stop the turn signal blinking, executed by the control loop
+// Inputs:
+//   parameter: Not used
+//   display: Device used for output
+static void r4aLedCommandTurnOff(intptr_t parameter, Print * display)
+{
+    car.ledsTurnOff();
+}
+
+//*********************************************************************
+// Turn right indicator, executed by the control loop
+// Inputs:
+//   parameter: Not used
+//   display: Device used for output
+static void r4aLedCommandTurnRight(intptr_t parameter, Print * display)
+{
+    car.ledsTurnRight();
 }
 
 //*********************************************************************
@@ -459,7 +540,11 @@ void R4A_Freenove_4WD_Car::ledsUpdate(uint32_t currentMsec,
 //   display: Device used for output
 void r4aLedMenuBackup(const R4A_MENU_ENTRY * menuEntry, const char * command, Print * display)
 {
-    car.backupLightsToggle();
+    r4aEsp32CommandQueueExecute(r4a4wdCarCommandQueue,
+                                r4aLedCommandBackup,
+                                0,
+                                display,
+                                R4A_4WD_CAR_COMMAND_WARN_USEC);
 }
 
 //*********************************************************************
@@ -470,7 +555,11 @@ void r4aLedMenuBackup(const R4A_MENU_ENTRY * menuEntry, const char * command, Pr
 //   display: Device used for output
 void r4aLedMenuBrake(const R4A_MENU_ENTRY * menuEntry, const char * command, Print * display)
 {
-    car.brakeLightsToggle();
+    r4aEsp32CommandQueueExecute(r4a4wdCarCommandQueue,
+                                r4aLedCommandBrake,
+                                0,
+                                display,
+                                R4A_4WD_CAR_COMMAND_WARN_USEC);
 }
 
 //*********************************************************************
@@ -481,7 +570,11 @@ void r4aLedMenuBrake(const R4A_MENU_ENTRY * menuEntry, const char * command, Pri
 //   display: Device used for output
 void r4aLedMenuHeadlights(const R4A_MENU_ENTRY * menuEntry, const char * command, Print * display)
 {
-    car.headlightsToggle();
+    r4aEsp32CommandQueueExecute(r4a4wdCarCommandQueue,
+                                r4aLedCommandHeadlights,
+                                0,
+                                display,
+                                R4A_4WD_CAR_COMMAND_WARN_USEC);
 }
 
 //*********************************************************************
@@ -492,11 +585,11 @@ void r4aLedMenuHeadlights(const R4A_MENU_ENTRY * menuEntry, const char * command
 //   display: Device used for output
 void r4aLedMenuOff(const R4A_MENU_ENTRY * menuEntry, const char * command, Print * display)
 {
-    car.backupLightsOff();
-    car.brakeLightsOff();
-    car.headlightsOff();
-    car.ledsTurnOff();
-    r4aLEDsOff();
+    r4aEsp32CommandQueueExecute(r4a4wdCarCommandQueue,
+                                r4aLedCommandOff,
+                                0,
+                                display,
+                                R4A_4WD_CAR_COMMAND_WARN_USEC);
 }
 
 //*********************************************************************
@@ -507,7 +600,11 @@ void r4aLedMenuOff(const R4A_MENU_ENTRY * menuEntry, const char * command, Print
 //   display: Device used for output
 void r4aLedMenuTurnLeft(const R4A_MENU_ENTRY * menuEntry, const char * command, Print * display)
 {
-    car.ledsTurnLeft();
+    r4aEsp32CommandQueueExecute(r4a4wdCarCommandQueue,
+                                r4aLedCommandTurnLeft,
+                                0,
+                                display,
+                                R4A_4WD_CAR_COMMAND_WARN_USEC);
 }
 
 //*********************************************************************
@@ -518,7 +615,11 @@ void r4aLedMenuTurnLeft(const R4A_MENU_ENTRY * menuEntry, const char * command,
 //   display: Device used for output
 void r4aLedMenuTurnOff(const R4A_MENU_ENTRY * menuEntry, const char * command, Print * display)
 {
-    car.ledsTurnOff();
+    r4aEsp32CommandQueueExecute(r4a4wdCarCommandQueue,
+                                r4aLedCommandTurnOff,
+                                0,
+                                display,
+                                R4A_4WD_CAR_COMMAND_WARN_USEC);
 }
 
 //*********************************************************************
@@ -529,7 +630,11 @@ void r4aLedMenuTurnOff(const R4A_MENU_ENTRY * menuEntry, const char * command, P
 //   display: Device used for output
 void r4aLedMenuTurnRight(const R4A_MENU_ENTRY * menuEntry, const char * command, Print * display)
 {
-    car.ledsTurnRight();
+    r4aEsp32CommandQueueExecute(r4a4wdCarCommandQueue,
+                                r4aLedCommandTurnRight,
+                                0,
+                                display,
+                                R4A_4WD_CAR_COMMAND_WARN_USEC);
 }
 
 //****************************************
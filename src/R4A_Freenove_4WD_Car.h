@@ -190,6 +190,14 @@ extern R4A_Freenove_4WD_Car r4aFreenove4wdCar;
 
 #define car         r4aFreenove4wdCar
 
+// Queue drained by the control loop, set by the robot before the menus
+// are used.  The LED menu commands are posted to this queue, keeping
+// the LED state and the SPI transfers on the control loop.  When
+// nullptr, the menu commands execute directly.
+extern R4A_ESP32_COMMAND_QUEUE * r4a4wdCarCommandQueue;
+
+#define R4A_4WD_CAR_COMMAND_WARN_USEC   (1000 * 1000)   // Warn when a command takes longer
+
 //****************************************
 // ESP32 WRover Module Pins
 //****************************************
@@ -381,7 +389,7 @@ const R4A_SPI_BUS spiBus =                          \
     -1,     /* SCLK GPIO */                         \
     BATTERY_WS2812_PIN,   /* MOSI GPIO */           \
     -1,     /* MISO GPIO  */                        \
-    r4aEsp32SpiTransfer /* SPI transfer routine */  \
+    r4aEsp32SpiFrameTransfer /* SPI transfer routine */ \
 };                                                  \
                                                     \
 /* Handle for device data for SPI driver */         \
@@ -0,0 +1,387 @@
+/**********************************************************************
+  Ring_Buffer.cpp
+
+  Robots-For-All (R4A)
+  Multiple producer, single consumer ring buffer with reserve and
+  commit support
+
+  This file only depends on R4A_ESP32_Ring_Buffer.h when built on the
+  host, see examples/Ring_Buffer_Test.
+**********************************************************************/
+
+#include <string.h>
+
+#ifdef  ESP_PLATFORM
+#include "R4A_ESP32.h"
+#else   // ESP_PLATFORM
+#include "Ring_Buffer_Host.h"   // Host stand-ins, see examples/Ring_Buffer_Test
+#include "R4A_ESP32_Ring_Buffer.h"
+#endif  // ESP_PLATFORM
+
+//****************************************
+// Constants
+//****************************************
+
+// Value written to the free space, never matches the position of a
+// record since records start on an 8 byte boundary
+#define R4A_RING_BUFFER_EMPTY                   0xff
+
+// Number of bytes used by a record, including the header and padding.
+// Using the header size as the alignment guarantees that the space at
+// the end of the buffer is always large enough for a pad record.
+#define R4A_RING_BUFFER_RECORD_BYTES(length)    \
+    ((sizeof(R4A_RING_BUFFER_HEADER) + (length) + 7) & ~7)
+
+//*********************************************************************
+// Discard the oldest record to make space for a new record
+// Inputs:
+//   ring: Address of the R4A_RING_BUFFER object
+//   tail: Free running offset of the oldest record
+// Outputs:
+//   Returns true if the tail moved and the reservation should be retried
+//   or false when the oldest record is not committed
+static bool r4aRingBufferDiscard(R4A_RING_BUFFER * ring, uint32_t tail)
+{
+    uint8_t flags;
+    R4A_RING_BUFFER_HEADER * header;
+    uint32_t next;
+
+    // Only committed records may be discarded
+    header = (R4A_RING_BUFFER_HEADER *)&ring->_buffer[tail & (ring->_bufferBytes - 1)];
+    if (__atomic_load_n(&header->_position, __ATOMIC_ACQUIRE) != tail)
+        return false;
+    flags = header->_flags;
+    next = tail + R4A_RING_BUFFER_RECORD_BYTES(header->_length);
+
+    // Another producer or the consumer may have already moved the tail
+    if (__atomic_compare_exchange_n(&ring->_tail,
+                                    &tail,
+                                    next,
+                                    false,
+                                    __ATOMIC_ACQ_REL,
+                                    __ATOMIC_RELAXED)
+        && ((flags & R4A_RING_BUFFER_FLAG_PAD) == 0))
+        __atomic_fetch_add(&ring->_recordsOverwritten, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+//*********************************************************************
+// Initialize the ring buffer, allocating the buffer if necessary
+bool r4aRingBufferBegin(R4A_RING_BUFFER * ring,
+                        uint32_t bufferBytes,
+                        bool overwrite,
+                        Print * display)
+{
+    // Validate the buffer size
+    if ((bufferBytes < (2 * sizeof(R4A_RING_BUFFER_HEADER)))
+        || (bufferBytes & (bufferBytes - 1)))
+    {
+        if (display)
+            display->printf("ERROR: Ring buffer size must be a power of 2!\r\n");
+        return false;
+    }
+
+    // Allocate the buffer
+    if (ring->_buffer && (ring->_bufferBytes != bufferBytes))
+        r4aRingBufferEnd(ring);
+    if (ring->_buffer == nullptr)
+    {
+        ring->_buffer = (uint8_t *)r4aMalloc(bufferBytes, "Ring buffer (_buffer)");
+        if (ring->_buffer == nullptr)
+        {
+            if (display)
+                display->printf("ERROR: Failed to allocate the ring buffer!\r\n");
+            return false;
+        }
+    }
+
+    // Empty the buffer, prevent false commits
+    memset(ring->_buffer, R4A_RING_BUFFER_EMPTY, bufferBytes);
+    ring->_bufferBytes = bufferBytes;
+    ring->_overwrite = overwrite;
+    ring->_head = 0;
+    ring->_tail = 0;
+    ring->_bytesDropped = 0;
+    ring->_recordsDropped = 0;
+    ring->_recordsOverwritten = 0;
+    return true;
+}
+
+//*********************************************************************
+// Commit a record making it available to the consumer
+void r4aRingBufferCommit(R4A_RING_BUFFER * ring, void * data)
+{
+    R4A_RING_BUFFER_HEADER * header;
+
+    // The reservation saved the inverted position of the record
+    header = ((R4A_RING_BUFFER_HEADER *)data) - 1;
+    __atomic_store_n(&header->_position,
+                     ~header->_position,
+                     __ATOMIC_RELEASE);
+}
+
+//*********************************************************************
+// Display the ring buffer statistics
+void r4aRingBufferDisplayStats(R4A_RING_BUFFER * ring, Print * display)
+{
+    display->printf("Ring buffer: %lu bytes, %s\r\n",
+                    ring->_bufferBytes,
+                    ring->_overwrite ? "overwrite oldest" : "drop newest");
+    display->printf("    %10lu  Bytes in use\r\n", r4aRingBufferUsedBytes(ring));
+    display->printf("    %10lu  Records dropped\r\n", ring->_recordsDropped);
+    display->printf("    %10lu  Bytes dropped\r\n", ring->_bytesDropped);
+    display->printf("    %10lu  Records overwritten\r\n", ring->_recordsOverwritten);
+}
+
+//*********************************************************************
+// Free the ring buffer
+void r4aRingBufferEnd(R4A_RING_BUFFER * ring)
+{
+    uint8_t * buffer;
+
+    buffer = ring->_buffer;
+    ring->_buffer = nullptr;
+    ring->_bufferBytes = 0;
+    if (buffer)
+        r4aFree(buffer, "Ring buffer (_buffer)");
+}
+
+//*********************************************************************
+// Get the oldest committed record without removing it from the buffer
+void * r4aRingBufferPeek(R4A_RING_BUFFER * ring,
+                         uint8_t * type,
+                         uint16_t * length)
+{
+    R4A_RING_BUFFER_HEADER * header;
+    uint32_t tail;
+
+    // Producers may discard the record while it is in use
+    if ((ring->_buffer == nullptr) || ring->_overwrite)
+        return nullptr;
+
+    // Skip over the pad records
+    tail = ring->_tail;
+    while (tail != __atomic_load_n(&ring->_head, __ATOMIC_ACQUIRE))
+    {
+        // Determine if the oldest record was committed
+        header = (R4A_RING_BUFFER_HEADER *)&ring->_buffer[tail & (ring->_bufferBytes - 1)];
+        if (__atomic_load_n(&header->_position, __ATOMIC_ACQUIRE) != tail)
+            break;
+        if (header->_flags & R4A_RING_BUFFER_FLAG_PAD)
+        {
+            r4aRingBufferRelease(ring);
+            tail = ring->_tail;
+            continue;
+        }
+
+        // Return the record
+        if (type)
+            *type = header->_type;
+        if (length)
+            *length = header->_length;
+        return (void *)(header + 1);
+    }
+    return nullptr;
+}
+
+//*********************************************************************
+// Copy the oldest committed record out of the buffer and remove it
+bool r4aRingBufferRead(R4A_RING_BUFFER * ring,
+                       void * data,
+                       uint16_t dataBytes,
+                       uint8_t * type,
+                       uint16_t * length)
+{
+    uint32_t bytes;
+    uint8_t flags;
+    R4A_RING_BUFFER_HEADER * header;
+    uint16_t recordLength;
+    uint8_t recordType;
+    uint32_t offset;
+    uint32_t tail;
+
+    if (ring->_buffer == nullptr)
+        return false;
+    while (1)
+    {
+        // Determine if the buffer is empty
+        tail = __atomic_load_n(&ring->_tail, __ATOMIC_ACQUIRE);
+        if (tail == __atomic_load_n(&ring->_head, __ATOMIC_ACQUIRE))
+            return false;
+
+        // Determine if the oldest record was committed
+        offset = tail & (ring->_bufferBytes - 1);
+        header = (R4A_RING_BUFFER_HEADER *)&ring->_buffer[offset];
+        if (__atomic_load_n(&header->_position, __ATOMIC_ACQUIRE) != tail)
+        {
+            // A producer may have discarded the record
+            if (tail != __atomic_load_n(&ring->_tail, __ATOMIC_ACQUIRE))
+                continue;
+            return false;
+        }
+
+        // Validate the record length, it changes when overwritten
+        recordLength = header->_length;
+        recordType = header->_type;
+        flags = header->_flags;
+        bytes = R4A_RING_BUFFER_RECORD_BYTES(recordLength);
+        if (bytes > (ring->_bufferBytes - offset))
+            continue;
+
+        // Copy the record data
+        if ((flags & R4A_RING_BUFFER_FLAG_PAD) == 0)
+            memcpy(data, header + 1, (recordLength < dataBytes) ? recordLength : dataBytes);
+
+        // Remove the record, retry when the record was overwritten
+        if (ring->_overwrite)
+        {
+            if (!__atomic_compare_exchange_n(&ring->_tail,
+                                             &tail,
+                                             tail + bytes,
+                                             false,
+                                             __ATOMIC_ACQ_REL,
+                                             __ATOMIC_RELAXED))
+                continue;
+        }
+        else
+        {
+            memset(header, R4A_RING_BUFFER_EMPTY, bytes);
+            __atomic_store_n(&ring->_tail, tail + bytes, __ATOMIC_RELEASE);
+        }
+
+        // Return the record
+        if (flags & R4A_RING_BUFFER_FLAG_PAD)
+            continue;
+        if (type)
+            *type = recordType;
+        if (length)
+            *length = recordLength;
+        return true;
+    }
+}
+
+//*********************************************************************
+// Remove the record returned by r4aRingBufferPeek
+void r4aRingBufferRelease(R4A_RING_BUFFER * ring)
+{
+    uint32_t bytes;
+    R4A_RING_BUFFER_HEADER * header;
+    uint32_t tail;
+
+    // Verify that a committed record is available
+    tail = ring->_tail;
+    if ((ring->_buffer == nullptr)
+        || (tail == __atomic_load_n(&ring->_head, __ATOMIC_ACQUIRE)))
+        return;
+    header = (R4A_RING_BUFFER_HEADER *)&ring->_buffer[tail & (ring->_bufferBytes - 1)];
+    if (__atomic_load_n(&header->_position, __ATOMIC_ACQUIRE) != tail)
+        return;
+
+    // Erase the record before making the space available to the producers
+    bytes = R4A_RING_BUFFER_RECORD_BYTES(header->_length);
+    memset(header, R4A_RING_BUFFER_EMPTY, bytes);
+    __atomic_store_n(&ring->_tail, tail + bytes, __ATOMIC_RELEASE);
+}
+
+//*********************************************************************
+// Reserve space for a record in the ring buffer, never blocks
+void * r4aRingBufferReserve(R4A_RING_BUFFER * ring,
+                            uint8_t type,
+                            uint16_t length)
+{
+    uint32_t bytes;
+    R4A_RING_BUFFER_HEADER * header;
+    uint32_t head;
+    uint32_t next;
+    uint32_t offset;
+    uint32_t pad;
+    uint32_t tail;
+
+    do
+    {
+        // Verify that the record fits in the buffer
+        bytes = R4A_RING_BUFFER_RECORD_BYTES(length);
+        if ((ring->_buffer == nullptr) || (bytes > (ring->_bufferBytes >> 1)))
+            break;
+
+        // Reserve the space for the record
+        head = __atomic_load_n(&ring->_head, __ATOMIC_RELAXED);
+        while (1)
+        {
+            // Records don't wrap, pad to the end of the buffer
+            tail = __atomic_load_n(&ring->_tail, __ATOMIC_ACQUIRE);
+            offset = head & (ring->_bufferBytes - 1);
+            pad = ((offset + bytes) > ring->_bufferBytes) ? ring->_bufferBytes - offset : 0;
+            next = head + pad + bytes;
+
+            // Determine if there is space for the record
+            if ((next - tail) > ring->_bufferBytes)
+            {
+                if ((!ring->_overwrite) || (!r4aRingBufferDiscard(ring, tail)))
+                    break;
+                head = __atomic_load_n(&ring->_head, __ATOMIC_RELAXED);
+                continue;
+            }
+
+            // Claim the space, a failure updates head
+            if (__atomic_compare_exchange_n(&ring->_head,
+                                            &head,
+                                            next,
+                                            false,
+                                            __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED))
+                break;
+        }
+        if ((next - tail) > ring->_bufferBytes)
+            break;
+
+        // Fill the end of the buffer with a pad record
+        if (pad)
+        {
+            header = (R4A_RING_BUFFER_HEADER *)&ring->_buffer[offset];
+            header->_length = pad - sizeof(R4A_RING_BUFFER_HEADER);
+            header->_type = 0;
+            header->_flags = R4A_RING_BUFFER_FLAG_PAD;
+            __atomic_store_n(&header->_position, head, __ATOMIC_RELEASE);
+            head += pad;
+        }
+
+        // Initialize the record header, r4aRingBufferCommit inverts the position
+        header = (R4A_RING_BUFFER_HEADER *)&ring->_buffer[head & (ring->_bufferBytes - 1)];
+        header->_position = ~head;
+        header->_length = length;
+        header->_type = type;
+        header->_flags = 0;
+        return (void *)(header + 1);
+    } while (0);
+
+    // Drop the record
+    __atomic_fetch_add(&ring->_recordsDropped, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ring->_bytesDropped, length, __ATOMIC_RELAXED);
+    return nullptr;
+}
+
+//*********************************************************************
+// Get the number of bytes in use
+uint32_t r4aRingBufferUsedBytes(R4A_RING_BUFFER * ring)
+{
+    return __atomic_load_n(&ring->_head, __ATOMIC_ACQUIRE)
+         - __atomic_load_n(&ring->_tail, __ATOMIC_ACQUIRE);
+}
+
+//*********************************************************************
+// Copy a record into the ring buffer
+bool r4aRingBufferWrite(R4A_RING_BUFFER * ring,
+                        uint8_t type,
+                        const void * data,
+                        uint16_t length)
+{
+    void * record;
+
+    record = r4aRingBufferReserve(ring, type, length);
+    if (record == nullptr)
+        return false;
+    memcpy(record, data, length);
+    r4aRingBufferCommit(ring, record);
+    return true;
+}
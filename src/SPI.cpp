@@ -101,6 +101,183 @@ const char * r4aEsp32SpiNames[] =
 const uint32_t r4aEsp32SpiNamesBytes = sizeof(r4aEsp32SpiNames);
 const uint32_t r4aEsp32SpiNamesEntries = sizeof(r4aEsp32SpiNames) / sizeof(r4aEsp32SpiNames[0]);
 
+//****************************************
+// Globals
+//****************************************
+
+R4A_ESP32_SPI_DEVICE_STATE r4aEsp32SpiDeviceState[R4A_ESP32_SPI_DEVICE_MAX];
+uint32_t r4aEsp32SpiPollBytes = 32; // Use polling for transfers of this size or smaller
+
+//*********************************************************************
+// Determine if the current task holds the SPI bus for a batch.  Only the
+// task that called r4aEsp32SpiBatchBegin may use the bus without
+// acquiring it, other tasks wait in spi_device_acquire_bus.
+static bool r4aEsp32SpiBatchOwner(R4A_ESP32_SPI_DEVICE_STATE * state)
+{
+    return state && state->_batchActive
+        && (state->_batchTask == xTaskGetCurrentTaskHandle());
+}
+
+//*********************************************************************
+// Locate the state for a SPI device
+static R4A_ESP32_SPI_DEVICE_STATE * r4aEsp32SpiDeviceStateGet(const R4A_SPI_DEVICE * spiDevice)
+{
+    for (int index = 0; index < R4A_ESP32_SPI_DEVICE_MAX; index++)
+        if (r4aEsp32SpiDeviceState[index]._spiDevice == spiDevice)
+            return &r4aEsp32SpiDeviceState[index];
+    return nullptr;
+}
+
+//*********************************************************************
+// Record the completion time, called from the SPI interrupt
+static void IRAM_ATTR r4aEsp32SpiPostCallback(spi_transaction_t * trans)
+{
+    R4A_ESP32_SPI_TRANSACTION * transaction;
+
+    transaction = (R4A_ESP32_SPI_TRANSACTION *)trans->user;
+    if (transaction)
+        transaction->_doneUsec = esp_timer_get_time();
+}
+
+//*********************************************************************
+// Account for a completed transaction
+static void r4aEsp32SpiTransactionDone(R4A_ESP32_SPI_DEVICE_STATE * state,
+                                       size_t length,
+                                       int64_t startUsec,
+                                       int64_t doneUsec,
+                                       bool success)
+{
+    uint32_t latencyUsec;
+
+    if (state)
+    {
+        if (!doneUsec)
+            doneUsec = esp_timer_get_time();
+        latencyUsec = (uint32_t)(doneUsec - startUsec);
+        state->_transactions += 1;
+        if (success)
+            state->_bytes += length;
+        else
+            state->_errors += 1;
+        state->_latencyUsec += latencyUsec;
+        if (state->_latencyUsecMax < latencyUsec)
+            state->_latencyUsecMax = latencyUsec;
+    }
+}
+
+//*********************************************************************
+// Wait for the previous frame to be sent, the caller must hold the frame
+// mutex so that only one task gets the transaction result
+static void r4aEsp32SpiFrameComplete(R4A_ESP32_SPI_DEVICE_STATE * state)
+{
+    R4A_ESP32_SPI_FRAME * frame;
+    uint32_t latencyUsec;
+    spi_transaction_t * trans;
+    R4A_ESP32_SPI_TRANSACTION * transaction;
+
+    // Determine if a frame is being sent
+    frame = state->_frame;
+    if ((!frame) || (!frame->_inFlight))
+        return;
+
+    // Wait for the frame to complete
+    if (spi_device_get_trans_result(*(r4aEsp32SpiDeviceHandleAddr(state->_spiDevice)),
+                                    &trans,
+                                    portMAX_DELAY) != ESP_OK)
+        return;
+    frame->_inFlight = false;
+
+    // Account for the frame
+    transaction = (R4A_ESP32_SPI_TRANSACTION *)trans->user;
+    r4aEsp32SpiTransactionDone(state,
+                               trans->length >> 3,
+                               transaction->_startUsec,
+                               transaction->_doneUsec,
+                               true);
+    if (!transaction->_doneUsec)
+        transaction->_doneUsec = esp_timer_get_time();
+    latencyUsec = (uint32_t)(transaction->_doneUsec - transaction->_startUsec);
+    frame->_frames += 1;
+    frame->_latencyUsec += latencyUsec;
+    if (frame->_latencyUsecMax < latencyUsec)
+        frame->_latencyUsecMax = latencyUsec;
+}
+
+//*********************************************************************
+// Start a batch of queued transactions
+bool r4aEsp32SpiBatchBegin(const R4A_SPI_DEVICE * spiDevice,
+                           Print * display)
+{
+    spi_device_handle_t spiDeviceHandle;
+    R4A_ESP32_SPI_DEVICE_STATE * state;
+    esp_err_t status;
+
+    // Locate the device state
+    state = r4aEsp32SpiDeviceStateGet(spiDevice);
+    if (!state)
+    {
+        if (display)
+            display->printf("ERROR: SPI device not initialized by r4aEsp32SpiDeviceHandleInit!\r\n");
+        return false;
+    }
+    if (r4aEsp32SpiBatchOwner(state))
+    {
+        if (display)
+            display->printf("ERROR: SPI batch already active!\r\n");
+        return false;
+    }
+
+    // Get exclusive access to the SPI bus, wait for a batch started by
+    // another task to end
+    spiDeviceHandle = *(r4aEsp32SpiDeviceHandleAddr(spiDevice));
+    status = spi_device_acquire_bus(spiDeviceHandle, portMAX_DELAY);
+    if (status != ESP_OK)
+    {
+        if (display)
+            display->printf("ERROR: Failed to acquire the SPI bus!\r\n");
+        return false;
+    }
+    state->_busStartUsec = esp_timer_get_time();
+    state->_batchTask = xTaskGetCurrentTaskHandle();
+    state->_batchActive = true;
+
+    // Use the chip select to enable the SPI device
+    r4aSpiChipSelect(spiDevice, true);
+    return true;
+}
+
+//*********************************************************************
+// Complete the batch of queued transactions
+bool r4aEsp32SpiBatchEnd(const R4A_SPI_DEVICE * spiDevice,
+                         Print * display)
+{
+    R4A_ESP32_SPI_DEVICE_STATE * state;
+
+    // Verify that this task started the batch
+    state = r4aEsp32SpiDeviceStateGet(spiDevice);
+    if (!r4aEsp32SpiBatchOwner(state))
+    {
+        if (display)
+            display->printf("ERROR: SPI batch not active!\r\n");
+        return false;
+    }
+
+    // Wait for the queued transactions to complete
+    while (state->_inFlight)
+        r4aEsp32SpiComplete(spiDevice, portMAX_DELAY);
+
+    // Disable the SPI device using the chip select
+    r4aSpiChipSelect(spiDevice, false);
+
+    // End the batch before releasing the SPI bus, another task may start
+    // a batch as soon as the bus is released
+    state->_busUsec += esp_timer_get_time() - state->_busStartUsec;
+    state->_batchActive = false;
+    state->_batchTask = nullptr;
+    spi_device_release_bus(*(r4aEsp32SpiDeviceHandleAddr(spiDevice)));
+    return true;
+}
+
 //*********************************************************************
 // Initialize the SPI controller
 bool r4aEsp32SpiBegin(const R4A_SPI_BUS * spiBus,
@@ -134,6 +311,50 @@ bool r4aEsp32SpiBegin(const R4A_SPI_BUS * spiBus,
     return (status == ESP_OK);
 };
 
+//*********************************************************************
+// Get the results of the completed transactions
+int r4aEsp32SpiComplete(const R4A_SPI_DEVICE * spiDevice,
+                        TickType_t ticksToWait)
+{
+    int completed;
+    spi_device_handle_t spiDeviceHandle;
+    R4A_ESP32_SPI_DEVICE_STATE * state;
+    esp_err_t status;
+    spi_transaction_t * trans;
+    R4A_ESP32_SPI_TRANSACTION * transaction;
+
+    // Verify that this task queued the transactions
+    completed = 0;
+    state = r4aEsp32SpiDeviceStateGet(spiDevice);
+    if ((!r4aEsp32SpiBatchOwner(state)) || (!state->_inFlight))
+        return completed;
+
+    // Get the completed transactions, only wait for the first one
+    spiDeviceHandle = *(r4aEsp32SpiDeviceHandleAddr(spiDevice));
+    while (state->_inFlight)
+    {
+        status = spi_device_get_trans_result(spiDeviceHandle, &trans, ticksToWait);
+        if (status != ESP_OK)
+            break;
+        ticksToWait = 0;
+        state->_inFlight -= 1;
+        completed += 1;
+
+        // Account for the transaction
+        transaction = (R4A_ESP32_SPI_TRANSACTION *)trans->user;
+        r4aEsp32SpiTransactionDone(state,
+                                   trans->length >> 3,
+                                   transaction->_startUsec,
+                                   transaction->_doneUsec,
+                                   true);
+
+        // Notify the caller
+        if (transaction->_callback)
+            transaction->_callback(transaction, true);
+    }
+    return completed;
+}
+
 //*********************************************************************
 // Translate a controller number into a controller base register address
 R4A_ESP32_SPI_REGS * r4aEsp32SpiControllerAddress(uint8_t number)
@@ -174,6 +395,7 @@ bool r4aEsp32SpiDeviceHandleInit(const R4A_SPI_DEVICE * spiDevice,
     uint8_t mode;
     const R4A_SPI_BUS * spiBus;
     spi_device_handle_t * spiDeviceHandleAddr;
+    R4A_ESP32_SPI_DEVICE_STATE * state;
     esp_err_t status;
     bool success;
 
@@ -203,7 +425,8 @@ bool r4aEsp32SpiDeviceHandleInit(const R4A_SPI_DEVICE * spiDevice,
     devcfg.clock_speed_hz = spiDevice->_clockHz;
     devcfg.mode = mode;
     devcfg.spics_io_num = spiDevice->_pinCS;
-    devcfg.queue_size = 7;
+    devcfg.queue_size = R4A_ESP32_SPI_QUEUE_SIZE;
+    devcfg.post_cb = r4aEsp32SpiPostCallback;
 
     // Configure the SPI controller to talk to the SPI device
     spiBus = spiDevice->_spiBus;
@@ -212,6 +435,21 @@ bool r4aEsp32SpiDeviceHandleInit(const R4A_SPI_DEVICE * spiDevice,
                                 &devcfg,
                                 spiDeviceHandleAddr);
     success = (status == ESP_OK);
+
+    // Assign an entry for the queue state and statistics
+    if (success && (!r4aEsp32SpiDeviceStateGet(spiDevice)))
+    {
+        state = r4aEsp32SpiDeviceStateGet(nullptr);
+        if (state)
+        {
+            memset(state, 0, sizeof(*state));
+            state->_frameMutex = xSemaphoreCreateMutex();
+            state->_spiDevice = spiDevice;
+        }
+        else if (display)
+            display->printf("WARNING: No SPI statistics, increase R4A_ESP32_SPI_DEVICE_MAX\r\n");
+    }
+
     if (display)
     {
         display->printf("SPI %d: %d, %s\r\n", spiBus->_busNumber, status, esp_err_to_name(status));
@@ -275,6 +513,213 @@ void r4aEsp32SpiDisplayRegisters(uintptr_t spiAddress, Print * display)
     }
 }
 
+//*********************************************************************
+// Display the SPI device statistics
+void r4aEsp32SpiDisplayStats(Print * display)
+{
+    uint32_t busMsec;
+    R4A_ESP32_SPI_DEVICE_STATE * state;
+
+    for (int index = 0; index < R4A_ESP32_SPI_DEVICE_MAX; index++)
+    {
+        state = &r4aEsp32SpiDeviceState[index];
+        if (!state->_spiDevice)
+            continue;
+
+        // Display the device
+        busMsec = (uint32_t)(state->_busUsec / 1000);
+        display->printf("SPI %d, CS %d: %lu transactions (%lu polled, %lu queued), %lu errors%s\r\n",
+                        state->_spiDevice->_spiBus->_busNumber,
+                        state->_spiDevice->_pinCS,
+                        state->_transactions,
+                        state->_polled,
+                        state->_queued,
+                        state->_errors,
+                        state->_inFlight ? ", busy" : "");
+        display->printf("    %llu bytes, bus held %lu mSec, %lu KB/s\r\n",
+                        state->_bytes,
+                        busMsec,
+                        busMsec ? (uint32_t)(state->_bytes / busMsec) : 0);
+        display->printf("    Latency: %lu uSec average, %lu uSec maximum\r\n",
+                        state->_transactions
+                            ? (uint32_t)(state->_latencyUsec / state->_transactions) : 0,
+                        state->_latencyUsecMax);
+
+        // Display the frame engine statistics
+        if (state->_frame)
+            display->printf("    Frames: %lu sent, %lu unchanged skipped, %lu uSec average, %lu uSec maximum latency\r\n",
+                            state->_frame->_frames,
+                            state->_frame->_skipped,
+                            state->_frame->_frames
+                                ? (uint32_t)(state->_frame->_latencyUsec / state->_frame->_frames) : 0,
+                            state->_frame->_latencyUsecMax);
+    }
+}
+
+//*********************************************************************
+// Send the next frame even if it has not changed
+void r4aEsp32SpiFrameForce(const R4A_SPI_DEVICE * spiDevice)
+{
+    R4A_ESP32_SPI_DEVICE_STATE * state;
+
+    state = r4aEsp32SpiDeviceStateGet(spiDevice);
+    if (state && state->_frameMutex)
+    {
+        xSemaphoreTake(state->_frameMutex, portMAX_DELAY);
+        if (state->_frame)
+            state->_frame->_force = true;
+        xSemaphoreGive(state->_frameMutex);
+    }
+}
+
+//*********************************************************************
+// Queue a changed frame, the caller must hold the frame mutex
+static bool r4aEsp32SpiFrameQueue(R4A_ESP32_SPI_DEVICE_STATE * state,
+                                  const uint8_t * txDmaBuffer,
+                                  size_t length,
+                                  int64_t startUsec,
+                                  Print * display)
+{
+    R4A_ESP32_SPI_FRAME * frame;
+    uint8_t next;
+    const R4A_SPI_DEVICE * spiDevice;
+    esp_err_t status;
+    R4A_ESP32_SPI_TRANSACTION * transaction;
+
+    spiDevice = state->_spiDevice;
+
+    // Allocate the frame engine, keep it in internal RAM since the
+    // completion time is set by the SPI interrupt routine
+    frame = state->_frame;
+    if (!frame)
+    {
+        frame = (R4A_ESP32_SPI_FRAME *)r4aDmaMalloc(sizeof(*frame), "SPI frame (frame)");
+        if (!frame)
+        {
+            if (display)
+                display->printf("ERROR: Failed to allocate the SPI frame!\r\n");
+            return false;
+        }
+        memset(frame, 0, sizeof(*frame));
+        state->_frame = frame;
+    }
+
+    // Skip the update when the frame has not changed
+    if ((!frame->_force)
+        && (frame->_length == length)
+        && (memcmp(frame->_buffer[frame->_next ^ 1], txDmaBuffer, length) == 0))
+    {
+        frame->_skipped += 1;
+        return true;
+    }
+    frame->_force = false;
+
+    // Allocate larger DMA buffers when necessary
+    if (frame->_bufferBytes < length)
+    {
+        r4aEsp32SpiFrameComplete(state);
+        for (next = 0; next < 2; next++)
+        {
+            if (frame->_buffer[next])
+                r4aDmaFree(frame->_buffer[next], "SPI frame buffer (_buffer)");
+            frame->_buffer[next] = (uint8_t *)r4aDmaMalloc(length, "SPI frame buffer (_buffer)");
+        }
+        frame->_length = 0;
+        frame->_bufferBytes = 0;
+        if ((!frame->_buffer[0]) || (!frame->_buffer[1]))
+        {
+            if (display)
+                display->printf("ERROR: Failed to allocate the SPI frame buffers!\r\n");
+            return false;
+        }
+        frame->_bufferBytes = length;
+    }
+
+    // Fill the idle buffer while the previous frame is being sent
+    next = frame->_next;
+    memcpy(frame->_buffer[next], txDmaBuffer, length);
+
+    // Wait for the previous frame to complete
+    r4aEsp32SpiFrameComplete(state);
+
+    // Queue the new frame
+    transaction = &frame->_transaction[next];
+    memset(&transaction->_transaction, 0, sizeof(transaction->_transaction));
+    transaction->_transaction.length = length << 3;
+    transaction->_transaction.tx_buffer = frame->_buffer[next];
+    transaction->_transaction.user = transaction;
+    transaction->_spiDevice = spiDevice;
+    transaction->_startUsec = startUsec;
+    transaction->_doneUsec = 0;
+    status = spi_device_queue_trans(*(r4aEsp32SpiDeviceHandleAddr(spiDevice)),
+                                    &transaction->_transaction,
+                                    portMAX_DELAY);
+    if (status != ESP_OK)
+    {
+        state->_errors += 1;
+        if (display)
+            display->printf("ERROR: Failed to queue SPI frame, %d, %s\r\n",
+                            status, esp_err_to_name(status));
+        return false;
+    }
+    state->_queued += 1;
+    frame->_inFlight = true;
+    frame->_length = length;
+    frame->_next = next ^ 1;
+    return true;
+}
+
+//*********************************************************************
+// Frame transfer routine for LED strings
+bool r4aEsp32SpiFrameTransfer(const struct _R4A_SPI_DEVICE * spiDevice,
+                              const uint8_t * txDmaBuffer,
+                              uint8_t * rxDmaBuffer,
+                              size_t length,
+                              Print * display)
+{
+    int64_t startUsec;
+    R4A_ESP32_SPI_DEVICE_STATE * state;
+    bool success;
+
+    // Use the blocking transfer when the device has no state, the SPI
+    // bus lock serializes these transfers
+    startUsec = esp_timer_get_time();
+    state = r4aEsp32SpiDeviceStateGet(spiDevice);
+    if ((!state) || (!state->_frameMutex))
+        return r4aEsp32SpiTransfer(spiDevice, txDmaBuffer, rxDmaBuffer, length, display);
+
+    // Only one task at a time may update the frame state and get the
+    // result of the frame being sent
+    xSemaphoreTake(state->_frameMutex, portMAX_DELAY);
+
+    // Use the blocking transfer when receiving data, the previous frame
+    // must complete before spi_device_transmit gets its result
+    if (rxDmaBuffer || (!txDmaBuffer) || (!length))
+    {
+        r4aEsp32SpiFrameComplete(state);
+        success = r4aEsp32SpiTransfer(spiDevice, txDmaBuffer, rxDmaBuffer, length, display);
+    }
+    else
+        success = r4aEsp32SpiFrameQueue(state, txDmaBuffer, length, startUsec, display);
+    xSemaphoreGive(state->_frameMutex);
+    return success;
+}
+
+//*********************************************************************
+// Wait for the previous frame to be sent
+void r4aEsp32SpiFrameWait(const R4A_SPI_DEVICE * spiDevice)
+{
+    R4A_ESP32_SPI_DEVICE_STATE * state;
+
+    state = r4aEsp32SpiDeviceStateGet(spiDevice);
+    if (state && state->_frameMutex)
+    {
+        xSemaphoreTake(state->_frameMutex, portMAX_DELAY);
+        r4aEsp32SpiFrameComplete(state);
+        xSemaphoreGive(state->_frameMutex);
+    }
+}
+
 //*********************************************************************
 // Get the SPI clock frequency
 uint32_t r4aEsp32SpiGetClock(R4A_ESP32_SPI_REGS * spi, Print * display)
@@ -344,6 +789,92 @@ uint32_t r4aEsp32SpiGetClock(R4A_ESP32_SPI_REGS * spi, Print * display)
     return clockHz;
 }
 
+//*********************************************************************
+// Display the SPI device statistics
+void r4aEsp32SpiMenuStats(const struct _R4A_MENU_ENTRY * menuEntry,
+                          const char * command,
+                          Print * display)
+{
+    r4aEsp32SpiDisplayStats(display);
+}
+
+//*********************************************************************
+// Queue a SPI transaction
+bool r4aEsp32SpiQueue(R4A_ESP32_SPI_TRANSACTION * transaction,
+                      const R4A_SPI_DEVICE * spiDevice,
+                      const uint8_t * txDmaBuffer,
+                      uint8_t * rxDmaBuffer,
+                      size_t length,
+                      R4A_ESP32_SPI_CALLBACK callback,
+                      void * context,
+                      Print * display)
+{
+    spi_device_handle_t spiDeviceHandle;
+    R4A_ESP32_SPI_DEVICE_STATE * state;
+    esp_err_t status;
+    bool success;
+
+    // Verify that this task started the batch
+    state = r4aEsp32SpiDeviceStateGet(spiDevice);
+    if (!r4aEsp32SpiBatchOwner(state))
+    {
+        if (display)
+            display->printf("ERROR: Call r4aEsp32SpiBatchBegin before r4aEsp32SpiQueue!\r\n");
+        return false;
+    }
+
+    // Describe the SPI transaction
+    memset(&transaction->_transaction, 0, sizeof(transaction->_transaction));
+    transaction->_transaction.length = length << 3;
+    transaction->_transaction.tx_buffer = txDmaBuffer;
+    transaction->_transaction.rx_buffer = rxDmaBuffer;
+    transaction->_transaction.user = transaction;
+    transaction->_spiDevice = spiDevice;
+    transaction->_callback = callback;
+    transaction->_context = context;
+    transaction->_startUsec = esp_timer_get_time();
+    transaction->_doneUsec = 0;
+    spiDeviceHandle = *(r4aEsp32SpiDeviceHandleAddr(spiDevice));
+
+    // Polling avoids the interrupt and task switch overhead for small
+    // transfers, but may only be used when the queue is empty
+    if ((length <= r4aEsp32SpiPollBytes) && (!state->_inFlight))
+    {
+        status = spi_device_polling_transmit(spiDeviceHandle, &transaction->_transaction);
+        success = (status == ESP_OK);
+        state->_polled += 1;
+        r4aEsp32SpiTransactionDone(state,
+                                   length,
+                                   transaction->_startUsec,
+                                   transaction->_doneUsec,
+                                   success);
+        if ((!success) && display)
+            display->printf("ERROR: SPI transaction failed, %d, %s\r\n",
+                            status, esp_err_to_name(status));
+        if (callback)
+            callback(transaction, success);
+        return success;
+    }
+
+    // Make room in the queue
+    if (state->_inFlight >= R4A_ESP32_SPI_QUEUE_SIZE)
+        r4aEsp32SpiComplete(spiDevice, portMAX_DELAY);
+
+    // Queue the transaction
+    status = spi_device_queue_trans(spiDeviceHandle, &transaction->_transaction, portMAX_DELAY);
+    if (status != ESP_OK)
+    {
+        state->_errors += 1;
+        if (display)
+            display->printf("ERROR: Failed to queue SPI transaction, %d, %s\r\n",
+                            status, esp_err_to_name(status));
+        return false;
+    }
+    state->_queued += 1;
+    state->_inFlight += 1;
+    return true;
+}
+
 //*********************************************************************
 // Transfer the data to the SPI device
 bool r4aEsp32SpiTransfer(const struct _R4A_SPI_DEVICE * spiDevice,
@@ -352,9 +883,12 @@ bool r4aEsp32SpiTransfer(const struct _R4A_SPI_DEVICE * spiDevice,
                          size_t length,
                          Print * display)
 {
+    bool batchOwner;
     bool busAcquired;
     bool chipSelected;
     spi_device_handle_t spiDeviceHandle;
+    int64_t startUsec;
+    R4A_ESP32_SPI_DEVICE_STATE * state;
     esp_err_t status;
     bool success;
     spi_transaction_t transaction;
@@ -364,6 +898,9 @@ bool r4aEsp32SpiTransfer(const struct _R4A_SPI_DEVICE * spiDevice,
         busAcquired = false;
         chipSelected = false;
         spiDeviceHandle = *(r4aEsp32SpiDeviceHandleAddr(spiDevice));
+        startUsec = esp_timer_get_time();
+        state = r4aEsp32SpiDeviceStateGet(spiDevice);
+        batchOwner = r4aEsp32SpiBatchOwner(state);
         success = false;
 
         // Describe the SPI transaction
@@ -372,22 +909,39 @@ bool r4aEsp32SpiTransfer(const struct _R4A_SPI_DEVICE * spiDevice,
         transaction.tx_buffer = txDmaBuffer;
         transaction.rx_buffer = rxDmaBuffer;
 
-        // Get exclusive access to the SPI bus
-        status = spi_device_acquire_bus(spiDeviceHandle, portMAX_DELAY);
-        if (status != ESP_OK)
+        // Within this task's batch the bus is already held, wait for the
+        // queued transactions to complete.  Other tasks wait for the bus.
+        if (batchOwner)
         {
-            if (display)
-                display->printf("ERROR: Failed to acquire the SPI bus!\r\n");
-            break;
+            while (state->_inFlight)
+                r4aEsp32SpiComplete(spiDevice, portMAX_DELAY);
+        }
+        else
+        {
+            // Get exclusive access to the SPI bus
+            status = spi_device_acquire_bus(spiDeviceHandle, portMAX_DELAY);
+            if (status != ESP_OK)
+            {
+                if (display)
+                    display->printf("ERROR: Failed to acquire the SPI bus!\r\n");
+                break;
+            }
+            busAcquired = true;
+
+            // Use the chip select to enable the SPI device
+            r4aSpiChipSelect(spiDevice, true);
+            chipSelected = true;
         }
-        busAcquired = true;
-
-        // Use the chip select to enable the SPI device
-        r4aSpiChipSelect(spiDevice, true);
-        chipSelected = true;
 
-        // Perform the SPI transaction
-        status = spi_device_transmit(spiDeviceHandle, &transaction);
+        // Perform the SPI transaction, use polling for small transfers
+        if (length <= r4aEsp32SpiPollBytes)
+        {
+            status = spi_device_polling_transmit(spiDeviceHandle, &transaction);
+            if (state)
+                state->_polled += 1;
+        }
+        else
+            status = spi_device_transmit(spiDeviceHandle, &transaction);
         if (status != ESP_OK)
         {
             if (display)
@@ -398,13 +952,21 @@ bool r4aEsp32SpiTransfer(const struct _R4A_SPI_DEVICE * spiDevice,
         success = true;
     } while (0);
 
+    // Account for the transaction
+    if (state && (busAcquired || batchOwner))
+        r4aEsp32SpiTransactionDone(state, length, startUsec, 0, success);
+
     // Disable the SPI device using the chip select
     if (chipSelected)
         r4aSpiChipSelect(spiDevice, false);
 
     // Release the SPI bus
     if (busAcquired)
+    {
         spi_device_release_bus(spiDeviceHandle);
+        if (state)
+            state->_busUsec += esp_timer_get_time() - startUsec;
+    }
 
     // Return the transaction status
     return success;
@@ -16,12 +16,49 @@ static const char * wpFormat  = "%14.9f   %14.9f   %10.3f   %9.3f   %9.3f   %3d
 static const char * wpHeader1 = "   Latitude        Longitude       Altitude    Horiz Acc   Std. Dev.   SIV   Comment\r\n";
 static const char * wpHeader2 = "--------------   --------------   ----------   ---------   ---------   ---   -------\r\n";
 
+#define R4A_ESP32_WP_BINARY_MAGIC       0x57413452  // "R4AW"
+#define R4A_ESP32_WP_BINARY_VERSION     1
+#define R4A_ESP32_WP_EARTH_RADIUS       6371008.8   // Mean radius in meters
+#define R4A_ESP32_WP_LINE_BUFFER_BYTES  512         // Longer than the longest line
+
+#define R4A_ESP32_WP_WRITER_BUFFER_BYTES    2048
+#define R4A_ESP32_WP_WRITER_FLUSH_BYTES     512
+#define R4A_ESP32_WP_WRITER_FLUSH_MSEC      1000
+
+//****************************************
+// Types
+//****************************************
+
+//  +--------+--------+--------+--------+
+//  | Header | Point0 | Point1 | ...... |
+//  +--------+--------+--------+--------+
+//
+// The binary waypoint file contains fixed size point records which
+// include the heading and distance to the next point
+typedef struct _R4A_ESP32_WP_BINARY_HEADER
+{
+    uint32_t _magic;        // R4A_ESP32_WP_BINARY_MAGIC
+    uint16_t _version;      // R4A_ESP32_WP_BINARY_VERSION
+    uint16_t _recordBytes;  // sizeof(R4A_ESP32_WP_POINT)
+    uint32_t _pointCount;   // Number of points in the file
+} R4A_ESP32_WP_BINARY_HEADER;
+
 //****************************************
 // Globals
 //****************************************
 
 int r4aEsp32WpPointsToAverage = 50;
 const char * r4aEsp32WpFileName = "Waypoints.txt";
+R4A_ESP32_FILE_WRITER r4aEsp32WpWriter;
+
+//****************************************
+// Locals
+//****************************************
+
+// Line reader used by r4aEsp32WpReadPoint(File *), the read ahead data
+// is kept between the calls
+static uint8_t r4aEsp32WpLineBuffer[R4A_ESP32_WP_LINE_BUFFER_BYTES];
+static R4A_ESP32_NVM_LINE_READER r4aEsp32WpLineReader;
 
 //*********************************************************************
 // Add a point to the waypoint file.  This routine is called indirectly
@@ -52,68 +89,447 @@ void r4aEsp32WpAddPoint(intptr_t parameter,
                         uint8_t satellitesInView,
                         Print * display)
 {
-    File file;
-    size_t fileLength;
     String filePath;
+    String header;
     char line[256];
+    size_t length;
     const char * path;
 
-    // Attempt to open the file
     do
     {
+        // Open the waypoint file once, the writer keeps it open
         filePath = String("/") + String(r4aEsp32WpFileName);
         path = filePath.c_str();
-        file = LittleFS.open(path, FILE_APPEND);
-        if (!file)
+        if ((!r4aEsp32WpWriter.isOpen()) || strcmp(r4aEsp32WpWriter.path(), path))
+        {
+            header = String(wpHeader1) + String(wpHeader2);
+            if (!r4aEsp32WpWriter.begin(path,
+                                        FILE_APPEND,
+                                        header.c_str(),
+                                        R4A_ESP32_WP_WRITER_BUFFER_BYTES,
+                                        R4A_ESP32_WP_WRITER_FLUSH_BYTES,
+                                        R4A_ESP32_WP_WRITER_FLUSH_MSEC,
+                                        display))
+                break;
+        }
+
+        // Queue the waypoint data, the writer task updates the file
+        length = snprintf(line, sizeof(line), wpFormat, latitude, longitude,
+                          altitude, horizontalAccuracy, horizontalAccuracyStdDev,
+                          satellitesInView, comment ? comment : "");
+        if (length >= sizeof(line))
+            length = strlen(line);
+        if (display)
+            display->printf("Saving waypoint to %s\r\n", path);
+        if (r4aEsp32WpWriter.write((const uint8_t *)line, length) != length)
+        {
+            if (display)
+                display->printf("ERROR: Waypoint dropped, %ld waypoints dropped for file %s\r\n",
+                                r4aEsp32WpWriter.recordsDropped(), path);
+            break;
+        }
+
+        // Display the waypoint
+        if (display)
+        {
+            display->print(wpHeader1);
+            display->print(wpHeader2);
+            display->print(line);
+        }
+    } while (0);
+}
+
+//*********************************************************************
+// Close the binary waypoint file
+// Inputs:
+//   wpFile: Address of the binary waypoint file object
+void r4aEsp32WpBinaryClose(R4A_ESP32_WP_FILE * wpFile)
+{
+    if (wpFile->_file)
+        wpFile->_file.close();
+    wpFile->_pointCount = 0;
+}
+
+//*********************************************************************
+// Get the path to the binary waypoint file
+// Outputs:
+//   Returns the path to the binary waypoint file
+String r4aEsp32WpBinaryFilePath()
+{
+    return String("/") + String(r4aEsp32WpFileName) + String(".bin");
+}
+
+//*********************************************************************
+// Open the binary waypoint file
+// Inputs:
+//   wpFile: Address of the binary waypoint file object
+//   path: Path to the binary waypoint file
+//   display: Device used for output
+// Outputs:
+//   Returns true if the file was successfully opened
+bool r4aEsp32WpBinaryOpen(R4A_ESP32_WP_FILE * wpFile,
+                          const char * path,
+                          Print * display)
+{
+    R4A_ESP32_WP_BINARY_HEADER header;
+
+    // Open the file
+    wpFile->_pointCount = 0;
+    wpFile->_file = LittleFS.open(path, FILE_READ);
+    if (!wpFile->_file)
+    {
+        if (display)
+            display->printf("ERROR: Failed to open file %s!\r\n", path);
+        return false;
+    }
+
+    // Validate the header
+    if ((wpFile->_file.read((uint8_t *)&header, sizeof(header)) != sizeof(header))
+        || (header._magic != R4A_ESP32_WP_BINARY_MAGIC)
+        || (header._version != R4A_ESP32_WP_BINARY_VERSION)
+        || (header._recordBytes != sizeof(R4A_ESP32_WP_POINT))
+        || (wpFile->_file.size() != (sizeof(header)
+                                     + (header._pointCount * sizeof(R4A_ESP32_WP_POINT)))))
+    {
+        if (display)
+            display->printf("ERROR: %s is not a valid binary waypoint file!\r\n", path);
+        wpFile->_file.close();
+        return false;
+    }
+    wpFile->_pointCount = header._pointCount;
+    return true;
+}
+
+//*********************************************************************
+// Read a point from the binary waypoint file
+// Inputs:
+//   wpFile: Address of the binary waypoint file object
+//   index: Zero based index of the point in the file
+//   point: Address of the buffer to receive the point
+//   display: Device used for output
+// Outputs:
+//   Returns true if the point was successfully read
+bool r4aEsp32WpBinaryReadPoint(R4A_ESP32_WP_FILE * wpFile,
+                               uint32_t index,
+                               R4A_ESP32_WP_POINT * point,
+                               Print * display)
+{
+    // Verify the index
+    if (index >= wpFile->_pointCount)
+        return false;
+
+    // Read the point
+    if ((!wpFile->_file.seek(sizeof(R4A_ESP32_WP_BINARY_HEADER) + (index * sizeof(*point))))
+        || (wpFile->_file.read((uint8_t *)point, sizeof(*point)) != sizeof(*point)))
+    {
+        if (display)
+            display->printf("ERROR: Failed to read waypoint %ld!\r\n", index);
+        return false;
+    }
+    return true;
+}
+
+//*********************************************************************
+// Compute the heading and distance between two points
+// Inputs:
+//   latitude1: Latitude of the first point in degrees
+//   longitude1: Longitude of the first point in degrees
+//   latitude2: Latitude of the second point in degrees
+//   longitude2: Longitude of the second point in degrees
+//   heading: Address to receive the initial heading in degrees (0 to 360)
+//   distance: Address to receive the great circle distance in meters
+void r4aEsp32WpComputeSegment(double latitude1,
+                              double longitude1,
+                              double latitude2,
+                              double longitude2,
+                              float * heading,
+                              float * distance)
+{
+    double a;
+    double deltaLatitude;
+    double deltaLongitude;
+    double degrees;
+    double lat1;
+    double lat2;
+
+    // Convert to radians
+    lat1 = latitude1 * DEG_TO_RAD;
+    lat2 = latitude2 * DEG_TO_RAD;
+    deltaLatitude = lat2 - lat1;
+    deltaLongitude = (longitude2 - longitude1) * DEG_TO_RAD;
+
+    // Compute the distance using the haversine formula
+    a = sin(deltaLatitude / 2) * sin(deltaLatitude / 2)
+      + cos(lat1) * cos(lat2) * sin(deltaLongitude / 2) * sin(deltaLongitude / 2);
+    *distance = (float)(2 * R4A_ESP32_WP_EARTH_RADIUS * atan2(sqrt(a), sqrt(1 - a)));
+
+    // Compute the initial heading
+    degrees = atan2(sin(deltaLongitude) * cos(lat2),
+                    cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(deltaLongitude))
+            * RAD_TO_DEG;
+    if (degrees < 0)
+        degrees += 360.;
+    *heading = (float)degrees;
+}
+
+//*********************************************************************
+// Convert a text waypoint file into a binary waypoint file
+// Inputs:
+//   textPath: Path to the text waypoint file
+//   binaryPath: Path to the binary waypoint file
+//   display: Device used for output
+// Outputs:
+//   Returns true if the file was successfully converted
+bool r4aEsp32WpConvertToBinary(const char * textPath,
+                               const char * binaryPath,
+                               Print * display)
+{
+    File binaryFile;
+    uint8_t buffer[512];
+    String comment;
+    R4A_ESP32_WP_BINARY_HEADER header;
+    char * line;
+    R4A_ESP32_WP_POINT point[2];
+    int previous;
+    bool readStatus;
+    R4A_ESP32_NVM_LINE_READER reader;
+    bool success;
+    String tempPath;
+    File textFile;
+    bool writeStatus;
+
+    // Write the binary file using a temporary name
+    tempPath = String(binaryPath) + String(".tmp");
+    memset(&header, 0, sizeof(header));
+    memset(point, 0, sizeof(point));
+    previous = -1;
+    success = false;
+    do
+    {
+        // Write any buffered waypoints to the text file
+        r4aEsp32WpWriter.flush();
+
+        // Open the files
+        textFile = LittleFS.open(textPath, FILE_READ);
+        if (!textFile)
         {
             if (display)
-                display->printf("ERROR: Failed to create file %s!\r\n", path);
+                display->printf("ERROR: Failed to open file %s!\r\n", textPath);
+            break;
+        }
+        binaryFile = LittleFS.open(tempPath.c_str(), FILE_WRITE);
+        if (!binaryFile)
+        {
+            if (display)
+                display->printf("ERROR: Failed to create file %s!\r\n", tempPath.c_str());
             break;
         }
 
-        // Get the file size
-        fileLength = file.size();
+        // Reserve space for the header
+        if (binaryFile.write((uint8_t *)&header, sizeof(header)) != sizeof(header))
+        {
+            if (display)
+                display->printf("ERROR: Failed to write file %s!\r\n", tempPath.c_str());
+            break;
+        }
 
-        // Add the file header if necessary
-        if (fileLength == 0)
+        // Walk the points in the text file
+        r4aEsp32NvmLineReaderBegin(&reader, &textFile, buffer, sizeof(buffer));
+        readStatus = false;
+        writeStatus = true;
+        while (1)
         {
-            // Write the header to the file
-            if ((!r4aEsp32NvmWriteFileString(file, wpHeader1, strlen(wpHeader1)))
-                || (!r4aEsp32NvmWriteFileString(file, wpHeader2, strlen(wpHeader2))))
+            R4A_ESP32_WP_POINT * current = &point[(previous + 1) & 1];
+            double horizontalAccuracy;
+            double horizontalAccuracyStdDev;
+
+            // Read the next line, the reader displays the line length error
+            line = r4aEsp32NvmLineReaderGetLine(&reader, nullptr, display);
+            if (!line)
+            {
+                readStatus = !reader._error;
+                break;
+            }
+
+            // Skip the file header and empty lines
+            if ((reader._lineCount <= 2) || (!*line))
+                continue;
+
+            // Parse the point, reject an invalid or partially written line
+            if (!r4aEsp32WpParsePoint(line,
+                                      &current->_latitude,
+                                      &current->_longitude,
+                                      &current->_altitude,
+                                      &horizontalAccuracy,
+                                      &horizontalAccuracyStdDev,
+                                      &current->_satellitesInView,
+                                      &comment,
+                                      display))
             {
                 if (display)
-                    display->printf("ERROR: Failed to write the header to file %s\r\n", path);
+                    display->printf("ERROR: Invalid waypoint on line %d of %s!\r\n",
+                                    reader._lineCount, textPath);
                 break;
             }
+            current->_horizontalAccuracy = (float)horizontalAccuracy;
+            current->_horizontalAccuracyStdDev = (float)horizontalAccuracyStdDev;
+            current->_heading = 0;
+            current->_distance = 0;
+            strlcpy(current->_comment, comment.c_str(), sizeof(current->_comment));
+
+            // Complete and write the previous point
+            if (previous >= 0)
+            {
+                r4aEsp32WpComputeSegment(point[previous]._latitude,
+                                         point[previous]._longitude,
+                                         current->_latitude,
+                                         current->_longitude,
+                                         &point[previous]._heading,
+                                         &point[previous]._distance);
+                writeStatus = (binaryFile.write((uint8_t *)&point[previous], sizeof(point[0]))
+                               == sizeof(point[0]));
+                if (!writeStatus)
+                {
+                    if (display)
+                        display->printf("ERROR: Failed to write file %s!\r\n", tempPath.c_str());
+                    break;
+                }
+            }
+            previous = current - point;
+            header._pointCount += 1;
         }
+        if (!readStatus)
+            break;
 
-        // Write the waypoint data
-        sprintf(line, wpFormat, latitude, longitude, altitude, horizontalAccuracy,
-                horizontalAccuracyStdDev, satellitesInView,
-                comment ? comment : "");
+        // Write the last point
+        if (previous >= 0)
+            writeStatus = writeStatus
+                        && (binaryFile.write((uint8_t *)&point[previous], sizeof(point[0]))
+                            == sizeof(point[0]));
+
+        // Write the header
+        header._magic = R4A_ESP32_WP_BINARY_MAGIC;
+        header._version = R4A_ESP32_WP_BINARY_VERSION;
+        header._recordBytes = sizeof(R4A_ESP32_WP_POINT);
+        writeStatus = writeStatus
+                    && binaryFile.seek(0)
+                    && (binaryFile.write((uint8_t *)&header, sizeof(header)) == sizeof(header));
+        if (!writeStatus)
+        {
+            if (display)
+                display->printf("ERROR: Failed to write file %s!\r\n", tempPath.c_str());
+            break;
+        }
+        binaryFile.close();
+
+        // Replace the binary file
+        if (!r4aEsp32NvmReplaceFile(tempPath.c_str(), binaryPath, display))
+            break;
         if (display)
-            display->printf("Saving waypoint to %s\r\n", path);
-        if (!r4aEsp32NvmWriteFileString(file, line, strlen(line)))
+            display->printf("Converted %ld waypoints from %s to %s\r\n",
+                            header._pointCount, textPath, binaryPath);
+        success = true;
+    } while (0);
+
+    // Done with the files
+    if (textFile)
+        textFile.close();
+    if (binaryFile)
+        binaryFile.close();
+    if ((!success) && LittleFS.exists(tempPath.c_str()))
+    {
+        if (display)
+            display->printf("ERROR: Failed to convert %s to %s!\r\n", textPath, binaryPath);
+        LittleFS.remove(tempPath.c_str());
+    }
+    return success;
+}
+
+//*********************************************************************
+// Convert a binary waypoint file into a text waypoint file
+// Inputs:
+//   binaryPath: Path to the binary waypoint file
+//   textPath: Path to the text waypoint file
+//   display: Device used for output
+// Outputs:
+//   Returns true if the file was successfully converted
+bool r4aEsp32WpConvertToText(const char * binaryPath,
+                             const char * textPath,
+                             Print * display)
+{
+    uint32_t index;
+    char line[256];
+    R4A_ESP32_WP_POINT point;
+    bool success;
+    String tempPath;
+    File textFile;
+    R4A_ESP32_WP_FILE wpFile;
+
+    // Write the text file using a temporary name
+    tempPath = String(textPath) + String(".tmp");
+    success = false;
+    do
+    {
+        // Open the files
+        if (!r4aEsp32WpBinaryOpen(&wpFile, binaryPath, display))
+            break;
+        textFile = LittleFS.open(tempPath.c_str(), FILE_WRITE);
+        if (!textFile)
         {
             if (display)
-                display->printf("ERROR: Failed to write the header to file %s\r\n", path);
+                display->printf("ERROR: Failed to create file %s!\r\n", tempPath.c_str());
             break;
         }
 
-        // Display the waypoint
-        sprintf(line, wpFormat, latitude, longitude, altitude, horizontalAccuracy,
-                horizontalAccuracyStdDev, satellitesInView,
-                comment ? comment : "");
-        display->print(wpHeader1);
-        display->print(wpHeader2);
-        display->print(line);
+        // Write the header to the file
+        if ((!r4aEsp32NvmWriteFileString(textFile, wpHeader1, strlen(wpHeader1)))
+            || (!r4aEsp32NvmWriteFileString(textFile, wpHeader2, strlen(wpHeader2))))
+        {
+            if (display)
+                display->printf("ERROR: Failed to write the header to file %s\r\n", tempPath.c_str());
+            break;
+        }
+
+        // Write the points to the file
+        for (index = 0; index < wpFile._pointCount; index++)
+        {
+            if (!r4aEsp32WpBinaryReadPoint(&wpFile, index, &point, display))
+                break;
+            snprintf(line, sizeof(line), wpFormat,
+                     point._latitude, point._longitude, point._altitude,
+                     point._horizontalAccuracy, point._horizontalAccuracyStdDev,
+                     point._satellitesInView, point._comment);
+            if (!r4aEsp32NvmWriteFileString(textFile, line, strlen(line)))
+            {
+                if (display)
+                    display->printf("ERROR: Failed to write to file %s\r\n", tempPath.c_str());
+                break;
+            }
+        }
+        if (index < wpFile._pointCount)
+            break;
+        textFile.close();
 
-        // The waypoint was successfully written
+        // Replace the text file, closes any file writer using the file
+        if (!r4aEsp32NvmReplaceFile(tempPath.c_str(), textPath, display))
+            break;
+        if (display)
+            display->printf("Converted %ld waypoints from %s to %s\r\n",
+                            wpFile._pointCount, binaryPath, textPath);
+        success = true;
     } while (0);
 
-    // Done with the file
-    if (file)
-        file.close();
+    // Done with the files
+    r4aEsp32WpBinaryClose(&wpFile);
+    if (textFile)
+        textFile.close();
+    if ((!success) && LittleFS.exists(tempPath.c_str()))
+    {
+        if (display)
+            display->printf("ERROR: Failed to convert %s to %s!\r\n", binaryPath, textPath);
+        LittleFS.remove(tempPath.c_str());
+    }
+    return success;
 }
 
 //*********************************************************************
@@ -142,6 +558,44 @@ void r4aEsp32WpMenuAddPoint(const R4A_MENU_ENTRY * menuEntry,
         display->printf("ERROR: GNSS not initialized!\r\n");
 }
 
+//*********************************************************************
+// Convert the waypoint file into a binary waypoint file
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32WpMenuConvertToBinary(const R4A_MENU_ENTRY * menuEntry,
+                                   const char * command,
+                                   Print * display)
+{
+    String binaryPath;
+    String textPath;
+
+    // Convert the file
+    binaryPath = r4aEsp32WpBinaryFilePath();
+    textPath = String("/") + String(r4aEsp32WpFileName);
+    r4aEsp32WpConvertToBinary(textPath.c_str(), binaryPath.c_str(), display);
+}
+
+//*********************************************************************
+// Convert the binary waypoint file into the waypoint file
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32WpMenuConvertToText(const R4A_MENU_ENTRY * menuEntry,
+                                 const char * command,
+                                 Print * display)
+{
+    String binaryPath;
+    String textPath;
+
+    // Convert the file
+    binaryPath = r4aEsp32WpBinaryFilePath();
+    textPath = String("/") + String(r4aEsp32WpFileName);
+    r4aEsp32WpConvertToText(binaryPath.c_str(), textPath.c_str(), display);
+}
+
 //*********************************************************************
 // Display a point from the waypoint file
 // Inputs:
@@ -226,12 +680,125 @@ void r4aEsp32WpMenuPrintFile(const R4A_MENU_ENTRY * menuEntry,
     String filePath;
 
     // Display the file contents
+    r4aEsp32WpWriter.flush();
     filePath = String("/") + String(r4aEsp32WpFileName);
     r4aEsp32NvmFileCat(filePath, display);
 }
 
 //*********************************************************************
-// Read a from the waypoint file
+// Display the waypoint file writer statistics
+// Inputs:
+//   menuEntry: Address of the object describing the menu entry
+//   command: Zero terminated command string
+//   display: Device used for output
+void r4aEsp32WpMenuWriterStats(const R4A_MENU_ENTRY * menuEntry,
+                               const char * command,
+                               Print * display)
+{
+    r4aEsp32WpWriter.displayStats(display);
+}
+
+//*********************************************************************
+// Parse a point line from the waypoint file
+// Inputs:
+//   line: Zero terminated line from the waypoint file
+//   latitude: Address to receive latitude in degrees
+//   longitude: Address to receive longitude in degrees
+//   altitude: Address to receive altitude in meters
+//   horizontalAccuracy: Address to receive horizontal accuracy in meters
+//   horizontalAccuracyStdDev: Address to receive horizontal accuracy standard deviation in meters
+//   satellitesInView: Address to receive the number of satellites feeding the GNSS receiver
+//   comment: Address of the String to receive the comment
+//   display: Device used for output
+// Outputs:
+//   Returns true if the point was successfully parsed
+bool r4aEsp32WpParsePoint(char * line,
+                          double * latitude,
+                          double * longitude,
+                          double * altitude,
+                          double * horizontalAccuracy,
+                          double * horizontalAccuracyStdDev,
+                          uint8_t * satellitesInView,
+                          String * comment,
+                          Print * display)
+{
+    uint8_t * nextParameter;
+    uint8_t * parameter;
+    int satellites;
+
+    // Get the latitude
+    parameter = (uint8_t *)line;
+    nextParameter = r4aSupportGetParameter(&parameter);
+    if (sscanf((char *)parameter, "%lf", latitude) != 1)
+    {
+        if (display)
+            display->printf("Invalid latitude value\r\n");
+        return false;
+    }
+
+    // Get the longitude
+    parameter = nextParameter;
+    nextParameter = r4aSupportGetParameter(&parameter);
+    if (sscanf((char *)parameter, "%lf", longitude) != 1)
+    {
+        if (display)
+            display->printf("Invalid longitude value\r\n");
+        return false;
+    }
+
+    // Get the altitude
+    parameter = nextParameter;
+    nextParameter = r4aSupportGetParameter(&parameter);
+    if (sscanf((char *)parameter, "%lf", altitude) != 1)
+    {
+        if (display)
+            display->printf("Invalid altitude value\r\n");
+        return false;
+    }
+
+    // Get the horizontalAccuracy
+    parameter = nextParameter;
+    nextParameter = r4aSupportGetParameter(&parameter);
+    if (sscanf((char *)parameter, "%lf", horizontalAccuracy) != 1)
+    {
+        if (display)
+            display->printf("Invalid horizontalAccuracy value\r\n");
+        return false;
+    }
+
+    // Get the horizontalAccuracyStdDev
+    parameter = nextParameter;
+    nextParameter = r4aSupportGetParameter(&parameter);
+    if (sscanf((char *)parameter, "%lf", horizontalAccuracyStdDev) != 1)
+    {
+        if (display)
+            display->printf("Invalid horizontalAccuracyStdDev value\r\n");
+        return false;
+    }
+
+    // Get the satellites
+    parameter = nextParameter;
+    nextParameter = r4aSupportGetParameter(&parameter);
+    if (sscanf((char *)parameter, "%d", &satellites) != 1)
+    {
+        if (display)
+            display->printf("Invalid satellitesInView value\r\n");
+        return false;
+    }
+    *satellitesInView = (uint8_t)satellites;
+
+    // Get the comment value
+    parameter = r4aSupportRemoveWhiteSpace(nextParameter);
+    r4aSupportTrimWhiteSpace(parameter);
+    *comment = String((char *)parameter);
+
+    // The waypoint was found
+    return true;
+}
+
+//*********************************************************************
+// Read a from the waypoint file.  The routine buffers the file data
+// between calls, only one waypoint file may be read at a time.
 // Inputs:
 //   file: Address of tha address of the waypoint file object
 //   fileSize: Address of the value to receive the file size
@@ -256,18 +823,18 @@ bool r4aEsp32WpReadPoint(File * file,
                          Print * display)
 {
     String filePath;
-    uint8_t line[256];
-    uint8_t * nextParameter;
+    char * line;
     const char * path;
-    uint8_t * parameter;
-    int satellites;
+    R4A_ESP32_NVM_LINE_READER * reader;
 
     // Read the next point from the waypoint file
+    reader = &r4aEsp32WpLineReader;
     do
     {
         // Open the waypoint file if necessary
         if (!*file)
         {
+            r4aEsp32WpWriter.flush();
             filePath = String("/") + String(r4aEsp32WpFileName);
             path = filePath.c_str();
             *file = LittleFS.open(path, FILE_READ);
@@ -279,13 +846,17 @@ bool r4aEsp32WpReadPoint(File * file,
             }
 
             // Discard the file header
-            if (!r4aEsp32NvmReadLine(file, line, sizeof(line), display))
+            r4aEsp32NvmLineReaderBegin(reader,
+                                       file,
+                                       r4aEsp32WpLineBuffer,
+                                       sizeof(r4aEsp32WpLineBuffer));
+            if (!r4aEsp32NvmLineReaderGetLine(reader, nullptr, display))
             {
                 if (display)
                     display->printf("ERROR: Failed to read the first header line!\r\n");
                 break;
             }
-            if (!r4aEsp32NvmReadLine(file, line, sizeof(line), display))
+            if (!r4aEsp32NvmLineReaderGetLine(reader, nullptr, display))
             {
                 if (display)
                     display->printf("ERROR: Failed to read the second header line!\r\n");
@@ -293,79 +864,34 @@ bool r4aEsp32WpReadPoint(File * file,
             }
         }
 
+        // Start reading at the current position of a file opened by the
+        // caller
+        else if (reader->_file != file)
+            r4aEsp32NvmLineReaderBegin(reader,
+                                       file,
+                                       r4aEsp32WpLineBuffer,
+                                       sizeof(r4aEsp32WpLineBuffer));
+
         // Read the next point line from the waypoint file
-        if (!r4aEsp32NvmReadLine(file, line, sizeof(line), display))
+        line = r4aEsp32NvmLineReaderGetLine(reader, nullptr, display);
+        if (!line)
         {
             if (display)
                 display->printf("End of file %s\r\n", r4aEsp32WpFileName);
             break;
         }
 
-        // Get the latitude
-        parameter = line;
-        nextParameter = r4aSupportGetParameter(&parameter);
-        if (sscanf((char *)parameter, "%lf", latitude) == 0)
-        {
-            if (display)
-                display->printf("Invalid latitude value\r\n");
-            break;
-        }
-
-        // Get the longitude
-        parameter = nextParameter;
-        nextParameter = r4aSupportGetParameter(&parameter);
-        if (sscanf((char *)parameter, "%lf", longitude) == 0)
-        {
-            if (display)
-                display->printf("Invalid longitude value\r\n");
-            break;
-        }
-
-        // Get the altitude
-        parameter = nextParameter;
-        nextParameter = r4aSupportGetParameter(&parameter);
-        if (sscanf((char *)parameter, "%lf", altitude) == 0)
-        {
-            if (display)
-                display->printf("Invalid altitude value\r\n");
-            break;
-        }
-
-        // Get the horizontalAccuracy
-        parameter = nextParameter;
-        nextParameter = r4aSupportGetParameter(&parameter);
-        if (sscanf((char *)parameter, "%lf", horizontalAccuracy) == 0)
-        {
-            if (display)
-                display->printf("Invalid horizontalAccuracy value\r\n");
-            break;
-        }
-
-        // Get the horizontalAccuracyStdDev
-        parameter = nextParameter;
-        nextParameter = r4aSupportGetParameter(&parameter);
-        if (sscanf((char *)parameter, "%lf", horizontalAccuracyStdDev) == 0)
-        {
-            if (display)
-                display->printf("Invalid horizontalAccuracyStdDev value\r\n");
-            break;
-        }
-
-        // Get the satellites
-        parameter = nextParameter;
-        nextParameter = r4aSupportGetParameter(&parameter);
-        if (sscanf((char *)parameter, "%d", &satellites) == 0)
-        {
-            if (display)
-                display->printf("Invalid satellitesInView value\r\n");
+        // Parse the point
+        if (!r4aEsp32WpParsePoint(line,
+                                  latitude,
+                                  longitude,
+                                  altitude,
+                                  horizontalAccuracy,
+                                  horizontalAccuracyStdDev,
+                                  satellitesInView,
+                                  comment,
+                                  display))
             break;
-        }
-        *satellitesInView = (uint8_t)satellites;
-
-        // Get the comment value
-        parameter = r4aSupportRemoveWhiteSpace(nextParameter);
-        r4aSupportTrimWhiteSpace(parameter);
-        *comment = String((char *)parameter);
 
         // The waypoint was found
         return true;
@@ -374,5 +900,57 @@ bool r4aEsp32WpReadPoint(File * file,
     // Done with the file
     if (*file)
         file->close();
+    reader->_file = nullptr;
     return false;
 }
+
+//*********************************************************************
+// Read a point from the waypoint file using a line reader
+// Inputs:
+//   reader: Address of the line reader object for the waypoint file
+//   latitude: Address to receive latitude in degrees
+//   longitude: Address to receive longitude in degrees
+//   altitude: Address to receive altitude in meters
+//   horizontalAccuracy: Address to receive horizontal accuracy in meters
+//   horizontalAccuracyStdDev: Address to receive horizontal accuracy standard deviation in meters
+//   satellitesInView: Address to receive the number of satellites feeding the GNSS receiver
+//   comment: Address of the String to receive the comment
+//   display: Device used for output
+// Outputs:
+//   Returns true if the point was found and false when no more points
+//   are available
+bool r4aEsp32WpReadPoint(R4A_ESP32_NVM_LINE_READER * reader,
+                         double * latitude,
+                         double * longitude,
+                         double * altitude,
+                         double * horizontalAccuracy,
+                         double * horizontalAccuracyStdDev,
+                         uint8_t * satellitesInView,
+                         String * comment,
+                         Print * display)
+{
+    char * line;
+
+    // Read the next point line, discarding the file header
+    do
+    {
+        line = r4aEsp32NvmLineReaderGetLine(reader, nullptr, display);
+        if (!line)
+        {
+            if (display)
+                display->printf("End of file %s\r\n", r4aEsp32WpFileName);
+            return false;
+        }
+    } while (reader->_lineCount <= 2);
+
+    // Parse the point
+    return r4aEsp32WpParsePoint(line,
+                                latitude,
+                                longitude,
+                                altitude,
+                                horizontalAccuracy,
+                                horizontalAccuracyStdDev,
+                                satellitesInView,
+                                comment,
+                                display);
+}
@@ -6,15 +6,59 @@
 **********************************************************************/
 
 #include "R4A_ESP32.h"
+#include <mbedtls/base64.h>     // IDF built-in, decode Basic authorization
+
+//****************************************
+// Constants
+//****************************************
+
+#define R4A_WEB_SERVER_AUTH_BYTES       128
+#define R4A_WEB_SERVER_BUFFER_BYTES_MAX (32 * 1024)
+#define R4A_WEB_SERVER_BUFFER_BYTES_MIN 1024
+#define R4A_WEB_SERVER_HEADER_BYTES     64
+#define R4A_WEB_SERVER_PATH_BYTES       128
+#define R4A_WEB_SERVER_SPEED_PASSES     4
+#define R4A_WEB_SERVER_VALID_TIME       1577836800  // 2020-01-01 00:00:00 UTC
+
+typedef struct _R4A_WEB_SERVER_CONTENT_TYPE
+{
+    const char * _extension;
+    const char * _contentType;
+} R4A_WEB_SERVER_CONTENT_TYPE;
+
+// Sorted by extension
+const R4A_WEB_SERVER_CONTENT_TYPE r4aWebServerContentTypes[] =
+{
+    {".bin",    "application/octet-stream"},
+    {".css",    "text/css"},
+    {".csv",    "text/csv"},
+    {".gif",    "image/gif"},
+    {".htm",    "text/html"},
+    {".html",   "text/html"},
+    {".ico",    "image/x-icon"},
+    {".jpeg",   "image/jpeg"},
+    {".jpg",    "image/jpeg"},
+    {".js",     "application/javascript"},
+    {".json",   "application/json"},
+    {".log",    "text/plain"},
+    {".png",    "image/png"},
+    {".svg",    "image/svg+xml"},
+    {".txt",    "text/plain"},
+    {".xml",    "text/xml"},
+};
+const int r4aWebServerContentTypeCount = sizeof(r4aWebServerContentTypes)
+                                       / sizeof(r4aWebServerContentTypes[0]);
 
 //****************************************
 // Globals
 //****************************************
 
+uint32_t r4aWebServerBufferBytes = 8192;    // File I/O buffer size per web server
 Print * r4aWebServerDebug;
 bool r4aWebServerEnable = true;
 const char * r4aWebServerDownloadArea;
 const char * r4aWebServerNvmArea;
+const char * r4aWebServerUploadPassword;
 uint8_t r4aWebServerCameraUser;
 volatile int32_t r4aWebServerCameraUserCount;
 
@@ -98,38 +142,331 @@ esp_err_t r4aWebServerError (httpd_req_t *request,
     return ESP_OK;
 }
 
+//*********************************************************************
+// Allocate the file I/O buffer, the web server processes one request
+// at a time so the buffer is reused by all of the requests
+static bool r4aWebServerBufferAllocate(R4A_WEB_SERVER * object)
+{
+    uint32_t bufferBytes;
+
+    // Determine the buffer size
+    bufferBytes = r4aWebServerBufferBytes;
+    if (bufferBytes < R4A_WEB_SERVER_BUFFER_BYTES_MIN)
+        bufferBytes = R4A_WEB_SERVER_BUFFER_BYTES_MIN;
+
+    // Reuse the existing buffer
+    if (object->_buffer && (object->_bufferBytes == bufferBytes))
+        return true;
+
+    // Allocate the new buffer
+    if (object->_buffer)
+        r4aFree(object->_buffer, "WebServer data buffer (_buffer)");
+    object->_bufferBytes = 0;
+    object->_buffer = (uint8_t *)r4aMalloc(bufferBytes, "WebServer data buffer (_buffer)");
+    if (!object->_buffer)
+        return false;
+    object->_bufferBytes = bufferBytes;
+    return true;
+}
+
+//*********************************************************************
+// Get the content type from the file extension
+static const char * r4aWebServerContentType(const char * path)
+{
+    int index;
+
+    for (index = 0; index < r4aWebServerContentTypeCount; index++)
+        if (r4aWebServerCheckExtension(nullptr,
+                                       path,
+                                       r4aWebServerContentTypes[index]._extension))
+            return r4aWebServerContentTypes[index]._contentType;
+    return "application/octet-stream";
+}
+
+//*********************************************************************
+// Add a JSON string to the buffer
+static size_t r4aWebServerJsonString(char * buffer, const char * string)
+{
+    char * start;
+
+    start = buffer;
+    *buffer++ = '"';
+    while (*string)
+    {
+        if ((*string == '"') || (*string == '\\'))
+        {
+            *buffer++ = '\\';
+            *buffer++ = *string;
+        }
+        else if ((uint8_t)*string < ' ')
+            buffer += sprintf(buffer, "\\u%04x", (uint8_t)*string);
+        else
+            *buffer++ = *string;
+        string += 1;
+    }
+    *buffer++ = '"';
+    *buffer = 0;
+    return buffer - start;
+}
+
+//*********************************************************************
+// Send the directory listing as a JSON object
+static esp_err_t r4aWebServerDirectoryList(httpd_req_t *request,
+                                           R4A_WEB_SERVER * object,
+                                           File * directory,
+                                           const char * path)
+{
+    char * buffer;
+    size_t bufferBytes;
+    File file;
+    bool firstFile;
+    size_t length;
+    esp_err_t status;
+
+    // Start the JSON object
+    buffer = (char *)object->_buffer;
+    bufferBytes = object->_bufferBytes;
+    httpd_resp_set_type(request, "application/json");
+    length = sprintf(buffer, "{\"path\":");
+    length += r4aWebServerJsonString(&buffer[length], path);
+    length += sprintf(&buffer[length], ",\"files\":[");
+
+    // Add the directory entries
+    firstFile = true;
+    status = ESP_OK;
+    file = directory->openNextFile();
+    while (file)
+    {
+        // Send the buffer when the next entry may not fit, the name
+        // may grow by a factor of 6 when escaped
+        if ((bufferBytes - length) < ((strlen(file.name()) * 6) + 128))
+        {
+            status = httpd_resp_send_chunk(request, buffer, length);
+            length = 0;
+            if (status != ESP_OK)
+                break;
+        }
+
+        // Add the entry
+        if (!firstFile)
+            buffer[length++] = ',';
+        firstFile = false;
+        length += sprintf(&buffer[length], "{\"name\":");
+        length += r4aWebServerJsonString(&buffer[length], file.name());
+        length += sprintf(&buffer[length],
+                          ",\"size\":%u,\"directory\":%s,\"modified\":%lu}",
+                          file.size(),
+                          file.isDirectory() ? "true" : "false",
+                          (uint32_t)file.getLastWrite());
+
+        // Get the next entry
+        file.close();
+        file = directory->openNextFile();
+    }
+    if (file)
+        file.close();
+
+    // Finish the JSON object
+    if (status == ESP_OK)
+    {
+        length += sprintf(&buffer[length], "]}\n");
+        status = httpd_resp_send_chunk(request, buffer, length);
+    }
+    if (status == ESP_OK)
+        status = httpd_resp_send_chunk(request, NULL, 0);
+    return status;
+}
+
+//*********************************************************************
+// Get the file path from the URI, remove the NVM area prefix, the query
+// string and the trailing slash.  Send an error response upon failure.
+static bool r4aWebServerGetFilePath(httpd_req_t *request,
+                                    char filePath[R4A_WEB_SERVER_PATH_BYTES])
+{
+    size_t length;
+    const char * path;
+
+    // Remove the NVM area prefix
+    path = request->uri;
+    if (strncmp(r4aWebServerNvmArea, path, strlen(r4aWebServerNvmArea)) != 0)
+    {
+        if (r4aWebServerDebug)
+            r4aWebServerDebug->printf("ERROR: Not a NVM file request\r\n");
+        httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Not a NVM file request");
+        return false;
+    }
+    path = &path[strlen(r4aWebServerNvmArea) - 1];
+
+    // Remove the query string and the trailing slash
+    length = strcspn(path, "?");
+    if (length >= R4A_WEB_SERVER_PATH_BYTES)
+    {
+        if (r4aWebServerDebug)
+            r4aWebServerDebug->printf("ERROR: File path too long!\r\n");
+        httpd_resp_send_err(request, HTTPD_404_NOT_FOUND, "File path too long");
+        return false;
+    }
+    memcpy(filePath, path, length);
+    if ((length > 1) && (filePath[length - 1] == '/'))
+        length -= 1;
+    filePath[length] = 0;
+    return true;
+}
+
+//*********************************************************************
+// Get the value of a request header, ignore truncated values
+static bool r4aWebServerGetHeader(httpd_req_t *request,
+                                  const char * name,
+                                  char * value,
+                                  size_t valueBytes)
+{
+    return (httpd_req_get_hdr_value_str(request, name, value, valueBytes) == ESP_OK);
+}
+
+//*********************************************************************
+// Verify the Basic authorization password for a request that changes
+// the files.  Send an error response upon failure.
+static bool r4aWebServerAuthorized(httpd_req_t *request)
+{
+    char authorization[R4A_WEB_SERVER_AUTH_BYTES];
+    uint8_t credentials[R4A_WEB_SERVER_AUTH_BYTES];
+    size_t length;
+    const char * password;
+
+    // Changes are not allowed until a password is set
+    if ((!r4aWebServerUploadPassword) || (!*r4aWebServerUploadPassword))
+    {
+        if (r4aWebServerDebug)
+            r4aWebServerDebug->printf("ERROR: Uploads disabled, no upload password set\r\n");
+        httpd_resp_send_err(request, HTTPD_403_FORBIDDEN, "Uploads disabled, no upload password set");
+        return false;
+    }
+
+    // Decode the user:password credentials, any user name is accepted
+    if (r4aWebServerGetHeader(request, "Authorization", authorization, sizeof(authorization))
+        && (strncasecmp(authorization, "Basic ", 6) == 0)
+        && (mbedtls_base64_decode(credentials,
+                                  sizeof(credentials) - 1,
+                                  &length,
+                                  (const uint8_t *)&authorization[6],
+                                  strlen(&authorization[6])) == 0))
+    {
+        credentials[length] = 0;
+        password = strchr((const char *)credentials, ':');
+        if (password && (strcmp(&password[1], r4aWebServerUploadPassword) == 0))
+            return true;
+    }
+
+    // Request the credentials
+    if (r4aWebServerDebug)
+        r4aWebServerDebug->printf("ERROR: Upload of %s not authorized\r\n", request->uri);
+    httpd_resp_set_status(request, "401 Unauthorized");
+    httpd_resp_set_hdr(request, "WWW-Authenticate", "Basic realm=\"R4A NVM\"");
+    httpd_resp_send(request, "Unauthorized", HTTPD_RESP_USE_STRLEN);
+    return false;
+}
+
+//*********************************************************************
+// Parse the Range header value, only a single byte range is supported
+// Outputs:
+//   Returns 1 when the range is valid, 0 when the header is ignored
+//   and the entire file is sent and -1 when the range is not satisfiable
+static int r4aWebServerParseRange(const char * range,
+                                  size_t fileSize,
+                                  size_t * offset,
+                                  size_t * length)
+{
+    char * end;
+    unsigned long firstByte;
+    unsigned long lastByte;
+
+    // Only byte ranges are supported, send the entire file for multiple ranges
+    if (strncmp(range, "bytes=", 6) || strchr(range, ','))
+        return 0;
+    range += 6;
+
+    // Handle the suffix range: bytes=-n
+    if (*range == '-')
+    {
+        lastByte = strtoul(&range[1], &end, 10);
+        if ((end == &range[1]) || *end)
+            return 0;
+        if ((lastByte == 0) || (fileSize == 0))
+            return -1;
+        if (lastByte > fileSize)
+            lastByte = fileSize;
+        *offset = fileSize - lastByte;
+        *length = lastByte;
+        return 1;
+    }
+
+    // Handle the ranges: bytes=first- and bytes=first-last
+    firstByte = strtoul(range, &end, 10);
+    if ((end == range) || (*end != '-'))
+        return 0;
+    range = &end[1];
+    lastByte = fileSize - 1;
+    if (*range)
+    {
+        lastByte = strtoul(range, &end, 10);
+        if (*end || (lastByte < firstByte))
+            return 0;
+    }
+    if (firstByte >= fileSize)
+        return -1;
+    if (lastByte >= fileSize)
+        lastByte = fileSize - 1;
+    *offset = firstByte;
+    *length = lastByte - firstByte + 1;
+    return 1;
+}
+
 //*********************************************************************
 // Download a file from the robot to the browser
 esp_err_t r4aWebServerFileDownload(httpd_req_t *request)
 {
-    uint8_t * buffer;
-    const size_t bufferLength = 1200;   //8192;
+    char acceptEncoding[R4A_WEB_SERVER_HEADER_BYTES];
     size_t bytesRead;
+    size_t bytesToSend;
+    char contentRange[64];
     const char * dataType;
+    uint32_t elapsedMsec;
+    char eTag[32];
     File file;
+    char filePath[R4A_WEB_SERVER_PATH_BYTES];
+    size_t fileSize;
+    bool gzip;
+    char gzipPath[R4A_WEB_SERVER_PATH_BYTES + 3];
+    char headerValue[R4A_WEB_SERVER_HEADER_BYTES];
+    char lastModified[32];
+    time_t lastWrite;
+    size_t length;
+    bool notModified;
+    R4A_WEB_SERVER * object;
+    size_t offset;
     const char * path;
+    int rangeStatus;
+    uint32_t startMsec;
     esp_err_t status;
-    R4A_WEB_SERVER * object;
+    struct tm timeFields;
 
     // Get the web server data structure
     object = (R4A_WEB_SERVER *)request->user_ctx;
 
     do
     {
-        buffer = nullptr;
+        status = ESP_FAIL;
 
         // Get the file name
-        path = request->uri;
-
-        // Remove the download prefix
-        if (strncmp(r4aWebServerNvmArea, path, strlen(r4aWebServerNvmArea)) != 0)
-        {
-            if (r4aWebServerDebug)
-                r4aWebServerDebug->printf("ERROR: Not a file download request\r\n");
-            httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Not a file download request");
+        if (!r4aWebServerGetFilePath(request, filePath))
             break;
-        }
-        path = &path[strlen(r4aWebServerNvmArea) - 1];
+
+        // Use the compressed file when the browser supports gzip encoding
+        sprintf(gzipPath, "%s.gz", filePath);
+        gzip = r4aWebServerGetHeader(request, "Accept-Encoding", acceptEncoding, sizeof(acceptEncoding))
+            && strstr(acceptEncoding, "gzip")
+            && LittleFS.exists(gzipPath);
+        path = gzip ? gzipPath : filePath;
 
         // Determine if the file exists
         if (LittleFS.exists(path) == false)
@@ -140,22 +477,8 @@ esp_err_t r4aWebServerFileDownload(httpd_req_t *request)
             break;
         }
 
-        // Determine the data type
-        dataType = nullptr;
-        if (r4aWebServerCheckExtension(object, path, ".txt")
-            || r4aWebServerCheckExtension(object, path, ".log"))
-            dataType = "text/plain";
-        if (!dataType)
-        {
-            if (r4aWebServerDebug)
-                r4aWebServerDebug->printf("ERROR: Unknowo file type!\r\n");
-            httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Unknown file type");
-            break;
-        }
-
-        // Allocate the buffer
-        buffer = (uint8_t *)r4aMalloc(bufferLength, "WebServer data buffer (buffer)");
-        if (!buffer)
+        // Get the data buffer
+        if (!r4aWebServerBufferAllocate(object))
         {
             if (r4aWebServerDebug)
                 r4aWebServerDebug->printf("ERROR: Failed to allocate the data buffer\r\n");
@@ -173,55 +496,301 @@ esp_err_t r4aWebServerFileDownload(httpd_req_t *request)
             break;
         }
 
-        // Verify that the file is not a directory
+        // List the directory contents
         if (file.isDirectory())
         {
-            if (r4aWebServerDebug)
-                r4aWebServerDebug->printf("ERROR: File %s is a directory!\r\n", path);
-            httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Unable to download a directory");
+            status = r4aWebServerDirectoryList(request, object, &file, filePath);
             break;
         }
 
+        // Describe the file, the ETag changes when the file is written
+        dataType = r4aWebServerContentType(filePath);
+        fileSize = file.size();
+        lastWrite = file.getLastWrite();
+        snprintf(eTag, sizeof(eTag), "\"%lx-%lx%s\"",
+                 (uint32_t)fileSize, (uint32_t)lastWrite, gzip ? "-gz" : "");
+        lastModified[0] = 0;
+        if ((lastWrite >= R4A_WEB_SERVER_VALID_TIME) && gmtime_r(&lastWrite, &timeFields))
+            strftime(lastModified, sizeof(lastModified), "%a, %d %b %Y %H:%M:%S GMT", &timeFields);
+
+        // Build the response header
+        httpd_resp_set_type(request, dataType);
+        httpd_resp_set_hdr(request, "Accept-Ranges", "bytes");
+        httpd_resp_set_hdr(request, "ETag", eTag);
+        if (lastModified[0])
+            httpd_resp_set_hdr(request, "Last-Modified", lastModified);
+        if (gzip)
+        {
+            httpd_resp_set_hdr(request, "Content-Encoding", "gzip");
+            httpd_resp_set_hdr(request, "Vary", "Accept-Encoding");
+        }
+
+        // Skip the download when the browser has the current file,
+        // If-None-Match takes precedence over If-Modified-Since
+        if (r4aWebServerGetHeader(request, "If-None-Match", headerValue, sizeof(headerValue)))
+            notModified = strstr(headerValue, eTag) || (strcmp(headerValue, "*") == 0);
+        else
+            notModified = lastModified[0]
+                && r4aWebServerGetHeader(request, "If-Modified-Since", headerValue, sizeof(headerValue))
+                && (strcmp(headerValue, lastModified) == 0);
+        if (notModified)
+        {
+            httpd_resp_set_status(request, "304 Not Modified");
+            status = httpd_resp_send(request, nullptr, 0);
+            break;
+        }
+
+        // Determine the portion of the file to send, If-Range sends the
+        // entire file when it has changed
+        offset = 0;
+        bytesToSend = fileSize;
+        if (r4aWebServerGetHeader(request, "Range", headerValue, sizeof(headerValue)))
+        {
+            rangeStatus = r4aWebServerParseRange(headerValue, fileSize, &offset, &bytesToSend);
+            if (r4aWebServerGetHeader(request, "If-Range", headerValue, sizeof(headerValue))
+                && strcmp(headerValue, eTag))
+            {
+                rangeStatus = 0;
+                offset = 0;
+                bytesToSend = fileSize;
+            }
+            if (rangeStatus < 0)
+            {
+                snprintf(contentRange, sizeof(contentRange), "bytes */%u", fileSize);
+                httpd_resp_set_hdr(request, "Content-Range", contentRange);
+                httpd_resp_set_status(request, "416 Range Not Satisfiable");
+                status = httpd_resp_send(request, nullptr, 0);
+                break;
+            }
+            if (rangeStatus > 0)
+            {
+                snprintf(contentRange, sizeof(contentRange), "bytes %u-%u/%u",
+                         offset, offset + bytesToSend - 1, fileSize);
+                httpd_resp_set_hdr(request, "Content-Range", contentRange);
+                httpd_resp_set_status(request, "206 Partial Content");
+                if (!file.seek(offset))
+                {
+                    if (r4aWebServerDebug)
+                        r4aWebServerDebug->printf("ERROR: Failed to seek to offset %u in %s\r\n", offset, path);
+                    httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to seek in file");
+                    break;
+                }
+            }
+        }
+
         // Send the file contents to the browser
-        do
+        startMsec = millis();
+        length = bytesToSend;
+        status = ESP_OK;
+        while (bytesToSend)
         {
             // Read data from the file
-            bytesRead = file.read(buffer, bufferLength);
+            bytesRead = bytesToSend;
+            if (bytesRead > object->_bufferBytes)
+                bytesRead = object->_bufferBytes;
+            bytesRead = file.read(object->_buffer, bytesRead);
+            if (bytesRead == 0)
+            {
+                if (r4aWebServerDebug)
+                    r4aWebServerDebug->printf("ERROR: Failed to read from %s\r\n", path);
+                status = ESP_FAIL;
+                break;
+            }
 
             // Send a partial response
-            if (bytesRead > 0)
-                status = httpd_resp_send_chunk(request, (char *)buffer, bytesRead);
-            else
-                status = httpd_resp_send_chunk(request, NULL, 0);
-
-            // Process the error
+            status = httpd_resp_send_chunk(request, (char *)object->_buffer, bytesRead);
             if (status != ESP_OK)
             {
                 if (r4aWebServerDebug)
                     r4aWebServerDebug->printf("ERROR: Failed to send %d data bytes to browser\r\n", bytesRead);
-                httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send data to browser");
                 break;
             }
-        } while (bytesRead > 0);
-
-        // Free the data buffer
-        r4aFree((void *)buffer, "WebServer data buffer (buffer)");
+            bytesToSend -= bytesRead;
+        }
 
-        // Close the file
-        file.close();
-        return ESP_OK;
+        // Done with the response
+        if (status == ESP_OK)
+            status = httpd_resp_send_chunk(request, NULL, 0);
+
+        // Display the throughput
+        elapsedMsec = millis() - startMsec;
+        if ((status == ESP_OK) && r4aWebServerDebug)
+            r4aWebServerDebug->printf("%s: %u bytes in %lu mSec, %lu KB/s, %lu byte buffer\r\n",
+                                      path,
+                                      length,
+                                      elapsedMsec,
+                                      elapsedMsec ? (uint32_t)(length / elapsedMsec) : 0,
+                                      (uint32_t)object->_bufferBytes);
     } while (0);
 
     // Close the file if necessary
     if (file)
         file.close();
+    return status;
+}
 
-    // Free the data buffer
-    if (buffer)
-        r4aFree((void **)&buffer, "WebServer data buffer (buffer)");
+//*********************************************************************
+// Upload a file from the browser to the robot
+esp_err_t r4aWebServerFileUpload(httpd_req_t *request)
+{
+    int bytesRead;
+    size_t bytesRemaining;
+    uint32_t crc;
+    char crcHeader[16];
+    uint32_t elapsedMsec;
+    uint32_t expectedCrc;
+    File file;
+    char filePath[R4A_WEB_SERVER_PATH_BYTES];
+    R4A_WEB_SERVER * object;
+    bool replaced;
+    char response[64];
+    uint32_t startMsec;
+    esp_err_t status;
+    char tempPath[R4A_WEB_SERVER_PATH_BYTES + 4];
+    int timeouts;
+    bool verifyCrc;
+
+    // Get the web server data structure
+    object = (R4A_WEB_SERVER *)request->user_ctx;
+    status = ESP_FAIL;
+    tempPath[0] = 0;
 
-    // Failed to access the requested page
-    return ESP_FAIL;
+    do
+    {
+        // Verify that the request may change the files
+        if (!r4aWebServerAuthorized(request))
+            break;
+
+        // Get the file name
+        if (!r4aWebServerGetFilePath(request, filePath))
+            break;
+
+        // Don't allow uploads to a directory or outside of the NVM area
+        if ((filePath[strlen(filePath) - 1] == '/') || strstr(filePath, ".."))
+        {
+            if (r4aWebServerDebug)
+                r4aWebServerDebug->printf("ERROR: Invalid upload path %s\r\n", filePath);
+            httpd_resp_send_err(request, HTTPD_400_BAD_REQUEST, "Invalid file path");
+            break;
+        }
+
+        // Get the optional CRC
+        verifyCrc = false;
+        expectedCrc = 0;
+        if (r4aWebServerGetHeader(request, "X-CRC32", crcHeader, sizeof(crcHeader)))
+        {
+            char * end;
+
+            expectedCrc = strtoul(crcHeader, &end, 16);
+            if ((end == crcHeader) || *end)
+            {
+                httpd_resp_send_err(request, HTTPD_400_BAD_REQUEST, "Invalid X-CRC32 value");
+                break;
+            }
+            verifyCrc = true;
+        }
+
+        // Get the data buffer
+        if (!r4aWebServerBufferAllocate(object))
+        {
+            if (r4aWebServerDebug)
+                r4aWebServerDebug->printf("ERROR: Failed to allocate the data buffer\r\n");
+            httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to allocate data buffer");
+            break;
+        }
+
+        // Create the temporary file
+        sprintf(tempPath, "%s.tmp", filePath);
+        file = LittleFS.open(tempPath, FILE_WRITE);
+        if (!file)
+        {
+            if (r4aWebServerDebug)
+                r4aWebServerDebug->printf("ERROR: Failed to create %s\r\n", tempPath);
+            httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create file");
+            tempPath[0] = 0;
+            break;
+        }
+
+        // Copy the request body into the temporary file
+        bytesRemaining = request->content_len;
+        crc = 0;
+        startMsec = millis();
+        timeouts = 0;
+        while (bytesRemaining)
+        {
+            // Receive the next portion of the body
+            bytesRead = httpd_req_recv(request,
+                                       (char *)object->_buffer,
+                                       (bytesRemaining < object->_bufferBytes)
+                                       ? bytesRemaining : object->_bufferBytes);
+            if ((bytesRead == HTTPD_SOCK_ERR_TIMEOUT) && (++timeouts < 3))
+                continue;
+            if (bytesRead <= 0)
+                break;
+            timeouts = 0;
+
+            // Write the data to the file
+            if (file.write(object->_buffer, bytesRead) != (size_t)bytesRead)
+            {
+                if (r4aWebServerDebug)
+                    r4aWebServerDebug->printf("ERROR: Failed to write to %s\r\n", tempPath);
+                break;
+            }
+            crc = esp_rom_crc32_le(crc, object->_buffer, bytesRead);
+            bytesRemaining -= bytesRead;
+        }
+        file.close();
+        elapsedMsec = millis() - startMsec;
+
+        // Verify the upload
+        if (bytesRemaining)
+        {
+            if (r4aWebServerDebug)
+                r4aWebServerDebug->printf("ERROR: Upload of %s failed, %u bytes missing\r\n",
+                                          filePath, bytesRemaining);
+            httpd_resp_send_err(request, HTTPD_400_BAD_REQUEST, "Upload failed");
+            break;
+        }
+        if (verifyCrc && (crc != expectedCrc))
+        {
+            if (r4aWebServerDebug)
+                r4aWebServerDebug->printf("ERROR: %s CRC 0x%08lx, expected 0x%08lx\r\n",
+                                          filePath, crc, expectedCrc);
+            httpd_resp_send_err(request, HTTPD_400_BAD_REQUEST, "CRC mismatch");
+            break;
+        }
+
+        // Replace the file, replacing the parameter file also removes the
+        // binary parameter file and journal of the previous file
+        if (parameterFilePath && (strcmp(filePath, parameterFilePath) == 0))
+            replaced = r4aEsp32NvmReplaceParameterFile(tempPath, filePath, r4aWebServerDebug);
+        else
+            replaced = r4aEsp32NvmReplaceFile(tempPath, filePath, r4aWebServerDebug);
+        if (!replaced)
+        {
+            httpd_resp_send_err(request, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to replace file");
+            break;
+        }
+        tempPath[0] = 0;
+        if (r4aWebServerDebug)
+            r4aWebServerDebug->printf("%s: %u bytes uploaded in %lu mSec, CRC 0x%08lx\r\n",
+                                      filePath, request->content_len, elapsedMsec, crc);
+
+        // Notify the application
+        if (object->_uploadComplete)
+            object->_uploadComplete(object, filePath);
+
+        // Send the response
+        sprintf(response, "%u bytes, CRC 0x%08lx\n", request->content_len, crc);
+        httpd_resp_set_status(request, "201 Created");
+        httpd_resp_set_type(request, "text/plain");
+        status = httpd_resp_send(request, response, HTTPD_RESP_USE_STRLEN);
+    } while (0);
+
+    // Remove the temporary file upon failure
+    if (tempPath[0] && LittleFS.exists(tempPath))
+        LittleFS.remove(tempPath);
+    return status;
 }
 
 //*********************************************************************
@@ -232,6 +801,105 @@ void r4aWebServerInit(uint8_t cameraUser)
     r4aWebServerCameraUser = cameraUser;
 }
 
+//*********************************************************************
+// Measure the file read speed for each download buffer size
+void r4aWebServerMenuBufferSpeed(const R4A_MENU_ENTRY * menuEntry,
+                                 const char * command,
+                                 Print * display)
+{
+    uint8_t * buffer;
+    size_t bufferBytes;
+    size_t bytesRead;
+    size_t bytesToRead;
+    File file;
+    String fileName;
+    String filePath;
+    size_t fileSize;
+    int pass;
+    uint64_t startUsec;
+    uint64_t usec;
+
+    // Build the file path
+    fileName = r4aMenuGetParameters(menuEntry, command);
+    filePath = String("/") + fileName;
+
+    buffer = nullptr;
+    do
+    {
+        // Open the file
+        file = LittleFS.open(filePath.c_str(), FILE_READ);
+        if ((!file) || file.isDirectory())
+        {
+            display->printf("ERROR: Failed to open file %s!\r\n", filePath.c_str());
+            break;
+        }
+        fileSize = file.size();
+        if (fileSize == 0)
+        {
+            display->printf("ERROR: File %s is empty!\r\n", filePath.c_str());
+            break;
+        }
+
+        // Allocate the largest buffer
+        buffer = (uint8_t *)r4aMalloc(R4A_WEB_SERVER_BUFFER_BYTES_MAX,
+                                      "WebServer speed buffer (buffer)");
+        if (!buffer)
+        {
+            display->printf("ERROR: Failed to allocate the data buffer!\r\n");
+            break;
+        }
+
+        // Read the file using each buffer size
+        display->printf("%s: %u bytes, %d passes, current buffer %lu bytes\r\n",
+                        filePath.c_str(),
+                        fileSize,
+                        R4A_WEB_SERVER_SPEED_PASSES,
+                        r4aWebServerBufferBytes);
+        display->printf("    Buffer       MB/s\r\n");
+        for (bufferBytes = R4A_WEB_SERVER_BUFFER_BYTES_MIN;
+             bufferBytes <= R4A_WEB_SERVER_BUFFER_BYTES_MAX;
+             bufferBytes <<= 1)
+        {
+            // Use the same read loop as r4aWebServerFileDownload
+            startUsec = esp_timer_get_time();
+            for (pass = 0; pass < R4A_WEB_SERVER_SPEED_PASSES; pass++)
+            {
+                file.seek(0);
+                bytesToRead = fileSize;
+                while (bytesToRead)
+                {
+                    bytesRead = bytesToRead;
+                    if (bytesRead > bufferBytes)
+                        bytesRead = bufferBytes;
+                    bytesRead = file.read(buffer, bytesRead);
+                    if (bytesRead == 0)
+                        break;
+                    bytesToRead -= bytesRead;
+                }
+                if (bytesToRead)
+                    break;
+            }
+            usec = esp_timer_get_time() - startUsec;
+            if (pass < R4A_WEB_SERVER_SPEED_PASSES)
+            {
+                display->printf("ERROR: Failed to read from %s!\r\n", filePath.c_str());
+                break;
+            }
+
+            // Bytes per microsecond is MB/s
+            display->printf("    %6u %10.2f\r\n",
+                            bufferBytes,
+                            usec ? (double)fileSize * R4A_WEB_SERVER_SPEED_PASSES / usec : 0.);
+        }
+    } while (0);
+
+    // Done with the buffer and file
+    if (buffer)
+        r4aFree(buffer, "WebServer speed buffer (buffer)");
+    if (file)
+        file.close();
+}
+
 //*********************************************************************
 // Start the web server
 bool r4aWebServerStart(R4A_WEB_SERVER * object)
@@ -301,6 +969,14 @@ void r4aWebServerStop(R4A_WEB_SERVER * object)
         httpd_stop(object->_webServer);
         object->_webServer = nullptr;
     }
+
+    // Done with the data buffer
+    if (object->_buffer)
+    {
+        r4aFree(object->_buffer, "WebServer data buffer (_buffer)");
+        object->_buffer = nullptr;
+        object->_bufferBytes = 0;
+    }
 }
 
 //*********************************************************************
@@ -315,3 +991,15 @@ void r4aWebServerUpdate(R4A_WEB_SERVER * object, bool wifiConnected)
     if (object->_webServer && ((!wifiConnected) || (!r4aWebServerEnable)))
         r4aWebServerStop(object);
 }
+
+//*********************************************************************
+// Read the parameters again when the parameter file is replaced
+void r4aWebServerUploadReloadParameters(R4A_WEB_SERVER * object,
+                                        const char * filePath)
+{
+    if (parameterFilePath && (strcmp(filePath, parameterFilePath) == 0))
+        r4aEsp32NvmReadParameters(parameterFilePath,
+                                  nvmParameters,
+                                  nvmParameterCount,
+                                  r4aWebServerDebug);
+}